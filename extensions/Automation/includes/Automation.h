@@ -19,6 +19,113 @@
 #define __AUTOMATION_H__
 
 #include "TimePluginLib.h"
+#include "TTCurve.h"
+#include "TTScoreSnapshot.h"
+
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+#define AUTOMATION_RECORD_BUFFER_SIZE 8192
+
+/**	A single producer / single consumer lock-free ring buffer
+ @details it passes the recorded points from the protocol thread (see AutomationReceiverReturnValueCallback)
+ to the scheduler thread (see Automation::Process) without locking and without allocating memory */
+class AutomationRecordBuffer
+{
+public:
+    
+    /** A recorded value for one index of an address */
+    struct Point
+    {
+        TTFloat64   x;
+        TTUInt32    index;
+        TTFloat64   y;
+    };
+    
+    AutomationRecordBuffer() : mPoints(AUTOMATION_RECORD_BUFFER_SIZE), mWrite(0), mRead(0), mDropped(0) {}
+    
+    /** Push a point (producer side only)
+     @return                NO if the buffer is full and the point have been dropped */
+    TTBoolean push(const Point& aPoint)
+    {
+        TTUInt32 write = mWrite.load(std::memory_order_relaxed);
+        TTUInt32 next = (write + 1) % AUTOMATION_RECORD_BUFFER_SIZE;
+        
+        if (next == mRead.load(std::memory_order_acquire))
+        {
+            mDropped.fetch_add(1, std::memory_order_relaxed);
+            return NO;
+        }
+        
+        mPoints[write] = aPoint;
+        mWrite.store(next, std::memory_order_release);
+        return YES;
+    }
+    
+    /** Pop a point (consumer side only)
+     @return                NO if the buffer is empty */
+    TTBoolean pop(Point& aPoint)
+    {
+        TTUInt32 read = mRead.load(std::memory_order_relaxed);
+        
+        if (read == mWrite.load(std::memory_order_acquire))
+            return NO;
+        
+        aPoint = mPoints[read];
+        mRead.store((read + 1) % AUTOMATION_RECORD_BUFFER_SIZE, std::memory_order_release);
+        return YES;
+    }
+    
+    /** How many points have been dropped because the consumer was too slow since the last call (consumer side only) */
+    TTUInt32 takeDropped() { return mDropped.exchange(0, std::memory_order_relaxed); }
+    
+private:
+    
+    std::vector<Point>          mPoints;
+    std::atomic<TTUInt32>       mWrite;
+    std::atomic<TTUInt32>       mRead;
+    std::atomic<TTUInt32>       mDropped;
+};
+
+/** A shared reference to a record buffer
+ @details the buffer is shared by the record receiver callback and by the compiled tracks so it lives as long as one of them can use it.
+ The reference given to the callback is only accessed with std::atomic_load and std::atomic_store :
+ the callback copies it before to push and it is emptied when the receiver is removed */
+typedef std::shared_ptr<AutomationRecordBuffer> AutomationRecordBufferRef;
+typedef AutomationRecordBufferRef* AutomationRecordBufferRefPtr;
+
+/**	A compiled track gathers all what is needed to process the indexed curves of an address
+ @details tracks are rebuilt by Automation::compileTracks after the curves, senders or record receivers tables change
+ so Automation::Process doesn't need to look up any table */
+struct AutomationTrack
+{
+    TTAddress                   address;                        ///< the address of the curves
+    TTObject                    sender;                         ///< the sender resolved for the address
+    TTValue                     objects;                        ///< the indexed curve objects (they stay alive as long as the track is used)
+    std::vector<TTCurvePtr>     curves;                         ///< the indexed curves (kept alive by objects)
+    TTBoolean                   recording;                      ///< is the address recording ?
+    AutomationRecordBufferRef   recordBuffer;                   ///< the buffer filled by the record receiver (empty if the track is not recording)
+    TTValue                     nextValue;                      ///< the values to send
+    TTValue                     lastValue;                      ///< the last values sent (empty if nothing have been sent)
+    TTFloat64                   lastDate;                       ///< the date of the last sending
+    TTFloat64                   period;                         ///< the minimal time between two sendings for this address (0. means no limit)
+};
+
+/**	A table of compiled tracks
+ @details a new table is compiled each time the curves, senders or record receivers tables change
+ and the thread which processes picks the last compiled table up before to use it (see Automation::pickTracks)
+ so a table is never modified nor deleted while it is processed */
+struct AutomationTrackTable
+{
+    std::vector<AutomationTrack>    tracks;
+    TTUInt32                        serial;                     ///< the number of the compilation which built the table
+    
+    AutomationTrackTable() : serial(0) {}
+};
+
+typedef AutomationTrackTable* AutomationTrackTablePtr;
 
 
 /**	The Automation class allows to ...
@@ -33,7 +140,27 @@ private :
     
     TTHash                      mCurves;						///< a table of freehand function units stored by address
     TTHash                      mSenders;						///< a table of TTSender to send curves
-    TTHash                      mRecordReceivers;               ///< a table of TTReceivers to record curves
+    TTHash                      mRecordReceivers;               ///< a table of TTReceivers and their AutomationRecordBuffer to record curves
+    TTFloat64                   mRecordTolerance;               ///< the maximal error allowed to simplify recorded curves on the fly (TTCURVE_RECORD_TOLERANCE_AUTO for a ratio of the range of each curve)
+    std::atomic<TTUInt32>       mRecordDropped;                 ///< how many received points have been dropped during the last record because the record buffers were full
+    
+    TTFloat64                   mOutputRate;                    ///< the maximal number of messages sent per second for each address (0. means at each scheduler tick)
+    TTBoolean                   mInterpolation;                 ///< is the value sent interpolated between two curve points ?
+    TTFloat64                   mChangeThreshold;               ///< the minimal absolute change needed to send a new value
+    TTFloat64                   mChangeRatio;                   ///< the minimal change relative to the last value sent needed to send a new value (0.01 means 1%)
+    TTHash                      mRateLimits;                    ///< a table of maximal number of messages per second stored by address
+    
+    AutomationTrackTablePtr                 mTracks;            ///< the compiled tracks used by Process (only touched by the thread which processes, see pickTracks)
+    std::atomic<AutomationTrackTablePtr>    mCompiledTracks;    ///< the last compiled tracks
+    std::atomic<AutomationTrackTablePtr>    mUsedTracks;        ///< the compiled tracks picked up by the thread which processes (they can't be deleted)
+    std::vector<AutomationTrackTablePtr>    mRetiredTracks;     ///< the compiled tracks replaced by a newer compilation waiting to be deleted
+    TTUInt32                                mTracksSerial;      ///< the number of compilations
+    std::atomic<TTBoolean>                  mTracksDirty;       ///< have the curves, senders or record receivers tables changed since the last compilation ?
+    std::mutex                              mCompileMutex;      ///< serializes the compilations (ProcessStart can compile from the scheduler thread), Process never locks it
+    
+    std::vector<AutomationRecordBufferRefPtr> mRecordBufferRefs; ///< the buffer references given to the record receivers callbacks (a callback can outlive its receiver so they are deleted with the automation)
+    
+    TTScoreSnapshotPending      mPending;                       ///< the reading of the curves deferred until they are needed (see TTScoreSnapshotReader::setLazy)
    
     TTValue                     mCurrentObjects;                ///< useful for file parsing
     TTFloat64                   mCurrentPosition;            ///< useful for recording
@@ -43,6 +170,11 @@ private :
      @return                kTTErrNone */
 	TTErr   getParameterNames(TTValue& value);
     
+    /** Get how many received points have been dropped during the last record
+     @param	value           the returned number of points
+     @return                kTTErrNone */
+    TTErr   getRecordDropped(TTValue& value);
+    
 
     
     /** Specific compilation method used to pre-processed data in order to accelarate Process method
@@ -50,6 +182,36 @@ private :
      @return                an error code returned by the compile method */
     TTErr   Compile();
     
+    /** Compile a new tracks table from the curves, senders and record receivers tables then publish it
+     @details use invalidateTracks when one of those tables changes */
+    void    compileTracks();
+    
+    /** Mark the tracks as out of date after a change of the curves, senders or record receivers tables
+     @details the tracks are compiled once before to be processed (see updateTracks) so reading N curves doesn't compile them N times.
+     While the process is running they are compiled at once so the change is heard */
+    void    invalidateTracks();
+    
+    /** Compile the tracks if they are out of date
+     @details this is called by Compile, ProcessStart and Goto */
+    void    updateTracks();
+    
+    /** Pick the last compiled tracks up
+     @details this is called by the thread which processes (see Process, ProcessEnd and Goto) before to use the tracks :
+     the table is marked as used then checked again so a compilation never deletes a table while it is processed */
+    void    pickTracks();
+    
+    /** Delete the compiled tracks which have been replaced and which are not used anymore
+     @details this have to be called while the compile mutex is locked */
+    void    deleteRetiredTracks();
+    
+    /** Forget what have been sent by each track
+     @details this is needed before to start or to go to a new date */
+    void    resetTracks();
+    
+    /** Move the points recorded by the receiver of a track into its curves
+     @param track           a recording track */
+    void    drainRecordBuffer(AutomationTrack& track);
+    
     /** Specific process method on start
      @details when this method is called the running state is NO which means event status propagation is disabled
      @return                an error code returned by the process end method */
@@ -94,6 +256,23 @@ private :
 	TTErr	WriteAsText(const TTValue& inputValue, TTValue& outputValue);
 	TTErr	ReadFromText(const TTValue& inputValue, TTValue& outputValue);
     
+    /**  needed to be handled by a TTScoreSnapshotWriter/Reader
+     @param	inputValue      a writer pointer | a reader pointer, the process record
+     @param	outputValue     nothing
+     @return                an error code if the operation fails */
+	TTErr	WriteAsSnapshot(const TTValue& inputValue, TTValue& outputValue);
+	TTErr	ReadFromSnapshot(const TTValue& inputValue, TTValue& outputValue);
+    
+    /** Read the curves of a process record
+     @param aReader         a snapshot reader
+     @param index           the process record
+     @return                an error code if the curve records are not valid */
+    TTErr   readSnapshotCurves(TTScoreSnapshotReader& aReader, TTUInt32 index);
+    
+    /** Read the curves if their reading have been deferred
+     @details this have to be called before any access to the curves */
+    void    loadPending();
+    
     
     
     /** To be notified when an event date changed
@@ -127,6 +306,20 @@ private :
      @return                an error code if the operation fails */
     TTErr   CurveGet(const TTValue& inputValue, TTValue& outputValue);
     
+    /** Get a min/max overview of an indexed curve at an address over a date range
+     @details this avoids to transfer all the curve points to draw it
+     @param inputvalue      address, index, start date, end date, number of columns
+     @param outputvalue     date1 min1 max1 date2 min2 max2 ... for each column
+     @return                an error code if the operation fails */
+    TTErr   CurveOverview(const TTValue& inputValue, TTValue& outputValue);
+    
+    /** Limit the number of messages sent per second to an address
+     @details the output rate attribute limits all the addresses, this limits one address more strictly
+     @param inputvalue      address, maximal number of messages per second (0. to remove the limit)
+     @param outputvalue     nothing
+     @return                an error code if the operation fails */
+    TTErr   CurveRateLimit(const TTValue& inputValue, TTValue& outputValue);
+    
     /** Update a curve at an address (when start or end state has changed)
      @param inputvalue      address
      @param outputvalue     nothing
@@ -149,6 +342,20 @@ private :
      @return                an error code if the operation fails */
     TTErr   CurveRecord(const TTValue& inputValue, TTValue& outputValue);
     
+    /** Import the indexed curves of an address from a sample file (e.g. motion capture data)
+     @details the file is read chunk by chunk and the points are simplified while they are read
+     so files with hundreds of millions of rows can be imported (see TTCurveImport).
+     The curves at the address are replaced (or created for each index of the start state value)
+     and the start and end states are set with the first and the last imported values.
+     @param inputvalue      address, file path, tolerance (the record tolerance by default or a thousandth of the range of each column if it is null),
+                            column of the first curve (1 by default, the next curves take the next columns),
+                            x column (0 by default, -1 to use the row number),
+                            format ("csv", "float32" or "float64", guessed from the file extension by default),
+                            number of columns of a binary file (just enough for the x and the curves columns by default)
+     @param outputvalue     the number of rows imported
+     @return                an error code if the operation fails */
+    TTErr   CurveImport(const TTValue& inputValue, TTValue& outputValue);
+    
     void    addSender(TTAddress anAddress);
     void    removeSender(TTAddress anAddress);
     
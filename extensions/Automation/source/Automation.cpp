@@ -15,6 +15,7 @@
 
 #include "Automation.h"
 #include "TTCurve.h"
+#include <algorithm>
 #include <libxml/encoding.h>
 #include <libxml/xmlwriter.h>
 #include <libxml/xmlreader.h>
@@ -35,18 +36,44 @@ extern "C" TT_EXTENSION_EXPORT TTErr TTLoadJamomaExtension_Automation(void)
 #pragma mark Constructor/Destructor
 #endif
 
-TIME_PROCESS_PLUGIN_CONSTRUCTOR
+TIME_PROCESS_PLUGIN_CONSTRUCTOR,
+mRecordTolerance(TTCURVE_RECORD_TOLERANCE_AUTO),
+mRecordDropped(0),
+mOutputRate(0.),
+mInterpolation(NO),
+mChangeThreshold(0.),
+mChangeRatio(0.),
+mTracks(NULL),
+mCompiledTracks(NULL),
+mUsedTracks(NULL),
+mTracksSerial(0),
+mTracksDirty(NO)
 {
     TIME_PLUGIN_INITIALIZE
+    
+    // start with no track to process
+    mTracks = new AutomationTrackTable();
+    mCompiledTracks.store(mTracks);
+    mUsedTracks.store(mTracks);
 
     registerAttribute(TTSymbol("curveAddresses"), kTypeLocalValue, NULL, (TTGetterMethod)& Automation::getCurveAddresses);
+    registerAttribute(TTSymbol("recordDropped"), kTypeUInt32, NULL, (TTGetterMethod)& Automation::getRecordDropped);
+    
+    addAttribute(RecordTolerance, kTypeFloat64);
+    addAttribute(OutputRate, kTypeFloat64);
+    addAttribute(Interpolation, kTypeBoolean);
+    addAttribute(ChangeThreshold, kTypeFloat64);
+    addAttribute(ChangeRatio, kTypeFloat64);
     
     addMessageWithArguments(CurveAdd);
     addMessageWithArguments(CurveGet);
+    addMessageWithArguments(CurveOverview);
+    addMessageWithArguments(CurveRateLimit);
     addMessageWithArguments(CurveUpdate);
     addMessageWithArguments(CurveRemove);
     addMessage(Clear);
     addMessageWithArguments(CurveRecord);
+    addMessageWithArguments(CurveImport);
     
     mScheduler.set("granularity", TTFloat64(1.));
 }
@@ -54,6 +81,20 @@ TIME_PROCESS_PLUGIN_CONSTRUCTOR
 Automation::~Automation()
 {
     Clear();
+    
+    // nothing is processed anymore
+    delete mCompiledTracks.exchange(NULL);
+    
+    for (TTUInt32 i = 0; i < mRetiredTracks.size(); i++)
+        delete mRetiredTracks[i];
+    
+    mRetiredTracks.clear();
+    
+    // all the record receivers and their callbacks have been released by Clear
+    for (TTUInt32 i = 0; i < mRecordBufferRefs.size(); i++)
+        delete mRecordBufferRefs[i];
+    
+    mRecordBufferRefs.clear();
 }
 
 #if 0
@@ -69,6 +110,13 @@ TTErr Automation::getParameterNames(TTValue& value)
 	return kTTErrNone;
 }
 
+TTErr Automation::getRecordDropped(TTValue& value)
+{
+    value = TTUInt32(mRecordDropped.load());
+    
+    return kTTErrNone;
+}
+
 #if 0
 #pragma mark -
 #pragma mark TTTimeProcess Methods
@@ -76,6 +124,8 @@ TTErr Automation::getParameterNames(TTValue& value)
 
 TTErr Automation::Compile()
 {
+    loadPending();
+    
     TTValue     duration, keys, objects, none;
     TTSymbol    key;
     TTObject    curve;
@@ -100,20 +150,161 @@ TTErr Automation::Compile()
         }
     }
     
+    // prepare the tracks to process
+    updateTracks();
+    
     // compilation done
     mCompiled = YES;
     
     return kTTErrNone;
 }
 
+void Automation::compileTracks()
+{
+    AutomationTrackTablePtr table = new AutomationTrackTable();
+    TTValue                 keys, objects, v;
+    TTSymbol                key;
+    TTObject                curve;
+    TTUInt32                i, j;
+    
+    std::lock_guard<std::mutex> lock(mCompileMutex);
+    
+    table->serial = ++mTracksSerial;
+    mTracksDirty = NO;
+    
+    mCurves.getKeys(keys);
+    table->tracks.resize(keys.size());
+    
+    for (i = 0; i < keys.size(); i++)
+    {
+        AutomationTrack& track = table->tracks[i];
+        
+        key = keys[i];
+        mCurves.lookup(key, objects);
+        
+        track.address = key;
+        track.objects = objects;
+        
+        // resolve the sender once
+        if (!mSenders.lookup(key, v))
+            track.sender = v[0];
+        
+        // a curve with a receiver is recording
+        track.recording = !mRecordReceivers.lookup(key, v);
+        track.recordBuffer = track.recording ? std::atomic_load(AutomationRecordBufferRefPtr(TTPtr(v[1]))) : AutomationRecordBufferRef();
+        
+        // keep a direct access to each indexed curve
+        track.curves.resize(objects.size());
+        for (j = 0; j < objects.size(); j++)
+        {
+            curve = objects[j];
+            track.curves[j] = TTCurvePtr(curve.instance());
+        }
+        
+        // prepare the sending buffer
+        track.nextValue.resize(objects.size());
+        
+        // limit the sending rate to the address
+        track.period = 0.;
+        if (!mRateLimits.lookup(key, v))
+        {
+            TTFloat64 rate = v[0];
+            if (rate > 0.)
+                track.period = 1000. / rate;
+        }
+        
+        track.lastValue.clear();
+        track.lastDate = 0.;
+    }
+    
+    // publish the new table : the previous one is deleted once it is not processed anymore
+    mRetiredTracks.push_back(mCompiledTracks.exchange(table));
+    deleteRetiredTracks();
+}
+
+void Automation::invalidateTracks()
+{
+    mTracksDirty = YES;
+    
+    // an edition made while the process is running is heard at once
+    if (mRunning)
+        compileTracks();
+}
+
+void Automation::updateTracks()
+{
+    if (mTracksDirty)
+        compileTracks();
+}
+
+void Automation::pickTracks()
+{
+    AutomationTrackTablePtr table;
+    
+    // if a new table is published meanwhile the one marked as used could have been deleted : check again
+    do {
+        table = mCompiledTracks.load();
+        mUsedTracks.store(table);
+    } while (table != mCompiledTracks.load());
+    
+    mTracks = table;
+}
+
+void Automation::deleteRetiredTracks()
+{
+    AutomationTrackTablePtr used = mUsedTracks.load();
+    TTUInt32                i = 0;
+    
+    while (i < mRetiredTracks.size())
+    {
+        if (mRetiredTracks[i] != used)
+        {
+            delete mRetiredTracks[i];
+            mRetiredTracks[i] = mRetiredTracks.back();
+            mRetiredTracks.pop_back();
+        }
+        else
+            i++;
+    }
+}
+
+void Automation::resetTracks()
+{
+    for (TTUInt32 i = 0; i < mTracks->tracks.size(); i++)
+    {
+        mTracks->tracks[i].lastValue.clear();
+        mTracks->tracks[i].lastDate = 0.;
+    }
+}
+
+void Automation::drainRecordBuffer(AutomationTrack& track)
+{
+    AutomationRecordBuffer::Point aPoint;
+    
+    if (!track.recordBuffer)
+        return;
+    
+    while (track.recordBuffer->pop(aPoint))
+    {
+        if (aPoint.index < track.curves.size())
+            track.curves[aPoint.index]->record(aPoint.x, aPoint.y, mRecordTolerance);
+    }
+    
+    mRecordDropped += track.recordBuffer->takeDropped();
+}
+
 TTErr Automation::ProcessStart()
 {
+    loadPending();
+    
     TTValue     v, keys, objects, vStart, none;
     TTSymbol    key;
     TTObject    curve;
     TTObject    aReceiver;
     TTUInt32    i, j;
     
+    mRecordDropped = 0;
+    
     // set curves on the first sample and prepare new curves to record the address value
     mCurves.getKeys(keys);
     
@@ -168,7 +359,7 @@ TTErr Automation::ProcessStart()
                     curve = TTObject("Curve");
                     
                     // store the first point
-                    TTCurvePtr(curve.instance())->append(TTValue(0., vStart[j]));
+                    TTCurvePtr(curve.instance())->recordStart(0., TTFloat64(vStart[j]));
                     
                     // index the curve
                     objects[j] = curve;
@@ -177,9 +368,15 @@ TTErr Automation::ProcessStart()
                 // register all the curves for this address
                 mCurves.append(key, objects);
             }
+            
+            // recording curves have been replaced
+            mTracksDirty = YES;
         }
     }
     
+    // compile the tracks once for all the curves read or edited since the last start
+    updateTracks();
+    
     return kTTErrNone;
 }
 
@@ -192,6 +389,32 @@ TTErr Automation::ProcessEnd()
     TTUInt32    i, j;
     TTBoolean   change = NO;
     
+    // the curves replaced by ProcessStart may not have been processed yet
+    pickTracks();
+    
+    std::vector<AutomationTrack>& tracks = mTracks->tracks;
+    
+    // store the points still pending in each recording curves
+    for (i = 0; i < tracks.size(); i++)
+    {
+        if (tracks[i].recording)
+        {
+            drainRecordBuffer(tracks[i]);
+            
+            for (j = 0; j < tracks[i].curves.size(); j++)
+                tracks[i].curves[j]->recordEnd();
+        }
+    }
+    
+    if (mRecordDropped.load() > 0)
+        TTLogMessage("Automation::ProcessEnd %s : %u received points have been dropped during the record (see recordDropped)\n", mName.c_str(), TTUInt32(mRecordDropped.load()));
+    
+    // the tracks replaced while running and the buffers of the removed receivers are not needed anymore
+    {
+        std::lock_guard<std::mutex> lock(mCompileMutex);
+        deleteRetiredTracks();
+    }
+    
     // edit last point of each recording curves
     mRecordReceivers.getKeys(keys);
     for (i = 0; i < keys.size(); i++) {
@@ -244,44 +467,55 @@ TTErr Automation::Process(const TTValue& inputValue, TTValue& outputValue)
     TTFloat64 position = inputValue[0];
     TTFloat64 date = inputValue[1];
     
-    TTFloat64       sample;
-    TTValue         v, keys, objects, valueToSend, none;
-    TTSymbol        key;
-    TTAddress       address;
-    TTObject 		curve, sender;
+    TTFloat64       sample, period, globalPeriod, last, threshold;
+    TTValue         none;
     TTUInt32        i, j;
-    TTBoolean       redundancy;
+    TTBoolean       redundancy, changed;
 	TTErr			err;
     
     // store current position for recording
     mCurrentPosition = position;
     
+    // use the last compiled tracks
+    pickTracks();
+    
+    std::vector<AutomationTrack>& tracks = mTracks->tracks;
+    
     // don't process for 0. or 1. to not send the same value twice
     if (position == 0. || position == 1.)
         return kTTErrGeneric;
     
+    // the output rate limits the sendings to all the addresses
+    globalPeriod = mOutputRate > 0. ? 1000. / mOutputRate : 0.;
+    
     // calculate the curves
-    mCurves.getKeys(keys);
-    for (i = 0; i < keys.size(); i++) {
-        
-        key = keys[i];
+    for (i = 0; i < tracks.size(); i++)
+    {
+        AutomationTrack& track = tracks[i];
         
         // a curve is processed only if it is not recording
-        if (!mRecordReceivers.lookup(key, objects))
+        if (track.recording)
+        {
+            // store the points recorded since the last tick
+            drainRecordBuffer(track);
             continue;
+        }
         
-        mCurves.lookup(key, objects);
+        // don't send more often than allowed
+        period = globalPeriod > track.period ? globalPeriod : track.period;
+        
+        if (period > 0. && track.lastValue.size() && date - track.lastDate < period)
+            continue;
         
         // process each indexed curve to fill the value to send
-        valueToSend.clear();
-        valueToSend.resize(objects.size());
         err = kTTErrNone;
         redundancy = YES;
-        for (j = 0; j < objects.size(); j++) {
-            
-            curve = objects[j];
-            
-            err = TTCurveNextSampleAt(TTCurvePtr(curve.instance()), position, sample);
+        for (j = 0; j < track.curves.size(); j++)
+        {
+            if (mInterpolation)
+                err = TTCurveInterpolatedSampleAt(track.curves[j], position, sample);
+            else
+                err = TTCurveNextSampleAt(track.curves[j], position, sample);
             
             // if no value
             if (err == kTTErrValueNotFound)
@@ -289,19 +523,38 @@ TTErr Automation::Process(const TTValue& inputValue, TTValue& outputValue)
             
             redundancy &= err == kTTErrGeneric;
             
-            valueToSend[j] = sample;
+            track.nextValue[j] = sample;
         }
         
         // if no value
-        if (err == kTTErrValueNotFound || redundancy)
+        if (err == kTTErrValueNotFound || (redundancy && !mInterpolation))
             continue;
         
-        // look for the sender at the address
-        if (!mSenders.lookup(key, objects)) {
+        // send only if one of the values changes enough
+        if (track.lastValue.size() == track.nextValue.size())
+        {
+            changed = NO;
+            for (j = 0; j < track.nextValue.size() && !changed; j++)
+            {
+                last = track.lastValue[j];
+                threshold = mChangeRatio * fabs(last);
+                
+                if (threshold < mChangeThreshold)
+                    threshold = mChangeThreshold;
+                
+                changed = fabs(TTFloat64(track.nextValue[j]) - last) > threshold;
+            }
             
-            sender = objects[0];
-            sender.send(kTTSym_Send, valueToSend, none);
+            if (!changed)
+                continue;
         }
+        
+        // send the value
+        if (track.sender.valid())
+            track.sender.send(kTTSym_Send, track.nextValue, none);
+        
+        track.lastValue = track.nextValue;
+        track.lastDate = date;
     }
     
     return kTTErrNone;
@@ -315,14 +568,17 @@ TTErr Automation::ProcessPaused(const TTValue& inputValue, TTValue& outputValue)
 
 TTErr Automation::Goto(const TTValue& inputValue, TTValue& outputValue)
 {
+    loadPending();
+    
     TTUInt32        duration, timeOffset;
     TTFloat64       position, date;
-    TTValue         v, keys, objects, none;
-    TTSymbol        key;
-    TTObject		curve;
+    TTValue         v, none;
     TTUInt32        i, j;
     TTBoolean       mute = NO;
     
+    // the curves read or edited since the last compilation have to be processed
+    updateTracks();
+    
     if (inputValue.size() >= 1) {
         
         if (inputValue[0].type() == kTypeUInt32) {
@@ -354,22 +610,17 @@ TTErr Automation::Goto(const TTValue& inputValue, TTValue& outputValue)
                 mScheduler.get("date", v);
                 date = TTFloat64(v[0]);
                 
+                // use the last compiled tracks
+                pickTracks();
+                
                 // DEBUG : to see if it is faster without this part
                 // reset each curves on its first sample
-                mCurves.getKeys(keys);
+                for (i = 0; i < mTracks->tracks.size(); i++)
+                    for (j = 0; j < mTracks->tracks[i].curves.size(); j++)
+                        mTracks->tracks[i].curves[j]->begin();
                 
-                for (i = 0; i < keys.size(); i++) {
-                    
-                    key = keys[i];
-                    mCurves.lookup(key, objects);
-                    
-                    for (j = 0; j < objects.size(); j++) {
-                        
-                        curve = objects[j];
-                        
-                        TTCurvePtr(curve.instance())->begin();
-                    }
-                }
+                // forget what have been sent before
+                resetTracks();
                 
                 v = position;
                 v.append(date);
@@ -386,6 +637,8 @@ TTErr Automation::Goto(const TTValue& inputValue, TTValue& outputValue)
 
 TTErr Automation::WriteAsXml(const TTValue& inputValue, TTValue& outputValue)
 {
+    loadPending();
+    
     TTObject o = inputValue[0];
 	TTXmlHandlerPtr aXmlHandler = (TTXmlHandlerPtr)o.instance();
     if (!aXmlHandler)
@@ -453,6 +706,10 @@ TTErr Automation::ReadFromXml(const TTValue& inputValue, TTValue& outputValue)
                         
                         // add a sender
                         addSender(address);
+                        
+                        // the last compilation is not valid
+                        invalidateTracks();
+                        mCompiled = NO;
                         return kTTErrNone;
                     }
                 }
@@ -474,8 +731,14 @@ TTErr Automation::ReadFromXml(const TTValue& inputValue, TTValue& outputValue)
         err = aXmlHandler->sendMessage(kTTSym_Read);
         
         // Sample the curve to be ready to process it
-        if (!err)
-            curve.send("Sample", duration, v);
+        // (during a load all the curves are sampled together, see in TTCurveSampler)
+        if (!err) {
+            
+            if (TTCurveSampler::current())
+                TTCurveSampler::current()->add(TTCurvePtr(curve.instance()), TTUInt32(duration[0]));
+            else
+                curve.send("Sample", duration, v);
+        }
         
         return err;
     }
@@ -507,6 +770,123 @@ TTErr Automation::ReadFromText(const TTValue& inputValue, TTValue& outputValue)
 	return kTTErrGeneric;
 }
 
+TTErr Automation::WriteAsSnapshot(const TTValue& inputValue, TTValue& outputValue)
+{
+    if (inputValue.size() != 2 || inputValue[0].type() != kTypePointer)
+        return kTTErrGeneric;
+    
+    TTScoreSnapshotWriterPtr    aWriter = TTScoreSnapshotWriterPtr(TTPtr(inputValue[0]));
+    TTUInt32                    index = inputValue[1];
+    TTUInt32                    curveFirst = aWriter->size(kTTScoreSnapshotCurves);
+    TTValue                     v, keys, out;
+    TTSymbol                    key;
+    TTUInt32                    i, j, address;
+    
+    loadPending();
+    
+    // write the indexed curves of each address one after the other
+    mCurves.getKeys(keys);
+    for (i = 0; i < keys.size(); i++) {
+        
+        key = keys[i];
+        mCurves.lookup(key, v);
+        
+        address = aWriter->addSymbol(key);
+        
+        for (j = 0; j < v.size(); j++) {
+            
+            TTObject curve = v[j];
+            
+            if (!curve.send("WriteAsSnapshot", TTPtr(aWriter), out))
+                aWriter->at<TTScoreSnapshotCurve>(kTTScoreSnapshotCurves, out[0]).address = address;
+        }
+    }
+    
+    TTScoreSnapshotProcess& record = aWriter->at<TTScoreSnapshotProcess>(kTTScoreSnapshotProcesses, index);
+    record.curveFirst = curveFirst;
+    record.curveCount = aWriter->size(kTTScoreSnapshotCurves) - curveFirst;
+    
+	return kTTErrNone;
+}
+
+TTErr Automation::ReadFromSnapshot(const TTValue& inputValue, TTValue& outputValue)
+{
+    if (inputValue.size() != 2 || inputValue[0].type() != kTypePointer)
+        return kTTErrGeneric;
+    
+    TTScoreSnapshotReaderPtr    aReader = TTScoreSnapshotReaderPtr(TTPtr(inputValue[0]));
+    TTUInt32                    index = inputValue[1];
+    
+    if (!aReader->contains(kTTScoreSnapshotProcesses, index, 1))
+        return kTTErrGeneric;
+    
+    // the curves will be read on first access
+    if (mPending.defer(*aReader, index))
+        return kTTErrNone;
+    
+    return readSnapshotCurves(*aReader, index);
+}
+
+void Automation::loadPending()
+{
+    std::shared_ptr<TTScoreSnapshotReader>  aReader;
+    TTUInt32                                index;
+    
+    if (mPending.take(aReader, index))
+        readSnapshotCurves(*aReader, index);
+}
+
+TTErr Automation::readSnapshotCurves(TTScoreSnapshotReader& aReader, TTUInt32 index)
+{
+    TTValue v, duration;
+    
+    const TTScoreSnapshotProcess& record = aReader.records<TTScoreSnapshotProcess>(kTTScoreSnapshotProcesses)[index];
+    
+    if (record.curveCount == 0)
+        return kTTErrNone;
+    
+    if (!aReader.contains(kTTScoreSnapshotCurves, record.curveFirst, record.curveCount))
+        return kTTErrGeneric;
+    
+    const TTScoreSnapshotCurve* curves = aReader.records<TTScoreSnapshotCurve>(kTTScoreSnapshotCurves) + record.curveFirst;
+    
+    // get the current duration
+    getAttributeValue(kTTSym_duration, duration);
+    
+    // the curves of an address are consecutive
+    mCurrentObjects.clear();
+    for (TTUInt32 i = 0; i < record.curveCount; i++) {
+        
+        TTObject curve("Curve");
+        
+        if (!curve.send("ReadFromSnapshot", TTValue(TTPtr(&aReader), record.curveFirst + i), v)) {
+            
+            // the curve is already sampled unless its duration changed
+            if (TTCurveSampler::current())
+                TTCurveSampler::current()->add(TTCurvePtr(curve.instance()), TTUInt32(duration[0]));
+            else
+                curve.send("Sample", duration, v);
+            mCurrentObjects.append(curve);
+        }
+        
+        if (i + 1 == record.curveCount || curves[i + 1].address != curves[i].address) {
+            
+            TTAddress address = aReader.symbol(curves[i].address);
+            
+            mCurves.append(address, mCurrentObjects);
+            addSender(address);
+            
+            mCurrentObjects.clear();
+        }
+    }
+    
+    // the last compilation is not valid
+    invalidateTracks();
+    mCompiled = NO;
+    
+	return kTTErrNone;
+}
+
 #if 0
 #pragma mark -
 #pragma mark Notifications
@@ -556,11 +936,15 @@ TTErr Automation::EventConditionChanged(const TTValue& inputValue, TTValue& outp
 
 TTErr Automation::getCurveAddresses(TTValue& value)
 {
+    loadPending();
+    
     return mCurves.getKeys(value);
 }
 
 TTErr Automation::CurveAdd(const TTValue& inputValue, TTValue& outputValue)
 {
+    loadPending();
+    
     TTValue     v, vStart, vEnd, parameters, objects, none;
     TTAddress   address;
     TTObject    curve, sender;
@@ -639,6 +1023,7 @@ TTErr Automation::CurveAdd(const TTValue& inputValue, TTValue& outputValue)
                 addSender(address);
                 
                 // the last compilation is not valid
+                invalidateTracks();
                 mCompiled = NO;
             }
         }
@@ -649,6 +1034,8 @@ TTErr Automation::CurveAdd(const TTValue& inputValue, TTValue& outputValue)
 
 TTErr Automation::CurveGet(const TTValue& inputValue, TTValue& outputValue)
 {
+    loadPending();
+    
     TTAddress  address;
     
     if (inputValue.size() == 1)
@@ -667,8 +1054,96 @@ TTErr Automation::CurveGet(const TTValue& inputValue, TTValue& outputValue)
     return kTTErrGeneric;
 }
 
+TTErr Automation::CurveOverview(const TTValue& inputValue, TTValue& outputValue)
+{
+    loadPending();
+    
+    TTValue     v, objects, args;
+    TTAddress   address;
+    TTObject    curve;
+    TTUInt32    index, startDate, endDate, columns, duration, i;
+    TTErr       err;
+    
+    if (inputValue.size() == 5)
+    {
+        if (inputValue[0].type() == kTypeSymbol &&
+            inputValue[1].type() == kTypeUInt32 &&
+            inputValue[2].type() == kTypeUInt32 &&
+            inputValue[3].type() == kTypeUInt32 &&
+            inputValue[4].type() == kTypeUInt32)
+        {
+            address = inputValue[0];
+            index = inputValue[1];
+            startDate = inputValue[2];
+            endDate = inputValue[3];
+            columns = inputValue[4];
+            
+            // if there is a curve at the address
+            if (!mCurves.lookup(address, objects))
+            {
+                if (index >= objects.size())
+                    return kTTErrGeneric;
+                
+                getAttributeValue(kTTSym_duration, v);
+                duration = v[0];
+                
+                if (duration == 0)
+                    return kTTErrGeneric;
+                
+                // convert the date range into a position range
+                args = TTFloat64(startDate) / TTFloat64(duration);
+                args.append(TTFloat64(endDate) / TTFloat64(duration));
+                args.append(columns);
+                
+                curve = objects[index];
+                err = curve.send("Overview", args, outputValue);
+                
+                // convert each column position back into a date
+                if (!err)
+                    for (i = 0; i < outputValue.size(); i = i+3)
+                        outputValue[i] = TTUInt32(TTFloat64(outputValue[i]) * duration);
+                
+                return err;
+            }
+        }
+    }
+    
+    return kTTErrGeneric;
+}
+
+TTErr Automation::CurveRateLimit(const TTValue& inputValue, TTValue& outputValue)
+{
+    TTAddress   address;
+    TTFloat64   rate;
+    TTValue     v;
+    
+    if (inputValue.size() == 2)
+    {
+        if (inputValue[0].type() == kTypeSymbol && (inputValue[1].type() == kTypeFloat64 || inputValue[1].type() == kTypeUInt32 || inputValue[1].type() == kTypeInt32))
+        {
+            address = inputValue[0];
+            rate = inputValue[1];
+            
+            if (!mRateLimits.lookup(address, v))
+                mRateLimits.remove(address);
+            
+            if (rate > 0.)
+                mRateLimits.append(address, rate);
+            
+            // the tracks need to know the new limit
+            invalidateTracks();
+            
+            return kTTErrNone;
+        }
+    }
+    
+    return kTTErrGeneric;
+}
+
 TTErr Automation::CurveUpdate(const TTValue& inputValue, TTValue& outputValue)
 {
+    loadPending();
+    
     TTValue     v, vStart, vEnd, parameters, objects, none;
     TTAddress   address;
     TTObject    curve;
@@ -764,6 +1239,8 @@ TTErr Automation::CurveUpdate(const TTValue& inputValue, TTValue& outputValue)
 
 TTErr Automation::CurveRemove(const TTValue& inputValue, TTValue& outputValue)
 {
+    loadPending();
+    
     TTValue     v, objects;
     TTAddress   address;
     TTObject    curve;
@@ -786,6 +1263,10 @@ TTErr Automation::CurveRemove(const TTValue& inputValue, TTValue& outputValue)
                 // remove receiver
                 removeRecordReceiver(address);
                 
+                // the last compilation is not valid
+                invalidateTracks();
+                mCompiled = NO;
+                
                 return kTTErrNone;
             }
         }
@@ -796,6 +1277,9 @@ TTErr Automation::CurveRemove(const TTValue& inputValue, TTValue& outputValue)
 
 TTErr Automation::Clear()
 {
+    // a deferred reading is useless now
+    mPending.clear();
+    
     TTValue         keys,objects;
     TTSymbol        key;
     TTUInt32        i;
@@ -815,11 +1299,16 @@ TTErr Automation::Clear()
     
     mCurves.clear();
     
+    // publish an empty table
+    compileTracks();
+    
     return kTTErrNone;
 }
 
 TTErr Automation::CurveRecord(const TTValue& inputValue, TTValue& outputValue)
 {
+    loadPending();
+    
     TTValue   v, objects, out;
     TTAddress address;
     TTBoolean record;
@@ -854,6 +1343,9 @@ TTErr Automation::CurveRecord(const TTValue& inputValue, TTValue& outputValue)
             else
                 removeRecordReceiver(address);
             
+            // the recording state of the track have changed
+            invalidateTracks();
+            
             return kTTErrNone;
         }
     }
@@ -861,6 +1353,116 @@ TTErr Automation::CurveRecord(const TTValue& inputValue, TTValue& outputValue)
     return kTTErrGeneric;
 }
 
+TTErr Automation::CurveImport(const TTValue& inputValue, TTValue& outputValue)
+{
+    loadPending();
+    
+    TTValue                 v, objects, vStart, vEnd, out;
+    TTAddress               address;
+    TTSymbol                path, format;
+    TTFloat64               tolerance = mRecordTolerance > 0. ? mRecordTolerance : TTCURVE_IMPORT_TOLERANCE_AUTO;
+    TTUInt32                firstColumn = 1, columns = 0, count, i, column;
+    TTInt32                 xColumn = 0;
+    TTUInt64                rows;
+    TTObject                curve;
+    TTCurveSampleFile       aFile;
+    std::vector<TTCurvePtr> curves;
+    
+    if (inputValue.size() < 2 || inputValue[0].type() != kTypeSymbol || inputValue[1].type() != kTypeSymbol)
+        return kTTErrGeneric;
+    
+    address = inputValue[0];
+    path = inputValue[1];
+    format = TTCurveSampleFile::format(path.c_str());
+    
+    if (inputValue.size() > 2)
+        tolerance = inputValue[2];
+    
+    if (inputValue.size() > 3)
+        firstColumn = inputValue[3];
+    
+    if (inputValue.size() > 4)
+        xColumn = inputValue[4];
+    
+    if (inputValue.size() > 5 && inputValue[5].type() == kTypeSymbol)
+        format = inputValue[5];
+    
+    if (inputValue.size() > 6)
+        columns = inputValue[6];
+    
+    // import as many indexed curves as there are at the address (or as the start state value size)
+    if (!mCurves.lookup(address, objects))
+        count = objects.size();
+    else
+        count = getStartEvent().send("StateAddressGetValue", address).size();
+    
+    if (count == 0)
+        count = 1;
+    
+    // a binary file needs at least the x column and the columns of the curves
+    if (columns == 0)
+    {
+        column = firstColumn;
+        
+        for (i = 0; i < count; i++, column++)
+            if (TTInt32(column) == xColumn)
+                column++;
+        
+        columns = std::max(TTInt32(column), xColumn + 1);
+    }
+    
+    // the new curves replace the current ones only once the import succeeded
+    objects.resize(count);
+    
+    for (i = 0; i < count; i++)
+    {
+        curve = TTObject("Curve");
+        curves.push_back(TTCurvePtr(curve.instance()));
+        objects[i] = curve;
+    }
+    
+    if (aFile.open(path.c_str(), format, columns))
+        return kTTErrGeneric;
+    
+    if (TTCurveImport(curves, aFile, xColumn, firstColumn, tolerance, rows))
+        return kTTErrGeneric;
+    
+    // update the start and the end states with the first and the last imported values
+    for (i = 0; i < count; i++)
+    {
+        curve = objects[i];
+        
+        curve.send("ValueAt", TTFloat64(0.), out);
+        vStart.append(TTFloat64(out[0]));
+        
+        curve.send("ValueAt", TTFloat64(1.), out);
+        vEnd.append(TTFloat64(out[0]));
+    }
+    
+    v = address;
+    v.append(TTPtr(&vStart));
+    getStartEvent().send("StateAddressSetValue", v);
+    
+    v = address;
+    v.append(TTPtr(&vEnd));
+    getEndEvent().send("StateAddressSetValue", v);
+    
+    // register all the curves for this address
+    mCurves.remove(address);
+    mCurves.append(address, objects);
+    
+    // add a sender for the curves
+    addSender(address);
+    
+    // the last compilation is not valid
+    invalidateTracks();
+    mCompiled = NO;
+    
+    outputValue = rows;
+    
+    return kTTErrNone;
+}
+
 void Automation::addSender(TTAddress anAddress)
 {
     TTObject    aSender;
@@ -893,8 +1495,9 @@ void Automation::removeSender(TTAddress anAddress)
 
 void Automation::addRecordReceiver(TTAddress anAddress)
 {
-    TTObject    aReceiver, aReceiverCallback, empty, thisObject(this);
-    TTValue     args, baton, none;
+    TTObject                    aReceiver, aReceiverCallback, empty, thisObject(this);
+    TTValue                     args, baton, v, none;
+    AutomationRecordBufferRefPtr aBuffer;
     
     // if there is no receiver for the address
     if (mRecordReceivers.lookup(anAddress, none))
@@ -902,10 +1505,16 @@ void Automation::addRecordReceiver(TTAddress anAddress)
         // No callback for the address
         args = empty;
         
+        // Create a buffer to pass the received values to the scheduler thread
+        // (the callback holds its own reference, the compiled tracks will share the buffer)
+        aBuffer = new AutomationRecordBufferRef(new AutomationRecordBuffer());
+        mRecordBufferRefs.push_back(aBuffer);
+        
         // Create a receiver callback to get the expression address value back
         aReceiverCallback = TTObject("callback");
         
         baton = TTValue(thisObject, anAddress);
+        baton.append(TTPtr(aBuffer));
         aReceiverCallback.set(kTTSym_baton, baton);
         aReceiverCallback.set(kTTSym_function, TTPtr(&AutomationReceiverReturnValueCallback));
         
@@ -916,7 +1525,9 @@ void Automation::addRecordReceiver(TTAddress anAddress)
         // set the address of the receiver
         aReceiver.set(kTTSym_address, anAddress);
         
-        mRecordReceivers.append(anAddress, aReceiver);
+        v = aReceiver;
+        v.append(TTPtr(aBuffer));
+        mRecordReceivers.append(anAddress, v);
     }
 }
 
@@ -930,6 +1541,10 @@ void Automation::removeRecordReceiver(TTAddress anAddress)
         aReceiver.set(kTTSym_address, kTTAdrsEmpty);
         
         mRecordReceivers.remove(anAddress);
+        
+        // a callback can still be running : it keeps its copy of the buffer and the next ones find an empty reference
+        // (the buffer is deleted with the last copy, see ProcessEnd and Clear for the copies held by the tracks)
+        std::atomic_store(AutomationRecordBufferRefPtr(TTPtr(v[1])), AutomationRecordBufferRef());
     }
 }
 
@@ -949,37 +1564,37 @@ TTValue Automation::queryValue(TTAddress anAddress)
 
 TTErr AutomationReceiverReturnValueCallback(const TTValue& baton, const TTValue& data)
 {
-    TTObject        o;
-    AutomationPtr   anAutomation;
-    TTAddress       anAddress;
-    TTObject        curve;
-    TTValue         v, objects;
+    TTObject                    o;
+    AutomationPtr               anAutomation;
+    AutomationRecordBufferRef   aBuffer;
+    AutomationRecordBuffer::Point aPoint;
     
-    // unpack baton (automation, address)
+    // unpack baton (automation, address, buffer reference)
     o = baton[0];
     anAutomation = (AutomationPtr)o.instance();
-    anAddress = baton[1];
+    
+    // own the buffer while pushing : the reference is emptied when the receiver is removed (see Automation::removeRecordReceiver)
+    aBuffer = std::atomic_load(AutomationRecordBufferRefPtr(TTPtr(baton[2])));
+    
+    if (!aBuffer)
+        return kTTErrNone;
     
     // if the automation is running
-    if (anAutomation->mRunning) {
+    // (and don't process when position is equal to 0. or 1.)
+    if (anAutomation->mRunning && anAutomation->mCurrentPosition != 0. && anAutomation->mCurrentPosition != 1.) {
         
-        // don't process when position is equal to 0. or 1.
-        if (anAutomation->mCurrentPosition == 0. || anAutomation->mCurrentPosition == 1.)
-            return kTTErrNone;
+        // this is called from the protocol thread : the points are only pushed into the buffer
+        // and the scheduler thread will store them into the curves (see in Automation::Process)
+        aPoint.x = anAutomation->mCurrentPosition;
         
-        // for each event's expression matching the incoming address
-        if (!anAutomation->mCurves.lookup(anAddress, objects)) {
+        // for each index
+        for (TTUInt32 i = 0; i < data.size(); i++) {
             
-            // for each indexed curves
-            for (TTUInt32 i = 0; i < objects.size(); i++) {
-                
-                curve = objects[i];
-                
-                // store the next point
-                TTCurvePtr(curve.instance())->append(TTValue(anAutomation->mCurrentPosition, TTFloat64(data[i])));
-            }
+            aPoint.index = i;
+            aPoint.y = TTFloat64(data[i]);
+            aBuffer->push(aPoint);
         }
     }
     
     return kTTErrNone;
-}
\ No newline at end of file
+}
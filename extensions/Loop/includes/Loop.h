@@ -19,6 +19,7 @@
 #define __LOOP_H__
 
 #include "TimePluginLib.h"
+#include "TTScoreSnapshot.h"
 
 #include <libxml/encoding.h>
 #include <libxml/xmlwriter.h>
@@ -42,6 +43,7 @@ private :
     TTObject                    mPatternStartEvent;             ///< the event object which handles the start of the pattern execution
     TTObject                    mPatternEndEvent;               ///< the event object which handles the end of the pattern execution
     TTObject                    mPatternCondition;              ///< the condition object which handles next pattern iteration or the end of the loop
+    TTScoreSnapshotPending      mPending;                       ///< the reading of the pattern deferred until it is needed (see TTScoreSnapshotReader::setLazy)
     
     TTObject                    mCurrentTimeEvent;              ///< an internal pointer to remember the current time event being read
     TTObject                    mCurrentTimeProcess;            ///< an internal pointer to remember the current time process being read
@@ -129,6 +131,24 @@ private :
      @return                nothing */
     void    writeTimeProcessAsXml(TTXmlHandlerPtr aXmlHandler, TTObject& aTimeProcess);
     
+    /** needed to be handled by a TTScoreSnapshotWriter/Reader
+     @details the pattern events, processes and condition are stored into a container record
+     @param	inputValue      a writer pointer | a reader pointer, the process record
+     @param	outputValue     nothing
+     @return                an error code if the operation fails */
+	TTErr	WriteAsSnapshot(const TTValue& inputValue, TTValue& outputValue);
+	TTErr	ReadFromSnapshot(const TTValue& inputValue, TTValue& outputValue);
+    
+    /** Read the pattern events, processes and condition of a process record
+     @param aReader         a snapshot reader
+     @param index           the process record
+     @return                an error code if the records are not valid */
+    TTErr   readSnapshotPattern(TTScoreSnapshotReader& aReader, TTUInt32 index);
+    
+    /** Read the pattern if its reading have been deferred
+     @details this have to be called before any access to the pattern */
+    void    loadPending();
+    
     
     /** To be notified when an event date changed
      @param inputValue      the event which have changed his date
@@ -16,6 +16,9 @@
  */
 
 #include "Loop.h"
+#include "TTScoreXmlFormatter.h"
+
+#include <string.h>
 
 #define thisTTClass                 Loop
 #define thisTTClassName             "Loop"
@@ -121,6 +124,8 @@ TTErr Loop::getParameterNames(TTValue& value)
 
 TTErr Loop::getPatternProcesses(TTValue& value)
 {
+    loadPending();
+    
     value.clear();
     
     if (mPatternProcesses.isEmpty())
@@ -139,6 +144,8 @@ TTErr Loop::getPatternProcesses(TTValue& value)
 
 TTErr Loop::Compile()
 {
+    loadPending();
+    
     mCompiled = YES;
     
     return kTTErrNone;
@@ -146,6 +153,8 @@ TTErr Loop::Compile()
 
 TTErr Loop::ProcessStart()
 {
+    loadPending();
+    
     mIteration = 0;
     
     // reset pattern events status
@@ -237,6 +246,8 @@ TTErr Loop::ProcessPaused(const TTValue& inputValue, TTValue& outputValue)
 
 TTErr Loop::Goto(const TTValue& inputValue, TTValue& outputValue)
 {
+    loadPending();
+    
     TTValue         v;
     TTUInt32        duration, timeOffset;
     TTBoolean       muteRecall = NO;
@@ -275,6 +286,8 @@ TTErr Loop::Goto(const TTValue& inputValue, TTValue& outputValue)
 
 TTErr Loop::WriteAsXml(const TTValue& inputValue, TTValue& outputValue)
 {
+    loadPending();
+    
     TTObject o = inputValue[0];
 	TTXmlHandlerPtr aXmlHandler = (TTXmlHandlerPtr)o.instance();
     if (!aXmlHandler)
@@ -339,8 +352,8 @@ TTErr Loop::WriteAsXml(const TTValue& inputValue, TTValue& outputValue)
 
 void Loop::writeTimeProcessAsXml(TTXmlHandlerPtr aXmlHandler, TTObject& aTimeProcess)
 {
-    TTValue     v;
-    TTString    s;
+    TTValue             v;
+    TTScoreXmlFormatter aFormatter;
     
     // write the name
     TTSymbol name;
@@ -349,39 +362,27 @@ void Loop::writeTimeProcessAsXml(TTXmlHandlerPtr aXmlHandler, TTObject& aTimePro
     
     // write the duration min
     aTimeProcess.get("durationMin", v);
-    v.toString();
-    s = TTString(v[0]);
-    xmlTextWriterWriteAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, BAD_CAST "durationMin", BAD_CAST s.data());
+    aFormatter.writeAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, "durationMin", v);
     
     // write the duration max
     aTimeProcess.get("durationMax", v);
-    v.toString();
-    s = TTString(v[0]);
-    xmlTextWriterWriteAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, BAD_CAST "durationMax", BAD_CAST s.data());
+    aFormatter.writeAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, "durationMax", v);
     
     // write the mute
     aTimeProcess.get("mute", v);
-    v.toString();
-    s = TTString(v[0]);
-    xmlTextWriterWriteAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, BAD_CAST "mute", BAD_CAST s.data());
+    aFormatter.writeAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, "mute", v);
     
     // write the color
     aTimeProcess.get("color", v);
-    v.toString();
-    s = TTString(v[0]);
-    xmlTextWriterWriteAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, BAD_CAST "color", BAD_CAST s.data());
+    aFormatter.writeAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, "color", v);
     
     // write the vertical position
     aTimeProcess.get("verticalPosition", v);
-    v.toString();
-    s = TTString(v[0]);
-    xmlTextWriterWriteAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, BAD_CAST "verticalPosition", BAD_CAST s.data());
+    aFormatter.writeAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, "verticalPosition", v);
     
     // write the vertical size
     aTimeProcess.get("verticalSize", v);
-    v.toString();
-    s = TTString(v[0]);
-    xmlTextWriterWriteAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, BAD_CAST "verticalSize", BAD_CAST s.data());
+    aFormatter.writeAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, "verticalSize", v);
 }
 
 TTErr Loop::ReadFromXml(const TTValue& inputValue, TTValue& outputValue)
@@ -713,6 +714,144 @@ TTErr Loop::ReadFromXml(const TTValue& inputValue, TTValue& outputValue)
     return kTTErrNone;
 }
 
+TTErr Loop::WriteAsSnapshot(const TTValue& inputValue, TTValue& outputValue)
+{
+    if (inputValue.size() != 2 || inputValue[0].type() != kTypePointer)
+        return kTTErrGeneric;
+    
+    TTScoreSnapshotWriterPtr    aWriter = TTScoreSnapshotWriterPtr(TTPtr(inputValue[0]));
+    TTUInt32                    index = inputValue[1];
+    TTScoreSnapshotContainer    record;
+    TTUInt32                    containerIndex, start, end, i;
+    TTValue                     v, out;
+    
+    memset(&record, 0, sizeof(record));
+    record.process = index;
+    record.startEvent = TTSCORE_SNAPSHOT_NONE;
+    record.endEvent = TTSCORE_SNAPSHOT_NONE;
+    
+    loadPending();
+    
+    containerIndex = aWriter->append(kTTScoreSnapshotContainers, record);
+    aWriter->at<TTScoreSnapshotProcess>(kTTScoreSnapshotProcesses, index).container = containerIndex;
+    
+    // write the pattern start and end events
+    record.eventFirst = aWriter->size(kTTScoreSnapshotEvents);
+    mPatternStartEvent.send("WriteAsSnapshot", TTPtr(aWriter), out);
+    mPatternEndEvent.send("WriteAsSnapshot", TTPtr(aWriter), out);
+    record.eventCount = aWriter->size(kTTScoreSnapshotEvents) - record.eventFirst;
+    
+    start = aWriter->eventIndex(mPatternStartEvent.instance());
+    end = aWriter->eventIndex(mPatternEndEvent.instance());
+    
+    // reserve the records of all pattern time processes
+    record.processFirst = aWriter->size(kTTScoreSnapshotProcesses);
+    for (mPatternProcesses.begin(); mPatternProcesses.end(); mPatternProcesses.next())
+    {
+        TTObject aTimeProcess = mPatternProcesses.current()[0];
+        TTScoreSnapshotWriteProcess(*aWriter, aTimeProcess, start, end);
+    }
+    record.processCount = aWriter->size(kTTScoreSnapshotProcesses) - record.processFirst;
+    
+    // write pattern condition
+    record.conditionFirst = aWriter->size(kTTScoreSnapshotConditions);
+    mPatternCondition.send("WriteAsSnapshot", TTPtr(aWriter), out);
+    record.conditionCount = aWriter->size(kTTScoreSnapshotConditions) - record.conditionFirst;
+    
+    aWriter->at<TTScoreSnapshotContainer>(kTTScoreSnapshotContainers, containerIndex) = record;
+    
+    // then let each time process write what is specific to it
+    i = record.processFirst;
+    for (mPatternProcesses.begin(); mPatternProcesses.end(); mPatternProcesses.next())
+    {
+        TTObject aTimeProcess = mPatternProcesses.current()[0];
+        
+        v = TTValue(TTPtr(aWriter), i++);
+        aTimeProcess.send("WriteAsSnapshot", v, out);
+    }
+    
+	return kTTErrNone;
+}
+
+TTErr Loop::ReadFromSnapshot(const TTValue& inputValue, TTValue& outputValue)
+{
+    if (inputValue.size() != 2 || inputValue[0].type() != kTypePointer)
+        return kTTErrGeneric;
+    
+    TTScoreSnapshotReaderPtr    aReader = TTScoreSnapshotReaderPtr(TTPtr(inputValue[0]));
+    TTUInt32                    index = inputValue[1];
+    
+    if (!aReader->contains(kTTScoreSnapshotProcesses, index, 1))
+        return kTTErrGeneric;
+    
+    // the pattern will be read on first access
+    if (mPending.defer(*aReader, index))
+        return kTTErrNone;
+    
+    return readSnapshotPattern(*aReader, index);
+}
+
+void Loop::loadPending()
+{
+    std::shared_ptr<TTScoreSnapshotReader>  aReader;
+    TTUInt32                                index;
+    
+    if (mPending.take(aReader, index))
+        readSnapshotPattern(*aReader, index);
+}
+
+TTErr Loop::readSnapshotPattern(TTScoreSnapshotReader& aReader, TTUInt32 index)
+{
+    TTObject    thisObject(this);
+    TTValue     v, out;
+    TTUInt32    i;
+    
+    const TTScoreSnapshotProcess& process = aReader.records<TTScoreSnapshotProcess>(kTTScoreSnapshotProcesses)[index];
+    
+    if (!aReader.contains(kTTScoreSnapshotContainers, process.container, 1))
+        return kTTErrGeneric;
+    
+    const TTScoreSnapshotContainer& record = aReader.records<TTScoreSnapshotContainer>(kTTScoreSnapshotContainers)[process.container];
+    
+    if (record.eventCount != 2 ||
+        !aReader.contains(kTTScoreSnapshotProcesses, record.processFirst, record.processCount) ||
+        !aReader.contains(kTTScoreSnapshotConditions, record.conditionFirst, record.conditionCount))
+        return kTTErrGeneric;
+    
+    // read the pattern start and end events
+    mPatternStartEvent.send("ReadFromSnapshot", TTValue(TTPtr(&aReader), record.eventFirst), out);
+    mPatternEndEvent.send("ReadFromSnapshot", TTValue(TTPtr(&aReader), record.eventFirst + 1), out);
+    
+    // read all pattern time processes
+    const TTScoreSnapshotProcess* processes = aReader.records<TTScoreSnapshotProcess>(kTTScoreSnapshotProcesses) + record.processFirst;
+    
+    for (i = 0; i < record.processCount; i++)
+    {
+        // create the time process
+        TTObject aTimeProcess(aReader.symbol(processes[i].type), thisObject);
+        if (!aTimeProcess.valid())
+            continue;
+        
+        // set the start and end events
+        setTimeProcessStartEvent(aTimeProcess, mPatternStartEvent);
+        setTimeProcessEndEvent(aTimeProcess, mPatternEndEvent);
+        
+        // append as pattern process
+        mPatternProcesses.append(aTimeProcess);
+        
+        TTScoreSnapshotReadProcess(aReader, processes[i], aTimeProcess);
+        
+        v = TTValue(TTPtr(&aReader), record.processFirst + i);
+        aTimeProcess.send("ReadFromSnapshot", v, out);
+    }
+    
+    // read pattern condition
+    if (record.conditionCount)
+        mPatternCondition.send("ReadFromSnapshot", TTValue(TTPtr(&aReader), record.conditionFirst), out);
+    
+	return kTTErrNone;
+}
+
 #if 0
 #pragma mark -
 #pragma mark Notifications
@@ -851,6 +990,8 @@ TTErr Loop::setPatternEndEvent(const TTValue& value)
 
 TTErr Loop::PatternAttach(const TTValue& inputValue, TTValue& outputValue)
 {
+    loadPending();
+    
     TT_ASSERT("Loop::PatternAttach : expects an object", inputValue.size() == 1 && inputValue[0].type() == kTypeObject);
     
     TTObject aTimeProcess = inputValue[0];
@@ -877,6 +1018,8 @@ TTErr Loop::PatternAttach(const TTValue& inputValue, TTValue& outputValue)
 
 TTErr Loop::PatternDetach(const TTValue& inputValue, TTValue& outputValue)
 {
+    loadPending();
+    
     TT_ASSERT("Loop::PatternDetach : expects an object", inputValue.size() == 1 && inputValue[0].type() == kTypeObject);
     
     TTObject aTimeProcess = inputValue[0];
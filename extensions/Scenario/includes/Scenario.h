@@ -19,6 +19,10 @@
 #define __SCENARIO_H__
 
 #include "TimePluginLib.h"
+#include "TTScoreSnapshot.h"
+#include "TTScoreProfiler.h"
+#include "TTScorePayloads.h"
+#include "TTCurve.h"
 
 #ifndef NO_EDITION_SOLVER
 #include "ScenarioSolver.h"
@@ -28,6 +32,8 @@
 #include <libxml/xmlwriter.h>
 #include <libxml/xmlreader.h>
 
+#include <unordered_set>
+
 /**	The Scenario class allows to ...
  
  @see TimePluginLib, TTTimeProcess, TTTimeContainer
@@ -57,9 +63,36 @@ class Scenario : public TimeContainerPlugin
     TTObject           	 		mCurrentLoop;                   ///< an internal pointer to remember the current loop being read
     
     TTBoolean                   mLoading;                       ///< a flag true when the scenario is loading (mainly used to mute the edition solver)
+    TTBoolean                   mLazyLoading;                   ///< do the sub scenarios, loops and automations read from a snapshot wait to be accessed to load their content ?
+    TTScoreSnapshotPending      mPending;                       ///< the reading of the content deferred until it is needed (see TTScoreSnapshotReader::setLazy)
+    TTCurveSampler              mSampler;                       ///< the curves read during a load to sample them all together at the end of the load
+    
+    TTBoolean                   mProfiling;                     ///< are the loads and the saves of the scenario measured ? (see profilingReport attribute)
+    TTUInt32                    mProfilingSlowest;              ///< how many of the slowest objects are listed into the profiling report
+    TTScoreProfiler             mProfiler;                      ///< the measures of the last load or save
+    
+    TTBoolean                   mSharedPayloads;                ///< are the states and the curves repeated into a xml file written once ? (they are always read, NO by default because the readers older than the shared payloads lose them)
+    TTScorePayloads             mPayloads;                      ///< the states and the curves shared during a load or a save
+    
+    std::unordered_set<TTPtr>   mJournalEdited;                 ///< the events, processes and conditions edited since the last journal frame or snapshot
+    std::vector<std::pair<TTUInt32, TTSymbol> > mJournalRemovals; ///< the table and the name of the objects removed since the last journal frame or snapshot
+    
+    TTScoreSnapshotBackgroundWriter mBackgroundWriter;          ///< writes a snapshot on a background thread (see SnapshotWriteAsync, only the file writing is in background : the copy of the score is made on the calling thread)
+    TTSymbol                    mBackgroundPath;                ///< the path of the snapshot written in background
+    std::unordered_set<TTPtr>   mBackgroundEdited;              ///< the editions written into the snapshot written in background (to save them again if the writing fails)
+    std::vector<std::pair<TTUInt32, TTSymbol> > mBackgroundRemovals; ///< the removals written into the snapshot written in background (to save them again if the writing fails)
     TTBoolean                   mAttributeLoaded;               ///< a flag true when the scenario is loading (mainly used to mute the edition solver)
+    TTUInt32                    mEditionDepth;                  ///< the number of nested edition transactions in progress (see EditionBegin)
+    
+    TTUInt32                    mEditionSearchTime;             ///< the maximal time allowed to the edition solver to search a solution (in millisecond, 0 means no limit)
+    TTUInt32                    mEditionSearchNodes;            ///< the maximal number of nodes explored by the edition solver (0 means no limit)
+    TTInt32                     mEditionSearchObjective;        ///< the edition solver stops as soon as the events moves cost less than this (-1 to find the best solution)
+    TTBoolean                   mEditionAnytime;                ///< does the edition solver return its first solution and search better ones in background ? (see EditionRefine)
+    TTUInt32                    mEditionSearchThreads;          ///< the number of threads used by the edition solver to search a solution (0 means one per core)
+    TTBoolean                   mEditionDeterministic;          ///< does the edition solver always return the same solution whatever the number of threads is (even one) ?
     
     TTSymbol                    mFileVersion;                   ///< a symbol used to store the score version format of the file being read
+    std::unordered_map<TTPtr, TTObject> mLoadingEvents;         ///< the time events read so far stored by name (only during a load to bind time processes on them)
 	
     /** Get parameters names needed by this time process
      @param	value           the returned parameter names
@@ -116,6 +149,131 @@ class Scenario : public TimeContainerPlugin
 	TTErr	WriteAsXml(const TTValue& inputValue, TTValue& outputValue);
 	TTErr	ReadFromXml(const TTValue& inputValue, TTValue& outputValue);
     
+    /**  needed to be handled by a TTScoreSnapshotWriter/Reader
+     @details the events, processes and conditions of a sub scenario are stored into a container record
+     @param	inputValue      a writer pointer | a reader pointer, the process record
+     @param	outputValue     nothing
+     @return                an error code if the operation fails */
+	TTErr	WriteAsSnapshot(const TTValue& inputValue, TTValue& outputValue);
+	TTErr	ReadFromSnapshot(const TTValue& inputValue, TTValue& outputValue);
+    
+    /** Write the whole score into a binary snapshot file
+     @details a snapshot is much faster to load than a xml file because it is mapped into memory and read in place (see TTScoreSnapshot.h)
+     @param inputValue      a file path
+     @param outputValue     nothing
+     @return                an error code if the file can't be written */
+    TTErr   SnapshotWrite(const TTValue& inputValue, TTValue& outputValue);
+    
+    /** Write the whole score into a binary snapshot file on a background thread
+     @details the score is copied into the tables of a snapshot writer then the file is written in background :
+     the score can be edited or played meanwhile. @n
+     Only the file writing is in background : the copy walks the live objects on the calling thread so it costs as much as the copy made by SnapshotWrite.
+     The end of the writing is handled by the next SnapshotWriteEnd, SnapshotWrite, SnapshotWriteAsync or JournalWrite (see SnapshotWriteEnd)
+     @param inputValue      a file path
+     @param outputValue     nothing
+     @return                an error code if a writing is already in progress */
+    TTErr   SnapshotWriteAsync(const TTValue& inputValue, TTValue& outputValue);
+    
+    /** Check if the background writing is done
+     @details once the writing is done the journal is removed and a SnapshotWritten notification is sent with the path and the success of the writing. @n
+     SnapshotWrite, SnapshotWriteAsync and JournalWrite do the same before to write so the journal is not kept until the next poll,
+     and the destruction of the scenario waits the end of the writing
+     @param outputvalue     YES if the writing is still in progress
+     @return                an error code if the file can't be written */
+    TTErr   SnapshotWriteEnd(const TTValue& inputValue, TTValue& outputValue);
+    
+    /** Get the ratio of the snapshot file written in background so far
+     @param value           the returned ratio (0. if there is no writing in progress)
+     @return                kTTErrNone */
+    TTErr   getSnapshotWriteProgress(TTValue& value);
+    
+    /** Join the background writing if it is done, remove the journal and notify the end of the writing
+     @return                an error code if the file can't be written */
+    TTErr   snapshotWriteFinish();
+    
+    /** Copy the whole score into the tables of a snapshot writer
+     @param aWriter         an empty snapshot writer */
+    void    writeSnapshot(TTScoreSnapshotWriter& aWriter);
+    
+    /** Read the whole score from a binary snapshot file
+     @param inputValue      a file path
+     @param outputValue     nothing
+     @return                an error code if the file is not a valid snapshot */
+    TTErr   SnapshotRead(const TTValue& inputValue, TTValue& outputValue);
+    
+    /** Append the events, processes and conditions edited since the last save to the journal of a snapshot file
+     @details the journal is the snapshot file path followed by .journal : it is replayed by SnapshotRead and removed by SnapshotWrite @n
+     so an autosave costs the size of the editions instead of the size of the score.
+     While a background writing is in progress no frame is written : the editions are kept for the next frame
+     @param inputValue      the snapshot file path
+     @param outputValue     YES if the frame is postponed because of a background writing
+     @return                an error code if the journal can't be written or if the frame is postponed */
+    TTErr   JournalWrite(const TTValue& inputValue, TTValue& outputValue);
+    
+    /** Tell an object have been edited directly (for example a state or a curve) to write it into the next journal frame
+     @details the creations, moves and removals made through the scenario are tracked without this
+     @param inputValue      a time event, a time process or a time condition
+     @param outputValue     nothing
+     @return                kTTErrNone */
+    TTErr   JournalTouch(const TTValue& inputValue, TTValue& outputValue);
+    
+    /** Remember an object have been edited since the last save */
+    void    journalEdit(const TTObject& anObject);
+    
+    /** Remember an object have been removed since the last save
+     @param table           kTTScoreSnapshotEvents, kTTScoreSnapshotProcesses or kTTScoreSnapshotConditions
+     @param anObject        the removed object */
+    void    journalRemove(TTUInt32 table, const TTObject& anObject);
+    
+    /** Write a time event into a journal frame if it is not already written */
+    void    writeJournalTimeEvent(TTScoreSnapshotWriter& aWriter, TTObject aTimeEvent);
+    
+    /** Apply a journal frame to the scenario
+     @details the objects are found by name : the edited ones are replaced, the new ones are created and the removed ones are released
+     @param aReader         a reader of the frame
+     @return                an error code if the frame is not valid */
+    TTErr   readJournalFrame(TTScoreSnapshotReader& aReader);
+    
+    /** Find an object of the scenario by name
+     @param table           kTTScoreSnapshotEvents, kTTScoreSnapshotProcesses or kTTScoreSnapshotConditions
+     @param aName           the name of the object
+     @return                the object or an empty object if there is no object with this name */
+    TTObject findJournalObject(TTUInt32 table, TTSymbol aName);
+    
+    /** Write the events, processes and conditions into the records of a container
+     @details the records of each kind are consecutive : the specific part of the time processes is written once all the records are reserved
+     @param aWriter         a snapshot writer
+     @param containerIndex  the container record */
+    void    writeSnapshotContent(TTScoreSnapshotWriter& aWriter, TTUInt32 containerIndex);
+    
+    /** Create the events, processes and conditions of a container record
+     @param aReader         a snapshot reader
+     @param containerIndex  the container record
+     @return                an error code if the records are not valid */
+    TTErr   readSnapshotContent(TTScoreSnapshotReader& aReader, TTUInt32 containerIndex);
+    
+    /** Create a time process from a process record and bind it on the events read before
+     @param aReader         a snapshot reader
+     @param index           the process record
+     @return                an error code if the time process can't be created */
+    TTErr   readSnapshotTimeProcess(TTScoreSnapshotReader& aReader, TTUInt32 index);
+    
+    /** Read the content of a sub scenario process record
+     @param aReader         a snapshot reader
+     @param index           the process record
+     @return                an error code if the records are not valid */
+    TTErr   readSnapshotProcess(TTScoreSnapshotReader& aReader, TTUInt32 index);
+    
+    /** Read the content if its reading have been deferred
+     @details this have to be called before any access to the events, processes and conditions */
+    void    loadPending();
+    
+    /** Clear the scenario before to load a file */
+    void    beginLoading();
+    
+    /** Sort the events and build the edition solver once a file is loaded */
+    void    endLoading();
+    
     /** To be notified when an event date changed
      @param inputValue      the event which have changed his date
      @param outputValue     nothing
@@ -153,6 +311,32 @@ class Scenario : public TimeContainerPlugin
      @return                kTTErrNone */
     TTErr   setViewPosition(const TTValue& value);
     
+    /** Set the edition solver search budget and mode
+     @param	value           a time in millisecond, a number of nodes, an objective, an anytime boolean, a number of threads or a deterministic boolean
+     @return                kTTErrNone */
+    TTErr   setEditionSearchTime(const TTValue& value);
+    TTErr   setEditionSearchNodes(const TTValue& value);
+    TTErr   setEditionSearchObjective(const TTValue& value);
+    TTErr   setEditionAnytime(const TTValue& value);
+    TTErr   setEditionSearchThreads(const TTValue& value);
+    TTErr   setEditionDeterministic(const TTValue& value);
+    
+    /** Pass the search budget and mode to the edition solver */
+    void    configureEditionSolver();
+    
+    /** Get statistics about the last edition solving
+     @param value           explored nodes, failures, elapsed time in millisecond, memory peak
+     @return                kTTErrGeneric if there is no edition solver */
+    TTErr   getEditionStatistics(TTValue& value);
+    
+    /** Get the measures of the last load or save (if the profiling attribute is enabled)
+     @param value           total time in millisecond,
+                            then phase name time for each phase (file, objects, solver, sampling and flattening),
+                            then type name time count for each object type,
+                            then object type name time for the slowest objects
+     @return                kTTErrNone */
+    TTErr   getProfilingReport(TTValue& value);
+    
     /** Trigger next pending time events
      @param inputvalue      nothing or any event pending passing there position in the list of pending event (ex : 1 3 if there is 3 or more pending events and we want to trigger the first and the third events)
      @param outputvalue     the triggered time events
@@ -171,9 +355,52 @@ class Scenario : public TimeContainerPlugin
      @return                an error code if the destruction fails */
     TTErr   TimeEventRelease(const TTValue& inputValue, TTValue& outputValue);
     
+    /** Begin an edition transaction
+     @details until EditionEnd the moves and limitations are only stored into the edition solver
+     so it solves once and the events are updated once for all the editions
+     transactions can be nested : only the last EditionEnd solves
+     @return                kTTErrNone */
+    TTErr   EditionBegin();
+    
+    /** End an edition transaction
+     @details solve all the editions made since EditionBegin then update only the events which date changed
+     @return                an error code if there is no transaction in progress or if the editions can't be solved */
+    TTErr   EditionEnd();
+    
+    /** Update the events date from the edition solver
+     @details nothing is updated during an edition transaction */
+    void    updateEditionVariables();
+    
+    /** Add the edition solver variable of a time event
+     @param aTimeEvent      a time event */
+    void    addEditionVariable(TTObject& aTimeEvent);
+    
+    /** Add the edition solver relation or constraint of a time process
+     @param aTimeProcess    a time process which start and end events have a variable */
+    void    addEditionTimeProcess(TTObject& aTimeProcess);
+    
+    /** Build all the edition solver elements from the time events and time processes in one pass
+     @details while a file is loading nothing is added to the edition solver : this is done once when the reading ends */
+    void    buildEditionSolver();
+    
+    /** Delete all the edition solver elements and create a new solver */
+    void    resetEditionSolver();
+    
+    /** Explain why the last edition failed
+     @details the time processes in conflict are the ones which duration bounds prevent the edition together
+     if the edition solver can't find them (because of its search budget) all the time processes are in conflict
+     @param value           the nearest date of the edited element which can be reached, the time processes in conflict */
+    void    getEditionConflict(TTValue& value);
+    
+    /** Update the events date with the better solutions found in background by the edition solver
+     @details this is only useful when the edition anytime attribute is enabled : it have to be called regularly (from the main thread) after an edition
+     @param outputvalue     YES if the edition solver is still searching better solutions
+     @return                kTTErrNone */
+    TTErr   EditionRefine(const TTValue& inputValue, TTValue& outputValue);
+    
     /** Move a time event
      @param inputvalue      a time event object, new date
-     @param outputvalue     nothing            
+     @param outputvalue     nothing or if the movement fails : the nearest date which can be reached and the time processes in conflict (see getEditionConflict)
      @return                an error code if the movement fails */
     TTErr   TimeEventMove(const TTValue& inputValue, TTValue& outputValue);
     
@@ -201,6 +428,12 @@ class Scenario : public TimeContainerPlugin
      @return                #TTErr*/
     TTErr   readTimeEventFromXml(TTXmlHandlerPtr aXmlHandler, TTObject& aNewTimeEvent);
     
+    /** Find a time event by name while the scenario is loading
+     @details the events read so far are stored by name so binding a time process doesn't search through all events
+     @param aName           the name of the time event
+     @return                the time event or an empty object if there is no event with this name */
+    TTObject findLoadingTimeEvent(TTSymbol aName);
+    
     
     
     /** Add an existing time process to the sceanrio (or create it passing a type)
@@ -217,7 +450,7 @@ class Scenario : public TimeContainerPlugin
     
     /** Move a time process into the scenario
      @param inputvalue      a time process object, new start date, new end date
-     @param outputvalue     nothing            
+     @param outputvalue     nothing or if the movement fails : the nearest start date which can be reached and the time processes in conflict (see getEditionConflict)
      @return                an error code if the movement fails */
     TTErr   TimeProcessMove(const TTValue& inputValue, TTValue& outputValue);
     
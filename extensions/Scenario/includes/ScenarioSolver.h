@@ -93,8 +93,9 @@ public:
     /** Set the range bounds of the variable */
     void limit(SolverValue min, SolverValue max);
     
-    /** Update the variable value from the solver */
-    void update();
+    /** Update the event date from the solver
+     @return                true if the date of the event have changed */
+    TTBoolean update();
 };
 typedef SolverVariable* SolverVariablePtr;
 
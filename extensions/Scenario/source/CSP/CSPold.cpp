@@ -46,6 +46,7 @@ knowledge of the CeCILL-C license and that you accept its terms.
 //#include "StoryLine.hpp"          // NOTE : we should not need this class anymore as the Scenario class should allow to retreive the story
 
 #include <iostream>
+#include <algorithm>
 using namespace std;
 
 #include "CSPold.hpp"
@@ -169,16 +170,16 @@ CSPold::removeBox(unsigned int boxId, std::vector<unsigned int>& relationsRemove
      remove temporal constraints implicating cedBox
 	 */
 
-	vector<BinaryTemporalRelation*> *relToRemove = links(cedBox);
-	for (vector<BinaryTemporalRelation*>::iterator it = relToRemove->begin() ; it != relToRemove->end() ; it++)
+	// removing a relation removes it from the links of cedBox so always take the last one
+	const vector<BinaryTemporalRelation*> &boxLinks = linksOf(cedBox);
+	while (!boxLinks.empty())
 	{
-		unsigned int relationId = (*it)->getId();
-		relationsRemoved.push_back(relationId);
-		removeTemporalRelation((*it));
-		delete (*it);
+		BinaryTemporalRelation *rel = boxLinks.back();
+		relationsRemoved.push_back(rel->getId());
+		removeTemporalRelation(rel);
+		delete rel;
 	}
-	relToRemove->clear();
-	delete relToRemove;
+	_linksOfEntity.erase(cedBox);
 
 	vector<unsigned int>* controlPointID = new vector <unsigned int>;
 	cedBox->getAllControlPointsId(controlPointID);
@@ -192,12 +193,14 @@ CSPold::removeBox(unsigned int boxId, std::vector<unsigned int>& relationsRemove
 			currentTriggerPoint->removeRelatedControlPoint();
 		}
 
-		relToRemove = links(currentControlPoint);
-		for (vector<BinaryTemporalRelation*>::iterator it = relToRemove->begin() ; it != relToRemove->end() ; it++)
+		const vector<BinaryTemporalRelation*> &controlPointLinks = linksOf(currentControlPoint);
+		while (!controlPointLinks.empty())
 		{
-			removeTemporalRelation((*it));
-			delete (*it);
+			BinaryTemporalRelation *rel = controlPointLinks.back();
+			removeTemporalRelation(rel);
+			delete rel;
 		}
+		_linksOfEntity.erase(currentControlPoint);
 
 		_solver->removeIntVar(currentControlPoint->beginID());
 		_solver->removeIntVar(currentControlPoint->lengthID());
@@ -279,7 +282,7 @@ CSPold::addAntPostRelation(unsigned int relationId, unsigned int boxId1, unsigne
 
 	if (mustCallSolver) {
 		if (newAntPost->validate()) {
-			_temporalRelations->push_back(newAntPost);
+			indexRelation(newAntPost);
 			newAntPost->setId(relationId);
 
 			ent1->addRelatedEntity(ent2);
@@ -320,7 +323,7 @@ CSPold::addAntPostRelation(unsigned int relationId, unsigned int boxId1, unsigne
 		delete varsIDs;
 		delete varsCoeffs;
 
-		_temporalRelations->push_back(newAntPost);
+		indexRelation(newAntPost);
 		ent1->addRelatedEntity(ent2);
 		ent2->addRelatedEntity(ent1);
 
@@ -390,14 +393,7 @@ CSPold::removeTemporalRelation(BinaryTemporalRelation *rel)
 	for (vector<CSPLinearConstraint*>::iterator it = rel->constraints()->begin() ; it != rel->constraints()->end() ; it++)
 		removeConstraint(*it);
 
-	vector<BinaryTemporalRelation*>::iterator it  = _temporalRelations->begin();
-	while (it != _temporalRelations->end()) {
-		if (*it == rel) {
-			_temporalRelations->erase(it);
-			break;
-		}
-		else it++;
-	}
+	unindexRelation(rel);
 }
 
 
@@ -420,7 +416,7 @@ CSPold::removeTemporalRelation(unsigned int relationId)
 			ent1->removeRelatedEntity(ent2);
 			ent2->removeRelatedEntity(ent1);
 
-			_temporalRelations->erase(it);
+			unindexRelation(rel);
 
 			break;
 		}
@@ -497,15 +493,48 @@ CSPold::links() const
 vector<BinaryTemporalRelation*> *
 CSPold::links(ConstrainedTemporalEntity *ent) const
 {
-	vector<BinaryTemporalRelation*> *links = new vector<BinaryTemporalRelation*>;
-	vector<BinaryTemporalRelation*>::iterator it;
+	return new vector<BinaryTemporalRelation*>(linksOf(ent));
+}
 
-	for (it = _temporalRelations->begin() ; it != _temporalRelations->end() ; it++)
-		if ((*it)->implicates(ent)) {
-			links->push_back(*it);
-		}
+const vector<BinaryTemporalRelation*> &
+CSPold::linksOf(ConstrainedTemporalEntity *ent) const
+{
+	static const vector<BinaryTemporalRelation*> noLinks;
+
+	map<ConstrainedTemporalEntity*, vector<BinaryTemporalRelation*> >::const_iterator it = _linksOfEntity.find(ent);
+	if (it == _linksOfEntity.end())
+		return noLinks;
 
-	return links;
+	return it->second;
+}
+
+void
+CSPold::indexRelation(BinaryTemporalRelation *rel)
+{
+	_temporalRelations->push_back(rel);
+
+	_linksOfEntity[rel->entity1()].push_back(rel);
+	if (rel->entity2() != rel->entity1())
+		_linksOfEntity[rel->entity2()].push_back(rel);
+}
+
+void
+CSPold::unindexRelation(BinaryTemporalRelation *rel)
+{
+	vector<BinaryTemporalRelation*>::iterator it = find(_temporalRelations->begin(), _temporalRelations->end(), rel);
+	if (it != _temporalRelations->end())
+		_temporalRelations->erase(it);
+
+	ConstrainedTemporalEntity *entities[2] = {rel->entity1(), rel->entity2()};
+	for (int i = 0 ; i < 2 ; ++i) {
+		map<ConstrainedTemporalEntity*, vector<BinaryTemporalRelation*> >::iterator entityLinks = _linksOfEntity.find(entities[i]);
+		if (entityLinks == _linksOfEntity.end())
+			continue;
+
+		vector<BinaryTemporalRelation*>::iterator pos = find(entityLinks->second.begin(), entityLinks->second.end(), rel);
+		if (pos != entityLinks->second.end())
+			entityLinks->second.erase(pos);
+	}
 }
 
 ConstrainedBox*
@@ -1238,7 +1267,7 @@ CSPold::addAllenRelation(ConstrainedTemporalEntity *ent1, ConstrainedTemporalEnt
 
 	if (mustCallSolver) {
 		if (newAllen->validate()) {
-			_temporalRelations->push_back(newAllen);
+			indexRelation(newAllen);
 
 			ent1->addRelatedEntity(ent2);
 			ent2->addRelatedEntity(ent1);
@@ -1263,7 +1292,7 @@ CSPold::addAllenRelation(ConstrainedTemporalEntity *ent1, ConstrainedTemporalEnt
 		delete varsIDs;
 		delete varsCoeffs;
 
-		_temporalRelations->push_back(newAllen);
+		indexRelation(newAllen);
 
 		ent1->addRelatedEntity(ent2);
 		ent2->addRelatedEntity(ent1);
@@ -171,8 +171,11 @@ public :
 	bool performMoving(unsigned int boxId, int x, int y, vector<unsigned int>& movedBoxes);
 	bool performMoving(unsigned int boxId, int x, int y, vector<unsigned int>& movedBoxes, unsigned int maxModification);
 
-	// Get the links implicating one particular entity
+	// Get the links implicating one particular entity (a new vector the caller has to delete)
 	vector<BinaryTemporalRelation*> *links(ConstrainedTemporalEntity *ent) const;
+	// Get the links implicating one particular entity without copying them
+	// (the vector is changed by any relation added or removed)
+	const vector<BinaryTemporalRelation*> &linksOf(ConstrainedTemporalEntity *ent) const;
 	// Get the whole links
 	vector<BinaryTemporalRelation*> *links() const;
 
@@ -372,6 +375,13 @@ private :
 
 	std::map<unsigned int, TriggerPoint *> *_triggerPoints;
 
+	// Relations implicating each entity, kept up to date when a relation is added or removed
+	std::map<ConstrainedTemporalEntity *, vector<BinaryTemporalRelation *> > _linksOfEntity;
+
+	// Add/remove a relation to/from the relations list and the links of its entities
+	void indexRelation(BinaryTemporalRelation *rel);
+	void unindexRelation(BinaryTemporalRelation *rel);
+
 	// Add/remove linear contraints to/from the solver, when adding/removing a relation
 	CSPLinearConstraint* addConstraint(vector<int> *varsIDs, vector<int> *varsCoeffs, BinaryRelationType type, int value, bool mustCallSolver);
 	bool removeConstraint(CSPLinearConstraint *cst);
@@ -40,7 +40,17 @@ knowledge of the CeCILL-C license and that you accept its terms.
 
 CustomSpace::CustomSpace()
 //TODO: avant ": Space(), _dat(this, 0), _objFuncInitialized(false)"
-: Space(), _dat(*this, 0), _objFuncInitialized(false)
+: Space(), _dat(*this, 0), _nbVars(0), _objFuncInitialized(false)
+#if GECODE_VERSION_NUMBER > 400000
+, _home(*this)
+#endif
+{
+	_lastVal = -1;
+	_cpt = 0;
+}
+
+CustomSpace::CustomSpace(int nbVars)
+: Space(), _dat(*this, nbVars), _nbVars(0), _objFuncInitialized(false)
 #if GECODE_VERSION_NUMBER > 400000
 , _home(*this)
 #endif
@@ -56,6 +66,7 @@ CustomSpace::CustomSpace(bool share, CustomSpace& s) : Space(share,s)
 {
 	//TODO: avant "_dat.update(this, share, s._dat);"
 	_dat.update(*this, share, s._dat);
+	_nbVars = s._nbVars;
 	_objFuncInitialized = s._objFuncInitialized;
 	_lastVal = s._lastVal;
 	_cpt = s._cpt;
@@ -72,7 +83,7 @@ CustomSpace::~CustomSpace()
 int
 CustomSpace::getNbVars() const
 {
-	return _dat.size();
+	return _nbVars;
 }
 
 void
@@ -82,6 +93,21 @@ CustomSpace::setObjFunc(IntVar v)
 	_objFuncInitialized = true;
 }
 
+int
+CustomSpace::getObjFunc() const
+{
+	if (_objFuncInitialized && _objFunc.assigned())
+		return _objFunc.val();
+
+	return -1;
+}
+
+void
+CustomSpace::boundObjFunc(int max)
+{
+	rel(*this, _objFunc, IRT_LQ, max);
+}
+
 void
 CustomSpace::constrain(const Space& t)
 {
@@ -107,9 +133,17 @@ CustomSpace::addVariable(int min, int max)
 {
 //TODO: avant "	IntVarArray newArray(this, _dat.size()+1);"
 //TODO:	avant "IntVar v(this, min, max);"
-	IntVarArray newArray(*this, _dat.size()+1);
 	IntVar v(*this, min, max);
 
+	// the array have been reserved (see in CustomSpace(int))
+	if (_nbVars < _dat.size())
+	{
+		_dat[_nbVars] = v;
+		return _nbVars++;
+	}
+
+	IntVarArray newArray(*this, _dat.size()+1);
+
 	// Copy from the old array to the new
 	for (int i=0; i<newArray.size()-1; i++)
 		newArray[i] = _dat[i];
@@ -118,8 +152,9 @@ CustomSpace::addVariable(int min, int max)
 
 	// Replace the array
 	_dat = newArray;
+	_nbVars = _dat.size();
 
-	return _dat.size()-1;
+	return _nbVars-1;
 }
 
 void
@@ -138,3 +173,9 @@ CustomSpace::getIntVar(int i) const
 {
 	return _dat[i];
 }
+
+bool
+CustomSpace::isAssigned() const
+{
+	return _dat.assigned();
+}
@@ -56,6 +56,9 @@ private :
 	// Array of the current variables
 	IntVarArray _dat;
 
+	// Number of variables added in the array (the array can be bigger, see in CustomSpace(int))
+	int _nbVars;
+
 	// Objective function var
 	IntVar _objFunc;
 
@@ -71,6 +74,11 @@ private :
 public :
 
 	CustomSpace();
+
+	// Reserves the array for nbVars variables so adding them doesn't copy the array
+	// note : exactly nbVars variables have to be added before to use the space
+	CustomSpace(int nbVars);
+
 	~CustomSpace();
 
 	// Constructor for cloning \a s
@@ -80,6 +88,12 @@ public :
 
 	void setObjFunc(IntVar v);
 
+	// value of the objective function (-1 if it is not assigned)
+	int getObjFunc() const;
+
+	// only accept the solutions which objective is lower or equal to max
+	void boundObjFunc(int max);
+
 	// Perform copying during cloning
 	CustomSpace* copy(bool share);
 
@@ -94,6 +108,9 @@ public :
 
 	// return the IntVar at index i in the array
 	IntVar getIntVar(int i) const;
+
+	// true if all the variables of the array are assigned
+	bool isAssigned() const;
 };
 
 #endif
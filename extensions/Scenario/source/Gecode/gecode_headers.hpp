@@ -41,10 +41,12 @@ knowledge of the CeCILL-C license and that you accept its terms.
 
 #include <vector>
 #include <map>
+#include <set>
 #include <string>
 using std::string;
 using std::vector;
 using std::map;
+using std::set;
 using std::pair;
 
 #include <gecode/kernel.hh>
@@ -54,6 +54,18 @@ IntegerVariable::IntegerVariable(int min, int max, int val, int i, int weight, i
 	_indexOfTotal = total;
 }
 
+int
+IntegerVariable::getInfBound() const
+{
+	return _infBound;
+}
+
+int
+IntegerVariable::getSupBound() const
+{
+	return _supBound;
+}
+
 int
 IntegerVariable::getMin() const
 {
@@ -72,6 +72,8 @@ private :
 public :
 
 	IntegerVariable(int min, int max, int val, int i, int weight, int pDelta, int nDelta, int total);
+	int getInfBound() const;
+	int getSupBound() const;
 	int getMin() const;
 	int getMax() const;
 	int getVal() const;
@@ -64,7 +64,7 @@ LinearConstraint::~LinearConstraint()
 }
 
 void 
-LinearConstraint::addToSpace() const
+LinearConstraint::addToSpace(CustomSpace *space) const
 {
 	int size = _varsIDs->size();
 
@@ -76,12 +76,12 @@ LinearConstraint::addToSpace() const
 	for (int i=0; i<size; i++)
 	{
 		IntegerVariable *iv = _solver->varFromID(_varsIDs->at(i));
-		vars[i] = _solver->getSpace()->getIntVar(iv->getTotalIndex());
+		vars[i] = space->getIntVar(iv->getTotalIndex());
 		coeffs[i] = _varsCoeffs->at(i);
 	}
 
 //TODO: avant "Gecode::linear((Space*)_solver->getSpace(), coeffs, vars, _relType, _val);"
-	Gecode::linear(*(Space*)_solver->getSpace(), coeffs, vars, _relType, _val); 
+	Gecode::linear(*(Space*)space, coeffs, vars, _relType, _val); 
 }
 
 bool 
@@ -94,4 +94,26 @@ LinearConstraint::dependsOn(int id) const
 	return false;
 }
 
+const vector<int> *
+LinearConstraint::getVarsIDs() const
+{
+	return _varsIDs;
+}
+
+const vector<int> *
+LinearConstraint::getVarsCoeffs() const
+{
+	return _varsCoeffs;
+}
 
+IntRelType
+LinearConstraint::getRelType() const
+{
+	return _relType;
+}
+
+int
+LinearConstraint::getVal() const
+{
+	return _val;
+}
@@ -42,6 +42,7 @@ knowledge of the CeCILL-C license and that you accept its terms.
 #include "gecode_headers.hpp"
 
 class Solver;
+class CustomSpace;
 
 ///////////////////////////////////////////////////////////////////////
 //
@@ -70,12 +71,18 @@ public :
 	LinearConstraint(Solver *s, vector<int> *varsIDs, vector<int> *varsCoeffs, IntRelType relType, int val);
 	~LinearConstraint();
 
-	// add the constraint to Gecode's space
-	void addToSpace() const;	
+	// add the constraint to a Gecode's space
+	void addToSpace(CustomSpace *space) const;	
 
 	// TRUE if the constraint implicated the variable whith the id 'i'
 	bool dependsOn(int i) const;	
 
+	// access to the linear combination
+	const vector<int> *getVarsIDs() const;
+	const vector<int> *getVarsCoeffs() const;
+	IntRelType getRelType() const;
+	int getVal() const;
+
 };
 
 #endif
\ No newline at end of file
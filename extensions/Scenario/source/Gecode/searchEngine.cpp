@@ -40,6 +40,35 @@ knowledge of the CeCILL-C license and that you accept its terms.
 
 #include "customSpace.hpp"
 
+SearchBudget::SearchBudget(int time, unsigned long nodes)
+: _start(std::chrono::steady_clock::now()), _time(time), _nodes(nodes), _cancelled(false)
+{
+}
+
+void
+SearchBudget::cancel()
+{
+	_cancelled = true;
+}
+
+double
+SearchBudget::elapsed() const
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _start).count();
+}
+
+bool
+SearchBudget::stop(const Search::Statistics& s, const Search::Options& o)
+{
+	if (_cancelled)
+		return true;
+
+	if (_nodes && s.node >= _nodes)
+		return true;
+
+	return _time && elapsed() >= _time;
+}
+
 SearchEngine::SearchEngine(CustomSpace *space)
 //TODO: avant ":_bab(space, Search::Config::c_d, Search::Config::a_d, NULL)"
 :_bab(space)
@@ -65,5 +94,22 @@ SearchEngine::next()
 int
 SearchEngine::getMemoryPeak()
 {
-	return 0;// _bab.statistics().memory;
+#if GECODE_VERSION_NUMBER < 400000
+	return _bab.statistics().memory;
+#else
+	// note : Gecode 4 doesn't measure the memory anymore
+	return 0;
+#endif
+}
+
+unsigned long
+SearchEngine::getNodes() const
+{
+	return _bab.statistics().node;
+}
+
+unsigned long
+SearchEngine::getFails() const
+{
+	return _bab.statistics().fail;
 }
@@ -41,8 +41,45 @@ knowledge of the CeCILL-C license and that you accept its terms.
 
 #include "gecode_headers.hpp"
 
+#include <atomic>
+#include <chrono>
+
 class CustomSpace;
 
+///////////////////////////////////////////////////////////////////////
+//
+// The search budget stops a search after a time or a number of nodes
+// or when it is cancelled from another thread
+//
+///////////////////////////////////////////////////////////////////////
+
+class SearchBudget : public Search::Stop {
+
+private :
+
+	std::chrono::steady_clock::time_point _start;
+
+	// maximal time in millisecond and maximal number of nodes (0 means no limit)
+	int _time;
+	unsigned long _nodes;
+
+	std::atomic<bool> _cancelled;
+
+public :
+
+	SearchBudget(int time, unsigned long nodes);
+
+	// stop the search as soon as possible
+	void cancel();
+
+	// time spent since the creation of the budget in millisecond
+	double elapsed() const;
+
+	// Called by the search engine
+	virtual bool stop(const Search::Statistics& s, const Search::Options& o);
+
+};
+
 ///////////////////////////////////////////////////////////////////////
 //
 // The search engine finds the solutions for a given system (space)
@@ -63,6 +100,10 @@ public :
 	CustomSpace* next();
 	int getMemoryPeak();
 
+	// number of nodes and fails explored until now
+	unsigned long getNodes() const;
+	unsigned long getFails() const;
+
 };
 
 #endif
\ No newline at end of file
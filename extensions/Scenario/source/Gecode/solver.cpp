@@ -43,24 +43,40 @@ knowledge of the CeCILL-C license and that you accept its terms.
 #include "linearConstraint.hpp"
 #include "relations_type.hpp"
 #include "searchEngine.hpp"
+#include "temporalNetwork.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
 
 #if GECODE_VERSION_NUMBER < 400000
 #define LinIntExpr LinExpr
 #endif
 Solver::Solver()
-  : _space(new CustomSpace()),
+  : _modelChanged(true),
     _integerVariablesMap(new map<int, IntegerVariable*>),
     _constraintsMap(new map<int, LinearConstraint*>),
-    _engine(new SearchEngine(_space)),
+    _network(new TemporalNetwork(_integerVariablesMap, _constraintsMap)),
     _strongVars(NULL),
     _suggest(false),
-    _maxModification(NO_MAX_MODIFICATION)
+    _maxModification(NO_MAX_MODIFICATION),
+    _batch(false),
+    _pendingSolve(false),
+    _batchMaxModification(NO_MAX_MODIFICATION),
+    _searchTime(SOLVER_SEARCH_TIME),
+    _searchNodes(0),
+    _searchObjective(NO_SEARCH_OBJECTIVE),
+    _anytime(false),
+    _searchThreads(SOLVER_SEARCH_THREADS),
+    _deterministic(false)
 {
 
 }
 
 Solver::~Solver()
 {
+	stopRefinements();
+
 	map<int, IntegerVariable*>::iterator p;
 	for (p = _integerVariablesMap->begin(); p != _integerVariablesMap->end(); p++)
 	{
@@ -70,11 +86,11 @@ Solver::~Solver()
 	delete(_integerVariablesMap);
 	_integerVariablesMap = NULL;
 
-	if (_space)
-	{
-		delete(_space);
-		_space = NULL;
-	}
+	delete(_network);
+	_network = NULL;
+
+	clearComponents();
+
 }
 
 // find the Gecode relation type corresponding to a binary relation
@@ -129,12 +145,6 @@ Solver::findNewVariableID() const
 	return newID;
 }
 
-CustomSpace*
-Solver::getSpace() const
-{
-	return _space;
-}
-
 // find an IntegerVariable from its ID
 IntegerVariable *
 Solver::varFromID(int varID) const
@@ -152,37 +162,44 @@ Solver::constraintFromID(int constID) const
 int
 Solver::addIntVar(int min, int max, int val, int weight)
 {
-	// to each abstract variable we associate 4 Gecode variable
-	// usefull to minimize the variations
-	int index = _space->addVariable(min, max);
-	int pdelta = _space->addVariable(0, max);
-	int ndelta = _space->addVariable(0, max);
-	int total = _space->addVariable(min, max);
-
 	// tha abstract variable, i.e. the variable for the solver user
-	IntegerVariable *newVar = new IntegerVariable(min, max, val, index, weight, pdelta, ndelta, total);
+	// note : its 4 Gecode variables are created when the model is rebuilt (see in updateState)
+	IntegerVariable *newVar = new IntegerVariable(min, max, val, -1, weight, -1, -1, -1);
 	int newID = findNewVariableID();
 	_integerVariablesMap->insert(pair<int, IntegerVariable*>(newID, newVar));
 
+	stopRefinements();
+	_modelChanged = true;
+	_network->structureChanged();
+
 	return newID;
 }
 
 int
 Solver::setIntVar(int id, int min, int max, int val, int weight)
 {
-	//removeIntVar(id);
+	// tha abstract variable, i.e. the variable for the solver user
+	// note : its 4 Gecode variables are created when the model is rebuilt (see in updateState)
+	IntegerVariable *newVar = new IntegerVariable(min, max, val, -1, weight, -1, -1, -1);
 
-	// to each abstract variable we associate 4 Gecode variable
-	// usefull to minimize the variations
-	int index = _space->addVariable(min, max);
-	int pdelta = _space->addVariable(0, max);
-	int ndelta = _space->addVariable(0, max);
-	int total = _space->addVariable(min, max);
+	stopRefinements();
 
-	// tha abstract variable, i.e. the variable for the solver user
-	IntegerVariable *newVar = new IntegerVariable(min, max, val, index, weight, pdelta, ndelta, total);
+	map<int, IntegerVariable*>::iterator p = _integerVariablesMap->find(id);
+	if (p != _integerVariablesMap->end())
+	{
+		delete(p->second);
+		p->second = newVar;
+		_network->variableChanged(id);
 
-	(*_integerVariablesMap)[id] = newVar;
+		// only the model of its component needs to be posted again
+		invalidateVariable(id);
+	}
+	else
+	{
+		(*_integerVariablesMap)[id] = newVar;
+		_network->structureChanged();
+		_modelChanged = true;
+	}
 
 	return id;
 }
@@ -194,10 +211,15 @@ Solver::removeIntVar(int varID)
 	if (p == _integerVariablesMap->end())
 		return false;
 
+	stopRefinements();
+
 	IntegerVariable *oldVar = p->second;
 	delete(oldVar);
 	_integerVariablesMap->erase(p);
 
+	_modelChanged = true;
+	_network->structureChanged();
+
 	vector<int> constraintsToRemove;
 
 	map<int, LinearConstraint*>::iterator i;
@@ -241,6 +263,10 @@ Solver::addConstraint(int *varsIDs, int *varsCoeffs, int nbVars, int relType, in
 	// insert the constraint in the map
 	_constraintsMap->insert(pair<int, LinearConstraint*>(newID, newCst));
 
+	stopRefinements();
+	_modelChanged = true;
+	_network->structureChanged();
+
     return newID;
 }
 
@@ -251,131 +277,426 @@ Solver::removeConstraint(int constID)
 	if (p == _constraintsMap->end())
 		return false;
 
+	stopRefinements();
+
 	delete(p->second);
 	_constraintsMap->erase(p);
 
+	_modelChanged = true;
+	_network->structureChanged();
+
 	return true;
 }
 
-// rebuild a Gecode space with the current variable and constraints
+// find the root of a variable in the union-find forest used to gather the components
+static int
+findComponentRoot(map<int, int> &parent, int varID)
+{
+	int root = varID;
+	while (parent[root] != root)
+		root = parent[root];
+
+	// path compression
+	while (parent[varID] != root)
+	{
+		int next = parent[varID];
+		parent[varID] = root;
+		varID = next;
+	}
+
+	return root;
+}
+
+// delete all the components and their Gecode models
+void
+Solver::clearComponents()
+{
+	stopRefinements();
+
+	for (unsigned int i=0; i<_components.size(); i++)
+	{
+		delete _components[i]->space;
+		delete _components[i]->result;
+		delete _components[i];
+	}
+
+	_components.clear();
+	_componentOfVar.clear();
+}
+
+// forget the Gecode model of the component of a variable which bounds changed
+void
+Solver::invalidateVariable(int varID)
+{
+	if (_modelChanged)
+		return;
+
+	map<int, SolverComponent*>::iterator p = _componentOfVar.find(varID);
+	if (p == _componentOfVar.end())
+		return;
+
+	delete p->second->space;
+	p->second->space = NULL;
+}
+
+// gather the variables into the connected components of the constraint graph
+// note : the Gecode model of a component is posted when it needs to be solved (see in buildComponent)
 void
 Solver::updateState()
 {
-	if (_space)
+	if (!_modelChanged)
+		return;
+
+	clearComponents();
+
+	map<int, int> parent;
+
+	for (map<int, IntegerVariable*>::iterator q = _integerVariablesMap->begin(); q != _integerVariablesMap->end(); q++)
+		parent[q->first] = q->first;
+
+	// merge the variables of each constraint
+	for (map<int, LinearConstraint*>::iterator p = _constraintsMap->begin(); p != _constraintsMap->end(); p++)
 	{
-		delete _space;
-		_space = NULL;
+		const vector<int> *ids = (p->second)->getVarsIDs();
+		int root = findComponentRoot(parent, ids->at(0));
+
+		for (unsigned int i=1; i<ids->size(); i++)
+		{
+			int other = findComponentRoot(parent, ids->at(i));
+			if (other != root)
+				parent[other] = root;
+		}
 	}
 
-	_space = new CustomSpace();
+	// create a component for each root
+	map<int, SolverComponent*> roots;
 
-	// create gecode variables
 	for (map<int, IntegerVariable*>::iterator q = _integerVariablesMap->begin(); q != _integerVariablesMap->end(); q++)
 	{
-		IntegerVariable *v = q->second;
+		int root = findComponentRoot(parent, q->first);
+		SolverComponent *component;
 
-		if ((_suggest) && (_maxModification != NO_MAX_MODIFICATION)) {
-			v->adjustMinMax(_suggest, _maxModification);
-		} else {
-			v->adjustMinMax(_suggest);
+		map<int, SolverComponent*>::iterator r = roots.find(root);
+		if (r == roots.end())
+		{
+			component = new SolverComponent();
+			component->space = NULL;
+			component->result = NULL;
+			component->solved = false;
+			component->refinement = NULL;
+
+			roots[root] = component;
+			_components.push_back(component);
 		}
+		else
+			component = r->second;
 
+		component->varsIDs.push_back(q->first);
+		_componentOfVar[q->first] = component;
+	}
+
+	for (map<int, LinearConstraint*>::iterator p = _constraintsMap->begin(); p != _constraintsMap->end(); p++)
+		_componentOfVar[(p->second)->getVarsIDs()->at(0)]->constraintsIDs.push_back(p->first);
+
+	_modelChanged = false;
+}
 
-		v->setIndex(_space->addVariable(v->getVal(), v->getVal()));
-		v->setPosDeltaIndex(_space->addVariable(0, v->getMax() - v->getVal() + 1));
-		v->setNegDeltaIndex(_space->addVariable(0, v->getVal() - v->getMin() + 1));
-		v->setTotalIndex(_space->addVariable(v->getMin(), v->getMax()));
+// post the Gecode model of a component
+// note : the bounds depending on the current values are not posted here (see in editState)
+void
+Solver::buildComponent(SolverComponent *component)
+{
+	// each variable has 4 Gecode variables : the array is sized once
+	CustomSpace *space = new CustomSpace(4 * component->varsIDs.size());
+
+	// create gecode variables with their widest domains
+	// note : the index can be one step out of the bounds as the current value can be
+	for (unsigned int i=0; i<component->varsIDs.size(); i++)
+	{
+		IntegerVariable *v = varFromID(component->varsIDs[i]);
+		int range = v->getSupBound() - v->getInfBound() + 2;
+
+		v->setIndex(space->addVariable(v->getInfBound() - 1, v->getSupBound() + 1));
+		v->setPosDeltaIndex(space->addVariable(0, range));
+		v->setNegDeltaIndex(space->addVariable(0, range));
+		v->setTotalIndex(space->addVariable(v->getInfBound(), v->getSupBound()));
 	}
 
 	// add constraints to space
-	for (map<int, LinearConstraint*>::iterator p = _constraintsMap->begin(); p != _constraintsMap->end(); p++)
+	for (unsigned int i=0; i<component->constraintsIDs.size(); i++)
 	{
-		(p->second)->addToSpace();
+		constraintFromID(component->constraintsIDs[i])->addToSpace(space);
 	}
 
 	LinIntExpr expr;
 	bool init=false;
 
 	// construct the linear combination of delta variables balanced by the weight associated with their type
-	for (map<int, IntegerVariable*>::iterator q = _integerVariablesMap->begin(); q != _integerVariablesMap->end(); q++)
+	for (unsigned int i=0; i<component->varsIDs.size(); i++)
 	{
-		IntegerVariable *currVar = q->second;
-
-		// add a delta variable for each beginning or length
-		int multiplier = 1;
-
-		bool isStrong = false;
-
-		// give more weight to the edited variables
-		if (_suggest)
-		{
-			for (unsigned int i=0; i<_strongVars->size(); i++)
-				if (_strongVars->at(i) == q->first)
-				{
-					isStrong = true;
-					//multiplier = 10;
-					break;
-				}
-		}
+		IntegerVariable *currVar = varFromID(component->varsIDs[i]);
 
 		IntVarArgs vars(4);
 		IntArgs coeffs(4);
 
-		if (isStrong) {
-			vars[0] = _space->getIntVar(currVar->getTotalIndex());
-			vars[1] = _space->getIntVar(currVar->getIndex());
-			vars[2] = _space->getIntVar(currVar->getTotalIndex());
-			vars[3] = _space->getIntVar(currVar->getIndex());
-
-			coeffs[0] = -1;
-			coeffs[1] = 1;
-			coeffs[2] = -1;
-			coeffs[3] = 1;
-		} else {
-			// constraint : <initial or wanted value> + <positive delta> - <negative delta> = <optimal value>
-			vars[0] = _space->getIntVar(currVar->getNegDeltaIndex());
-			vars[1] = _space->getIntVar(currVar->getPosDeltaIndex());
-			vars[2] = _space->getIntVar(currVar->getTotalIndex());
-			vars[3] = _space->getIntVar(currVar->getIndex());
-			coeffs[0] = -1;
-			coeffs[1] = 1;
-			coeffs[2] = 1;
-			coeffs[3] = -1;
-		}
+		// constraint : <initial or wanted value> + <positive delta> - <negative delta> = <optimal value>
+		// note : both deltas of the edited variables are null (see in editState)
+		vars[0] = space->getIntVar(currVar->getNegDeltaIndex());
+		vars[1] = space->getIntVar(currVar->getPosDeltaIndex());
+		vars[2] = space->getIntVar(currVar->getTotalIndex());
+		vars[3] = space->getIntVar(currVar->getIndex());
+		coeffs[0] = -1;
+		coeffs[1] = 1;
+		coeffs[2] = 1;
+		coeffs[3] = -1;
 
-		linear(*_space, coeffs, vars, IRT_EQ, 0);
+		linear(*space, coeffs, vars, IRT_EQ, 0);
 
 		// construction of the objective function
 		if (!init)
 		{
-			expr = LinIntExpr(vars[0], currVar->getWeight()*multiplier);
+			expr = LinIntExpr(vars[0], currVar->getWeight());
 
 			init = true;
 
-			LinIntExpr tmp(vars[1], currVar->getWeight()*multiplier);
+			LinIntExpr tmp(vars[1], currVar->getWeight());
 
 			expr = LinIntExpr(expr, Gecode::LinIntExpr::NT_ADD, tmp);
 		}
 		else
 		{
-			LinIntExpr tmp(vars[0], currVar->getWeight()*multiplier);
+			LinIntExpr tmp(vars[0], currVar->getWeight());
 
 			expr = LinIntExpr(expr, Gecode::LinIntExpr::NT_ADD, tmp);
 
-			tmp = LinIntExpr(vars[1], currVar->getWeight()*multiplier);
+			tmp = LinIntExpr(vars[1], currVar->getWeight());
 
 			expr = LinIntExpr(expr, Gecode::LinIntExpr::NT_ADD, tmp);
 		}
 	}
 
 	// the objective function is a linear combination of the delta variables (lengths are more important than beginnings)
-	_space->setObjFunc(Gecode::expr(*_space, expr));
+	space->setObjFunc(Gecode::expr(*space, expr));
+
+	// propagate once : a space have to be stable to be cloned
+	space->status();
+
+	component->space = space;
+}
+
+// bound a variable around its current value
+// returns the value the variable have to reach (if it is strong) or to stay close to
+int
+Solver::adjustVariable(IntegerVariable *v) const
+{
+	if ((_suggest) && (_maxModification != NO_MAX_MODIFICATION)) {
+		v->adjustMinMax(_suggest, _maxModification);
+	} else {
+		v->adjustMinMax(_suggest);
+	}
+
+	int val = v->getVal();
+
+	if (val < v->getInfBound() - 1)
+		val = v->getInfBound() - 1;
+
+	if (val > v->getSupBound() + 1)
+		val = v->getSupBound() + 1;
+
+	return val;
+}
+
+// copy the model of a component and bound each variable around its current value
+CustomSpace *
+Solver::editState(SolverComponent *component, bool fixed, const set<int> *strongVars)
+{
+	CustomSpace *edit = (CustomSpace*)component->space->clone(false);
+
+	for (unsigned int i=0; i<component->varsIDs.size(); i++)
+	{
+		IntegerVariable *v = varFromID(component->varsIDs[i]);
+		int val = adjustVariable(v);
+
+		// the edited variables have to reach their value
+		bool isStrong = fixed || strongVars->count(component->varsIDs[i]);
+
+		rel(*edit, edit->getIntVar(v->getIndex()), IRT_EQ, val);
+		rel(*edit, edit->getIntVar(v->getPosDeltaIndex()), IRT_LQ, isStrong ? 0 : v->getMax() - val + 1);
+		rel(*edit, edit->getIntVar(v->getNegDeltaIndex()), IRT_LQ, isStrong ? 0 : val - v->getMin() + 1);
+		dom(*edit, edit->getIntVar(v->getTotalIndex()), v->getMin(), v->getMax());
+
+		if (edit->failed())
+			break;
+	}
+
+	return edit;
+}
+
+// find the best solution of a component
+// note : components are independent so they can be solved in parallel
+bool
+Solver::solveComponent(SolverComponent *component, const set<int> *strongVars, unsigned int threads)
+{
+	component->statistics = SolverStatistics();
+
+	component->solved = false;
+
+	// a variable without constraint only needs to stay into its bounds
+	if (component->constraintsIDs.empty())
+	{
+		for (unsigned int i=0; i<component->varsIDs.size(); i++)
+		{
+			IntegerVariable *v = varFromID(component->varsIDs[i]);
+			adjustVariable(v);
+
+			if (strongVars->count(component->varsIDs[i]) && (v->getVal() < v->getMin() || v->getVal() > v->getMax()))
+				return false;
+		}
+
+		component->solved = true;
+		return true;
+	}
+
+	if (!component->space)
+		buildComponent(component);
+
+	// the model can't be solved whatever the values are
+	if (component->space->failed())
+		return false;
+
+	// warm start : most of the time the edited variables reach their new values without moving the others
+	// so the previous solution is tried first by propagation only (its objective is null so it is the best)
+	CustomSpace *edit = editState(component, true, strongVars);
+
+	if (!edit->failed() && edit->status() != SS_FAILED && edit->isAssigned())
+	{
+		component->result = edit;
+		component->solved = true;
+		return true;
+	}
+
+	delete edit;
+
+	// else search the best solution moving the other variables
+	edit = editState(component, false, strongVars);
+
+	if (edit->failed())
+	{
+		delete edit;
+		return false;
+	}
+
+	// branch variables
+	edit->doBranching();
+
+	component->result = run(edit, component, threads);
+	component->solved = component->result != NULL;
+
+	delete edit;
+
+	return component->solved;
+}
+
+// solve several components, in parallel if there are enough of them
+bool
+Solver::solveComponents(const vector<SolverComponent*> &components, const set<int> *strongVars)
+{
+	unsigned int nbThreads = std::thread::hardware_concurrency();
+
+	if (nbThreads > components.size())
+		nbThreads = components.size();
+
+	if (components.size() < SOLVER_PARALLEL_COMPONENTS || nbThreads < 2)
+	{
+		unsigned int searchThreads = _searchThreads ? _searchThreads : std::thread::hardware_concurrency();
+
+		for (unsigned int i=0; i<components.size(); i++)
+			if (!solveComponent(components[i], strongVars, searchThreads))
+				break;
+	}
+	else
+	{
+		std::atomic<unsigned int> next(0);
+		vector<std::thread> threads;
+
+		for (unsigned int t=0; t<nbThreads; t++)
+			threads.push_back(std::thread([this, &components, &next, strongVars]()
+			{
+				unsigned int i;
+				while ((i = next++) < components.size())
+					solveComponent(components[i], strongVars, 1);
+			}));
+
+		for (unsigned int t=0; t<threads.size(); t++)
+			threads[t].join();
+	}
+
+	bool res = true;
+	for (unsigned int i=0; i<components.size(); i++)
+		res = res && components[i]->solved;
+
+	// store the new values only if every component is solved
+	for (unsigned int i=0; i<components.size(); i++)
+	{
+		SolverComponent *component = components[i];
+
+		for (unsigned int j=0; res && j<component->varsIDs.size(); j++)
+		{
+			IntegerVariable *v = varFromID(component->varsIDs[j]);
+
+			if (component->result)
+				v->updateValue(component->result);
+			else if (v->getVal() < v->getMin())
+				v->updateValue(v->getMin());
+			else if (v->getVal() > v->getMax())
+				v->updateValue(v->getMax());
+		}
+
+		delete component->result;
+		component->result = NULL;
+		component->solved = false;
+	}
+
+	// the better solutions of a rejected edition are useless
+	if (res)
+		startRefinements(components);
+	else
+		for (unsigned int i=0; i<components.size(); i++)
+			stopRefinement(components[i]);
+
+	return res;
 }
 
 // edit some variables and try to reach the new values
 bool
 Solver::suggestValues(int *varsIDs, unsigned int* values, int nbVars, int maxModification)
 {
+	// the better solutions found in background are obsolete
+	stopRefinements();
+
+	// during an edition transaction the values are only stored (see in endEdition)
+	if (_batch)
+	{
+		bool first = _batchVars.empty();
+
+		for (int i=0; i<nbVars; i++)
+		{
+			map<int, IntegerVariable*>::iterator p = _integerVariablesMap->find(varsIDs[i]);
+			if (p == _integerVariablesMap->end())
+				return false;
+
+			(p->second)->updateValue(values[i]);
+			_batchVars.push_back(varsIDs[i]);
+		}
+
+		// the widest modification of the transaction is allowed
+		if (first || maxModification == NO_MAX_MODIFICATION || (_batchMaxModification != NO_MAX_MODIFICATION && maxModification > _batchMaxModification))
+			_batchMaxModification = maxModification;
+
+		_pendingSolve = true;
+		return true;
+	}
+
 	_suggest = true;
 
 	_maxModification = maxModification;
@@ -399,6 +720,9 @@ Solver::suggestValues(int *varsIDs, unsigned int* values, int nbVars, int maxMod
 
 	bool res = updateVariablesValues();
 
+	if (!res)
+		explainFailure();
+
 	_strongVars->clear();
 	delete _strongVars;
 	_strongVars = NULL;
@@ -408,89 +732,386 @@ Solver::suggestValues(int *varsIDs, unsigned int* values, int nbVars, int maxMod
 	return res;
 }
 
+void
+Solver::beginEdition()
+{
+	_batch = true;
+}
+
 bool
-Solver::updateVariablesValues()
+Solver::endEdition()
 {
-	CustomSpace *result = solve();
+	_batch = false;
 
-	if (result == NULL) {
-		return false;
-	}
+	if (!_pendingSolve)
+		return true;
 
+	_pendingSolve = false;
 
-	if (_space)
+	bool res;
+
+	if (_batchVars.empty())
+		res = updateVariablesValues();
+	else
 	{
-		delete _space;
-		_space = NULL;
+		_suggest = true;
+		_maxModification = _batchMaxModification;
+		_strongVars = &_batchVars;
+
+		res = updateVariablesValues();
+
+		if (!res)
+			explainFailure();
+
+		_strongVars = NULL;
+		_suggest = false;
+		_maxModification = NO_MAX_MODIFICATION;
 	}
-	_space = (CustomSpace*)result->clone(false);
-	delete result; // des fois a merde !!!
 
-	for (map<int, IntegerVariable*>::iterator q = _integerVariablesMap->begin(); q != _integerVariablesMap->end(); q++)
-		(q->second)->updateValue(_space);
+	_batchVars.clear();
+	_batchMaxModification = NO_MAX_MODIFICATION;
 
-	return true;
+	return res;
 }
 
-CustomSpace *
-Solver::solve()
+bool
+Solver::updateVariablesValues()
 {
+	// during an edition transaction the solving is deferred (see in endEdition)
+	if (_batch)
+	{
+		_pendingSolve = true;
+		return true;
+	}
+
+	stopRefinements();
+
+	_statistics = SolverStatistics();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	// most of the editions only push a few variables : try to reposition them without any search
+	if (_network->solve(_strongVars, _suggest, _maxModification))
+	{
+		_statistics.elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		return true;
+	}
+
 	updateState();
 
-	// branch variables
-	_space->doBranching();
+	set<int> strongVars;
+	vector<SolverComponent*> components;
 
-	return run();
-}
+	// only the components of the edited variables need to be solved
+	if (_suggest && _strongVars)
+	{
+		set<SolverComponent*> touched;
 
+		for (unsigned int i=0; i<_strongVars->size(); i++)
+		{
+			SolverComponent *component = _componentOfVar[_strongVars->at(i)];
 
-// Returns the best solution, NULL if the system can't be solved
-CustomSpace *
-Solver::run()
-{
-	if (_engine)
+			strongVars.insert(_strongVars->at(i));
+
+			if (touched.insert(component).second)
+				components.push_back(component);
+		}
+	}
+	else
+		components = _components;
+
+	bool res = solveComponents(components, &strongVars);
+
+	for (unsigned int i=0; i<components.size(); i++)
 	{
-		delete (_engine);
-		_engine = NULL;
+		_statistics.nodes += components[i]->statistics.nodes;
+		_statistics.fails += components[i]->statistics.fails;
+
+		if (components[i]->statistics.memoryPeak > _statistics.memoryPeak)
+			_statistics.memoryPeak = components[i]->statistics.memoryPeak;
 	}
 
-	Search::TimeStop* ts = new Search::TimeStop(100);
+	_statistics.elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	return res;
+}
+
+// Returns the best solution found within the search budget, NULL if the system can't be solved
+// in anytime mode the first solution is returned and the search goes on in background (see in refine)
+CustomSpace *
+Solver::run(CustomSpace *space, SolverComponent *component, unsigned int threads)
+{
+	SearchBudget *budget = new SearchBudget(_searchTime, _searchNodes);
 	Search::Options o;
 
-	o.stop = ts;
+	o.stop = budget;
+	o.threads = threads > 1 ? threads : 1;
+
+	// a parallel search can find any of the solutions having the same objective
+	// note : a single thread search is also replayed (see below) so the result is the same whatever the number of threads is
+	bool deterministic = _deterministic;
 
-	_engine = new SearchEngine(_space, o);
+	SearchEngine *engine = new SearchEngine(space, o);
 
 	CustomSpace *last = NULL;
 
 	while (true)
 	{
-		CustomSpace *ex = _engine->next();
+		CustomSpace *ex = engine->next();
 
 		// When there's no better solution, stop the search
 		if (ex == NULL)
 			break;
 
-		if (last)
+		// note : each solution is better than the previous one so it is kept without copy
+		delete last;
+		last = ex;
+
+		// the solution is good enough
+		if (_searchObjective != NO_SEARCH_OBJECTIVE && last->getObjFunc() <= _searchObjective)
+			break;
+
+		// a better solution is maybe still possible : go on searching in background
+		// note : the refinement is started only if the other components are solved too (see in solveComponents)
+		if (_anytime && !deterministic && last->getObjFunc() > 0)
 		{
-			delete last; // des fois a merde !!!
-			last = NULL;
-		}
+			component->statistics.nodes = engine->getNodes();
+			component->statistics.fails = engine->getFails();
+			component->statistics.memoryPeak = engine->getMemoryPeak();
+
+			SolverRefinement *refinement = new SolverRefinement();
+			refinement->engine = engine;
+			refinement->budget = budget;
+			refinement->objective = _searchObjective;
+			refinement->best = NULL;
+			refinement->finished = false;
 
-		last = (CustomSpace*)ex->clone(false);
-		delete(ex);
+			component->refinement = refinement;
+
+			return last;
+		}
 	}
 
-	delete ts;
+	component->statistics.nodes = engine->getNodes();
+	component->statistics.fails = engine->getFails();
+	component->statistics.memoryPeak = engine->getMemoryPeak();
+
+	delete engine;
+	delete budget;
+
+	// the first solution reaching the best objective in depth first order from the root is reproducible across thread counts
+	// (it is not always the last solution of a sequential branch and bound : the bound changes the search order)
+	// note : this is only true if the first search was not stopped by the budget
+	if (last && deterministic)
+	{
+		space->status();
+		CustomSpace *bounded = (CustomSpace*)space->clone(false);
+		bounded->boundObjFunc(last->getObjFunc());
+
+		SearchBudget sequentialBudget(_searchTime, _searchNodes);
+		Search::Options so;
+
+		so.stop = &sequentialBudget;
+
+		SearchEngine *sequential = new SearchEngine(bounded, so);
+		CustomSpace *first = sequential->next();
+
+		if (first)
+		{
+			delete last;
+			last = first;
+		}
+
+		component->statistics.nodes += sequential->getNodes();
+		component->statistics.fails += sequential->getFails();
+
+		delete sequential;
+		delete bounded;
+	}
 
 	return last;
 }
 
+// search better solutions until the end of the budget (running in a background thread)
+void
+Solver::refine(SolverRefinement *refinement)
+{
+	while (true)
+	{
+		CustomSpace *ex = refinement->engine->next();
+
+		if (ex == NULL)
+			break;
+
+		int objective = ex->getObjFunc();
+
+		{
+			std::lock_guard<std::mutex> lock(refinement->mutex);
+			delete refinement->best;
+			refinement->best = ex;
+		}
+
+		if (refinement->objective != NO_SEARCH_OBJECTIVE && objective <= refinement->objective)
+			break;
+	}
+
+	refinement->finished = true;
+}
+
+void
+Solver::startRefinements(const vector<SolverComponent*> &components)
+{
+	for (unsigned int i=0; i<components.size(); i++)
+	{
+		SolverRefinement *refinement = components[i]->refinement;
+
+		if (refinement && !refinement->thread.joinable())
+			refinement->thread = std::thread(&Solver::refine, refinement);
+	}
+}
+
+void
+Solver::stopRefinement(SolverComponent *component)
+{
+	SolverRefinement *refinement = component->refinement;
+
+	if (!refinement)
+		return;
+
+	refinement->budget->cancel();
+
+	if (refinement->thread.joinable())
+		refinement->thread.join();
+
+	delete refinement->best;
+	delete refinement->engine;
+	delete refinement->budget;
+	delete refinement;
+
+	component->refinement = NULL;
+}
+
+void
+Solver::stopRefinements()
+{
+	for (unsigned int i=0; i<_components.size(); i++)
+		stopRefinement(_components[i]);
+}
+
+bool
+Solver::applyRefinements()
+{
+	bool changed = false;
+
+	for (unsigned int i=0; i<_components.size(); i++)
+	{
+		SolverComponent *component = _components[i];
+		SolverRefinement *refinement = component->refinement;
+
+		if (!refinement)
+			continue;
+
+		CustomSpace *best;
+		{
+			std::lock_guard<std::mutex> lock(refinement->mutex);
+			best = refinement->best;
+			refinement->best = NULL;
+		}
+
+		if (best)
+		{
+			for (unsigned int j=0; j<component->varsIDs.size(); j++)
+				varFromID(component->varsIDs[j])->updateValue(best);
+
+			delete best;
+			changed = true;
+		}
+
+		if (refinement->finished)
+		{
+			component->statistics.nodes = refinement->engine->getNodes();
+			component->statistics.fails = refinement->engine->getFails();
+			stopRefinement(component);
+		}
+	}
+
+	return changed;
+}
+
+bool
+Solver::isRefining() const
+{
+	for (unsigned int i=0; i<_components.size(); i++)
+		if (_components[i]->refinement)
+			return true;
+
+	return false;
+}
+
+void
+Solver::setSearchOptions(int time, unsigned long nodes, int objective, bool anytime)
+{
+	stopRefinements();
+
+	_searchTime = time;
+	_searchNodes = nodes;
+	_searchObjective = objective;
+	_anytime = anytime;
+}
+
+void
+Solver::setSearchThreads(unsigned int threads, bool deterministic)
+{
+	stopRefinements();
+
+	_searchThreads = threads;
+	_deterministic = deterministic;
+}
+
+// note : the bounds of the variables are still adjusted for the edition
+// and the conflict can only be in the components of the edited variables (see in updateVariablesValues)
+void
+Solver::explainFailure()
+{
+	_conflict = SolverConflict();
+
+	if (!_strongVars)
+		return;
+
+	set<SolverComponent*> touched;
+	vector<int> varsIDs, constraintsIDs;
+
+	for (unsigned int i=0; i<_strongVars->size(); i++)
+	{
+		map<int, SolverComponent*>::iterator p = _componentOfVar.find(_strongVars->at(i));
+		if (p == _componentOfVar.end())
+			return;
+
+		if (!touched.insert(p->second).second)
+			continue;
+
+		varsIDs.insert(varsIDs.end(), p->second->varsIDs.begin(), p->second->varsIDs.end());
+		constraintsIDs.insert(constraintsIDs.end(), p->second->constraintsIDs.begin(), p->second->constraintsIDs.end());
+	}
+
+	_conflict.explained = _network->explain(_strongVars, varsIDs, constraintsIDs, _conflict.constraintsIDs, _conflict.varsIDs, _conflict.nearestValue);
+}
+
+const SolverConflict &
+Solver::getConflict() const
+{
+	return _conflict;
+}
+
+const SolverStatistics &
+Solver::getStatistics() const
+{
+	return _statistics;
+}
+
 int
 Solver::getMemoryPeak()
 {
-	if (_engine) return _engine->getMemoryPeak();
-	return 0;
+	return _statistics.memoryPeak;
 }
 
 int
@@ -42,14 +42,128 @@ knowledge of the CeCILL-C license and that you accept its terms.
 #include "gecode_headers.hpp"
 #include "relations_type.hpp"
 
+#include <atomic>
+#include <mutex>
+#include <thread>
+
 class CustomSpace;
 class IntegerVariable;
 class LinearConstraint;
+class SearchBudget;
 class SearchEngine;
+class TemporalNetwork;
 class linearConstraint;
 
 #define NO_MAX_MODIFICATION 0
 
+// the minimal number of components to solve them in parallel
+#define SOLVER_PARALLEL_COMPONENTS 4
+
+// the default time allowed to search a solution (in millisecond)
+#define SOLVER_SEARCH_TIME 100
+
+// the default number of threads of a search
+#define SOLVER_SEARCH_THREADS 1
+
+// no objective to reach : the search goes on until the best solution or the end of the budget
+#define NO_SEARCH_OBJECTIVE -1
+
+///////////////////////////////////////////////////////////////////////
+//
+// Statistics about the last solving
+//
+///////////////////////////////////////////////////////////////////////
+
+struct SolverStatistics {
+
+	SolverStatistics() : nodes(0), fails(0), elapsed(0.), memoryPeak(0) {}
+
+	// explored nodes and failures of the search engines
+	unsigned long nodes;
+	unsigned long fails;
+
+	// time spent in millisecond
+	double elapsed;
+
+	int memoryPeak;
+};
+
+///////////////////////////////////////////////////////////////////////
+//
+// Explanation of the last edition which can't be solved
+//
+///////////////////////////////////////////////////////////////////////
+
+struct SolverConflict {
+
+	SolverConflict() : explained(false), nearestValue(0) {}
+
+	// true if a minimal set of constraints in conflict have been found
+	// else the edition failed for another reason (a disequality or the end of the search budget)
+	bool explained;
+
+	// the constraints in conflict and the variables which bounds or edited values take part in the conflict
+	vector<int> constraintsIDs;
+	vector<int> varsIDs;
+
+	// the value of the first edited variable the closest to the edited one which can be reached
+	int nearestValue;
+};
+
+///////////////////////////////////////////////////////////////////////
+//
+// In anytime mode the first solution of a component is returned at once
+// and its search goes on in a background thread to find better ones
+// (see in Solver::applyRefinements).
+// The thread is only started once every component of the edition is solved
+// (see in Solver::solveComponents).
+//
+///////////////////////////////////////////////////////////////////////
+
+struct SolverRefinement {
+
+	SearchEngine *engine;
+	SearchBudget *budget;
+
+	// the objective to reach
+	int objective;
+
+	// the best solution found in background (NULL until a better one is found)
+	CustomSpace *best;
+	std::mutex mutex;
+
+	// not joinable until the refinement is started
+	std::thread thread;
+	std::atomic<bool> finished;
+};
+
+///////////////////////////////////////////////////////////////////////
+//
+// A connected component of the constraint graph : its variables only
+// depend on each other so it has its own Gecode model and it can be
+// solved alone (or in parallel with the other components).
+//
+///////////////////////////////////////////////////////////////////////
+
+struct SolverComponent {
+
+	// IDs of the variables and constraints of the component
+	vector<int> varsIDs;
+	vector<int> constraintsIDs;
+
+	// the posted model (NULL until the component needs to be solved)
+	CustomSpace *space;
+
+	// the last solution found
+	CustomSpace *result;
+	bool solved;
+
+	SolverStatistics statistics;
+
+	// the search going on in background (NULL if none)
+	SolverRefinement *refinement;
+};
+
 ///////////////////////////////////////////////////////////////////////
 //
 // Top-level interface for the Gecode Solver.
@@ -63,8 +177,13 @@ class Solver {
 
 private :
 
-	// Gecode space
-	CustomSpace *_space;
+	// The connected components of the constraint graph and the component of each variable ID
+	// the posted model of each component is kept alive across editions and only rebuilt when its variables or constraints change
+	vector<SolverComponent*> _components;
+	map<int, SolverComponent*> _componentOfVar;
+
+	// true if the components have to be gathered again before the next solving
+	bool _modelChanged;
 
 	// Hash table containing the currently used variables
 	map<int, IntegerVariable*> *_integerVariablesMap;
@@ -72,13 +191,36 @@ private :
 	// Hash table containing linear constraints
 	map<int, LinearConstraint*> *_constraintsMap;
 
-	// The search engine to find a solution
-	SearchEngine *_engine;
+	// The temporal network to reposition the variables without search when it is possible
+	TemporalNetwork *_network;
 
 private:
-	// Reloads all variables and constraints
+	// Gathers the variables into components (only if the model changed)
 	void updateState();
 
+	// Deletes all the components
+	void clearComponents();
+
+	// Forgets the model of the component of a variable
+	void invalidateVariable(int varID);
+
+	// Posts the model of a component
+	void buildComponent(SolverComponent *component);
+
+	// Bounds a variable around its current value and returns the value to reach
+	int adjustVariable(IntegerVariable *v) const;
+
+	// Returns a copy of the model of a component where each variable is bounded around its current value
+	// if fixed is true, every variable keeps its current value (used to try the previous solution first)
+	CustomSpace *editState(SolverComponent *component, bool fixed, const set<int> *strongVars);
+
+	// Finds the best solution of a component
+	// the search uses several threads if threads > 1
+	bool solveComponent(SolverComponent *component, const set<int> *strongVars, unsigned int threads);
+
+	// Solves several components then stores the new values if each one is solved
+	bool solveComponents(const vector<SolverComponent*> &components, const set<int> *strongVars);
+
 	// Get the relation type as defined by Gecode
 	static IntRelType getGecodeRelType(int relType);
 
@@ -86,8 +228,18 @@ private:
 	int findNewRelationID() const;
 	int findNewVariableID() const;
 
-	// Launch the search engine
-	CustomSpace *run();
+	// Launch the search engine on a space
+	CustomSpace *run(CustomSpace *space, SolverComponent *component, unsigned int threads);
+
+	// Goes on searching better solutions in background (see in run)
+	static void refine(SolverRefinement *refinement);
+
+	// Starts the searches prepared by run for the components of an edition which is solved
+	void startRefinements(const vector<SolverComponent*> &components);
+
+	// Stops the searches going on in background
+	void stopRefinement(SolverComponent *component);
+	void stopRefinements();
 
 private:
 	// To put strong variables when edition
@@ -98,6 +250,39 @@ private:
 	
 	int _maxModification;
 
+	// true while an edition transaction is in progress (see beginEdition)
+	bool _batch;
+
+	// true if a solving have been deferred until the end of the edition transaction
+	bool _pendingSolve;
+
+	// edited variables and maximal modification of the edition transaction
+	vector<int> _batchVars;
+	int _batchMaxModification;
+
+	// maximal time (in millisecond) and maximal number of nodes of a search (0 means no limit)
+	int _searchTime;
+	unsigned long _searchNodes;
+
+	// the search stops as soon as a solution is good enough (NO_SEARCH_OBJECTIVE to find the best one)
+	int _searchObjective;
+
+	// true if the search goes on in background after the first solution
+	bool _anytime;
+
+	// number of threads of a search (0 means one per core)
+	unsigned int _searchThreads;
+
+	// true if a parallel search have to return the same solution as a sequential one
+	bool _deterministic;
+
+	SolverStatistics _statistics;
+
+	SolverConflict _conflict;
+
+	// Explain why the current edition can't be solved
+	void explainFailure();
+
 public :
 
 	Solver();
@@ -107,9 +292,6 @@ public :
 	IntegerVariable *varFromID(int varID) const;
 	LinearConstraint *constraintFromID(int constID) const;
 
-	// Accessor to the CustomSpace Pointer
-	CustomSpace *getSpace() const;
-
 	// inserts a new entry in the variables map and return the variable ID
 	int addIntVar(int min, int max, int val, int weight);
 	
@@ -127,9 +309,12 @@ public :
 	// check if the new value for the variable 'varID' is in the variable's domain
 	bool suggestValues(int *varsIDs, unsigned int* values, int nbVars, int maxModification = NO_MAX_MODIFICATION);
 
-	// find a solution to the system
-	// returns NULL if there's no solution
-	CustomSpace *solve();
+	// defer the solving of the next editions until endEdition
+	void beginEdition();
+
+	// solve once all the editions made since beginEdition
+	// returns false if there's no solution
+	bool endEdition();
 
 	// update the value of each variable
 	bool updateVariablesValues();
@@ -141,6 +326,26 @@ public :
 
 	int getMemoryPeak();
 
+	// set the budget of the next searches
+	void setSearchOptions(int time, unsigned long nodes, int objective, bool anytime);
+
+	// set the number of threads used to search a solution (0 means one per core)
+	// in deterministic mode the result is reproducible across thread counts (the best solution is searched again sequentially)
+	void setSearchThreads(unsigned int threads, bool deterministic);
+
+	// get the explanation of the last edition which can't be solved
+	const SolverConflict &getConflict() const;
+
+	// get statistics about the last solving
+	const SolverStatistics &getStatistics() const;
+
+	// in anytime mode, store the better solutions found in background since the last solving
+	// returns true if some values changed
+	bool applyRefinements();
+
+	// true if some searches are still going on in background
+	bool isRefining() const;
+
 private:
   Solver(const Solver &);
   Solver &operator=(const Solver &);
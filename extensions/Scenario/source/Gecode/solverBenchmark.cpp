@@ -0,0 +1,201 @@
+/*
+Copyright: LaBRI (http://www.labri.fr)
+
+Author(s): Bruno Valeze, Raphael Marczak
+Last modification: 08/03/2010
+
+Adviser(s): Myriam Desainte-Catherine (myriam.desainte-catherine@labri.fr)
+
+This software is a computer program whose purpose is to propose
+a library for interactive scores edition and execution.
+
+This software is governed by the CeCILL-C license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL-C
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL-C license and that you accept its terms.
+*/
+
+// Benchmark of the edition solver on large synthetic scores
+// usage : solverBenchmark [lanes] [boxes per lane] [editions] [threads...]
+// it prints the average time of an edition for each number of threads (0 means one per core)
+// then checks that the deterministic mode gives the same dates whatever the number of threads is
+
+#include "solver.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+// weights of the variables (see SolverVariableType in ScenarioSolver.h)
+#define BENCHMARK_DATE_VARIABLE 1
+#define BENCHMARK_RANGE_VARIABLE 100
+
+#define BENCHMARK_DURATION 36000000
+#define BENCHMARK_BOX_DURATION 1000
+
+struct BenchmarkScore {
+
+	Solver *solver;
+
+	// date and range variables of each event (lane by lane)
+	vector<int> dateIDs;
+	vector<int> rangeIDs;
+};
+
+// add an event at a date
+static int
+addEvent(BenchmarkScore &score, int date)
+{
+	score.dateIDs.push_back(score.solver->addIntVar(1, BENCHMARK_DURATION, date, BENCHMARK_DATE_VARIABLE));
+	score.rangeIDs.push_back(score.solver->addIntVar(0, BENCHMARK_DURATION, 0, BENCHMARK_RANGE_VARIABLE));
+
+	return score.dateIDs.size() - 1;
+}
+
+// add a box between two events (see SolverConstraint in ScenarioSolver.cpp)
+static void
+addBox(BenchmarkScore &score, int start, int end, int durationMin, int durationMax)
+{
+	int IDs[4] = {score.dateIDs[start], score.rangeIDs[start], score.dateIDs[end], score.rangeIDs[end]};
+	int coeffs[4] = {1, 1, -1, -1};
+
+	score.solver->addConstraint(IDs, coeffs, 4, REL_EQ, 0);
+
+	// (see SolverRelation in ScenarioSolver.cpp)
+	int boundIDs[2] = {score.dateIDs[end], score.dateIDs[start]};
+	int boundCoeffs[2] = {1, -1};
+
+	score.solver->addConstraint(boundIDs, boundCoeffs, 2, REL_GQ, durationMin);
+	score.solver->addConstraint(boundIDs, boundCoeffs, 2, REL_LQ, durationMax);
+}
+
+// each lane is a sequence of boxes and the lanes are linked together every 4 boxes
+// so the whole score is one component and most of the editions need a search
+static void
+buildScore(BenchmarkScore &score, int lanes, int boxes)
+{
+	for (int l=0; l<lanes; l++)
+	{
+		for (int b=0; b<=boxes; b++)
+		{
+			int e = addEvent(score, 1 + b * BENCHMARK_BOX_DURATION + l);
+
+			if (b > 0)
+				addBox(score, e - 1, e, BENCHMARK_BOX_DURATION / 2, BENCHMARK_BOX_DURATION * 2);
+
+			if (l > 0 && b % 4 == 0)
+				addBox(score, e - (boxes + 1), e, 0, BENCHMARK_BOX_DURATION / 4);
+		}
+	}
+
+	score.solver->updateVariablesValues();
+}
+
+// returns the average time of an edition in millisecond
+static double
+runEditions(BenchmarkScore &score, int editions)
+{
+	double total = 0.;
+
+	for (int i=0; i<editions; i++)
+	{
+		int event = 1 + (i * 7) % (score.dateIDs.size() - 1);
+		int varsIDs[1] = {score.dateIDs[event]};
+		unsigned int values[1] = {(unsigned int)(score.solver->getVariableValue(score.dateIDs[event]) + (i % 2 ? -1 : 1) * BENCHMARK_BOX_DURATION / 3)};
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		score.solver->suggestValues(varsIDs, values, 1);
+
+		total += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	return total / editions;
+}
+
+int
+main(int argc, char *argv[])
+{
+	int lanes = argc > 1 ? atoi(argv[1]) : 8;
+	int boxes = argc > 2 ? atoi(argv[2]) : 64;
+	int editions = argc > 3 ? atoi(argv[3]) : 20;
+
+	vector<unsigned int> threads;
+	for (int i=4; i<argc; i++)
+		threads.push_back(atoi(argv[i]));
+
+	if (threads.empty())
+	{
+		threads.push_back(1);
+		threads.push_back(2);
+		threads.push_back(4);
+		threads.push_back(0);
+	}
+
+	std::cout << lanes << " lanes of " << boxes << " boxes, " << editions << " editions" << std::endl;
+
+	double reference = 0.;
+	vector<int> referenceDates;
+
+	for (unsigned int t=0; t<threads.size(); t++)
+	{
+		for (int deterministic=0; deterministic<2; deterministic++)
+		{
+			BenchmarkScore score;
+			score.solver = new Solver();
+			score.solver->setSearchOptions(SOLVER_SEARCH_TIME, 0, NO_SEARCH_OBJECTIVE, false);
+			score.solver->setSearchThreads(threads[t], deterministic);
+
+			buildScore(score, lanes, boxes);
+
+			double average = runEditions(score, editions);
+			const SolverStatistics &statistics = score.solver->getStatistics();
+
+			if (t == 0 && !deterministic)
+				reference = average;
+
+			std::cout << "threads " << threads[t] << (deterministic ? " (deterministic)" : "")
+					  << " : " << average << " ms per edition"
+					  << ", speedup " << (average > 0. ? reference / average : 0.)
+					  << ", last edition " << statistics.nodes << " nodes " << statistics.fails << " fails" << std::endl;
+
+			// the deterministic mode have to give the same dates whatever the number of threads is
+			if (deterministic)
+			{
+				vector<int> dates;
+				for (unsigned int i=0; i<score.dateIDs.size(); i++)
+					dates.push_back(score.solver->getVariableValue(score.dateIDs[i]));
+
+				if (referenceDates.empty())
+					referenceDates = dates;
+				else if (dates != referenceDates)
+					std::cout << "  warning : the dates differ from the first deterministic run (a search was maybe stopped by the time budget)" << std::endl;
+			}
+
+			delete score.solver;
+		}
+	}
+
+	return 0;
+}
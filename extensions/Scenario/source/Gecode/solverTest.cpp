@@ -0,0 +1,355 @@
+/*
+Copyright: LaBRI (http://www.labri.fr)
+
+Author(s): Bruno Valeze, Raphael Marczak
+Last modification: 08/03/2010
+
+Adviser(s): Myriam Desainte-Catherine (myriam.desainte-catherine@labri.fr)
+
+This software is a computer program whose purpose is to propose
+a library for interactive scores edition and execution.
+
+This software is governed by the CeCILL-C license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL-C
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL-C license and that you accept its terms.
+*/
+
+// Unit test of the edition solver on small networks
+// usage : solverTest
+// it prints each check and returns the number of failed checks
+// the temporal network is checked alone then through the solver (which falls back on the Gecode search)
+
+#include "solver.hpp"
+#include "integerVariable.hpp"
+#include "linearConstraint.hpp"
+#include "temporalNetwork.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+// the number of failed checks
+static int failures = 0;
+
+static void
+check(const char *description, bool condition)
+{
+	std::cout << (condition ? "ok     " : "FAILED ") << description << std::endl;
+
+	if (!condition)
+		failures++;
+}
+
+///////////////////////////////////////////////////////////////////////
+//
+// The temporal network alone
+//
+///////////////////////////////////////////////////////////////////////
+
+// a temporal network over its own variables and constraints
+struct TestNetwork {
+
+	TestNetwork() : network(&vars, &constraints) {}
+
+	~TestNetwork()
+	{
+		for (map<int, IntegerVariable*>::iterator p = vars.begin(); p != vars.end(); p++)
+			delete p->second;
+
+		for (map<int, LinearConstraint*>::iterator p = constraints.begin(); p != constraints.end(); p++)
+			delete p->second;
+	}
+
+	map<int, IntegerVariable*> vars;
+	map<int, LinearConstraint*> constraints;
+	TemporalNetwork network;
+};
+
+static int
+addVariable(TestNetwork &test, int min, int max, int val, int weight)
+{
+	int varID = test.vars.size();
+
+	test.vars[varID] = new IntegerVariable(min, max, val, -1, weight, -1, -1, -1);
+
+	return varID;
+}
+
+static int
+addConstraint(TestNetwork &test, const vector<int> &varsIDs, const vector<int> &varsCoeffs, IntRelType relType, int val)
+{
+	int constID = test.constraints.size();
+
+	test.constraints[constID] = new LinearConstraint(NULL, new vector<int>(varsIDs), new vector<int>(varsCoeffs), relType, val);
+
+	return constID;
+}
+
+static int
+valueOf(TestNetwork &test, int varID)
+{
+	return test.vars[varID]->getVal();
+}
+
+// edit a variable and reposition the others
+static bool
+edit(TestNetwork &test, int varID, int val)
+{
+	vector<int> strongVars(1, varID);
+
+	test.vars[varID]->updateValue(val);
+
+	return test.network.solve(&strongVars, true, NO_MAX_MODIFICATION);
+}
+
+// a + b + c = 30 : when a moves, b and c can take the move
+static void
+checkNetworkTie()
+{
+	TestNetwork tie;
+	int a = addVariable(tie, 0, 100, 10, 1);
+	int b = addVariable(tie, 0, 100, 10, 1);
+	int c = addVariable(tie, 0, 100, 10, 1);
+
+	addConstraint(tie, {a, b, c}, {1, 1, 1}, IRT_EQ, 30);
+
+	check("network : a tie between the lightest variables gives up without moving anything",
+		  !edit(tie, a, 16) && valueOf(tie, b) == 10 && valueOf(tie, c) == 10);
+
+	TestNetwork lightest;
+	a = addVariable(lightest, 0, 100, 10, 1);
+	b = addVariable(lightest, 0, 100, 10, 1);
+	c = addVariable(lightest, 0, 100, 10, 2);
+
+	addConstraint(lightest, {a, b, c}, {1, 1, 1}, IRT_EQ, 30);
+
+	check("network : without a tie the lightest variable takes the whole move",
+		  edit(lightest, a, 16) && valueOf(lightest, b) == 4 && valueOf(lightest, c) == 10);
+}
+
+// b - a >= 10 with b <= 30
+static void
+checkNetworkBound()
+{
+	TestNetwork bound;
+	int a = addVariable(bound, 0, 100, 10, 1);
+	int b = addVariable(bound, 0, 30, 20, 1);
+
+	addConstraint(bound, {b, a}, {1, -1}, IRT_GQ, 10);
+
+	check("network : a repair reaching the bound of a variable is kept",
+		  edit(bound, a, 20) && valueOf(bound, b) == 30);
+
+	check("network : a repair beyond the bound of a variable gives up without moving anything",
+		  !edit(bound, a, 21) && valueOf(bound, b) == 30);
+}
+
+// b - a >= 10 with b <= 30 : a can't go beyond 20
+static void
+checkNetworkExplain()
+{
+	TestNetwork conflict;
+	int a = addVariable(conflict, 0, 100, 10, 1);
+	int b = addVariable(conflict, 0, 30, 20, 1);
+	int c0 = addConstraint(conflict, {b, a}, {1, -1}, IRT_GQ, 10);
+
+	vector<int> strongVars(1, a);
+	vector<int> componentVarsIDs = {a, b};
+	vector<int> componentConstraintsIDs = {c0};
+	vector<int> constraintsIDs, varsIDs;
+	int nearestValue;
+
+	conflict.vars[a]->updateValue(25);
+
+	bool explained = conflict.network.explain(&strongVars, componentVarsIDs, componentConstraintsIDs, constraintsIDs, varsIDs, nearestValue);
+
+	check("network : a negative cycle gives the constraint and the bounds in conflict",
+		  explained && constraintsIDs == vector<int>(1, c0) && set<int>(varsIDs.begin(), varsIDs.end()) == set<int>(componentVarsIDs.begin(), componentVarsIDs.end()));
+
+	check("network : the nearest value is the closest value without conflict",
+		  nearestValue == 20);
+
+	conflict.vars[a]->updateValue(15);
+
+	explained = conflict.network.explain(&strongVars, componentVarsIDs, componentConstraintsIDs, constraintsIDs, varsIDs, nearestValue);
+
+	check("network : an edition without conflict is not explained",
+		  !explained && constraintsIDs.empty() && varsIDs.empty() && nearestValue == 15);
+}
+
+///////////////////////////////////////////////////////////////////////
+//
+// The solver
+//
+///////////////////////////////////////////////////////////////////////
+
+static bool
+suggest(Solver &solver, int varID, int val)
+{
+	int varsIDs[1] = {varID};
+	unsigned int values[1] = {(unsigned int)val};
+
+	return solver.suggestValues(varsIDs, values, 1);
+}
+
+// a tie can't be repaired by the network : the search has to find the cheapest moves
+static void
+checkSolverTie()
+{
+	Solver solver;
+	int x = solver.addIntVar(0, 100, 10, 1);
+	int y = solver.addIntVar(0, 100, 10, 1);
+	int z = solver.addIntVar(0, 100, 10, 1);
+	int IDs[3] = {x, y, z};
+	int coeffs[3] = {1, 1, 1};
+
+	solver.addConstraint(IDs, coeffs, 3, REL_EQ, 30);
+	solver.updateVariablesValues();
+
+	bool solved = suggest(solver, x, 16);
+	int dy = solver.getVariableValue(y) - 10;
+	int dz = solver.getVariableValue(z) - 10;
+
+	check("solver : a tie is solved by the search with the cheapest moves",
+		  solved && dy + dz == -6 && abs(dy) + abs(dz) == 6);
+}
+
+// y - x >= 10 with y <= 30
+static void
+checkSolverBound()
+{
+	Solver solver;
+	int x = solver.addIntVar(0, 100, 10, 1);
+	int y = solver.addIntVar(0, 30, 20, 1);
+	int IDs[2] = {y, x};
+	int coeffs[2] = {1, -1};
+
+	int c0 = solver.addConstraint(IDs, coeffs, 2, REL_GQ, 10);
+	solver.updateVariablesValues();
+
+	check("solver : a repair reaching the bound of a variable is kept without search",
+		  suggest(solver, x, 20) && solver.getVariableValue(y) == 30 && solver.getStatistics().nodes == 0);
+
+	bool solved = suggest(solver, x, 21);
+	const SolverConflict &conflict = solver.getConflict();
+
+	check("solver : an edition beyond the bound of a variable fails",
+		  !solved && solver.getVariableValue(y) == 30);
+
+	check("solver : the failure is explained by a negative cycle with the nearest value",
+		  conflict.explained && conflict.constraintsIDs == vector<int>(1, c0) && conflict.nearestValue == 20);
+}
+
+// an edition transaction which can't be solved
+static void
+checkSolverFailedBatch()
+{
+	Solver solver;
+	int x = solver.addIntVar(0, 100, 10, 1);
+	int y = solver.addIntVar(0, 30, 20, 1);
+	int w = solver.addIntVar(0, 100, 50, 1);
+	int IDs[2] = {y, x};
+	int coeffs[2] = {1, -1};
+
+	int c0 = solver.addConstraint(IDs, coeffs, 2, REL_GQ, 10);
+	solver.updateVariablesValues();
+
+	solver.beginEdition();
+
+	bool deferred = suggest(solver, x, 25) && suggest(solver, w, 60) && solver.getVariableValue(y) == 20;
+	bool solved = solver.endEdition();
+	const SolverConflict &conflict = solver.getConflict();
+
+	check("solver : the editions of a transaction are solved at its end",
+		  deferred && !solved);
+
+	check("solver : a failed transaction doesn't move the other variables and is explained",
+		  solver.getVariableValue(y) == 20 && conflict.explained && conflict.constraintsIDs == vector<int>(1, c0) && conflict.nearestValue == 20);
+
+	check("solver : the editions after a failed transaction are solved at once",
+		  suggest(solver, x, 15) && solver.getVariableValue(y) == 25);
+}
+
+// in anytime mode a component is refined in background only if the whole edition is solved
+static void
+checkSolverFailedAnytime()
+{
+	Solver solver;
+	int x = solver.addIntVar(0, 100, 10, 1);
+	int y = solver.addIntVar(0, 100, 10, 1);
+	int z = solver.addIntVar(0, 100, 10, 1);
+	int a = solver.addIntVar(0, 100, 10, 1);
+	int b = solver.addIntVar(0, 30, 20, 1);
+	int tieIDs[3] = {x, y, z};
+	int tieCoeffs[3] = {1, 1, 1};
+	int boundIDs[2] = {b, a};
+	int boundCoeffs[2] = {1, -1};
+
+	solver.setSearchOptions(SOLVER_SEARCH_TIME, 0, NO_SEARCH_OBJECTIVE, true);
+	solver.addConstraint(tieIDs, tieCoeffs, 3, REL_EQ, 30);
+	solver.addConstraint(boundIDs, boundCoeffs, 2, REL_GQ, 10);
+	solver.updateVariablesValues();
+
+	bool solved = suggest(solver, x, 16);
+
+	// wait the end of the refinements
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	while (solver.isRefining() && std::chrono::steady_clock::now() - start < std::chrono::milliseconds(10 * SOLVER_SEARCH_TIME))
+		solver.applyRefinements();
+
+	int dy = solver.getVariableValue(y) - 10;
+	int dz = solver.getVariableValue(z) - 10;
+
+	check("solver : the refinements of an edition solved in anytime mode reach the cheapest moves",
+		  solved && !solver.isRefining() && dy + dz == -6 && abs(dy) + abs(dz) == 6);
+
+	// the tie component is solved first then the bound component fails
+	int varsIDs[2] = {x, a};
+	unsigned int values[2] = {18, 25};
+
+	solved = solver.suggestValues(varsIDs, values, 2);
+
+	check("solver : a failed edition in anytime mode leaves no search in background",
+		  !solved && !solver.isRefining() && !solver.applyRefinements() &&
+		  solver.getVariableValue(y) == 10 + dy && solver.getVariableValue(z) == 10 + dz);
+}
+
+int
+main()
+{
+	checkNetworkTie();
+	checkNetworkBound();
+	checkNetworkExplain();
+
+	checkSolverTie();
+	checkSolverBound();
+	checkSolverFailedBatch();
+	checkSolverFailedAnytime();
+
+	std::cout << failures << " failed checks" << std::endl;
+
+	return failures;
+}
@@ -0,0 +1,636 @@
+/*
+Copyright: LaBRI (http://www.labri.fr)
+
+Author(s): Bruno Valeze, Raphael Marczak
+Last modification: 08/03/2010
+
+Adviser(s): Myriam Desainte-Catherine (myriam.desainte-catherine@labri.fr)
+
+This software is a computer program whose purpose is to propose
+a library for interactive scores edition and execution.
+
+This software is governed by the CeCILL-C license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL-C
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL-C license and that you accept its terms.
+*/
+
+#include "temporalNetwork.hpp"
+
+#include "integerVariable.hpp"
+#include "linearConstraint.hpp"
+#include "solver.hpp"
+
+#include <cstdlib>
+#include <limits>
+
+TemporalNetwork::TemporalNetwork(map<int, IntegerVariable*> *integerVariablesMap, map<int, LinearConstraint*> *constraintsMap)
+  : _integerVariablesMap(integerVariablesMap),
+    _constraintsMap(constraintsMap),
+    _structureChanged(true)
+{
+
+}
+
+TemporalNetwork::~TemporalNetwork()
+{
+
+}
+
+void
+TemporalNetwork::structureChanged()
+{
+	_structureChanged = true;
+}
+
+void
+TemporalNetwork::variableChanged(int varID)
+{
+	_changedVars.push_back(varID);
+}
+
+void
+TemporalNetwork::updateAdjacency()
+{
+	_adjacency.clear();
+
+	for (map<int, LinearConstraint*>::iterator p = _constraintsMap->begin(); p != _constraintsMap->end(); p++)
+	{
+		const vector<int> *ids = (p->second)->getVarsIDs();
+
+		for (unsigned int i=0; i<ids->size(); i++)
+			_adjacency[ids->at(i)].push_back(p->first);
+	}
+}
+
+int
+TemporalNetwork::valueOf(int varID) const
+{
+	map<int, int>::const_iterator m = _moved.find(varID);
+	if (m != _moved.end())
+		return m->second;
+
+	return (_integerVariablesMap->find(varID))->second->getVal();
+}
+
+void
+TemporalNetwork::enqueue(int varID)
+{
+	map<int, vector<int> >::iterator a = _adjacency.find(varID);
+	if (a == _adjacency.end())
+		return;
+
+	_queue.insert(_queue.end(), a->second.begin(), a->second.end());
+}
+
+// bound a variable around its current value as the Gecode search would (see in Solver::adjustVariable)
+static void
+adjustBounds(IntegerVariable *v, bool suggest, int maxModification)
+{
+	if ((suggest) && (maxModification != NO_MAX_MODIFICATION)) {
+		v->adjustMinMax(suggest, maxModification);
+	} else {
+		v->adjustMinMax(suggest);
+	}
+}
+
+long long
+TemporalNetwork::sumOf(LinearConstraint *c) const
+{
+	const vector<int> *ids = c->getVarsIDs();
+	const vector<int> *coeffs = c->getVarsCoeffs();
+
+	long long sum = 0;
+	for (unsigned int i=0; i<ids->size(); i++)
+		sum += (long long)coeffs->at(i) * valueOf(ids->at(i));
+
+	return sum;
+}
+
+long long
+TemporalNetwork::excess(LinearConstraint *c, long long sum)
+{
+	long long val = c->getVal();
+
+	switch (c->getRelType())
+	{
+	case IRT_EQ :
+		return val - sum;
+	case IRT_LQ :
+		return sum > val ? val - sum : 0;
+	case IRT_LE :
+		return sum > val - 1 ? val - 1 - sum : 0;
+	case IRT_GQ :
+		return sum < val ? val - sum : 0;
+	case IRT_GR :
+		return sum < val + 1 ? val + 1 - sum : 0;
+	default :
+		// a disequality can't be repaired by a single move
+		return 0;
+	}
+}
+
+bool
+TemporalNetwork::repair(int constID, bool suggest, int maxModification)
+{
+	map<int, LinearConstraint*>::iterator p = _constraintsMap->find(constID);
+	if (p == _constraintsMap->end())
+		return true;
+
+	LinearConstraint *c = p->second;
+	const vector<int> *ids = c->getVarsIDs();
+	const vector<int> *coeffs = c->getVarsCoeffs();
+
+	long long sum = sumOf(c);
+
+	if (c->getRelType() == IRT_NQ)
+		return sum != c->getVal();
+
+	// the minimal change of the linear combination
+	long long delta = excess(c, sum);
+	if (delta == 0)
+		return true;
+
+	// find the lightest variable which can move
+	int candidate = -1;
+	int weight = 0;
+	bool tie = false;
+
+	for (unsigned int i=0; i<ids->size(); i++)
+	{
+		if (coeffs->at(i) != 1 && coeffs->at(i) != -1)
+			continue;
+
+		if (_moved.find(ids->at(i)) != _moved.end())
+			continue;
+
+		IntegerVariable *v = (_integerVariablesMap->find(ids->at(i)))->second;
+
+		if (v->getInfBound() == v->getSupBound())
+			continue;
+
+		if (candidate == -1 || v->getWeight() < weight)
+		{
+			candidate = i;
+			weight = v->getWeight();
+			tie = false;
+		}
+		else if (v->getWeight() == weight)
+			tie = true;
+	}
+
+	// nothing to move or no way to choose
+	if (candidate == -1 || tie)
+		return false;
+
+	int varID = ids->at(candidate);
+	IntegerVariable *v = (_integerVariablesMap->find(varID))->second;
+
+	long long newVal = v->getVal() + delta * coeffs->at(candidate);
+
+	adjustBounds(v, suggest, maxModification);
+
+	if (newVal < v->getMin() || newVal > v->getMax())
+		return false;
+
+	_moved[varID] = (int)newVal;
+	enqueue(varID);
+
+	return true;
+}
+
+// note : any solution changes the linear combination of a violated constraint at least by its excess
+// and moving a variable by one unit costs its weight for each unit of its coefficient.
+// The cheapest variable of each constraint gives a bound which only adds up for the constraints
+// that share no variable which can move.
+double
+TemporalNetwork::lowerBound(const set<int> &strong) const
+{
+	set<int> checked, used;
+	double bound = 0;
+
+	for (unsigned int q=0; q<_queue.size(); q++)
+	{
+		if (!checked.insert(_queue[q]).second)
+			continue;
+
+		map<int, LinearConstraint*>::const_iterator p = _constraintsMap->find(_queue[q]);
+		if (p == _constraintsMap->end())
+			continue;
+
+		LinearConstraint *c = p->second;
+		long long violation = excess(c, sumOf(c));
+		if (violation == 0)
+			continue;
+
+		const vector<int> *ids = c->getVarsIDs();
+		const vector<int> *coeffs = c->getVarsCoeffs();
+
+		vector<int> movable;
+		double cheapest = -1;
+		bool disjoint = true;
+
+		for (unsigned int i=0; i<ids->size(); i++)
+		{
+			if (strong.count(ids->at(i)) || coeffs->at(i) == 0)
+				continue;
+
+			IntegerVariable *v = (_integerVariablesMap->find(ids->at(i)))->second;
+
+			if (v->getInfBound() == v->getSupBound())
+				continue;
+
+			if (used.count(ids->at(i)))
+				disjoint = false;
+
+			double unit = (double)v->getWeight() / abs(coeffs->at(i));
+			if (cheapest < 0 || unit < cheapest)
+				cheapest = unit;
+
+			movable.push_back(ids->at(i));
+		}
+
+		// (without any movable variable the repair fails anyway)
+		if (!disjoint || movable.empty())
+			continue;
+
+		bound += (violation < 0 ? -violation : violation) * cheapest;
+		used.insert(movable.begin(), movable.end());
+	}
+
+	return bound;
+}
+
+// the Gecode search will solve the whole system
+// so everything needs to be checked again next time
+void
+TemporalNetwork::giveUp()
+{
+	_moved.clear();
+	_queue.clear();
+	_structureChanged = true;
+}
+
+bool
+TemporalNetwork::solve(const vector<int> *strongVars, bool suggest, int maxModification)
+{
+	_moved.clear();
+	_queue.clear();
+
+	set<int> strong;
+	if (strongVars)
+		strong.insert(strongVars->begin(), strongVars->end());
+
+	vector<int> changed;
+
+	// after a structure change every constraint and every variable needs to be checked
+	if (_structureChanged)
+	{
+		updateAdjacency();
+
+		for (map<int, LinearConstraint*>::iterator p = _constraintsMap->begin(); p != _constraintsMap->end(); p++)
+			_queue.push_back(p->first);
+
+		for (map<int, IntegerVariable*>::iterator q = _integerVariablesMap->begin(); q != _integerVariablesMap->end(); q++)
+			changed.push_back(q->first);
+
+		_structureChanged = false;
+	}
+	else
+	{
+		for (unsigned int i=0; i<_changedVars.size(); i++)
+			enqueue(_changedVars[i]);
+
+		changed.swap(_changedVars);
+	}
+
+	_changedVars.clear();
+
+	// a variable out of its bounds has to move by itself : the Gecode search decides where
+	for (unsigned int i=0; i<changed.size(); i++)
+	{
+		map<int, IntegerVariable*>::iterator q = _integerVariablesMap->find(changed[i]);
+		if (q == _integerVariablesMap->end() || strong.count(changed[i]))
+			continue;
+
+		IntegerVariable *v = q->second;
+		adjustBounds(v, suggest, maxModification);
+
+		if (v->getVal() < v->getMin() || v->getVal() > v->getMax())
+		{
+			giveUp();
+			return false;
+		}
+	}
+
+	// the edited variables can't move
+	if (strongVars)
+	{
+		for (unsigned int i=0; i<strongVars->size(); i++)
+		{
+			IntegerVariable *v = (_integerVariablesMap->find(strongVars->at(i)))->second;
+
+			if (v->getVal() < v->getInfBound() || v->getVal() > v->getSupBound())
+			{
+				giveUp();
+				return false;
+			}
+
+			_moved[strongVars->at(i)] = v->getVal();
+			enqueue(strongVars->at(i));
+		}
+	}
+
+	// what any solution costs at least
+	double bound = lowerBound(strong);
+
+	// repair the violated constraints until everything is consistent
+	while (!_queue.empty())
+	{
+		int constID = _queue.back();
+		_queue.pop_back();
+
+		if (!repair(constID, suggest, maxModification))
+		{
+			giveUp();
+			return false;
+		}
+	}
+
+	// the repair is kept only if it reaches the bound : then it is as cheap as the Gecode solution
+	// (a chain of light moves can cost more than a single heavy one)
+	double cost = 0;
+
+	for (map<int, int>::iterator m = _moved.begin(); m != _moved.end(); m++)
+	{
+		if (strong.count(m->first))
+			continue;
+
+		IntegerVariable *v = (_integerVariablesMap->find(m->first))->second;
+		cost += (double)v->getWeight() * abs(m->second - v->getVal());
+	}
+
+	if (cost > bound)
+	{
+		giveUp();
+		return false;
+	}
+
+	// store the new values
+	for (map<int, int>::iterator m = _moved.begin(); m != _moved.end(); m++)
+		(_integerVariablesMap->find(m->first))->second->updateValue(m->second);
+
+	_moved.clear();
+
+	return true;
+}
+
+// note : a constraint is relaxed into a difference constraint between its lightest positive and negative variables
+// the other variables are replaced by their bounds so each solution of the system satisfies the relaxed constraints
+// (this keeps the box constraints between dates when the ranges are limited)
+void
+TemporalNetwork::buildDistanceGraph(const vector<int> *strongVars, bool fixStrongVars, const vector<int> &varsIDs, const vector<int> &constraintsIDs, map<int, int> &nodes, vector<TemporalEdge> &edges) const
+{
+	set<int> strong;
+	if (strongVars)
+		strong.insert(strongVars->begin(), strongVars->end());
+
+	map<int, long long> low, high;
+
+	// the bounds of each variable (or its edited value)
+	for (unsigned int k=0; k<varsIDs.size(); k++)
+	{
+		int varID = varsIDs[k];
+		IntegerVariable *v = (_integerVariablesMap->find(varID))->second;
+		int node = nodes.size() + 1;
+		nodes[varID] = node;
+
+		if (!strong.count(varID))
+		{
+			low[varID] = v->getMin();
+			high[varID] = v->getMax();
+		}
+		else if (fixStrongVars)
+		{
+			low[varID] = v->getVal();
+			high[varID] = v->getVal();
+		}
+		else
+		{
+			low[varID] = v->getInfBound();
+			high[varID] = v->getSupBound();
+		}
+
+		TemporalEdge upper = {0, node, high[varID], -1, varID};
+		TemporalEdge lower = {node, 0, -low[varID], -1, varID};
+		edges.push_back(upper);
+		edges.push_back(lower);
+	}
+
+	for (unsigned int k=0; k<constraintsIDs.size(); k++)
+	{
+		int constID = constraintsIDs[k];
+		LinearConstraint *c = (_constraintsMap->find(constID))->second;
+		const vector<int> *ids = c->getVarsIDs();
+		const vector<int> *coeffs = c->getVarsCoeffs();
+
+		// each relation is written as sign * sum <= bound
+		vector<pair<int, long long> > forms;
+
+		switch (c->getRelType())
+		{
+		case IRT_EQ :
+			forms.push_back(pair<int, long long>(1, c->getVal()));
+			forms.push_back(pair<int, long long>(-1, -(long long)c->getVal()));
+			break;
+		case IRT_LQ :
+			forms.push_back(pair<int, long long>(1, c->getVal()));
+			break;
+		case IRT_LE :
+			forms.push_back(pair<int, long long>(1, (long long)c->getVal() - 1));
+			break;
+		case IRT_GQ :
+			forms.push_back(pair<int, long long>(-1, -(long long)c->getVal()));
+			break;
+		case IRT_GR :
+			forms.push_back(pair<int, long long>(-1, -(long long)c->getVal() - 1));
+			break;
+		default :
+			// a disequality is not a difference constraint
+			break;
+		}
+
+		for (unsigned int f=0; f<forms.size(); f++)
+		{
+			int positive = -1, negative = -1;
+			bool unit = true;
+
+			for (unsigned int i=0; i<ids->size() && unit; i++)
+			{
+				int coeff = forms[f].first * coeffs->at(i);
+				IntegerVariable *v = (_integerVariablesMap->find(ids->at(i)))->second;
+
+				if (coeff == 1 && (positive == -1 || v->getWeight() < (_integerVariablesMap->find(ids->at(positive)))->second->getWeight()))
+					positive = i;
+				else if (coeff == -1 && (negative == -1 || v->getWeight() < (_integerVariablesMap->find(ids->at(negative)))->second->getWeight()))
+					negative = i;
+				else if (coeff != 1 && coeff != -1)
+					unit = false;
+			}
+
+			if (!unit)
+				break;
+
+			// the other variables at their lowest contribution
+			long long bound = forms[f].second;
+
+			for (unsigned int i=0; i<ids->size(); i++)
+			{
+				if ((int)i == positive || (int)i == negative)
+					continue;
+
+				int coeff = forms[f].first * coeffs->at(i);
+				bound -= coeff > 0 ? low[ids->at(i)] : -high[ids->at(i)];
+			}
+
+			TemporalEdge e = {negative == -1 ? 0 : nodes[ids->at(negative)], positive == -1 ? 0 : nodes[ids->at(positive)], bound, constID, -1};
+			edges.push_back(e);
+		}
+	}
+}
+
+int
+TemporalNetwork::shortestPaths(const vector<TemporalEdge> &edges, int nbNodes, bool reversed, vector<long long> &distances, vector<int> &predecessors)
+{
+	const long long unreachable = std::numeric_limits<long long>::max();
+
+	distances.assign(nbNodes, unreachable);
+	predecessors.assign(nbNodes, -1);
+	distances[0] = 0;
+
+	for (int n=0; n<nbNodes; n++)
+	{
+		bool relaxed = false;
+
+		for (unsigned int i=0; i<edges.size(); i++)
+		{
+			int from = reversed ? edges[i].to : edges[i].from;
+			int to = reversed ? edges[i].from : edges[i].to;
+
+			if (distances[from] == unreachable)
+				continue;
+
+			if (distances[from] + edges[i].weight < distances[to])
+			{
+				// still relaxing after nbNodes - 1 rounds : there is a negative cycle
+				if (n == nbNodes - 1)
+				{
+					predecessors[to] = i;
+					return to;
+				}
+
+				distances[to] = distances[from] + edges[i].weight;
+				predecessors[to] = i;
+				relaxed = true;
+			}
+		}
+
+		if (!relaxed)
+			break;
+	}
+
+	return -1;
+}
+
+bool
+TemporalNetwork::explain(const vector<int> *strongVars, const vector<int> &componentVarsIDs, const vector<int> &componentConstraintsIDs, vector<int> &constraintsIDs, vector<int> &varsIDs, int &nearestValue) const
+{
+	map<int, int> nodes;
+	vector<TemporalEdge> edges;
+	vector<long long> distances;
+	vector<int> predecessors;
+
+	constraintsIDs.clear();
+	varsIDs.clear();
+
+	if (!strongVars || strongVars->empty())
+		return false;
+
+	IntegerVariable *edited = (_integerVariablesMap->find(strongVars->at(0)))->second;
+	nearestValue = edited->getVal();
+
+	// the nearest value of the first strong variable when it is edited alone
+	buildDistanceGraph(strongVars, false, componentVarsIDs, componentConstraintsIDs, nodes, edges);
+
+	int node = nodes[strongVars->at(0)];
+
+	if (shortestPaths(edges, nodes.size() + 1, false, distances, predecessors) == -1)
+	{
+		long long high = distances[node];
+
+		if (shortestPaths(edges, nodes.size() + 1, true, distances, predecessors) == -1)
+		{
+			long long low = -distances[node];
+
+			if (nearestValue > high)
+				nearestValue = high;
+
+			if (nearestValue < low)
+				nearestValue = low;
+		}
+	}
+
+	// the conflict of the edited values
+	nodes.clear();
+	edges.clear();
+
+	buildDistanceGraph(strongVars, true, componentVarsIDs, componentConstraintsIDs, nodes, edges);
+
+	int last = shortestPaths(edges, nodes.size() + 1, false, distances, predecessors);
+	if (last == -1)
+		return false;
+
+	// go back into the cycle then follow it
+	for (unsigned int i=0; i<nodes.size() + 1; i++)
+		last = edges[predecessors[last]].from;
+
+	set<int> constraints, vars;
+	int current = last;
+
+	do
+	{
+		const TemporalEdge &e = edges[predecessors[current]];
+
+		if (e.constID != -1 && constraints.insert(e.constID).second)
+			constraintsIDs.push_back(e.constID);
+
+		if (e.varID != -1 && vars.insert(e.varID).second)
+			varsIDs.push_back(e.varID);
+
+		current = e.from;
+	}
+	while (current != last);
+
+	return true;
+}
@@ -0,0 +1,161 @@
+/*
+Copyright: LaBRI (http://www.labri.fr)
+
+Author(s): Bruno Valeze, Raphael Marczak
+Last modification: 08/03/2010
+
+Adviser(s): Myriam Desainte-Catherine (myriam.desainte-catherine@labri.fr)
+
+This software is a computer program whose purpose is to propose
+a library for interactive scores edition and execution.
+
+This software is governed by the CeCILL-C license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL-C
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL-C license and that you accept its terms.
+*/
+
+#ifndef TEMPORAL_NETWORK_H
+#define TEMPORAL_NETWORK_H
+
+#include "gecode_headers.hpp"
+
+class IntegerVariable;
+class LinearConstraint;
+
+// An edge of the distance graph of the temporal network : value(to) - value(from) <= weight
+// it comes from a constraint (constID) or from the bounds or the edited value of a variable (varID)
+struct TemporalEdge {
+	int from;
+	int to;
+	long long weight;
+	int constID;
+	int varID;
+};
+
+///////////////////////////////////////////////////////////////////////
+//
+// A temporal network repositions the variables after an edition
+// without any search : starting from the previous solution, each
+// constraint violated by an edited variable is repaired by moving its
+// lightest variable the minimal amount, then the constraints of this
+// variable are checked in turn.
+// Each variable moves at most once so an edition only costs the
+// number of affected constraints.
+// The repair is greedy : it is only kept when its weighted cost reaches
+// a lower bound of the cost of any solution (so it is optimal like the
+// Gecode solution). When a repair is more expensive, ambiguous or
+// impossible the network gives up and the Gecode search has to be used.
+//
+///////////////////////////////////////////////////////////////////////
+
+class TemporalNetwork {
+
+private :
+
+	// The variables and constraints of the solver
+	map<int, IntegerVariable*> *_integerVariablesMap;
+	map<int, LinearConstraint*> *_constraintsMap;
+
+	// IDs of the constraints implicating each variable
+	map<int, vector<int> > _adjacency;
+
+	// true if the adjacency have to be rebuilt
+	bool _structureChanged;
+
+	// IDs of the variables changed outside of an edition
+	vector<int> _changedVars;
+
+	// values of the variables moved during the current solving
+	map<int, int> _moved;
+
+	// IDs of the constraints to check
+	vector<int> _queue;
+
+private :
+
+	// Rebuild the adjacency
+	void updateAdjacency();
+
+	// Get the value of a variable during the current solving
+	int valueOf(int varID) const;
+
+	// Schedule the checking of the constraints implicating a variable
+	void enqueue(int varID);
+
+	// The linear combination of a constraint during the current solving
+	long long sumOf(LinearConstraint *c) const;
+
+	// The minimal change of the linear combination which satisfies the constraint (0 if it is satisfied)
+	static long long excess(LinearConstraint *c, long long sum);
+
+	// The minimal weighted cost of any solution to the violations of the queued constraints
+	double lowerBound(const set<int> &strong) const;
+
+	// Move the lightest variable of the constraint if it is violated
+	// returns false if the constraint can't be repaired
+	bool repair(int constID, bool suggest, int maxModification);
+
+	// Forget the current solving
+	void giveUp();
+
+	// Build the distance graph of the given constraints relaxed to difference constraints
+	// node 0 is the origin of the dates, the others are given by nodes (the given variables have to contain the variables of the constraints)
+	// the values of the strong variables are fixed if fixStrongVars is true else they only have to stay in their widest bounds
+	void buildDistanceGraph(const vector<int> *strongVars, bool fixStrongVars, const vector<int> &varsIDs, const vector<int> &constraintsIDs, map<int, int> &nodes, vector<TemporalEdge> &edges) const;
+
+	// Bellman-Ford shortest paths from the origin (or to the origin if reversed)
+	// returns the index of an edge of a negative cycle, -1 if there is none
+	static int shortestPaths(const vector<TemporalEdge> &edges, int nbNodes, bool reversed, vector<long long> &distances, vector<int> &predecessors);
+
+public :
+
+	TemporalNetwork(map<int, IntegerVariable*> *integerVariablesMap, map<int, LinearConstraint*> *constraintsMap);
+	~TemporalNetwork();
+
+	// to be called when a variable or a constraint is added or removed
+	void structureChanged();
+
+	// to be called when the bounds or the value of a variable changed outside of an edition
+	// (its value is checked against its new bounds at the next solving)
+	void variableChanged(int varID);
+
+	// reposition the variables after the edition of the strong variables (which values are already updated)
+	// returns false if the Gecode search is needed (then no variable have been modified) :
+	// when the repair fails or when it can't be proved as cheap as the Gecode solution
+	bool solve(const vector<int> *strongVars, bool suggest, int maxModification);
+
+	// explain why the edition of the strong variables can't be solved (the bounds of the variables have to be adjusted for the edition)
+	// only the graph of the given variables and constraints is searched : the connected components of the strong variables
+	// constraintsIDs and varsIDs are a negative cycle of the distance graph : a minimal set of constraints and variables bounds in conflict
+	// nearestValue is the value of the first strong variable the closest to its edited value which doesn't conflict
+	// returns false if the conflict doesn't come from the difference constraints (then the vectors are empty)
+	bool explain(const vector<int> *strongVars, const vector<int> &componentVarsIDs, const vector<int> &componentConstraintsIDs, vector<int> &constraintsIDs, vector<int> &varsIDs, int &nearestValue) const;
+
+private:
+  TemporalNetwork(const TemporalNetwork &);
+  TemporalNetwork &operator=(const TemporalNetwork &);
+};
+
+#endif // TEMPORAL_NETWORK_H
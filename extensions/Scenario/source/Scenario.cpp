@@ -14,6 +14,11 @@
  */
 
 #include "Scenario.h"
+#include "TTScoreXmlFormatter.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <string.h>
 
 #define thisTTClass                 Scenario
 #define thisTTClassName             "Scenario"
@@ -39,7 +44,18 @@ mViewPosition(TTValue(0, 0)),
 mEditionSolver(NULL),
 #endif
 mLoading(NO),
+mLazyLoading(NO),
+mProfiling(NO),
+mProfilingSlowest(TTSCORE_PROFILER_SLOWEST),
+mSharedPayloads(NO),
 mAttributeLoaded(NO),
+mEditionDepth(0),
+mEditionSearchTime(100),
+mEditionSearchNodes(0),
+mEditionSearchObjective(-1),
+mEditionAnytime(NO),
+mEditionSearchThreads(1),
+mEditionDeterministic(NO),
 mFileVersion(kTTSymEmpty)
 {
     TIME_PLUGIN_INITIALIZE
@@ -51,6 +67,24 @@ mFileVersion(kTTSymEmpty)
     addAttributeWithSetter(ViewZoom, kTypeLocalValue);
     addAttributeWithSetter(ViewPosition, kTypeLocalValue);
     
+    addAttribute(LazyLoading, kTypeBoolean);
+    
+    addAttribute(Profiling, kTypeBoolean);
+    addAttribute(ProfilingSlowest, kTypeUInt32);
+    registerAttribute(TTSymbol("profilingReport"), kTypeLocalValue, NULL, (TTGetterMethod)& Scenario::getProfilingReport, NULL);
+    
+    addAttribute(SharedPayloads, kTypeBoolean);
+    
+    addAttributeWithSetter(EditionSearchTime, kTypeUInt32);
+    addAttributeWithSetter(EditionSearchNodes, kTypeUInt32);
+    addAttributeWithSetter(EditionSearchObjective, kTypeInt32);
+    addAttributeWithSetter(EditionAnytime, kTypeBoolean);
+    addAttributeWithSetter(EditionSearchThreads, kTypeUInt32);
+    addAttributeWithSetter(EditionDeterministic, kTypeBoolean);
+    
+    registerAttribute(TTSymbol("editionStatistics"), kTypeLocalValue, NULL, (TTGetterMethod)& Scenario::getEditionStatistics, NULL);
+    registerAttribute(TTSymbol("snapshotWriteProgress"), kTypeLocalValue, NULL, (TTGetterMethod)& Scenario::getSnapshotWriteProgress, NULL);
+    
     // needed to be notified by scheduler speed change
     addMessageWithArguments(SchedulerSpeedChanged);
     addMessageProperty(SchedulerSpeedChanged, hidden, YES);
@@ -58,6 +92,16 @@ mFileVersion(kTTSymEmpty)
     addMessageWithArguments(Next);
     
     
+    addMessage(EditionBegin);
+    addMessageProperty(EditionBegin, hidden, YES);
+    
+    addMessage(EditionEnd);
+    addMessageProperty(EditionEnd, hidden, YES);
+    
+    addMessageWithArguments(EditionRefine);
+    addMessageProperty(EditionRefine, hidden, YES);
+    
+    
     addMessageWithArguments(TimeEventCreate);
     addMessageProperty(TimeEventCreate, hidden, YES);
     
@@ -93,10 +137,22 @@ mFileVersion(kTTSymEmpty)
     addMessageWithArguments(TimeConditionRelease);
     addMessageProperty(TimeConditionRelease, hidden, YES);
     
+    
+    addMessageWithArguments(SnapshotWrite);
+    addMessageWithArguments(SnapshotWriteAsync);
+    addMessageWithArguments(SnapshotWriteEnd);
+    addMessageWithArguments(SnapshotRead);
+    
+    addMessageWithArguments(JournalWrite);
+    
+    addMessageWithArguments(JournalTouch);
+    addMessageProperty(JournalTouch, hidden, YES);
+    
     addMessage(Compile);
 #ifndef NO_EDITION_SOLVER
     // Create the edition solver
     mEditionSolver = new Solver();
+    configureEditionSolver();
 #endif
     // it is possible to pass 2 events for the root scenario (which don't need a container by definition)
     if (arguments.size() == 2) {
@@ -125,6 +181,15 @@ mFileVersion(kTTSymEmpty)
 
 Scenario::~Scenario()
 {
+    // wait the snapshot written in background (the observers are not notified anymore)
+    if (mBackgroundWriter.busy() && !mBackgroundWriter.finish()) {
+        
+        TTString journalPath = mBackgroundPath.c_str();
+        journalPath += ".journal";
+        
+        TTScoreSnapshotRemoveJournal(journalPath);
+    }
+    
     if (mNamespace) {
         delete mNamespace;
         mNamespace = NULL;
@@ -157,6 +222,8 @@ TTErr Scenario::getParameterNames(TTValue& value)
 
 TTErr Scenario::getTimeProcesses(TTValue& value)
 {
+    loadPending();
+    
     value.clear();
     
     if (mTimeProcesses.isEmpty())
@@ -170,6 +237,8 @@ TTErr Scenario::getTimeProcesses(TTValue& value)
 
 TTErr Scenario::getTimeEvents(TTValue& value)
 {
+    loadPending();
+    
     value.clear();
     
     if (mTimeEvents.isEmpty())
@@ -191,6 +260,8 @@ TTErr Scenario::getTimeEvents(TTValue& value)
 
 TTErr Scenario::getTimeConditions(TTValue& value)
 {
+    loadPending();
+    
     value.clear();
     
     if (mTimeConditions.isEmpty())
@@ -209,6 +280,8 @@ TTErr Scenario::getTimeConditions(TTValue& value)
 
 TTErr Scenario::Compile()
 {
+    loadPending();
+    
     TTValue     v;
     TTUInt32    timeOffset;
     TTBoolean   compiled;
@@ -244,6 +317,8 @@ TTErr Scenario::Compile()
 
 TTErr Scenario::ProcessStart()
 {
+    loadPending();
+    
     // reset all events to waiting status
     for (mTimeEvents.begin(); mTimeEvents.end(); mTimeEvents.next())
     {
@@ -412,6 +487,8 @@ TTErr Scenario::ProcessPaused(const TTValue& inputValue, TTValue& outputValue)
 
 TTErr Scenario::Goto(const TTValue& inputValue, TTValue& outputValue)
 {
+    loadPending();
+    
     TTObject		aTimeEvent, aTimeProcess, state;
     TTValue         v, none;
     TTUInt32        duration, timeOffset, date;
@@ -505,8 +582,25 @@ TTErr Scenario::Goto(const TTValue& inputValue, TTValue& outputValue)
     return kTTErrGeneric;
 }
 
+/** Set the object measured by a profiler scope
+ @details the name of the object is only looked for if the scope is profiled
+ @param aScope          a profiler scope
+ @param anObject        a time event, a time process or a time condition */
+static void ScenarioProfileObject(TTScoreProfilerScope& aScope, TTObject& anObject)
+{
+    if (aScope.active() && anObject.valid()) {
+        
+        TTSymbol name;
+        anObject.get(kTTSym_name, name);
+        
+        aScope.setObject(anObject.instance(), anObject.name(), name);
+    }
+}
+
 TTErr Scenario::WriteAsXml(const TTValue& inputValue, TTValue& outputValue)
 {
+    loadPending();
+    
     TTObject o = inputValue[0];
 	TTXmlHandlerPtr aXmlHandler = (TTXmlHandlerPtr)o.instance();
     if (!aXmlHandler)
@@ -519,9 +613,22 @@ TTErr Scenario::WriteAsXml(const TTValue& inputValue, TTValue& outputValue)
     // if the scenario is not handled by a upper scenario
     if (!mContainer.valid()) {
         
-        TTValue     v;
-        TTString    s;
-        TTObject    thisObject(this);
+        TTScoreXmlFormatter aFormatter;
+        TTObject            thisObject(this);
+        
+        // measure the save of the whole tree
+        if (mProfiling && !TTScoreProfiler::current()) {
+            
+            mProfiler.start();
+            TTScoreProfiler::setCurrent(&mProfiler);
+        }
+        
+        // write the repeated states and curves once
+        if (mSharedPayloads && !TTScorePayloads::current()) {
+            
+            mPayloads.clear();
+            TTScorePayloads::setCurrent(&mPayloads);
+        }
         
         // Start a Scenario node
         xmlTextWriterStartElement((xmlTextWriterPtr)aXmlHandler->mWriter, BAD_CAST "Scenario");
@@ -532,16 +639,10 @@ TTErr Scenario::WriteAsXml(const TTValue& inputValue, TTValue& outputValue)
         xmlTextWriterWriteAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, BAD_CAST "version", BAD_CAST TTSCORE_VERSION_STRING);
         
         // Write the view zoom
-        v = mViewZoom;
-        v.toString();
-        s = TTString(v[0]);
-        xmlTextWriterWriteAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, BAD_CAST "viewZoom", BAD_CAST s.data());
+        aFormatter.writeAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, "viewZoom", mViewZoom);
         
         // Write the view position
-        v = mViewPosition;
-        v.toString();
-        s = TTString(v[0]);
-        xmlTextWriterWriteAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, BAD_CAST "viewPosition", BAD_CAST s.data());
+        aFormatter.writeAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, "viewPosition", mViewPosition);
         
         // Write the start event
         {
@@ -549,6 +650,10 @@ TTErr Scenario::WriteAsXml(const TTValue& inputValue, TTValue& outputValue)
             
             // Force the name
             getStartEvent().set("name", kTTSym_start);
+            
+            TTObject                startEvent = getStartEvent();
+            TTScoreProfilerScope    profile(kTTScoreProfilerObjects, kTTSymEmpty);
+            ScenarioProfileObject(profile, startEvent);
  
             // Pass the xml handler to the event to fill his attribute
             aXmlHandler->setAttributeValue(kTTSym_object, getStartEvent());
@@ -565,6 +670,10 @@ TTErr Scenario::WriteAsXml(const TTValue& inputValue, TTValue& outputValue)
             // Force the name
             getEndEvent().set("name", kTTSym_end);
             
+            TTObject                endEvent = getEndEvent();
+            TTScoreProfilerScope    profile(kTTScoreProfilerObjects, kTTSymEmpty);
+            ScenarioProfileObject(profile, endEvent);
+            
             // Pass the xml handler to the event to fill his attribute
             aXmlHandler->setAttributeValue(kTTSym_object, getEndEvent());
             aXmlHandler->sendMessage(kTTSym_Write);
@@ -603,41 +712,131 @@ TTErr Scenario::WriteAsXml(const TTValue& inputValue, TTValue& outputValue)
         
         // Close the event node
         xmlTextWriterEndElement((xmlTextWriterPtr)aXmlHandler->mWriter);
+        
+        if (TTScoreProfiler::current() == &mProfiler) {
+            
+            mProfiler.stop();
+            TTScoreProfiler::setCurrent(NULL);
+        }
+        
+        if (TTScorePayloads::current() == &mPayloads) {
+            
+            TTScorePayloads::setCurrent(NULL);
+            mPayloads.clear();
+        }
     }
 	
 	return kTTErrNone;
 }
 
+/** The kinds of xml node a scenario reads */
+enum ScenarioXmlNode
+{
+    kScenarioXmlNodeIgnored = 0,        ///< a node which is not part of a score
+    kScenarioXmlNodeReadingStarts,
+    kScenarioXmlNodeReadingEnds,
+    kScenarioXmlNodeScenario,
+    kScenarioXmlNodeLoop,
+    kScenarioXmlNodeStartEvent,
+    kScenarioXmlNodeEndEvent,
+    kScenarioXmlNodeEvent,
+    kScenarioXmlNodeCondition,
+    kScenarioXmlNodeContent             ///< a node read by a time event, a time process or a time condition
+};
+
+typedef std::unordered_map<TTPtr, ScenarioXmlNode> ScenarioXmlNodeTable;
+
+static ScenarioXmlNodeTable ScenarioXmlNodeTableBuild()
+{
+    ScenarioXmlNodeTable table;
+    
+    table[TTSymbol("xmlHandlerReadingStarts").rawpointer()] = kScenarioXmlNodeReadingStarts;
+    table[TTSymbol("xmlHandlerReadingEnds").rawpointer()] = kScenarioXmlNodeReadingEnds;
+    table[TTSymbol("Scenario").rawpointer()] = kScenarioXmlNodeScenario;
+    table[TTSymbol("Loop").rawpointer()] = kScenarioXmlNodeLoop;
+    table[TTSymbol("startEvent").rawpointer()] = kScenarioXmlNodeStartEvent;
+    table[TTSymbol("endEvent").rawpointer()] = kScenarioXmlNodeEndEvent;
+    table[TTSymbol("event").rawpointer()] = kScenarioXmlNodeEvent;
+    table[TTSymbol("condition").rawpointer()] = kScenarioXmlNodeCondition;
+    table[TTSymbol("Automation").rawpointer()] = kScenarioXmlNodeContent;
+    table[TTSymbol("indexedCurves").rawpointer()] = kScenarioXmlNodeContent;
+    table[TTSymbol("curve").rawpointer()] = kScenarioXmlNodeContent;
+    table[TTSymbol("Interval").rawpointer()] = kScenarioXmlNodeContent;
+    table[TTSymbol("command").rawpointer()] = kScenarioXmlNodeContent;
+    table[TTSymbol("case").rawpointer()] = kScenarioXmlNodeContent;
+    
+    return table;
+}
+
+/** Get the kind of an xml node from its name
+ @details the symbols are looked up once so each node only costs a hash of the symbol pointer
+ @param aNodeName       the name of an xml node
+ @return                the kind of the node */
+static ScenarioXmlNode ScenarioXmlNodeKind(TTSymbol aNodeName)
+{
+    static const ScenarioXmlNodeTable table = ScenarioXmlNodeTableBuild();
+    
+    ScenarioXmlNodeTable::const_iterator it = table.find(aNodeName.rawpointer());
+    
+    if (it == table.end())
+        return kScenarioXmlNodeIgnored;
+    
+    return it->second;
+}
+
+/** Read an unsigned integer attribute of the current xml node
+ @details the attribute is parsed directly instead of being converted into a TTValue (see TTScoreXmlFormatter::parseUInt32)
+ @param aXmlHandler     a xml handler
+ @param attributeName   the name of the attribute
+ @param value           the returned value
+ @return                NO if the attribute is missing or is not an unsigned integer */
+static TTBoolean ScenarioReadXmlUInt32(TTXmlHandlerPtr aXmlHandler, const char* attributeName, TTUInt32& value)
+{
+    xmlChar* data = xmlTextReaderGetAttribute((xmlTextReaderPtr)aXmlHandler->mReader, BAD_CAST attributeName);
+    if (!data)
+        return NO;
+    
+    TTBoolean valid = TTScoreXmlFormatter::parseUInt32((const char*)data, value);
+    
+    xmlFree(data);
+    return valid;
+}
+
+/** Read a symbol attribute of the current xml node
+ @param aXmlHandler     a xml handler
+ @param attributeName   the name of the attribute
+ @param value           the returned symbol
+ @return                NO if the attribute is missing or empty */
+static TTBoolean ScenarioReadXmlSymbol(TTXmlHandlerPtr aXmlHandler, const char* attributeName, TTSymbol& value)
+{
+    xmlChar* data = xmlTextReaderGetAttribute((xmlTextReaderPtr)aXmlHandler->mReader, BAD_CAST attributeName);
+    if (!data)
+        return NO;
+    
+    TTBoolean valid = data[0] != 0;
+    
+    if (valid)
+        value = TTSymbol((const char*)data);
+    
+    xmlFree(data);
+    return valid;
+}
+
 TTErr Scenario::ReadFromXml(const TTValue& inputValue, TTValue& outputValue)
 {
     TTObject o = inputValue[0];
 	TTXmlHandlerPtr aXmlHandler = (TTXmlHandlerPtr)o.instance();
     if (!aXmlHandler)
 		return kTTErrGeneric;
-#ifndef NO_EDITION_SOLVER
-    SolverObjectMapIterator itSolver;
-#endif
-    TTValue                 v;
+    
+    TTValue v;
     
     // Filtering Score plugin
-    // théo : this is ugly but it is due to the bad design of XmlHandler
-    if (aXmlHandler->mXmlNodeName != TTSymbol("xmlHandlerReadingStarts") &&
-        aXmlHandler->mXmlNodeName != TTSymbol("xmlHandlerReadingEnds") &&
-        aXmlHandler->mXmlNodeName != TTSymbol("Scenario") &&
-        aXmlHandler->mXmlNodeName != TTSymbol("Automation") &&
-        aXmlHandler->mXmlNodeName != TTSymbol("indexedCurves") &&
-        aXmlHandler->mXmlNodeName != TTSymbol("curve") &&
-        aXmlHandler->mXmlNodeName != TTSymbol("Loop") &&
-        aXmlHandler->mXmlNodeName != TTSymbol("Interval") &&
-        aXmlHandler->mXmlNodeName != TTSymbol("event") &&
-        aXmlHandler->mXmlNodeName != TTSymbol("command") &&
-        aXmlHandler->mXmlNodeName != TTSymbol("startEvent") &&
-        aXmlHandler->mXmlNodeName != TTSymbol("endEvent") &&
-        aXmlHandler->mXmlNodeName != TTSymbol("condition")&&
-        aXmlHandler->mXmlNodeName != TTSymbol("case"))
-    {
+    // note : the handler passes every node of the file to the scenario
+    ScenarioXmlNode node = ScenarioXmlNodeKind(aXmlHandler->mXmlNodeName);
+    
+    if (node == kScenarioXmlNodeIgnored)
         return kTTErrNone;
-    }
 #ifdef TTSCORE_DEBUG
      TTLogMessage("Scenario::ReadFromXml %s : reading %s\n", mName.c_str(), aXmlHandler->mXmlNodeName.c_str());
 #endif
@@ -645,21 +844,12 @@ TTErr Scenario::ReadFromXml(const TTValue& inputValue, TTValue& outputValue)
     if (mCurrentScenario.valid()) {
         
         // Scenario node :
-        if (aXmlHandler->mXmlNodeName == TTSymbol("Scenario")) {
+        if (node == kScenarioXmlNodeScenario) {
             
             TTSymbol subName;
             
             // get sub scenario name
-            if (!aXmlHandler->getXmlAttribute(kTTSym_name, v, YES)) {
-                
-                if (v.size() == 1) {
-                    
-                    if (v[0].type() == kTypeSymbol) {
-                        
-                        subName = v[0];
-                    }
-                }
-            }
+            ScenarioReadXmlSymbol(aXmlHandler, "name", subName);
             
             TTSymbol currentSubName;
             mCurrentScenario.get("name", currentSubName);
@@ -699,21 +889,12 @@ TTErr Scenario::ReadFromXml(const TTValue& inputValue, TTValue& outputValue)
     if (mCurrentLoop.valid())
     {
         // Loop node :
-        if (aXmlHandler->mXmlNodeName == TTSymbol("Loop"))
+        if (node == kScenarioXmlNodeLoop)
         {
             TTSymbol loopName;
             
             // get sub scenario name
-            if (!aXmlHandler->getXmlAttribute(kTTSym_name, v, YES))
-            {
-                if (v.size() == 1)
-                {
-                    if (v[0].type() == kTypeSymbol)
-                    {
-                        loopName = v[0];
-                    }
-                }
-            }
+            ScenarioReadXmlSymbol(aXmlHandler, "name", loopName);
             
             TTSymbol currentLoopName;
             mCurrentLoop.get("name", currentLoopName);
@@ -747,94 +928,30 @@ TTErr Scenario::ReadFromXml(const TTValue& inputValue, TTValue& outputValue)
         }
         
         // any other case
+        TTScoreProfilerScope profile(kTTScoreProfilerObjects, kTTSymEmpty);
+        ScenarioProfileObject(profile, mCurrentLoop);
+        
         return mCurrentLoop.send("ReadFromXml", inputValue);
     }
 	
 	// Switch on the name of the XML node
 	
     // Starts scenario reading
-    if (aXmlHandler->mXmlNodeName == kTTSym_xmlHandlerReadingStarts) {
-        
-        mLoading = YES;
-        mAttributeLoaded = NO;
-        mFileVersion = kTTSymEmpty;
-        
-        mCurrentTimeEvent = TTObject();
-
-        mCurrentTimeProcess = TTObject();
-        mCurrentTimeCondition = TTObject();
-        
-        // clear all data structures
-        mTimeEvents.clear();
-        mTimeProcesses.clear();
-#ifndef NO_EDITION_SOLVER
-        for (itSolver = mVariablesMap.begin() ; itSolver != mVariablesMap.end() ; itSolver++)
-            delete (SolverVariablePtr)itSolver->second;
-        
-        mVariablesMap.clear();
-        
-        for (itSolver = mConstraintsMap.begin() ; itSolver != mConstraintsMap.end() ; itSolver++)
-            delete (SolverConstraintPtr)itSolver->second;
-        
-        mConstraintsMap.clear();
+    if (node == kScenarioXmlNodeReadingStarts) {
         
-        for (itSolver = mRelationsMap.begin() ; itSolver != mRelationsMap.end() ; itSolver++)
-            delete (SolverRelationPtr)itSolver->second;
-        
-        mRelationsMap.clear();
-        
-        delete mEditionSolver;
-        mEditionSolver = new Solver();
-#endif
+        beginLoading();
         return kTTErrNone;
     }
     
     // Ends scenario reading
-    if (aXmlHandler->mXmlNodeName == kTTSym_xmlHandlerReadingEnds) {
-        
-        mLoading = NO;
-        mCompiled = NO;
-        
-        // for backward compatibility between version 0.2 and 0.3
-        if (mFileVersion == TTSymbol("0.2") &&
-            TTSymbol(TTSCORE_VERSION_STRING) == TTSymbol("0.3"))
-        {
-            
-            for (mTimeProcesses.begin(); mTimeProcesses.end(); mTimeProcesses.next())
-            {
-                TTObject aTimeProcess = mTimeProcesses.current()[0];
-                TTObject endEvent = getTimeProcessEndEvent(aTimeProcess);
-                
-                TTUInt32 duration, durationMin, durationMax;
-                aTimeProcess.get("duration", duration);
-                aTimeProcess.get("durationMin", durationMin);
-                aTimeProcess.get("durationMax", durationMax);
-                
-                TTObject endCondition;
-                endEvent.get("condition", endCondition);
-                
-                if (!endCondition.valid() && durationMin == 0 && durationMax == 0)
-                {
-                    aTimeProcess.set("durationMin", duration);
-                    aTimeProcess.set("durationMax", duration);
-                }
-            }
-        }
-        
-        // ask all event's state addresses to flatten it because they are managed by a TTScript class
-        // TODO : don't use TTScript anymore !
-        for (mTimeEvents.begin(); mTimeEvents.end(); mTimeEvents.next())
-        {
-            TTObject event = mTimeEvents.current()[0];
-            TTValue none;
-            event.send("StateAddresses", none);
-        }
+    if (node == kScenarioXmlNodeReadingEnds) {
         
+        endLoading();
         return kTTErrNone;
     }
     
     // Scenario node : read attribute only for upper scenario
-    if (aXmlHandler->mXmlNodeName == TTSymbol("Scenario") && !mAttributeLoaded) {
+    if (node == kScenarioXmlNodeScenario && !mAttributeLoaded) {
         
         // Get the scenario name
         if (!aXmlHandler->getXmlAttribute(kTTSym_name, v, YES)) {
@@ -901,13 +1018,15 @@ TTErr Scenario::ReadFromXml(const TTValue& inputValue, TTValue& outputValue)
     }
     
     // Start Event node (root Scenario only)
-    if (aXmlHandler->mXmlNodeName == TTSymbol("startEvent")) {
+    if (node == kScenarioXmlNodeStartEvent) {
         
         if (aXmlHandler->mXmlNodeStart) {
             
+            TTUInt32 date;
+            
             // Get the date
-            if (!aXmlHandler->getXmlAttribute(kTTSym_date, v, NO))
-                getStartEvent().set(kTTSym_date, v);
+            if (ScenarioReadXmlUInt32(aXmlHandler, "date", date))
+                getStartEvent().set(kTTSym_date, date);
             
             // Get the name
             if (!aXmlHandler->getXmlAttribute(kTTSym_name, v, YES))
@@ -916,19 +1035,27 @@ TTErr Scenario::ReadFromXml(const TTValue& inputValue, TTValue& outputValue)
             if (!aXmlHandler->mXmlNodeIsEmpty)
                 mCurrentTimeEvent = getStartEvent();
             
+            // an empty node can refer to a state read before (see TTTimeEvent::ReadFromXml)
+            else {
+                
+                aXmlHandler->setAttributeValue(kTTSym_object, getStartEvent());
+                aXmlHandler->sendMessage(kTTSym_Read);
+            }
         }
         else
             mCurrentTimeEvent = NULL;
     }
     
     // End Event node (root Scenario only)
-    if (aXmlHandler->mXmlNodeName == TTSymbol("endEvent")) {
+    if (node == kScenarioXmlNodeEndEvent) {
         
         if (aXmlHandler->mXmlNodeStart) {
             
+            TTUInt32 date;
+            
             // Get the date
-            if (!aXmlHandler->getXmlAttribute(kTTSym_date, v, NO))
-                getEndEvent().set(kTTSym_date, v);
+            if (ScenarioReadXmlUInt32(aXmlHandler, "date", date))
+                getEndEvent().set(kTTSym_date, date);
             
             // Get the name
             if (!aXmlHandler->getXmlAttribute(kTTSym_name, v, YES))
@@ -937,17 +1064,26 @@ TTErr Scenario::ReadFromXml(const TTValue& inputValue, TTValue& outputValue)
             if (!aXmlHandler->mXmlNodeIsEmpty)
                 mCurrentTimeEvent = getEndEvent();
             
+            // an empty node can refer to a state read before (see TTTimeEvent::ReadFromXml)
+            else {
+                
+                aXmlHandler->setAttributeValue(kTTSym_object, getEndEvent());
+                aXmlHandler->sendMessage(kTTSym_Read);
+            }
         }
         else
             mCurrentTimeEvent = NULL;
     }
     
     // Event node
-    if (aXmlHandler->mXmlNodeName == kTTSym_event) {
+    if (node == kScenarioXmlNodeEvent) {
         
         if (aXmlHandler->mXmlNodeStart) {
             
+            TTScoreProfilerScope profile(kTTScoreProfilerObjects, kTTSymEmpty);
+            
             readTimeEventFromXml(aXmlHandler, mCurrentTimeEvent);
+            ScenarioProfileObject(profile, mCurrentTimeEvent);
             
             if (aXmlHandler->mXmlNodeIsEmpty)
                 mCurrentTimeEvent = TTObject();
@@ -962,17 +1098,23 @@ TTErr Scenario::ReadFromXml(const TTValue& inputValue, TTValue& outputValue)
     // If there is a current time event
     if (mCurrentTimeEvent.valid()) {
         
+        TTScoreProfilerScope profile(kTTScoreProfilerObjects, kTTSymEmpty);
+        ScenarioProfileObject(profile, mCurrentTimeEvent);
+        
         // Pass the xml handler to the current condition to fill his data structure
         aXmlHandler->setAttributeValue(kTTSym_object, mCurrentTimeEvent);
         return aXmlHandler->sendMessage(kTTSym_Read);
     }
     
     // Condition node
-    if (aXmlHandler->mXmlNodeName == kTTSym_condition) {
+    if (node == kScenarioXmlNodeCondition) {
         
         if (aXmlHandler->mXmlNodeStart) {
             
+            TTScoreProfilerScope profile(kTTScoreProfilerObjects, kTTSymEmpty);
+            
             readTimeConditionFromXml(aXmlHandler, mCurrentTimeCondition);
+            ScenarioProfileObject(profile, mCurrentTimeCondition);
         
             if (aXmlHandler->mXmlNodeIsEmpty)
                 mCurrentTimeCondition = TTObject();
@@ -987,12 +1129,17 @@ TTErr Scenario::ReadFromXml(const TTValue& inputValue, TTValue& outputValue)
     // If there is a current time condition
     if (mCurrentTimeCondition.valid()) {
         
+        TTScoreProfilerScope profile(kTTScoreProfilerObjects, kTTSymEmpty);
+        ScenarioProfileObject(profile, mCurrentTimeCondition);
+        
         // Pass the xml handler to the current condition to fill his data structure
         aXmlHandler->setAttributeValue(kTTSym_object, mCurrentTimeCondition);
         return aXmlHandler->sendMessage(kTTSym_Read);
     }
     
     // Process node : the name of the node is the name of the process type
+    TTScoreProfilerScope profile(kTTScoreProfilerObjects, kTTSymEmpty);
+    
     if (!mCurrentTimeProcess.valid()) {
         
         if (aXmlHandler->mXmlNodeStart) {
@@ -1013,7 +1160,8 @@ TTErr Scenario::ReadFromXml(const TTValue& inputValue, TTValue& outputValue)
     if (mCurrentTimeProcess.valid())
     {
         // if the current time process is a sub scenario : don't forget it
-        if (mCurrentTimeProcess.name() == TTSymbol("Scenario") &&
+        if (node == kScenarioXmlNodeScenario &&
+            mCurrentTimeProcess.name() == aXmlHandler->mXmlNodeName &&
             !aXmlHandler->mXmlNodeIsEmpty)
         {
             mCurrentScenario = mCurrentTimeProcess;
@@ -1023,8 +1171,9 @@ TTErr Scenario::ReadFromXml(const TTValue& inputValue, TTValue& outputValue)
 #endif
         }
         // if the current time process is a loop : don't forget it
-        else if (mCurrentTimeProcess.name() == TTSymbol("Loop") &&
-                !aXmlHandler->mXmlNodeIsEmpty)
+        else if (node == kScenarioXmlNodeLoop &&
+                 mCurrentTimeProcess.name() == aXmlHandler->mXmlNodeName &&
+                 !aXmlHandler->mXmlNodeIsEmpty)
         {
             mCurrentLoop = mCurrentTimeProcess;
 #ifdef TTSCORE_DEBUG
@@ -1034,6 +1183,8 @@ TTErr Scenario::ReadFromXml(const TTValue& inputValue, TTValue& outputValue)
 #endif
         }
         
+        ScenarioProfileObject(profile, mCurrentTimeProcess);
+        
         // Pass the xml handler to the current process to fill his data structure
         aXmlHandler->setAttributeValue(kTTSym_object, mCurrentTimeProcess);
         return aXmlHandler->sendMessage(kTTSym_Read);
@@ -1042,104 +1193,1036 @@ TTErr Scenario::ReadFromXml(const TTValue& inputValue, TTValue& outputValue)
     return kTTErrNone;
 }
 
-#if 0
-#pragma mark -
-#pragma mark Notifications
-#endif
+void Scenario::beginLoading()
+{
+    mLoading = YES;
+    mAttributeLoaded = NO;
+    mFileVersion = kTTSymEmpty;
+    mLoadingEvents.clear();
+    mPending.clear();
+    
+    // the outermost loading scenario samples the curves of the whole tree
+    if (!TTCurveSampler::current())
+        TTCurveSampler::setCurrent(&mSampler);
+    
+    // and measures the load of the whole tree
+    if (mProfiling && !TTScoreProfiler::current()) {
+        
+        mProfiler.start();
+        TTScoreProfiler::setCurrent(&mProfiler);
+    }
+    
+    // and copies the states and the curves written once for the whole tree
+    if (!TTScorePayloads::current()) {
+        
+        mPayloads.clear();
+        TTScorePayloads::setCurrent(&mPayloads);
+    }
+    
+    mCurrentTimeEvent = TTObject();
+    mCurrentTimeProcess = TTObject();
+    mCurrentTimeCondition = TTObject();
+    
+    // clear all data structures
+    mTimeEvents.clear();
+    mTimeProcesses.clear();
+    mJournalEdited.clear();
+    mJournalRemovals.clear();
+    
+    resetEditionSolver();
+}
 
-TTErr Scenario::EventDateChanged(const TTValue& inputValue, TTValue& outputValue)
+void Scenario::endLoading()
 {
-    TT_ASSERT("Scenario::EventDateChanged : inputValue is correct", inputValue.size() == 1 && inputValue[0].type() == kTypeObject);
+    mLoading = NO;
+    mCompiled = NO;
+    mLoadingEvents.clear();
     
-    TTObject aTimeEvent = inputValue[0];
+    // sample all the curves read during the load before to link the events and processes
+    if (TTCurveSampler::current() == &mSampler) {
+        
+        TTCurveSampler::setCurrent(NULL);
+        
+        TTScoreProfilerScope profile(kTTScoreProfilerSampling, TTSymbol("curve"));
+        profile.setCount(mSampler.size());
+        
+        mSampler.run();
+    }
     
-    if (aTimeEvent == this->getStartEvent())
+    // the events are sorted once for all the events created during the load
+    mTimeEvents.sort(&TTTimeEventCompareDate);
+    
+    // for backward compatibility between version 0.2 and 0.3
+    if (mFileVersion == TTSymbol("0.2") &&
+        TTSymbol(TTSCORE_VERSION_STRING) == TTSymbol("0.3"))
     {
-        // if needed, the compile method should be called again now
-        mCompiled = NO;
         
-        return kTTErrNone;
+        for (mTimeProcesses.begin(); mTimeProcesses.end(); mTimeProcesses.next())
+        {
+            TTObject aTimeProcess = mTimeProcesses.current()[0];
+            TTObject endEvent = getTimeProcessEndEvent(aTimeProcess);
+            
+            TTUInt32 duration, durationMin, durationMax;
+            aTimeProcess.get("duration", duration);
+            aTimeProcess.get("durationMin", durationMin);
+            aTimeProcess.get("durationMax", durationMax);
+            
+            TTObject endCondition;
+            endEvent.get("condition", endCondition);
+            
+            if (!endCondition.valid() && durationMin == 0 && durationMax == 0)
+            {
+                aTimeProcess.set("durationMin", duration);
+                aTimeProcess.set("durationMax", duration);
+            }
+        }
     }
-    else if (aTimeEvent == this->getEndEvent())
+    
+    // ask all event's state addresses to flatten it because they are managed by a TTScript class
+    // TODO : don't use TTScript anymore !
+    for (mTimeEvents.begin(); mTimeEvents.end(); mTimeEvents.next())
     {
-        // if needed, the compile method should be called again now
-        mCompiled = NO;
+        TTObject event = mTimeEvents.current()[0];
+        TTValue none;
         
-        return kTTErrNone;
+        TTScoreProfilerScope profile(kTTScoreProfilerFlattening, kTTSymEmpty);
+        ScenarioProfileObject(profile, event);
+        
+        event.send("StateAddresses", none);
     }
     
-    TTLogError("Scenario::EventDateChanged %s : wrong event\n", mName.c_str());
-    return kTTErrGeneric;
+    // the edition solver is built once from the loaded events and processes
+    {
+        TTScoreProfilerScope profile(kTTScoreProfilerSolver, TTSymbol("Scenario"), this, mName);
+        buildEditionSolver();
+    }
+    
+    // what have been loaded is not edited
+    mJournalEdited.clear();
+    mJournalRemovals.clear();
+    
+    if (TTScorePayloads::current() == &mPayloads) {
+        
+        TTScorePayloads::setCurrent(NULL);
+        mPayloads.clear();
+    }
+    
+    if (TTScoreProfiler::current() == &mProfiler) {
+        
+        mProfiler.stop();
+        TTScoreProfiler::setCurrent(NULL);
+    }
 }
 
-TTErr Scenario::EventConditionChanged(const TTValue& inputValue, TTValue& outputValue)
+TTErr Scenario::WriteAsSnapshot(const TTValue& inputValue, TTValue& outputValue)
 {
-    TTBoolean assertion = inputValue.size() == 2 && inputValue[0].type() == kTypeObject && inputValue[1].type() == kTypeObject;
-    TT_ASSERT("Scenario::EventConditionChanged : inputValue is correct", assertion);
+    if (inputValue.size() != 2 || inputValue[0].type() != kTypePointer)
+        return kTTErrGeneric;
     
-    TTObject    aTimeEvent = inputValue[0];
-    TTObject    aTimeCondition = inputValue[1];
+    TTScoreSnapshotWriterPtr    aWriter = TTScoreSnapshotWriterPtr(TTPtr(inputValue[0]));
+    TTUInt32                    index = inputValue[1];
+    TTScoreSnapshotContainer    record;
+    TTUInt32                    containerIndex;
     
-    // no rule
+    loadPending();
     
-    return kTTErrNone;
+    memset(&record, 0, sizeof(record));
+    record.process = index;
+    record.startEvent = TTSCORE_SNAPSHOT_NONE;
+    record.endEvent = TTSCORE_SNAPSHOT_NONE;
+    
+    containerIndex = aWriter->append(kTTScoreSnapshotContainers, record);
+    aWriter->at<TTScoreSnapshotProcess>(kTTScoreSnapshotProcesses, index).container = containerIndex;
+    
+    writeSnapshotContent(*aWriter, containerIndex);
+    
+	return kTTErrNone;
 }
 
-TTErr Scenario::SchedulerSpeedChanged(const TTValue& inputValue, TTValue& outputValue)
+TTErr Scenario::ReadFromSnapshot(const TTValue& inputValue, TTValue& outputValue)
 {
-    TT_ASSERT("TTTimeContainer::SchedulerSpeedChanged : inputValue is correct", inputValue.size() == 1 && inputValue[0].type() == kTypeFloat64);
+    if (inputValue.size() != 2 || inputValue[0].type() != kTypePointer)
+        return kTTErrGeneric;
     
-    // for each time process of the scenario
-    for (mTimeProcesses.begin(); mTimeProcesses.end(); mTimeProcesses.next())
-    {
-        TTObject aTimeProcess = mTimeProcesses.current()[0];
-        
-        // get the actual time process scheduler
-        TTObject aScheduler;
-        aTimeProcess.get("scheduler", aScheduler);
-        
-        // set the time process scheduler speed value with the container scheduler speed value
-        aScheduler.set(kTTSym_speed, inputValue);
-    }
+    TTScoreSnapshotReaderPtr    aReader = TTScoreSnapshotReaderPtr(TTPtr(inputValue[0]));
+    TTUInt32                    index = inputValue[1];
     
-    return kTTErrNone;
+    if (!aReader->contains(kTTScoreSnapshotProcesses, index, 1))
+        return kTTErrGeneric;
+    
+    // the content will be read on first access
+    if (mPending.defer(*aReader, index))
+        return kTTErrNone;
+    
+	return readSnapshotProcess(*aReader, index);
 }
 
-#if 0
-#pragma mark -
-#pragma mark Specific Scenario Methods
-#endif
-
-TTErr Scenario::setViewZoom(const TTValue& value)
+TTErr Scenario::readSnapshotProcess(TTScoreSnapshotReader& aReader, TTUInt32 index)
 {
-    mViewZoom = value;
+    const TTScoreSnapshotProcess& process = aReader.records<TTScoreSnapshotProcess>(kTTScoreSnapshotProcesses)[index];
+    TTErr                         err;
     
-    return kTTErrNone;
+    beginLoading();
+    err = readSnapshotContent(aReader, process.container);
+    endLoading();
+    
+    return err;
 }
 
-TTErr Scenario::setViewPosition(const TTValue& value)
+void Scenario::loadPending()
 {
-    mViewPosition = value;
+    std::shared_ptr<TTScoreSnapshotReader>  aReader;
+    TTUInt32                                index;
     
-    return kTTErrNone;
+    if (mPending.take(aReader, index))
+        readSnapshotProcess(*aReader, index);
 }
 
-TTErr Scenario::Next(const TTValue& inputValue, TTValue& outputValue)
+TTErr Scenario::SnapshotWrite(const TTValue& inputValue, TTValue& outputValue)
 {
-    TTObject    aTimeEvent;
-    TTList      eventsToHappen;
-    TTUInt32    found = 0;
+    if (inputValue.size() != 1 || inputValue[0].type() != kTypeSymbol)
+        return kTTErrGeneric;
     
-    if (!mRunning)
+    TTSymbol                    path = inputValue[0];
+    TTScoreSnapshotWriter       aWriter;
+    
+    // a background writing done is finished, one in progress have to end first (it removes the journal too)
+    snapshotWriteFinish();
+    
+    if (mBackgroundWriter.busy())
         return kTTErrGeneric;
     
-    if (mMute)
+    writeSnapshot(aWriter);
+    
+    if (aWriter.write(TTString(path.c_str())))
         return kTTErrGeneric;
     
-    // trigger the first pending time event of the list (as there are sorted by date)
-    for (mTimeEvents.begin(); mTimeEvents.end(); mTimeEvents.next()) {
-        
-        aTimeEvent = mTimeEvents.current()[0];
+    // the journal is compacted into the snapshot
+    TTString journalPath = path.c_str();
+    journalPath += ".journal";
+    
+    TTScoreSnapshotRemoveJournal(journalPath);
+    mJournalEdited.clear();
+    mJournalRemovals.clear();
+    
+    return kTTErrNone;
+}
+
+TTErr Scenario::SnapshotWriteAsync(const TTValue& inputValue, TTValue& outputValue)
+{
+    if (inputValue.size() != 1 || inputValue[0].type() != kTypeSymbol)
+        return kTTErrGeneric;
+    
+    TTSymbol                    path = inputValue[0];
+    TTScoreSnapshotWriter       aWriter;
+    
+    snapshotWriteFinish();
+    
+    if (mBackgroundWriter.busy()) {
+        
+        TTLogError("Scenario::SnapshotWriteAsync %s : a writing is already in progress\n", mName.c_str());
+        return kTTErrGeneric;
+    }
+    
+    // copy the score into the tables of the writer
+    writeSnapshot(aWriter);
+    
+    // the editions made from now will be written into the next journal frame
+    mBackgroundPath = path;
+    mBackgroundEdited.swap(mJournalEdited);
+    mBackgroundRemovals.swap(mJournalRemovals);
+    mJournalEdited.clear();
+    mJournalRemovals.clear();
+    
+    return mBackgroundWriter.start(aWriter, TTString(path.c_str()));
+}
+
+TTErr Scenario::SnapshotWriteEnd(const TTValue& inputValue, TTValue& outputValue)
+{
+    TTErr err = snapshotWriteFinish();
+    
+    outputValue = TTBoolean(mBackgroundWriter.busy());
+    
+    return err;
+}
+
+TTErr Scenario::getSnapshotWriteProgress(TTValue& value)
+{
+    value = mBackgroundWriter.busy() ? mBackgroundWriter.progress() : TTFloat64(0.);
+    return kTTErrNone;
+}
+
+TTErr Scenario::snapshotWriteFinish()
+{
+    TTErr err;
+    
+    if (!mBackgroundWriter.busy() || !mBackgroundWriter.done())
+        return kTTErrNone;
+    
+    err = mBackgroundWriter.finish();
+    
+    if (!err) {
+        
+        // the journal is compacted into the snapshot
+        TTString journalPath = mBackgroundPath.c_str();
+        journalPath += ".journal";
+        
+        TTScoreSnapshotRemoveJournal(journalPath);
+    }
+    else {
+        
+        TTLogError("Scenario::snapshotWriteFinish %s : can't write %s\n", mName.c_str(), mBackgroundPath.c_str());
+        
+        // the editions written into the snapshot are still to save
+        mJournalEdited.insert(mBackgroundEdited.begin(), mBackgroundEdited.end());
+        mJournalRemovals.insert(mJournalRemovals.begin(), mBackgroundRemovals.begin(), mBackgroundRemovals.end());
+    }
+    
+    mBackgroundEdited.clear();
+    mBackgroundRemovals.clear();
+    
+    // notify observers the writing is done
+    sendNotification(TTSymbol("SnapshotWritten"), TTValue(mBackgroundPath, TTBoolean(err == kTTErrNone)));
+    
+    return err;
+}
+
+void Scenario::writeSnapshot(TTScoreSnapshotWriter& aWriter)
+{
+    TTScoreSnapshotContainer    record;
+    TTUInt32                    containerIndex;
+    TTValue                     out;
+    
+    memset(&record, 0, sizeof(record));
+    record.process = TTSCORE_SNAPSHOT_NONE;
+    record.name = aWriter.addSymbol(mName);
+    record.version = aWriter.addSymbol(TTSymbol(TTSCORE_VERSION_STRING));
+    
+    if (mColor.size() == 3) {
+        record.color[0] = TTUInt32(mColor[0]);
+        record.color[1] = TTUInt32(mColor[1]);
+        record.color[2] = TTUInt32(mColor[2]);
+    }
+    
+    if (mViewZoom.size() == 2) {
+        record.viewZoom[0] = mViewZoom[0];
+        record.viewZoom[1] = mViewZoom[1];
+    }
+    
+    if (mViewPosition.size() == 2) {
+        record.viewPosition[0] = mViewPosition[0];
+        record.viewPosition[1] = mViewPosition[1];
+    }
+    
+    // write the start and end events (the names are forced as for a xml file)
+    getStartEvent().set("name", kTTSym_start);
+    getStartEvent().send("WriteAsSnapshot", TTPtr(&aWriter), out);
+    record.startEvent = out[0];
+    
+    getEndEvent().set("name", kTTSym_end);
+    getEndEvent().send("WriteAsSnapshot", TTPtr(&aWriter), out);
+    record.endEvent = out[0];
+    
+    containerIndex = aWriter.append(kTTScoreSnapshotContainers, record);
+    
+    writeSnapshotContent(aWriter, containerIndex);
+}
+
+TTErr Scenario::SnapshotRead(const TTValue& inputValue, TTValue& outputValue)
+{
+    if (inputValue.size() != 1 || inputValue[0].type() != kTypeSymbol)
+        return kTTErrGeneric;
+    
+    TTSymbol                path = inputValue[0];
+    TTValue                 out;
+    TTErr                   err;
+    
+    // the reader is shared with the sub processes which defer their reading (see lazyLoading attribute)
+    std::shared_ptr<TTScoreSnapshotReader> reader(new TTScoreSnapshotReader());
+    TTScoreSnapshotReader&  aReader = *reader;
+    
+    aReader.setLazy(mLazyLoading);
+    
+    if (aReader.open(TTString(path.c_str()))) {
+        
+        TTLogError("Scenario::SnapshotRead %s : %s is not a valid snapshot\n", mName.c_str(), path.c_str());
+        return kTTErrGeneric;
+    }
+    
+    // the root container is always the first one
+    if (!aReader.contains(kTTScoreSnapshotContainers, 0, 1))
+        return kTTErrGeneric;
+    
+    const TTScoreSnapshotContainer& record = aReader.records<TTScoreSnapshotContainer>(kTTScoreSnapshotContainers)[0];
+    
+    if (record.process != TTSCORE_SNAPSHOT_NONE)
+        return kTTErrGeneric;
+    
+    beginLoading();
+    
+    mName = aReader.symbol(record.name);
+    mFileVersion = aReader.symbol(record.version);
+    mColor = TTValue(TTInt32(record.color[0]), TTInt32(record.color[1]), TTInt32(record.color[2]));
+    mViewZoom = TTValue(record.viewZoom[0], record.viewZoom[1]);
+    mViewPosition = TTValue(record.viewPosition[0], record.viewPosition[1]);
+    mAttributeLoaded = YES;
+    
+    // read the start and end events
+    getStartEvent().send("ReadFromSnapshot", TTValue(TTPtr(&aReader), record.startEvent), out);
+    getEndEvent().send("ReadFromSnapshot", TTValue(TTPtr(&aReader), record.endEvent), out);
+    
+    err = readSnapshotContent(aReader, 0);
+    
+    // replay the journal frames written since the snapshot
+    if (!err) {
+        
+        TTString                                        journalPath = path.c_str();
+        TTScoreBuffer                                   journal;
+        std::vector<std::pair<TTUInt64, TTUInt64> >     frames;
+        
+        journalPath += ".journal";
+        
+        // a torn frame left by a crash is cut from the journal : the complete frames before it are still replayed
+        if (TTScoreSnapshotReadJournal(journalPath, journal, frames) == kTTErrGeneric)
+            TTLogError("Scenario::SnapshotRead %s : the journal of %s can't be repaired\n", mName.c_str(), path.c_str());
+        
+        for (TTUInt32 i = 0; i < frames.size(); i++) {
+            
+            TTScoreSnapshotReader aFrameReader;
+            
+            if (aFrameReader.open(&journal[frames[i].first], frames[i].second) || readJournalFrame(aFrameReader)) {
+                
+                TTLogError("Scenario::SnapshotRead %s : the journal frame %d is not valid\n", mName.c_str(), i);
+                break;
+            }
+        }
+    }
+    
+    endLoading();
+    
+    return err;
+}
+
+TTErr Scenario::JournalWrite(const TTValue& inputValue, TTValue& outputValue)
+{
+    if (inputValue.size() != 1 || inputValue[0].type() != kTypeSymbol)
+        return kTTErrGeneric;
+    
+    TTSymbol                    path = inputValue[0];
+    TTString                    journalPath = path.c_str();
+    TTScoreSnapshotWriter       aWriter;
+    TTScoreSnapshotContainer    record;
+    TTScoreSnapshotRemoval      removal;
+    TTObject                    aTimeEvent, aTimeProcess, aTimeCondition;
+    TTValue                     v, out;
+    TTUInt32                    i;
+    
+    outputValue = TTBoolean(NO);
+    
+    // a background writing done removes the journal before the frame is appended
+    snapshotWriteFinish();
+    
+    // nothing have been edited since the last save
+    if (mJournalEdited.empty() && mJournalRemovals.empty())
+        return kTTErrNone;
+    
+    // the journal is removed at the end of the background writing : the editions wait the next frame
+    if (mBackgroundWriter.busy()) {
+        
+        outputValue = TTBoolean(YES);
+        return kTTErrGeneric;
+    }
+    
+    memset(&record, 0, sizeof(record));
+    record.process = TTSCORE_SNAPSHOT_NONE;
+    record.name = aWriter.addSymbol(mName);
+    record.version = aWriter.addSymbol(TTSymbol(TTSCORE_VERSION_STRING));
+    record.startEvent = TTSCORE_SNAPSHOT_NONE;
+    record.endEvent = TTSCORE_SNAPSHOT_NONE;
+    
+    // write the removed objects
+    for (i = 0; i < mJournalRemovals.size(); i++) {
+        
+        removal.table = mJournalRemovals[i].first;
+        removal.name = aWriter.addSymbol(mJournalRemovals[i].second);
+        aWriter.append(kTTScoreSnapshotRemovals, removal);
+    }
+    
+    // write the edited time events and the time events the edited time processes and time conditions bind on
+    // (the start and end events are found by their names as for a xml file)
+    getStartEvent().set("name", kTTSym_start);
+    getEndEvent().set("name", kTTSym_end);
+    
+    record.eventFirst = aWriter.size(kTTScoreSnapshotEvents);
+    
+    if (mJournalEdited.count(getStartEvent().instance()))
+        writeJournalTimeEvent(aWriter, getStartEvent());
+    
+    if (mJournalEdited.count(getEndEvent().instance()))
+        writeJournalTimeEvent(aWriter, getEndEvent());
+    
+    for (mTimeEvents.begin(); mTimeEvents.end(); mTimeEvents.next()) {
+        
+        aTimeEvent = mTimeEvents.current()[0];
+        
+        if (mJournalEdited.count(aTimeEvent.instance()))
+            writeJournalTimeEvent(aWriter, aTimeEvent);
+    }
+    
+    for (mTimeProcesses.begin(); mTimeProcesses.end(); mTimeProcesses.next()) {
+        
+        aTimeProcess = mTimeProcesses.current()[0];
+        
+        if (mJournalEdited.count(aTimeProcess.instance())) {
+            
+            writeJournalTimeEvent(aWriter, getTimeProcessStartEvent(aTimeProcess));
+            writeJournalTimeEvent(aWriter, getTimeProcessEndEvent(aTimeProcess));
+        }
+    }
+    
+    for (mTimeConditions.begin(); mTimeConditions.end(); mTimeConditions.next()) {
+        
+        aTimeCondition = mTimeConditions.current()[0];
+        
+        if (mJournalEdited.count(aTimeCondition.instance())) {
+            
+            aTimeCondition.get("events", v);
+            
+            for (TTUInt32 j = 0; j < v.size(); j++)
+                writeJournalTimeEvent(aWriter, v[j]);
+        }
+    }
+    
+    record.eventCount = aWriter.size(kTTScoreSnapshotEvents) - record.eventFirst;
+    
+    // reserve the records of the edited time processes
+    record.processFirst = aWriter.size(kTTScoreSnapshotProcesses);
+    for (mTimeProcesses.begin(); mTimeProcesses.end(); mTimeProcesses.next()) {
+        
+        aTimeProcess = mTimeProcesses.current()[0];
+        
+        if (mJournalEdited.count(aTimeProcess.instance()))
+            TTScoreSnapshotWriteProcess(aWriter, aTimeProcess,
+                                        aWriter.eventIndex(getTimeProcessStartEvent(aTimeProcess).instance()),
+                                        aWriter.eventIndex(getTimeProcessEndEvent(aTimeProcess).instance()));
+    }
+    record.processCount = aWriter.size(kTTScoreSnapshotProcesses) - record.processFirst;
+    
+    // write the edited time conditions
+    record.conditionFirst = aWriter.size(kTTScoreSnapshotConditions);
+    for (mTimeConditions.begin(); mTimeConditions.end(); mTimeConditions.next()) {
+        
+        aTimeCondition = mTimeConditions.current()[0];
+        
+        if (mJournalEdited.count(aTimeCondition.instance()))
+            aTimeCondition.send("WriteAsSnapshot", TTPtr(&aWriter), out);
+    }
+    record.conditionCount = aWriter.size(kTTScoreSnapshotConditions) - record.conditionFirst;
+    
+    aWriter.append(kTTScoreSnapshotContainers, record);
+    
+    // then let each edited time process write what is specific to it
+    i = record.processFirst;
+    for (mTimeProcesses.begin(); mTimeProcesses.end(); mTimeProcesses.next()) {
+        
+        aTimeProcess = mTimeProcesses.current()[0];
+        
+        if (mJournalEdited.count(aTimeProcess.instance())) {
+            
+            v = TTValue(TTPtr(&aWriter), i++);
+            aTimeProcess.send("WriteAsSnapshot", v, out);
+        }
+    }
+    
+    journalPath += ".journal";
+    
+    if (aWriter.append(journalPath)) {
+        
+        TTLogError("Scenario::JournalWrite %s : can't write the journal of %s\n", mName.c_str(), path.c_str());
+        return kTTErrGeneric;
+    }
+    
+    mJournalEdited.clear();
+    mJournalRemovals.clear();
+    
+    return kTTErrNone;
+}
+
+TTErr Scenario::JournalTouch(const TTValue& inputValue, TTValue& outputValue)
+{
+    if (inputValue.size() != 1 || inputValue[0].type() != kTypeObject)
+        return kTTErrGeneric;
+    
+    TTObject anObject = inputValue[0];
+    journalEdit(anObject);
+    
+    return kTTErrNone;
+}
+
+void Scenario::journalEdit(const TTObject& anObject)
+{
+    // what is loaded is already saved
+    if (mLoading || !anObject.valid())
+        return;
+    
+    mJournalEdited.insert(anObject.instance());
+}
+
+void Scenario::journalRemove(TTUInt32 table, const TTObject& anObject)
+{
+    TTSymbol name;
+    
+    if (mLoading || !anObject.valid())
+        return;
+    
+    mJournalEdited.erase(anObject.instance());
+    
+    TTObject(anObject).get(kTTSym_name, name);
+    mJournalRemovals.push_back(std::make_pair(table, name));
+}
+
+void Scenario::writeJournalTimeEvent(TTScoreSnapshotWriter& aWriter, TTObject aTimeEvent)
+{
+    TTValue out;
+    
+    if (aTimeEvent.valid() && aWriter.eventIndex(aTimeEvent.instance()) == TTSCORE_SNAPSHOT_NONE)
+        aTimeEvent.send("WriteAsSnapshot", TTPtr(&aWriter), out);
+}
+
+TTErr Scenario::readJournalFrame(TTScoreSnapshotReader& aReader)
+{
+    TTObject    anObject, aTimeEvent, aTimeCondition;
+    TTValue     out;
+    TTUInt32    i, j;
+    
+    if (!aReader.contains(kTTScoreSnapshotContainers, 0, 1))
+        return kTTErrGeneric;
+    
+    const TTScoreSnapshotContainer& record = aReader.records<TTScoreSnapshotContainer>(kTTScoreSnapshotContainers)[0];
+    
+    if (!aReader.contains(kTTScoreSnapshotEvents, record.eventFirst, record.eventCount) ||
+        !aReader.contains(kTTScoreSnapshotProcesses, record.processFirst, record.processCount) ||
+        !aReader.contains(kTTScoreSnapshotConditions, record.conditionFirst, record.conditionCount))
+        return kTTErrGeneric;
+    
+    // release the removed objects : the time processes and the time conditions before the time events they bind on
+    const TTScoreSnapshotRemoval*   removals = aReader.records<TTScoreSnapshotRemoval>(kTTScoreSnapshotRemovals);
+    const TTUInt32                  tables[3] = {kTTScoreSnapshotProcesses, kTTScoreSnapshotConditions, kTTScoreSnapshotEvents};
+    
+    for (j = 0; j < 3; j++) {
+        
+        for (i = 0; i < aReader.size(kTTScoreSnapshotRemovals); i++) {
+            
+            if (removals[i].table != tables[j])
+                continue;
+            
+            anObject = findJournalObject(tables[j], aReader.symbol(removals[i].name));
+            if (!anObject.valid())
+                continue;
+            
+            if (tables[j] == kTTScoreSnapshotProcesses)
+                this->TimeProcessRemove(anObject, out);
+            else if (tables[j] == kTTScoreSnapshotConditions)
+                this->TimeConditionRelease(anObject, out);
+            else
+                this->TimeEventRelease(anObject, out);
+        }
+    }
+    
+    // update the edited time events or create them
+    const TTScoreSnapshotEvent* events = aReader.records<TTScoreSnapshotEvent>(kTTScoreSnapshotEvents) + record.eventFirst;
+    
+    for (i = 0; i < record.eventCount; i++) {
+        
+        aTimeEvent = findJournalObject(kTTScoreSnapshotEvents, aReader.symbol(events[i].name));
+        
+        if (aTimeEvent.valid())
+            aTimeEvent.send("StateClear");
+        
+        else if (!this->TimeEventCreate(TTUInt32(events[i].date), out))
+            aTimeEvent = out[0];
+        
+        else {
+            
+            TTLogError("Scenario::readJournalFrame %s : can't create event\n", mName.c_str());
+            continue;
+        }
+        
+        aTimeEvent.send("ReadFromSnapshot", TTValue(TTPtr(&aReader), record.eventFirst + i), out);
+    }
+    
+    // replace the edited time processes
+    const TTScoreSnapshotProcess* processes = aReader.records<TTScoreSnapshotProcess>(kTTScoreSnapshotProcesses) + record.processFirst;
+    
+    for (i = 0; i < record.processCount; i++) {
+        
+        anObject = findJournalObject(kTTScoreSnapshotProcesses, aReader.symbol(processes[i].name));
+        if (anObject.valid())
+            this->TimeProcessRemove(anObject, out);
+        
+        readSnapshotTimeProcess(aReader, record.processFirst + i);
+    }
+    
+    // replace the edited time conditions
+    const TTScoreSnapshotCondition* conditions = aReader.records<TTScoreSnapshotCondition>(kTTScoreSnapshotConditions) + record.conditionFirst;
+    
+    for (i = 0; i < record.conditionCount; i++) {
+        
+        anObject = findJournalObject(kTTScoreSnapshotConditions, aReader.symbol(conditions[i].name));
+        if (anObject.valid())
+            this->TimeConditionRelease(anObject, out);
+        
+        if (this->TimeConditionCreate(TTValue(), out))
+            continue;
+        
+        aTimeCondition = out[0];
+        aTimeCondition.send("ReadFromSnapshot", TTValue(TTPtr(&aReader), record.conditionFirst + i), out);
+    }
+    
+    return kTTErrNone;
+}
+
+TTObject Scenario::findJournalObject(TTUInt32 table, TTSymbol aName)
+{
+    TTValue v(aName), out;
+    
+    if (table == kTTScoreSnapshotEvents) {
+        
+        if (aName == kTTSym_start)
+            return getStartEvent();
+        
+        if (aName == kTTSym_end)
+            return getEndEvent();
+        
+        mTimeEvents.find(&TTTimeContainerFindTimeEventWithName, (TTPtr)&v, out);
+    }
+    else if (table == kTTScoreSnapshotProcesses)
+        mTimeProcesses.find(&TTTimeContainerFindTimeProcessWithName, (TTPtr)&v, out);
+    
+    else if (table == kTTScoreSnapshotConditions)
+        mTimeConditions.find(&TTTimeContainerFindTimeConditionWithName, (TTPtr)&v, out);
+    
+    if (out.size() == 0)
+        return TTObject();
+    
+    return out[0];
+}
+
+void Scenario::writeSnapshotContent(TTScoreSnapshotWriter& aWriter, TTUInt32 containerIndex)
+{
+    TTScoreSnapshotContainer    record = aWriter.at<TTScoreSnapshotContainer>(kTTScoreSnapshotContainers, containerIndex);
+    TTObject                    aTimeEvent, aTimeProcess, aTimeCondition;
+    TTValue                     v, out;
+    TTUInt32                    i;
+    
+    // write all the time events
+    record.eventFirst = aWriter.size(kTTScoreSnapshotEvents);
+    for (mTimeEvents.begin(); mTimeEvents.end(); mTimeEvents.next()) {
+        
+        aTimeEvent = mTimeEvents.current()[0];
+        aTimeEvent.send("WriteAsSnapshot", TTPtr(&aWriter), out);
+    }
+    record.eventCount = aWriter.size(kTTScoreSnapshotEvents) - record.eventFirst;
+    
+    // reserve the records of all the time processes
+    record.processFirst = aWriter.size(kTTScoreSnapshotProcesses);
+    for (mTimeProcesses.begin(); mTimeProcesses.end(); mTimeProcesses.next()) {
+        
+        aTimeProcess = mTimeProcesses.current()[0];
+        
+        TTScoreSnapshotWriteProcess(aWriter, aTimeProcess,
+                                    aWriter.eventIndex(getTimeProcessStartEvent(aTimeProcess).instance()),
+                                    aWriter.eventIndex(getTimeProcessEndEvent(aTimeProcess).instance()));
+    }
+    record.processCount = aWriter.size(kTTScoreSnapshotProcesses) - record.processFirst;
+    
+    // write all the time conditions
+    record.conditionFirst = aWriter.size(kTTScoreSnapshotConditions);
+    for (mTimeConditions.begin(); mTimeConditions.end(); mTimeConditions.next()) {
+        
+        aTimeCondition = mTimeConditions.current()[0];
+        aTimeCondition.send("WriteAsSnapshot", TTPtr(&aWriter), out);
+    }
+    record.conditionCount = aWriter.size(kTTScoreSnapshotConditions) - record.conditionFirst;
+    
+    aWriter.at<TTScoreSnapshotContainer>(kTTScoreSnapshotContainers, containerIndex) = record;
+    
+    // then let each time process write what is specific to it (sub scenarios append their own container)
+    i = record.processFirst;
+    for (mTimeProcesses.begin(); mTimeProcesses.end(); mTimeProcesses.next()) {
+        
+        aTimeProcess = mTimeProcesses.current()[0];
+        
+        v = TTValue(TTPtr(&aWriter), i++);
+        aTimeProcess.send("WriteAsSnapshot", v, out);
+    }
+}
+
+TTErr Scenario::readSnapshotContent(TTScoreSnapshotReader& aReader, TTUInt32 containerIndex)
+{
+    TTObject    aTimeEvent, aTimeCondition;
+    TTValue     v, out;
+    TTUInt32    i;
+    
+    if (!aReader.contains(kTTScoreSnapshotContainers, containerIndex, 1))
+        return kTTErrGeneric;
+    
+    const TTScoreSnapshotContainer& record = aReader.records<TTScoreSnapshotContainer>(kTTScoreSnapshotContainers)[containerIndex];
+    
+    if (!aReader.contains(kTTScoreSnapshotEvents, record.eventFirst, record.eventCount) ||
+        !aReader.contains(kTTScoreSnapshotProcesses, record.processFirst, record.processCount) ||
+        !aReader.contains(kTTScoreSnapshotConditions, record.conditionFirst, record.conditionCount))
+        return kTTErrGeneric;
+    
+    // create all the time events
+    const TTScoreSnapshotEvent* events = aReader.records<TTScoreSnapshotEvent>(kTTScoreSnapshotEvents) + record.eventFirst;
+    
+    for (i = 0; i < record.eventCount; i++) {
+        
+        if (this->TimeEventCreate(TTUInt32(events[i].date), out)) {
+            
+            TTLogError("Scenario::readSnapshotContent %s : can't create event\n", mName.c_str());
+            continue;
+        }
+        
+        aTimeEvent = out[0];
+        aTimeEvent.send("ReadFromSnapshot", TTValue(TTPtr(&aReader), record.eventFirst + i), out);
+    }
+    
+    // create all the time processes
+    for (i = 0; i < record.processCount; i++)
+        readSnapshotTimeProcess(aReader, record.processFirst + i);
+    
+    // create all the time conditions
+    for (i = 0; i < record.conditionCount; i++) {
+        
+        if (this->TimeConditionCreate(v, out))
+            continue;
+        
+        aTimeCondition = out[0];
+        aTimeCondition.send("ReadFromSnapshot", TTValue(TTPtr(&aReader), record.conditionFirst + i), out);
+    }
+    
+    return kTTErrNone;
+}
+
+TTErr Scenario::readSnapshotTimeProcess(TTScoreSnapshotReader& aReader, TTUInt32 index)
+{
+    TTObject    aTimeProcess, start, end;
+    TTValue     v, out;
+    
+    const TTScoreSnapshotProcess& record = aReader.records<TTScoreSnapshotProcess>(kTTScoreSnapshotProcesses)[index];
+    
+    start = aReader.event(record.start);
+    end = aReader.event(record.end);
+    
+    if (!start.valid() || !end.valid()) {
+        
+        TTLogError("Scenario::readSnapshotTimeProcess %s : can't find start or end event\n", mName.c_str());
+        return kTTErrGeneric;
+    }
+    
+    v = TTValue(aReader.symbol(record.type), start, end);
+    if (this->TimeProcessAdd(v, out))
+        return kTTErrGeneric;
+    
+    aTimeProcess = out[0];
+    TTScoreSnapshotReadProcess(aReader, record, aTimeProcess);
+    
+    v = TTValue(TTPtr(&aReader), index);
+    return aTimeProcess.send("ReadFromSnapshot", v, out);
+}
+
+#if 0
+#pragma mark -
+#pragma mark Notifications
+#endif
+
+TTErr Scenario::EventDateChanged(const TTValue& inputValue, TTValue& outputValue)
+{
+    TT_ASSERT("Scenario::EventDateChanged : inputValue is correct", inputValue.size() == 1 && inputValue[0].type() == kTypeObject);
+    
+    TTObject aTimeEvent = inputValue[0];
+    
+    if (aTimeEvent == this->getStartEvent())
+    {
+        // if needed, the compile method should be called again now
+        mCompiled = NO;
+        
+        journalEdit(aTimeEvent);
+        
+        return kTTErrNone;
+    }
+    else if (aTimeEvent == this->getEndEvent())
+    {
+        // if needed, the compile method should be called again now
+        mCompiled = NO;
+        
+        journalEdit(aTimeEvent);
+        
+        return kTTErrNone;
+    }
+    
+    TTLogError("Scenario::EventDateChanged %s : wrong event\n", mName.c_str());
+    return kTTErrGeneric;
+}
+
+TTErr Scenario::EventConditionChanged(const TTValue& inputValue, TTValue& outputValue)
+{
+    TTBoolean assertion = inputValue.size() == 2 && inputValue[0].type() == kTypeObject && inputValue[1].type() == kTypeObject;
+    TT_ASSERT("Scenario::EventConditionChanged : inputValue is correct", assertion);
+    
+    TTObject    aTimeEvent = inputValue[0];
+    TTObject    aTimeCondition = inputValue[1];
+    
+    // the cases of the time condition changed
+    journalEdit(aTimeCondition);
+    
+    // no rule
+    
+    return kTTErrNone;
+}
+
+TTErr Scenario::SchedulerSpeedChanged(const TTValue& inputValue, TTValue& outputValue)
+{
+    TT_ASSERT("TTTimeContainer::SchedulerSpeedChanged : inputValue is correct", inputValue.size() == 1 && inputValue[0].type() == kTypeFloat64);
+    
+    // for each time process of the scenario
+    for (mTimeProcesses.begin(); mTimeProcesses.end(); mTimeProcesses.next())
+    {
+        TTObject aTimeProcess = mTimeProcesses.current()[0];
+        
+        // get the actual time process scheduler
+        TTObject aScheduler;
+        aTimeProcess.get("scheduler", aScheduler);
+        
+        // set the time process scheduler speed value with the container scheduler speed value
+        aScheduler.set(kTTSym_speed, inputValue);
+    }
+    
+    return kTTErrNone;
+}
+
+#if 0
+#pragma mark -
+#pragma mark Specific Scenario Methods
+#endif
+
+TTErr Scenario::setViewZoom(const TTValue& value)
+{
+    mViewZoom = value;
+    
+    return kTTErrNone;
+}
+
+TTErr Scenario::setViewPosition(const TTValue& value)
+{
+    mViewPosition = value;
+    
+    return kTTErrNone;
+}
+
+TTErr Scenario::setEditionSearchTime(const TTValue& value)
+{
+    mEditionSearchTime = value;
+    configureEditionSolver();
+    
+    return kTTErrNone;
+}
+
+TTErr Scenario::setEditionSearchNodes(const TTValue& value)
+{
+    mEditionSearchNodes = value;
+    configureEditionSolver();
+    
+    return kTTErrNone;
+}
+
+TTErr Scenario::setEditionSearchObjective(const TTValue& value)
+{
+    mEditionSearchObjective = value;
+    configureEditionSolver();
+    
+    return kTTErrNone;
+}
+
+TTErr Scenario::setEditionAnytime(const TTValue& value)
+{
+    mEditionAnytime = value;
+    configureEditionSolver();
+    
+    return kTTErrNone;
+}
+
+TTErr Scenario::setEditionSearchThreads(const TTValue& value)
+{
+    mEditionSearchThreads = value;
+    configureEditionSolver();
+    
+    return kTTErrNone;
+}
+
+TTErr Scenario::setEditionDeterministic(const TTValue& value)
+{
+    mEditionDeterministic = value;
+    configureEditionSolver();
+    
+    return kTTErrNone;
+}
+
+void Scenario::configureEditionSolver()
+{
+#ifndef NO_EDITION_SOLVER
+    if (mEditionSolver) {
+        
+        mEditionSolver->setSearchOptions(mEditionSearchTime, mEditionSearchNodes, mEditionSearchObjective, mEditionAnytime);
+        mEditionSolver->setSearchThreads(mEditionSearchThreads, mEditionDeterministic);
+    }
+#endif
+}
+
+TTErr Scenario::getEditionStatistics(TTValue& value)
+{
+    value.clear();
+    
+#ifndef NO_EDITION_SOLVER
+    if (mEditionSolver) {
+        
+        const SolverStatistics& statistics = mEditionSolver->getStatistics();
+        
+        value.append(TTUInt32(statistics.nodes));
+        value.append(TTUInt32(statistics.fails));
+        value.append(TTFloat64(statistics.elapsed));
+        value.append(TTInt32(statistics.memoryPeak));
+        
+        return kTTErrNone;
+    }
+#endif
+    return kTTErrGeneric;
+}
+
+TTErr Scenario::getProfilingReport(TTValue& value)
+{
+    mProfiler.report(value, mProfilingSlowest);
+    return kTTErrNone;
+}
+
+TTErr Scenario::Next(const TTValue& inputValue, TTValue& outputValue)
+{
+    TTObject    aTimeEvent;
+    TTList      eventsToHappen;
+    TTUInt32    found = 0;
+    
+    if (!mRunning)
+        return kTTErrGeneric;
+    
+    if (mMute)
+        return kTTErrGeneric;
+    
+    // trigger the first pending time event of the list (as there are sorted by date)
+    for (mTimeEvents.begin(); mTimeEvents.end(); mTimeEvents.next()) {
+        
+        aTimeEvent = mTimeEvents.current()[0];
         
         if (getTimeEventStatus(aTimeEvent) == kTTSym_eventPending) {
             
@@ -1185,6 +2268,8 @@ TTErr Scenario::Next(const TTValue& inputValue, TTValue& outputValue)
 
 TTErr Scenario::TimeEventCreate(const TTValue& inputValue, TTValue& outputValue)
 {
+    loadPending();
+    
     TTObject    aTimeEvent, thisObject(this);
     TTValue     args, aCacheElement, scenarioDuration;
     
@@ -1210,15 +2295,17 @@ TTErr Scenario::TimeEventCreate(const TTValue& inputValue, TTValue& outputValue)
             makeTimeEventCacheElement(aTimeEvent, aCacheElement);
             
             // store time event object and observers
+            // (during a load the events are sorted once at the end, see in endLoading)
             mTimeEvents.append(aCacheElement);
-            mTimeEvents.sort(&TTTimeEventCompareDate);
-#ifndef NO_EDITION_SOLVER
-            // add variable to the solver
-            SolverVariablePtr variable = new SolverVariable(mEditionSolver, aTimeEvent, TTUInt32(scenarioDuration[0]));
+            if (!mLoading)
+                mTimeEvents.sort(&TTTimeEventCompareDate);
+            
+            // add variable to the solver (during a load this is done at the end, see in buildEditionSolver)
+            if (!mLoading)
+                addEditionVariable(aTimeEvent);
+            
+            journalEdit(aTimeEvent);
             
-            // store the variable relative to the time event
-            mVariablesMap.emplace(aTimeEvent.instance(), variable);
-#endif
             // return the time event
             outputValue = aTimeEvent;
             
@@ -1229,92 +2316,326 @@ TTErr Scenario::TimeEventCreate(const TTValue& inputValue, TTValue& outputValue)
         }
     }
     
-    return kTTErrGeneric;
+    return kTTErrGeneric;
+}
+
+TTErr Scenario::TimeEventRelease(const TTValue& inputValue, TTValue& outputValue)
+{
+    TTObject                aTimeEvent;
+    TTValue                 v, aCacheElement;
+#ifndef NO_EDITION_SOLVER
+    TTBoolean               found;
+    SolverVariablePtr       variable;
+    SolverObjectMapIterator it;
+#endif
+    
+    if (inputValue.size() == 1) {
+        
+        if (inputValue[0].type() == kTypeObject) {
+            
+            aTimeEvent = inputValue[0];
+            
+            // try to find the time event
+            mTimeEvents.find(&TTTimeContainerFindTimeEvent, (TTPtr)aTimeEvent.instance(), aCacheElement);
+            
+            // couldn't find the same time event in the scenario
+            if (aCacheElement.size() == 0)
+                return kTTErrValueNotFound;
+            
+            else {
+                
+                // if the time event is used by a time process it can't be released
+                mTimeProcesses.find(&TTTimeContainerFindTimeProcessWithTimeEvent, (TTPtr)aTimeEvent.instance(), v);
+                
+                if (v.size() == 0) {
+                    
+                    journalRemove(kTTScoreSnapshotEvents, aTimeEvent);
+                    
+                    // remove time event object and observers
+                    mTimeEvents.remove(aCacheElement);
+                    
+                    // delete all observers
+                    deleteTimeEventCacheElement(aCacheElement);
+                    
+                    // remove the time event from its time condition
+                    TTObject aTimeCondition;
+                    aTimeEvent.get("condition", aTimeCondition);
+                    if (aTimeCondition.valid())
+                    {
+                        aTimeCondition.send("EventRemove", aTimeEvent);
+                    }
+                    
+#ifndef NO_EDITION_SOLVER
+                    // retreive solver variable relative to each event
+                    // note : there is no variable during a load
+                    it = mVariablesMap.find(aTimeEvent.instance());
+                    if (it == mVariablesMap.end())
+                        return kTTErrNone;
+                    
+                    variable = SolverVariablePtr(it->second);
+                    
+                    // remove variable from the solver
+                    // if it is still not used in a constraint
+                    found = NO;
+                    for (it = mConstraintsMap.begin() ; it != mConstraintsMap.end() ; it++) {
+                        
+                        found = SolverConstraintPtr(it->second)->startVariable == variable || SolverConstraintPtr(it->second)->endVariable == variable;
+                        if (found) break;
+                    }
+                    
+                    if (!found) {
+                        
+                        // if it is still not used in a relation
+                        for (it = mRelationsMap.begin() ; it != mRelationsMap.end() ; it++) {
+                            
+                            found = SolverRelationPtr(it->second)->startVariable == variable || SolverRelationPtr(it->second)->endVariable == variable;
+                            if (found) break;
+                        }
+                    }
+                    
+                    if (!found) {
+                        mVariablesMap.erase(aTimeEvent.instance());
+                        delete variable;
+                    }
+#endif
+                    // needs to be compiled again
+                    mCompiled = NO;
+                    
+                    return kTTErrNone;
+                }
+            }
+        }
+    }
+    
+    return kTTErrGeneric;
+}
+
+TTErr Scenario::EditionBegin()
+{
+    loadPending();
+    
+#ifndef NO_EDITION_SOLVER
+    if (mEditionDepth == 0)
+        mEditionSolver->beginEdition();
+#endif
+    mEditionDepth++;
+    
+    return kTTErrNone;
+}
+
+TTErr Scenario::EditionEnd()
+{
+    if (mEditionDepth == 0) {
+        
+        TTLogError("Scenario::EditionEnd %s : no edition transaction in progress\n", mName.c_str());
+        return kTTErrGeneric;
+    }
+    
+    mEditionDepth--;
+    
+    if (mEditionDepth > 0)
+        return kTTErrNone;
+    
+#ifndef NO_EDITION_SOLVER
+    if (!mEditionSolver->endEdition()) {
+        
+        TTLogError("Scenario::EditionEnd %s : the editions can't be solved\n", mName.c_str());
+        return kTTErrGeneric;
+    }
+    
+    updateEditionVariables();
+    
+    // needs to be compiled again
+    mCompiled = NO;
+#endif
+    return kTTErrNone;
+}
+
+void Scenario::updateEditionVariables()
+{
+#ifndef NO_EDITION_SOLVER
+    SolverObjectMapIterator it;
+    
+    // the events are updated once at the end of the transaction
+    if (mEditionDepth > 0)
+        return;
+    
+    // note : only the events which date changed are notified
+    for (it = mVariablesMap.begin() ; it != mVariablesMap.end() ; it++)
+        if (SolverVariablePtr(it->second)->update())
+            journalEdit(SolverVariablePtr(it->second)->event);
+#endif
+}
+
+void Scenario::addEditionVariable(TTObject& aTimeEvent)
+{
+#ifndef NO_EDITION_SOLVER
+    TTValue scenarioDuration;
+    
+    this->getAttributeValue(kTTSym_duration, scenarioDuration);
+    
+    // add variable to the solver
+    SolverVariablePtr variable = new SolverVariable(mEditionSolver, aTimeEvent, TTUInt32(scenarioDuration[0]));
+    
+    // store the variable relative to the time event
+    mVariablesMap.emplace(aTimeEvent.instance(), variable);
+#endif
+}
+
+void Scenario::addEditionTimeProcess(TTObject& aTimeProcess)
+{
+#ifndef NO_EDITION_SOLVER
+    SolverVariablePtr       startVariable, endVariable;
+    SolverObjectMapIterator it;
+    TTValue                 duration, scenarioDuration;
+    
+    aTimeProcess.get(kTTSym_duration, duration);
+    
+    // get scenario duration
+    this->getAttributeValue(kTTSym_duration, scenarioDuration);
+    
+    // retreive solver variable relative to each event
+    it = mVariablesMap.find(getTimeProcessStartEvent(aTimeProcess).instance());
+    startVariable = SolverVariablePtr(it->second);
+    
+    it = mVariablesMap.find(getTimeProcessEndEvent(aTimeProcess).instance());
+    endVariable = SolverVariablePtr(it->second);
+    
+    // update the Solver depending on the type of the time process
+    if (aTimeProcess.name() == TTSymbol("Interval")) {
+        
+        // add a relation between the 2 variables to the solver
+        SolverRelationPtr relation = new SolverRelation(mEditionSolver, startVariable, endVariable, getTimeProcessDurationMin(aTimeProcess), getTimeProcessDurationMax(aTimeProcess));
+        
+        // store the relation relative to this time process
+        mRelationsMap.emplace(aTimeProcess.instance(), relation);
+        
+    }
+    else {
+        
+        // limit the start variable to the process duration
+        // this avoid time crushing when a time process moves while it is connected to other process
+        startVariable->limit(TTUInt32(duration[0]), TTUInt32(duration[0]));
+        
+        // add a constraint between the 2 variables to the solver
+        SolverConstraintPtr constraint = new SolverConstraint(mEditionSolver, startVariable, endVariable, getTimeProcessDurationMin(aTimeProcess), getTimeProcessDurationMax(aTimeProcess), TTUInt32(scenarioDuration[0]));
+        
+        // store the constraint relative to this time process
+        mConstraintsMap.emplace(aTimeProcess.instance(), constraint);
+    }
+#endif
+}
+
+void Scenario::getEditionConflict(TTValue& value)
+{
+    value.clear();
+#ifndef NO_EDITION_SOLVER
+    SolverObjectMapIterator it;
+    const SolverConflict&   conflict = mEditionSolver->getConflict();
+    
+    value.append(TTUInt32(conflict.nearestValue));
+    
+    // the time processes which constraint or duration is in conflict
+    for (it = mConstraintsMap.begin() ; it != mConstraintsMap.end() ; it++) {
+        
+        SolverConstraintPtr constraint = SolverConstraintPtr(it->second);
+        
+        if (!conflict.explained ||
+            std::find(conflict.constraintsIDs.begin(), conflict.constraintsIDs.end(), constraint->ID) != conflict.constraintsIDs.end() ||
+            std::find(conflict.varsIDs.begin(), conflict.varsIDs.end(), constraint->startVariable->rangeID) != conflict.varsIDs.end())
+            value.append(TTObject(TTObjectBasePtr(it->first)));
+    }
+    
+    // the intervals which relation is in conflict
+    for (it = mRelationsMap.begin() ; it != mRelationsMap.end() ; it++) {
+        
+        SolverRelationPtr relation = SolverRelationPtr(it->second);
+        
+        if (!conflict.explained ||
+            std::find(conflict.constraintsIDs.begin(), conflict.constraintsIDs.end(), relation->minBoundID) != conflict.constraintsIDs.end() ||
+            std::find(conflict.constraintsIDs.begin(), conflict.constraintsIDs.end(), relation->maxBoundID) != conflict.constraintsIDs.end())
+            value.append(TTObject(TTObjectBasePtr(it->first)));
+    }
+#endif
 }
 
-TTErr Scenario::TimeEventRelease(const TTValue& inputValue, TTValue& outputValue)
+void Scenario::resetEditionSolver()
 {
-    TTObject                aTimeEvent;
-    TTValue                 v, aCacheElement;
 #ifndef NO_EDITION_SOLVER
-    TTBoolean               found;
-    SolverVariablePtr       variable;
-    SolverObjectMapIterator it;
+    SolverObjectMapIterator itSolver;
+    
+    for (itSolver = mVariablesMap.begin() ; itSolver != mVariablesMap.end() ; itSolver++)
+        delete (SolverVariablePtr)itSolver->second;
+    
+    mVariablesMap.clear();
+    
+    for (itSolver = mConstraintsMap.begin() ; itSolver != mConstraintsMap.end() ; itSolver++)
+        delete (SolverConstraintPtr)itSolver->second;
+    
+    mConstraintsMap.clear();
+    
+    for (itSolver = mRelationsMap.begin() ; itSolver != mRelationsMap.end() ; itSolver++)
+        delete (SolverRelationPtr)itSolver->second;
+    
+    mRelationsMap.clear();
+    
+    delete mEditionSolver;
+    mEditionSolver = new Solver();
+    configureEditionSolver();
 #endif
+    mEditionDepth = 0;
+}
+
+void Scenario::buildEditionSolver()
+{
+#ifndef NO_EDITION_SOLVER
+    // the relations which need to be ordered are solved once at the end
+    mEditionSolver->beginEdition();
     
-    if (inputValue.size() == 1) {
+    for (mTimeEvents.begin(); mTimeEvents.end(); mTimeEvents.next())
+    {
+        TTObject aTimeEvent = mTimeEvents.current()[0];
         
-        if (inputValue[0].type() == kTypeObject) {
-            
-            aTimeEvent = inputValue[0];
-            
-            // try to find the time event
-            mTimeEvents.find(&TTTimeContainerFindTimeEvent, (TTPtr)aTimeEvent.instance(), aCacheElement);
-            
-            // couldn't find the same time event in the scenario
-            if (aCacheElement.size() == 0)
-                return kTTErrValueNotFound;
-            
-            else {
-                
-                // if the time event is used by a time process it can't be released
-                mTimeProcesses.find(&TTTimeContainerFindTimeProcessWithTimeEvent, (TTPtr)aTimeEvent.instance(), v);
-                
-                if (v.size() == 0) {
-                    
-                    // remove time event object and observers
-                    mTimeEvents.remove(aCacheElement);
-                    
-                    // delete all observers
-                    deleteTimeEventCacheElement(aCacheElement);
-                    
-                    // remove the time event from its time condition
-                    TTObject aTimeCondition;
-                    aTimeEvent.get("condition", aTimeCondition);
-                    if (aTimeCondition.valid())
-                    {
-                        aTimeCondition.send("EventRemove", aTimeEvent);
-                    }
-                    
-#ifndef NO_EDITION_SOLVER
-                    // retreive solver variable relative to each event
-                    it = mVariablesMap.find(aTimeEvent.instance());
-                    variable = SolverVariablePtr(it->second);
-                    
-                    // remove variable from the solver
-                    // if it is still not used in a constraint
-                    found = NO;
-                    for (it = mConstraintsMap.begin() ; it != mConstraintsMap.end() ; it++) {
-                        
-                        found = SolverConstraintPtr(it->second)->startVariable == variable || SolverConstraintPtr(it->second)->endVariable == variable;
-                        if (found) break;
-                    }
-                    
-                    if (!found) {
-                        
-                        // if it is still not used in a relation
-                        for (it = mRelationsMap.begin() ; it != mRelationsMap.end() ; it++) {
-                            
-                            found = SolverRelationPtr(it->second)->startVariable == variable || SolverRelationPtr(it->second)->endVariable == variable;
-                            if (found) break;
-                        }
-                    }
-                    
-                    if (!found) {
-                        mVariablesMap.erase(aTimeEvent.instance());
-                        delete variable;
-                    }
+        if (mVariablesMap.find(aTimeEvent.instance()) == mVariablesMap.end())
+            addEditionVariable(aTimeEvent);
+    }
+    
+    for (mTimeProcesses.begin(); mTimeProcesses.end(); mTimeProcesses.next())
+    {
+        TTObject aTimeProcess = mTimeProcesses.current()[0];
+        
+        if (mRelationsMap.find(aTimeProcess.instance()) == mRelationsMap.end() &&
+            mConstraintsMap.find(aTimeProcess.instance()) == mConstraintsMap.end())
+            addEditionTimeProcess(aTimeProcess);
+    }
+    
+    if (!mEditionSolver->endEdition())
+        TTLogError("Scenario::buildEditionSolver %s : the loaded scenario can't be solved\n", mName.c_str());
+    
+    updateEditionVariables();
 #endif
-                    // needs to be compiled again
-                    mCompiled = NO;
-                    
-                    return kTTErrNone;
-                }
-            }
-        }
+}
+
+TTErr Scenario::EditionRefine(const TTValue& inputValue, TTValue& outputValue)
+{
+    outputValue = TTBoolean(NO);
+    
+#ifndef NO_EDITION_SOLVER
+    // the events are updated at the end of the transaction
+    if (mEditionDepth > 0)
+        return kTTErrNone;
+    
+    if (mEditionSolver->applyRefinements()) {
+        
+        updateEditionVariables();
+        
+        // needs to be compiled again
+        mCompiled = NO;
     }
     
-    return kTTErrGeneric;
+    outputValue = TTBoolean(mEditionSolver->isRefining());
+#endif
+    return kTTErrNone;
 }
 
 TTErr Scenario::TimeEventMove(const TTValue& inputValue, TTValue& outputValue)
@@ -1366,15 +2687,16 @@ TTErr Scenario::TimeEventMove(const TTValue& inputValue, TTValue& outputValue)
             if (!sErr) {
                 
                 // update each solver variable value
-                for (it = mVariablesMap.begin() ; it != mVariablesMap.end() ; it++)
-                    
-                    SolverVariablePtr(it->second)->update();
+                updateEditionVariables();
                 
                 // needs to be compiled again
                 mCompiled = NO;
                 
                 return kTTErrNone;
             }
+            
+            // tell why the event can't be moved
+            getEditionConflict(outputValue);
 #endif
         }
     }
@@ -1419,6 +2741,9 @@ TTErr Scenario::TimeEventReplace(const TTValue& inputValue, TTValue& outputValue
             
             else {
                 
+                journalRemove(kTTScoreSnapshotEvents, aFormerTimeEvent);
+                journalEdit(aNewTimeEvent);
+                
                 // remove the former time event object and observers
                 mTimeEvents.remove(aCacheElement);
                 
@@ -1441,12 +2766,14 @@ TTErr Scenario::TimeEventReplace(const TTValue& inputValue, TTValue& outputValue
                 if (getTimeProcessStartEvent(aTimeProcess) == aFormerTimeEvent) {
                     
                     setTimeProcessStartEvent(aTimeProcess, aNewTimeEvent);
+                    journalEdit(aTimeProcess);
                     continue;
                 }
                 
                 if (getTimeProcessEndEvent(aTimeProcess) == aFormerTimeEvent) {
                     
                     setTimeProcessEndEvent(aTimeProcess, aNewTimeEvent);
+                    journalEdit(aTimeProcess);
                     
                     // a time process with a conditioned end event cannot be rigid
                     v = TTBoolean(!getTimeEventCondition(aNewTimeEvent).valid());
@@ -1455,7 +2782,11 @@ TTErr Scenario::TimeEventReplace(const TTValue& inputValue, TTValue& outputValue
             }
 #ifndef NO_EDITION_SOLVER
             // retreive solver variable relative to the time event
+            // note : there is no variable during a load
             it = mVariablesMap.find(aFormerTimeEvent.instance());
+            if (it == mVariablesMap.end())
+                return kTTErrNone;
+            
             SolverVariablePtr variable = SolverVariablePtr(it->second);
             
             // replace the time event
@@ -1481,6 +2812,9 @@ TTErr Scenario::TimeEventReplace(const TTValue& inputValue, TTValue& outputValue
 
 void Scenario::writeTimeEventAsXml(TTXmlHandlerPtr aXmlHandler, TTObject& aTimeEvent)
 {
+    TTScoreProfilerScope profile(kTTScoreProfilerObjects, kTTSymEmpty);
+    ScenarioProfileObject(profile, aTimeEvent);
+    
     // Start an event node
     xmlTextWriterStartElement((xmlTextWriterPtr)aXmlHandler->mWriter, BAD_CAST "event");
     
@@ -1494,49 +2828,42 @@ void Scenario::writeTimeEventAsXml(TTXmlHandlerPtr aXmlHandler, TTObject& aTimeE
 
 TTErr Scenario::readTimeEventFromXml(TTXmlHandlerPtr aXmlHandler, TTObject& aNewTimeEvent)
 {
-    TTValue v, out;
-    TTErr   err = kTTErrGeneric;
+    TTValue     v, out;
+    TTErr       err = kTTErrGeneric;
+    TTUInt32    date;
+    TTSymbol    name;
     
     if (aXmlHandler->mXmlNodeStart) {
         
         // Get the date
-        if (!aXmlHandler->getXmlAttribute(kTTSym_date, v, NO)) {
+        if (ScenarioReadXmlUInt32(aXmlHandler, "date", date)) {
             
-            if (v.size() == 1) {
+            // an event cannot be created after the end event of its container
+            if (date > getTimeEventDate(getEndEvent())) {
                 
-                if (v[0].type() == kTypeUInt32) {
-                    
-                    // an event cannot be created after the end event of its container
-                    if (TTUInt32(v[0]) > getTimeEventDate(getEndEvent())) {
-                        
-                        TTLogError("Scenario::readTimeEventFromXml %s : event created after the end event of its container\n", mName.c_str());
-                        return kTTErrGeneric;
-                    }
-                    
-                    // Create the time event
-                    err = this->TimeEventCreate(v, out);
-                    
-                    if (!err) {
-                        
-                        aNewTimeEvent = out[0];
-                        
-                        // Get the name
-                        if (!aXmlHandler->getXmlAttribute(kTTSym_name, v, YES)) {
-                            
-                            if (v.size() == 1) {
-                                
-                                if (v[0].type() == kTypeSymbol) {
-                                    
-                                    aNewTimeEvent.set(kTTSym_name, v);
-                                }
-                            }
-                        }
-                        
-                        // Pass the xml handler to the new event to fill his attribute
-                        aXmlHandler->setAttributeValue(kTTSym_object, out);
-                        return aXmlHandler->sendMessage(kTTSym_Read);
-                    }
-                }
+                TTLogError("Scenario::readTimeEventFromXml %s : event created after the end event of its container\n", mName.c_str());
+                return kTTErrGeneric;
+            }
+            
+            // Create the time event
+            v = date;
+            err = this->TimeEventCreate(v, out);
+            
+            if (!err) {
+                
+                aNewTimeEvent = out[0];
+                
+                // Get the name
+                if (ScenarioReadXmlSymbol(aXmlHandler, "name", name))
+                    aNewTimeEvent.set(kTTSym_name, name);
+                
+                // remember the event to bind the time processes on it (see in readTimeProcessFromXml)
+                aNewTimeEvent.get(kTTSym_name, name);
+                mLoadingEvents.emplace(name.rawpointer(), aNewTimeEvent);
+                
+                // Pass the xml handler to the new event to fill his attribute
+                aXmlHandler->setAttributeValue(kTTSym_object, out);
+                return aXmlHandler->sendMessage(kTTSym_Read);
             }
         }
     }
@@ -1544,16 +2871,33 @@ TTErr Scenario::readTimeEventFromXml(TTXmlHandlerPtr aXmlHandler, TTObject& aNew
     return err;
 }
 
+TTObject Scenario::findLoadingTimeEvent(TTSymbol aName)
+{
+    TTValue v, aCacheElement;
+    
+    std::unordered_map<TTPtr, TTObject>::iterator it = mLoadingEvents.find(aName.rawpointer());
+    if (it != mLoadingEvents.end())
+        return it->second;
+    
+    // the start and end events of the scenario are not read as events
+    v = aName;
+    mTimeEvents.find(&TTTimeContainerFindTimeEventWithName, (TTPtr)&v, aCacheElement);
+    
+    if (aCacheElement.size() == 0)
+        return TTObject();
+    
+    return aCacheElement[0];
+}
+
 TTErr Scenario::TimeProcessAdd(const TTValue& inputValue, TTValue& outputValue)
 {
+    loadPending();
+    
     TTObject    startEvent, endEvent;
     TTObject    aTimeProcess;
     TTValue     args, aCacheElement;
-    TTValue     duration, scenarioDuration;
-#ifndef NO_EDITION_SOLVER
-    SolverVariablePtr       startVariable, endVariable;
-    SolverObjectMapIterator it;
-#endif
+    TTValue     duration;
+    
     if (inputValue.size() == 3) {
         
         if (inputValue[1].type() == kTypeObject && inputValue[2].type() == kTypeObject) {
@@ -1595,41 +2939,13 @@ TTErr Scenario::TimeProcessAdd(const TTValue& inputValue, TTValue& outputValue)
                 
                 // store time process object and observers
                 mTimeProcesses.append(aCacheElement);
-#ifndef NO_EDITION_SOLVER
-                // get scenario duration
-                this->getAttributeValue(kTTSym_duration, scenarioDuration);
-
-                // retreive solver variable relative to each event
-                it = mVariablesMap.find(getTimeProcessStartEvent(aTimeProcess).instance());
-                startVariable = SolverVariablePtr(it->second);
                 
-                it = mVariablesMap.find(getTimeProcessEndEvent(aTimeProcess).instance());
-                endVariable = SolverVariablePtr(it->second);
+                // update the solver (during a load this is done at the end, see in buildEditionSolver)
+                if (!mLoading)
+                    addEditionTimeProcess(aTimeProcess);
+                
+                journalEdit(aTimeProcess);
                 
-                // update the Solver depending on the type of the time process
-                if (aTimeProcess.name() == TTSymbol("Interval")) {
-                    
-                    // add a relation between the 2 variables to the solver
-                    SolverRelationPtr relation = new SolverRelation(mEditionSolver, startVariable, endVariable, getTimeProcessDurationMin(aTimeProcess), getTimeProcessDurationMax(aTimeProcess));
-                    
-                    // store the relation relative to this time process
-                    mRelationsMap.emplace(aTimeProcess.instance(), relation);
-
-                }
-                else {
-                    
-                    // limit the start variable to the process duration
-                    // this avoid time crushing when a time process moves while it is connected to other process
-                    startVariable->limit(TTUInt32(duration[0]), TTUInt32(duration[0]));
-                    
-                    // add a constraint between the 2 variables to the solver
-                    SolverConstraintPtr constraint = new SolverConstraint(mEditionSolver, startVariable, endVariable, getTimeProcessDurationMin(aTimeProcess), getTimeProcessDurationMax(aTimeProcess), TTUInt32(scenarioDuration[0]));
-                    
-                    // store the constraint relative to this time process
-                    mConstraintsMap.emplace(aTimeProcess.instance(), constraint);
-                    
-                }
-#endif
                 // return the time process
                 outputValue = aTimeProcess;
                 
@@ -1666,6 +2982,8 @@ TTErr Scenario::TimeProcessRemove(const TTValue& inputValue, TTValue& outputValu
             
             else {
                 
+                journalRemove(kTTScoreSnapshotProcesses, aTimeProcess);
+                
                 // remove time process object and observers
                 mTimeProcesses.remove(aCacheElement);
                 
@@ -1673,23 +2991,30 @@ TTErr Scenario::TimeProcessRemove(const TTValue& inputValue, TTValue& outputValu
                 deleteTimeProcessCacheElement(aCacheElement);
 #ifndef NO_EDITION_SOLVER
                 // update the Solver depending on the type of the time process
+                // note : there is no relation nor constraint during a load
                 if (aTimeProcess.name() == TTSymbol("Interval")) {
                     
                     // retreive solver relation relative to the time process
                     it = mRelationsMap.find(aTimeProcess.instance());
-                    SolverRelationPtr relation = SolverRelationPtr(it->second);
-                    
-                    mRelationsMap.erase(aTimeProcess.instance());
-                    delete relation;
+                    if (it != mRelationsMap.end()) {
+                        
+                        SolverRelationPtr relation = SolverRelationPtr(it->second);
+                        
+                        mRelationsMap.erase(aTimeProcess.instance());
+                        delete relation;
+                    }
                     
                 } else {
                     
                     // retreive solver constraint relative to the time process
                     it = mConstraintsMap.find(aTimeProcess.instance());
-                    SolverConstraintPtr constraint = SolverConstraintPtr(it->second);
-                    
-                    mConstraintsMap.erase(aTimeProcess.instance());
-                    delete constraint;
+                    if (it != mConstraintsMap.end()) {
+                        
+                        SolverConstraintPtr constraint = SolverConstraintPtr(it->second);
+                        
+                        mConstraintsMap.erase(aTimeProcess.instance());
+                        delete constraint;
+                    }
                 }
 #endif
                 // fill outputValue with start and event
@@ -1776,15 +3101,16 @@ TTErr Scenario::TimeProcessMove(const TTValue& inputValue, TTValue& outputValue)
             if (!sErr) {
                 
                 // update each solver variable value
-                for (it = mVariablesMap.begin() ; it != mVariablesMap.end() ; it++)
-                    
-                    SolverVariablePtr(it->second)->update();
+                updateEditionVariables();
 
                 // needs to be compiled again
                 mCompiled = NO;
                 
                 return kTTErrNone;
             }
+            
+            // tell why the process can't be moved
+            getEditionConflict(outputValue);
 #else
             return kTTErrNone;
 #endif
@@ -1808,7 +3134,14 @@ TTErr Scenario::TimeProcessLimit(const TTValue& inputValue, TTValue& outputValue
         if (inputValue[0].type() == kTypeObject && inputValue[1].type() == kTypeUInt32 && inputValue[2].type() == kTypeUInt32) {
             
             aTimeProcess = inputValue[0];
+            
+            // the duration bounds are stored with the time process
+            journalEdit(aTimeProcess);
 #ifndef NO_EDITION_SOLVER
+            // the limits are read when the solver is built at the end of the load (see in buildEditionSolver)
+            if (mLoading)
+                return kTTErrNone;
+            
             // update the Solver depending on the type of the time process
             timeProcessType = aTimeProcess.name();
             
@@ -1852,9 +3185,7 @@ TTErr Scenario::TimeProcessLimit(const TTValue& inputValue, TTValue& outputValue
             if (!sErr && !mLoading) {
                 
                 // update each solver variable value
-                for (it = mVariablesMap.begin() ; it != mVariablesMap.end() ; it++)
-                    
-                    SolverVariablePtr(it->second)->update();
+                updateEditionVariables();
                 
                 // needs to be compiled again
                 mCompiled = NO;
@@ -1872,9 +3203,12 @@ TTErr Scenario::TimeProcessLimit(const TTValue& inputValue, TTValue& outputValue
 
 void Scenario::writeTimeProcessAsXml(TTXmlHandlerPtr aXmlHandler, TTObject& aTimeProcess)
 {
-    TTObject    timeProcessContainer;
-    TTValue     v;
-    TTString    s;
+    TTObject            timeProcessContainer;
+    TTValue             v;
+    TTScoreXmlFormatter aFormatter;
+    
+    TTScoreProfilerScope profile(kTTScoreProfilerObjects, kTTSymEmpty);
+    ScenarioProfileObject(profile, aTimeProcess);
     
     aTimeProcess.get("container", timeProcessContainer);
     
@@ -1895,55 +3229,39 @@ void Scenario::writeTimeProcessAsXml(TTXmlHandlerPtr aXmlHandler, TTObject& aTim
     {
         // Write the start event name
         getTimeProcessStartEvent(aTimeProcess).get("name", v);
-        v.toString();
-        s = TTString(v[0]);
-        xmlTextWriterWriteAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, BAD_CAST "start", BAD_CAST s.data());
+        aFormatter.writeAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, "start", v);
         
         // Write the end event name
         getTimeProcessEndEvent(aTimeProcess).get("name", v);
-        v.toString();
-        s = TTString(v[0]);
-        xmlTextWriterWriteAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, BAD_CAST "end", BAD_CAST s.data());
+        aFormatter.writeAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, "end", v);
     }
     
     // Write the duration min
     aTimeProcess.get("durationMin", v);
-    v.toString();
-    s = TTString(v[0]);
-    xmlTextWriterWriteAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, BAD_CAST "durationMin", BAD_CAST s.data());
+    aFormatter.writeAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, "durationMin", v);
         
     // Write the duration max
     aTimeProcess.get("durationMax", v);
-    v.toString();
-    s = TTString(v[0]);
-    xmlTextWriterWriteAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, BAD_CAST "durationMax", BAD_CAST s.data());
+    aFormatter.writeAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, "durationMax", v);
     
     // Write the mute
     aTimeProcess.get("mute", v);
-    v.toString();
-    s = TTString(v[0]);
-    xmlTextWriterWriteAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, BAD_CAST "mute", BAD_CAST s.data());
+    aFormatter.writeAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, "mute", v);
     
     // Write the color
     aTimeProcess.get("color", v);
-    v.toString();
-    s = TTString(v[0]);
-    xmlTextWriterWriteAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, BAD_CAST "color", BAD_CAST s.data());
+    aFormatter.writeAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, "color", v);
     
     // If the process is handled by a upper scenario
     if (timeProcessContainer.valid())
     {
         // Write the vertical position
          aTimeProcess.get("verticalPosition", v);
-        v.toString();
-        s = TTString(v[0]);
-        xmlTextWriterWriteAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, BAD_CAST "verticalPosition", BAD_CAST s.data());
+        aFormatter.writeAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, "verticalPosition", v);
         
         // Write the vertical size
          aTimeProcess.get("verticalSize", v);
-        v.toString();
-        s = TTString(v[0]);
-        xmlTextWriterWriteAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, BAD_CAST "verticalSize", BAD_CAST s.data());
+        aFormatter.writeAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, "verticalSize", v);
         
         // Pass the xml handler to the process to fill his attribute
         aXmlHandler->setAttributeValue(kTTSym_object, aTimeProcess);
@@ -1958,48 +3276,34 @@ TTErr Scenario::readTimeProcessFromXml(TTXmlHandlerPtr aXmlHandler, TTObject& aN
 {
     TTObject    start;
     TTObject    end;
-    TTValue     v, out, aCacheElement;
+    TTValue     v, out;
     TTErr       err;
+    TTSymbol    name;
+    TTUInt32    u;
     
     // Get the name of the start event
-    if (!aXmlHandler->getXmlAttribute(kTTSym_start, v, YES))
+    if (ScenarioReadXmlSymbol(aXmlHandler, "start", name))
     {
-        if (v.size() == 1)
+        // Find the start event using his name inside the container
+        start = findLoadingTimeEvent(name);
+        
+        if (!start.valid())
         {
-            if (v[0].type() == kTypeSymbol)
-            {
-                // Find the start event using his name inside the container
-                mTimeEvents.find(&TTTimeContainerFindTimeEventWithName, (TTPtr)&v, aCacheElement);
-                
-                if (aCacheElement.size() == 0)
-                {
-                    TTLogError("Scenario::readTimeProcessFromXml %s : can't find start event\n", mName.c_str());
-                    return kTTErrGeneric;
-                }
-                
-                start = aCacheElement[0];
-            }
+            TTLogError("Scenario::readTimeProcessFromXml %s : can't find start event\n", mName.c_str());
+            return kTTErrGeneric;
         }
     }
     
     // Get the name of the end event
-    if (!aXmlHandler->getXmlAttribute(kTTSym_end, v, YES))
+    if (ScenarioReadXmlSymbol(aXmlHandler, "end", name))
     {
-        if (v.size() == 1)
+        // Find the end event using his name inside the container
+        end = findLoadingTimeEvent(name);
+        
+        if (!end.valid())
         {
-            if (v[0].type() == kTypeSymbol)
-            {
-                // Find the end event using his name inside the container
-                mTimeEvents.find(&TTTimeContainerFindTimeEventWithName, (TTPtr)&v, aCacheElement);
-                
-                if (aCacheElement.size() == 0)
-                {
-                    TTLogError("Scenario::readTimeProcessFromXml %s : can't find end event\n", mName.c_str());
-                    return kTTErrGeneric;
-                }
-                
-                end = aCacheElement[0];
-            }
+            TTLogError("Scenario::readTimeProcessFromXml %s : can't find end event\n", mName.c_str());
+            return kTTErrGeneric;
         }
     }
     
@@ -2021,40 +3325,16 @@ TTErr Scenario::readTimeProcessFromXml(TTXmlHandlerPtr aXmlHandler, TTObject& aN
         // Get all generic time process atttributes
         
         // Get the time process name
-        if (!aXmlHandler->getXmlAttribute(kTTSym_name, v, YES))
-        {
-            if (v.size() == 1)
-            {
-                if (v[0].type() == kTypeSymbol)
-                {
-                    aNewTimeProcess.set(kTTSym_name, v);
-                }
-            }
-        }
+        if (ScenarioReadXmlSymbol(aXmlHandler, "name", name))
+            aNewTimeProcess.set(kTTSym_name, name);
         
         // Get the durationMin
-        if (!aXmlHandler->getXmlAttribute(kTTSym_durationMin, v, NO))
-        {
-            if (v.size() == 1)
-            {
-                if (v[0].type() == kTypeUInt32)
-                {
-                    aNewTimeProcess.set(kTTSym_durationMin, v);
-                }
-            }
-        }
+        if (ScenarioReadXmlUInt32(aXmlHandler, "durationMin", u))
+            aNewTimeProcess.set(kTTSym_durationMin, u);
         
         // Get the durationMax
-        if (!aXmlHandler->getXmlAttribute(kTTSym_durationMax, v, NO))
-        {
-            if (v.size() == 1)
-            {
-                if (v[0].type() == kTypeUInt32)
-                {
-                    aNewTimeProcess.set(kTTSym_durationMax, v);
-                }
-            }
-        }
+        if (ScenarioReadXmlUInt32(aXmlHandler, "durationMax", u))
+            aNewTimeProcess.set(kTTSym_durationMax, u);
         
         // Get the mute
         if (!aXmlHandler->getXmlAttribute(kTTSym_mute, v, NO))
@@ -2081,28 +3361,12 @@ TTErr Scenario::readTimeProcessFromXml(TTXmlHandlerPtr aXmlHandler, TTObject& aN
         }
         
         // Get the vertical position
-        if (!aXmlHandler->getXmlAttribute(kTTSym_verticalPosition, v, NO))
-        {
-            if (v.size() == 1)
-            {
-                if (v[0].type() == kTypeUInt32)
-                {
-                    aNewTimeProcess.set(kTTSym_verticalPosition, v);
-                }
-            }
-        }
+        if (ScenarioReadXmlUInt32(aXmlHandler, "verticalPosition", u))
+            aNewTimeProcess.set(kTTSym_verticalPosition, u);
         
         // Get the vertical size
-        if (!aXmlHandler->getXmlAttribute(kTTSym_verticalSize, v, NO))
-        {
-            if (v.size() == 1)
-            {
-                if (v[0].type() == kTypeUInt32)
-                {
-                    aNewTimeProcess.set(kTTSym_verticalSize, v);
-                }
-            }
-        }
+        if (ScenarioReadXmlUInt32(aXmlHandler, "verticalSize", u))
+            aNewTimeProcess.set(kTTSym_verticalSize, u);
     }
     
     return err;
@@ -2110,6 +3374,8 @@ TTErr Scenario::readTimeProcessFromXml(TTXmlHandlerPtr aXmlHandler, TTObject& aN
 
 TTErr Scenario::TimeConditionCreate(const TTValue& inputValue, TTValue& outputValue)
 {
+    loadPending();
+    
     TTObject    aTimeCondition;
     TTValue     args, aCacheElement;
     
@@ -2127,6 +3393,8 @@ TTErr Scenario::TimeConditionCreate(const TTValue& inputValue, TTValue& outputVa
     // store time condition object and observers
     mTimeConditions.append(aCacheElement);
     
+    journalEdit(aTimeCondition);
+    
     // add a first case if
     
     // TODO : how conditions are constrained by the Solver ?
@@ -2160,6 +3428,8 @@ TTErr Scenario::TimeConditionRelease(const TTValue& inputValue, TTValue& outputV
             
             else {
                 
+                journalRemove(kTTScoreSnapshotConditions, aTimeCondition);
+                
                 // remove time condition object and observers
                 mTimeConditions.remove(aCacheElement);
                 
@@ -2185,6 +3455,9 @@ TTErr Scenario::TimeConditionRelease(const TTValue& inputValue, TTValue& outputV
 
 void Scenario::writeTimeConditionAsXml(TTXmlHandlerPtr aXmlHandler, TTObject& aTimeCondition)
 {
+    TTScoreProfilerScope profile(kTTScoreProfilerObjects, kTTSymEmpty);
+    ScenarioProfileObject(profile, aTimeCondition);
+    
     // Start a condition node
     xmlTextWriterStartElement((xmlTextWriterPtr)aXmlHandler->mWriter, BAD_CAST "condition");
     
@@ -58,11 +58,20 @@ void SolverVariable::limit(SolverValue min, SolverValue max)
     solver->setIntVar(rangeID, min, max, value, RANGE_VARIABLE);
 }
 
-void SolverVariable::update()
+TTBoolean SolverVariable::update()
 {
+    TTValue  v;
     TTUInt32 value = solver->getVariableValue(dateID);
     
+    // don't notify the event if its date doesn't change
+    event.get(kTTSym_date, v);
+    
+    if (TTUInt32(v[0]) == value)
+        return NO;
+    
     event.set(kTTSym_date, value);
+    
+    return YES;
 }
 
 SolverConstraint::SolverConstraint(SolverPtr aSolver, SolverVariablePtr variableA, SolverVariablePtr variableB, SolverValue durationMin, SolverValue durationMax, SolverValue max):
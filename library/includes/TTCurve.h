@@ -20,19 +20,59 @@
 
 #include "TTScoreIncludes.h"
 
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#define TTCURVE_RECORD_WINDOW_MAX 256
+#define TTCURVE_OVERVIEW_SIZE_MAX 65536
+#define TTCURVE_SAMPLER_PARALLEL_CURVES 8
+#define TTCURVE_IMPORT_CHUNK_SIZE 1048576
+#define TTCURVE_IMPORT_POINTS_MAX 65536
+#define TTCURVE_IMPORT_TOLERANCE_RATIO 0.001
+#define TTCURVE_IMPORT_TOLERANCE_AUTO -1.
+#define TTCURVE_RECORD_TOLERANCE_RATIO 0.001
+#define TTCURVE_RECORD_TOLERANCE_AUTO -1.
+
 /**	The TTCurve class allows to ...
  
  @see Automation
  */
+class TTCurve;
+class TTCurveSampleFile;
+typedef TTCurve* TTCurvePtr;
+
 class TTSCORE_EXPORT TTCurve : public TTObjectBase//, public TTList
 {
 	TTCLASS_SETUP(TTCurve)
 	
 public:
-		void begin() { mList.begin(); }
+		void begin() { mList.begin(); mPreviousValid = NO; }
 		void end() { mList.end(); }
 		void next() { mList.next(); } 
-		void append(const TTValue& v) { mList.append(v); }
+		void append(const TTValue& v) { mList.append(v); clearOverview(); }
+    
+        /** Start a record storing the first point
+         @param x               a float64 between [0. :: 1.]
+         @param y               a float64 between [min :: max] */
+        void recordStart(TTFloat64 x, TTFloat64 y);
+    
+        /** Record a new point simplifying the curve on the fly
+         @details the point is stored only if the points received since the last stored one can't be
+         approximated by a line with a vertical error lower than the tolerance (opening window algorithm)
+         @param x               a float64 between [0. :: 1.]
+         @param y               a float64 between [min :: max]
+         @param tolerance       maximal vertical error allowed, 0. drops only colinear points,
+                                a negative value (TTCURVE_RECORD_TOLERANCE_AUTO) for TTCURVE_RECORD_TOLERANCE_RATIO of the range of the points recorded so far */
+        void record(TTFloat64 x, TTFloat64 y, TTFloat64 tolerance);
+    
+        /** End a record storing the last pending point */
+        void recordEnd();
+    
+        /** Reduce the number of points using the Ramer-Douglas-Peucker algorithm
+         @param tolerance       maximal vertical error allowed
+         @return                the number of removed points */
+        TTUInt32 simplify(TTFloat64 tolerance);
 		
 private :
     TTList								mList;							///< Inheritance won't work on Windows
@@ -42,7 +82,57 @@ private :
     TTObject                            mFunction;						///< a freehand function unit
     TTBoolean                           mRecorded;                      ///< is the curve based on a record or not ?
     TTBoolean                           mSampled;                       ///< is the curve already sampled ?
+    TTBoolean                           mSamplesCompressed;             ///< are the recorded samples xor encoded (when it makes them smaller) when they are written into a file ?
     TTFloat64                           mLastSample;                    ///< used internally to avoid redundancy
+    TTFloat64                           mPreviousX;                     ///< used internally to interpolate between two points
+    TTFloat64                           mPreviousY;
+    TTBoolean                           mPreviousValid;
+    
+    TTFloat64                           mRecordAnchorX;                 ///< the last point stored during a record
+    TTFloat64                           mRecordAnchorY;
+    std::vector<TTFloat64>              mRecordWindowX;                 ///< the points received since the last stored one
+    std::vector<TTFloat64>              mRecordWindowY;
+    TTFloat64                           mRecordMinY;                    ///< the range of the points recorded so far
+    TTFloat64                           mRecordMaxY;
+    
+    std::vector<std::vector<TTFloat64> > mOverviewMin;                  ///< a min/max pyramid of the points built on demand (level 0 is the finest)
+    std::vector<std::vector<TTFloat64> > mOverviewMax;
+    
+    /** Forget the min/max pyramid when the points change */
+    void    clearOverview() { mOverviewMin.clear(); mOverviewMax.clear(); }
+    
+    /** Build the min/max pyramid from the points */
+    void    buildOverview();
+    
+    /** Calculate the samples of a function based curve without changing the curve
+     @details only the function is read so the samples of many curves can be calculated on many threads (see TTCurveSampler)
+     @param nbPoints        the number of samples evenly spaced between [0. :: 1.[
+     @param y               the returned samples */
+    void    calculateSamples(TTUInt32 nbPoints, std::vector<TTFloat64>& y);
+    
+    /** Replace the points by the samples calculated by calculateSamples
+     @param y               the samples evenly spaced between [0. :: 1.[ */
+    void    setSamples(const std::vector<TTFloat64>& y);
+    
+    /** Encode the points into base64 text
+     @details the first byte tells the format (raw float64 or xor with the previous value), then the number of points and the x y values.
+     The xor encoding is only kept if it is smaller than the raw one (e.g. noisy 64 bits values hardly share any bit).
+     @param text            the returned text */
+    void    encodeSamples(TTString& text);
+    
+    /** Decode the points from base64 text written by encodeSamples
+     @param text            a null terminated text
+     @return                an error code if the text is not valid */
+    TTErr   decodeSamples(const char* text);
+    
+    /** Get the canonical bytes of the points definition (function parameters or recorded points)
+     @details this is used to store identical curves once into the files (see TTScorePayloads)
+     @param content         the returned content */
+    void    getPayloadContent(std::string& content);
+    
+    /** Copy the points definition of another curve
+     @param aCurve          the curve read first with the same points definition */
+    void    copyPayload(TTCurve* aCurve);
     
     /** Set curve's function parameters
      @param value           x1 y1 b1 x2 y2 b2 ... with x[0. :: 1.], y[min, max], b[-1. :: 1.]
@@ -76,6 +166,29 @@ private :
      @return                an error code if the operation fails */
     TTErr   ValueAt(const TTValue& inputValue, TTValue& outputValue);
     
+    /** Get a min/max overview of the curve at a given resolution
+     @details this is useful to draw the curve without transfering all its points
+     @param inputvalue      start position, end position, number of columns
+     @param outputvalue     x1 min1 max1 x2 min2 max2 ... for each column
+     @return                an error code if the operation fails */
+    TTErr   Overview(const TTValue& inputValue, TTValue& outputValue);
+    
+    /** Simplify a record based curve
+     @param inputvalue      tolerance
+     @param outputvalue     the number of removed points
+     @return                an error code if the operation fails */
+    TTErr   Simplify(const TTValue& inputValue, TTValue& outputValue);
+    
+    /** Import a column of a sample file as a record based curve
+     @details the file is read chunk by chunk and the points are simplified while they are read (see TTCurveImport)
+     @param inputvalue      file path, tolerance (a thousandth of the range of the column by default, see TTCurveImport),
+                            y column (1 by default), x column (0 by default, -1 to use the row number),
+                            format ("csv", "float32" or "float64", guessed from the file extension by default),
+                            number of columns of a binary file (just enough for the x and y columns by default)
+     @param outputvalue     the number of rows read, the number of points kept
+     @return                an error code if the operation fails */
+    TTErr   Import(const TTValue& inputValue, TTValue& outputValue);
+    
     /**  needed to be handled by a TTXmlHandler
      @param	inputValue      ..
      @param	outputValue     ..
@@ -90,12 +203,21 @@ private :
 	TTErr	WriteAsText(const TTValue& inputValue, TTValue& outputValue);
 	TTErr	ReadFromText(const TTValue& inputValue, TTValue& outputValue);
     
+    /**  needed to be handled by a TTScoreSnapshotWriter/Reader
+     @details the sampled points are stored as they are so the curve doesn't need to be sampled again when it is read
+     @param	inputValue      a writer pointer | a reader pointer, the curve record
+     @param	outputValue     the curve record written | nothing
+     @return                an error code if the operation fails */
+	TTErr	WriteAsSnapshot(const TTValue& inputValue, TTValue& outputValue);
+	TTErr	ReadFromSnapshot(const TTValue& inputValue, TTValue& outputValue);
+    
     friend TTErr TTSCORE_EXPORT TTCurveNextSampleAt(TTCurve* aCurve, TTFloat64& x, TTFloat64& y);
+    friend TTErr TTSCORE_EXPORT TTCurveInterpolatedSampleAt(TTCurve* aCurve, TTFloat64& x, TTFloat64& y);
+    friend class TTCurveSampler;
+    friend TTErr TTSCORE_EXPORT TTCurveImport(std::vector<TTCurvePtr>& curves, TTCurveSampleFile& aFile, TTInt32 xColumn, TTUInt32 firstColumn, TTFloat64 tolerance, TTUInt64& rows);
 
 };
 
-typedef TTCurve* TTCurvePtr;
-
 /** Get the next sample values for a given x.
  a call TTList::begin() method before to use this method could be needed
  @param x               a float64 between [0. :: 1.]
@@ -103,4 +225,123 @@ typedef TTCurve* TTCurvePtr;
  @return                an error code if the operation fails */
 TTErr TTSCORE_EXPORT TTCurveNextSampleAt(TTCurve* aCurve, TTFloat64& x, TTFloat64& y);
 
+/** Get the value for a given x linearly interpolated between the two surrounding points.
+ a call to TTCurve::begin() method before to use this method could be needed
+ @details unlike TTCurveNextSampleAt there is no redundancy filtering
+ @param x               a float64 between [0. :: 1.]
+ @param y               a float64 between [min :: max]
+ @return                an error code if the operation fails */
+TTErr TTSCORE_EXPORT TTCurveInterpolatedSampleAt(TTCurve* aCurve, TTFloat64& x, TTFloat64& y);
+
+/** Get the vertical distance between a point and the line passing by two other points
+ @param x1 y1           the first point of the line
+ @param x2 y2           the second point of the line
+ @param x y             the point to measure
+ @return                the absolute vertical distance */
+TTFloat64 TTSCORE_EXPORT TTCurveVerticalError(TTFloat64 x1, TTFloat64 y1, TTFloat64 x2, TTFloat64 y2, TTFloat64 x, TTFloat64 y);
+
+/**	Sample many curves at once on a pool of threads
+ @details while a score is loading the curves are added to the current sampler instead of being sampled one by one,
+ then they are all sampled before the events and processes are linked (see Scenario::endLoading).
+ The threads only calculate the samples of the function based curves into their own vectors,
+ the points of the curves are replaced on the calling thread once all the threads are done. */
+class TTSCORE_EXPORT TTCurveSampler
+{
+public:
+    
+    /** Add a curve to sample
+     @param aCurve          a curve
+     @param duration        the duration to sample the curve for */
+    void        add(TTCurvePtr aCurve, TTUInt32 duration);
+    
+    /** Sample all the added curves then forget them
+     @details the curves are sampled in parallel if there are enough of them */
+    void        run();
+    
+    /** How many curves are waiting to be sampled */
+    TTUInt32    size() const { return mCurves.size(); }
+    
+    /** The sampler of the load in progress on the calling thread
+     @details each thread has its own current sampler so two scores can be loaded at the same time
+     @return                NULL if the curves have to be sampled at once */
+    static TTCurveSampler*  current();
+    
+    /** Set the sampler of the load in progress on the calling thread
+     @param aSampler        a sampler or NULL at the end of the load */
+    static void             setCurrent(TTCurveSampler* aSampler);
+    
+private:
+    
+    std::vector<std::pair<TTCurvePtr, TTUInt32> > mCurves;
+};
+
+/**	Read the rows of a sample file chunk by chunk
+ @details a csv file has a row per line and its columns are separated by commas, semicolons, tabs or spaces
+ (the lines which can't be parsed like a header are skipped).
+ A binary file stores the rows one after the other, each row being a number of float32 or float64 columns in the byte order of the machine.
+ Only one chunk of the file is in memory whatever the size of the file is. */
+class TTSCORE_EXPORT TTCurveSampleFile
+{
+public:
+    
+    TTCurveSampleFile();
+    ~TTCurveSampleFile();
+    
+    /** Open a sample file
+     @param path            the file path
+     @param format          "csv", "float32" or "float64"
+     @param columns         the number of columns of a row (only for the binary files)
+     @return                an error code if the file can't be opened or if the format is unknown */
+    TTErr       open(const TTString& path, TTSymbol format, TTUInt32 columns = 0);
+    
+    /** Read the next row
+     @param row             the returned columns
+     @return                NO at the end of the file */
+    TTBoolean   next(std::vector<TTFloat64>& row);
+    
+    /** Close the file */
+    void        close();
+    
+    /** Guess the format of a file from its extension
+     @return                "csv" for .csv and .txt files, "float32" for .f32 files, "float64" otherwise */
+    static TTSymbol format(const TTString& path);
+    
+private:
+    
+    /** Move the bytes not read yet at the beginning of the chunk then read the next bytes of the file after them
+     @return                NO if nothing more have been read */
+    TTBoolean   fill();
+    
+    /** Parse a line of a csv file
+     @return                NO if the line is not made of numbers */
+    TTBoolean   parse(const char* line, const char* end, std::vector<TTFloat64>& row);
+    
+    FILE*                   mFile;
+    TTSymbol                mFormat;
+    TTUInt32                mColumns;
+    TTUInt32                mRowSize;                       ///< the size of a row of a binary file (in bytes)
+    std::vector<char>       mChunk;                         ///< the bytes read from the file (with an ending zero)
+    size_t                  mBegin;                         ///< the first byte of the chunk which is not read yet
+    size_t                  mEnd;                           ///< the end of the bytes of the chunk
+};
+
+/** Import the columns of a sample file into record based curves simplifying the points on the fly
+ @details each row goes through TTCurve::record so only the points kept are stored :
+ the memory needed depends on the shape of the data and not on the size of the file.
+ The rows with a x lower or equal to the previous one are ignored.
+ A curve never keeps more than TTCURVE_IMPORT_POINTS_MAX points : when it reaches this size (e.g. noisy data with a small tolerance)
+ the points already kept are simplified with a doubled tolerance until half of them are removed and the import goes on with this tolerance
+ (so the vertical error can reach twice the final tolerance).
+ Once the whole file is read the x of the points are normalized between [0. :: 1.],
+ this doesn't change the vertical errors so the points kept stay the same.
+ @param curves          a curve for each column to import
+ @param aFile           an opened sample file
+ @param xColumn         the column of the x (-1 to use the row number)
+ @param firstColumn     the column of the first curve (the next curves take the next columns, skipping the x column)
+ @param tolerance       maximal vertical error allowed, 0. drops only colinear points,
+                        a negative value (TTCURVE_IMPORT_TOLERANCE_AUTO) for TTCURVE_IMPORT_TOLERANCE_RATIO of the range of each column (growing with the range read so far)
+ @param rows            the returned number of rows imported
+ @return                an error code if no row can be imported */
+TTErr TTSCORE_EXPORT TTCurveImport(std::vector<TTCurvePtr>& curves, TTCurveSampleFile& aFile, TTInt32 xColumn, TTUInt32 firstColumn, TTFloat64 tolerance, TTUInt64& rows);
+
 #endif // __CURVE_H__
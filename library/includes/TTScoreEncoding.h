@@ -0,0 +1,82 @@
+/** @file
+ *
+ * @ingroup scoreLibrary
+ *
+ * @brief binary encoding tools used to store large data into score files
+ *
+ * @details The encoding functions allows to pack numbers into a compact byte buffer (raw or xor with the previous number) and to convert it into base64 text @n@n
+ *
+ * @see TTCurve
+ *
+ * @authors Théo de la Hogue & Clément Bossut
+ *
+ * @copyright Copyright © 2013, Théo de la Hogue & Clément Bossut @n
+ * This code is licensed under the terms of the "CeCILL-C" @n
+ * http://www.cecill.info
+ */
+
+#ifndef __TT_SCORE_ENCODING_H__
+#define __TT_SCORE_ENCODING_H__
+
+#include "TTScoreIncludes.h"
+
+#include <vector>
+
+/** A byte buffer */
+typedef std::vector<unsigned char> TTScoreBuffer;
+
+/** Append an unsigned integer using a variable number of bytes (7 bits per byte, little endian)
+ @param buffer              the buffer to fill
+ @param value               the integer to append */
+void TTSCORE_EXPORT TTScoreBufferAppendVarint(TTScoreBuffer& buffer, TTUInt64 value);
+
+/** Read an unsigned integer written by TTScoreBufferAppendVarint
+ @param buffer              the buffer to read
+ @param offset              the position where to read, moved after the integer
+ @param value               the returned integer
+ @return                    NO if the buffer ends before the integer */
+TTBoolean TTSCORE_EXPORT TTScoreBufferReadVarint(const TTScoreBuffer& buffer, TTUInt32& offset, TTUInt64& value);
+
+/** Append a float using its 8 bytes IEEE 754 representation (little endian)
+ @param buffer              the buffer to fill
+ @param value               the float to append */
+void TTSCORE_EXPORT TTScoreBufferAppendFloat64(TTScoreBuffer& buffer, TTFloat64 value);
+
+/** Read a float written by TTScoreBufferAppendFloat64
+ @param buffer              the buffer to read
+ @param offset              the position where to read, moved after the float
+ @param value               the returned float
+ @return                    NO if the buffer ends before the float */
+TTBoolean TTSCORE_EXPORT TTScoreBufferReadFloat64(const TTScoreBuffer& buffer, TTUInt32& offset, TTFloat64& value);
+
+/** Append a float as the exclusive or of its IEEE 754 representation with the previous one
+ @details successive samples of a curve share their sign, their exponent and the first bits of their mantissa
+ (all the mantissa for a repeated value, the last bits are often null for values coming from integers or 32 bits floats)
+ so only the bytes between the leading and trailing null bytes of the exclusive or are written after a control byte.
+ The decoded float is exactly the same and a float never takes more than 9 bytes.
+ @param buffer              the buffer to fill
+ @param value               the float to append
+ @param previous            the representation of the previous float (0 at the beginning), updated */
+void TTSCORE_EXPORT TTScoreBufferAppendFloat64Xor(TTScoreBuffer& buffer, TTFloat64 value, TTUInt64& previous);
+
+/** Read a float written by TTScoreBufferAppendFloat64Xor
+ @param buffer              the buffer to read
+ @param offset              the position where to read, moved after the float
+ @param value               the returned float
+ @param previous            the representation of the previous float (0 at the beginning), updated
+ @return                    NO if the buffer ends before the float or if the control byte is not valid */
+TTBoolean TTSCORE_EXPORT TTScoreBufferReadFloat64Xor(const TTScoreBuffer& buffer, TTUInt32& offset, TTFloat64& value, TTUInt64& previous);
+
+/** Convert a buffer into base64 text
+ @param buffer              the buffer to convert
+ @param text                the returned text */
+void TTSCORE_EXPORT TTScoreBase64Encode(const TTScoreBuffer& buffer, TTString& text);
+
+/** Convert base64 text into a buffer
+ @details white spaces are ignored
+ @param text                the null terminated text to convert
+ @param buffer              the returned buffer
+ @return                    NO if the text is not valid base64 */
+TTBoolean TTSCORE_EXPORT TTScoreBase64Decode(const char* text, TTScoreBuffer& buffer);
+
+#endif // __TT_SCORE_ENCODING_H__
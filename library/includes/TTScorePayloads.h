@@ -0,0 +1,89 @@
+/** @file
+ *
+ * @ingroup scoreLibrary
+ *
+ * @brief share the payloads which are repeated in a score file (identical states, identical curves)
+ *
+ * @details A payload is the content of an event state or the points of a curve. Its key is a hash of its canonical bytes.
+ * When a score is written the first occurrence of a payload is written with its key and the next occurrences only write the key.
+ * When a score is read the first object read with a key holds the payload and the next ones copy it. @n@n
+ *
+ * @see TTTimeEvent, TTCurve, Scenario
+ *
+ * @authors Théo de la Hogue & Clément Bossut
+ *
+ * @copyright Copyright © 2013, Théo de la Hogue & Clément Bossut @n
+ * This code is licensed under the terms of the "CeCILL-C" @n
+ * http://www.cecill.info
+ */
+
+#ifndef __TT_SCORE_PAYLOADS_H__
+#define __TT_SCORE_PAYLOADS_H__
+
+#include "TTScoreIncludes.h"
+
+#include <string>
+#include <unordered_map>
+
+#define TTSCORE_PAYLOAD_SHARED_SIZE 64      ///< the payloads smaller than this (in bytes) are cheaper to write than to share
+
+/**	Share the payloads repeated in a score file while it is written or read
+ @details only one file is written or read at a time (see current) */
+class TTSCORE_EXPORT TTScorePayloads
+{
+public:
+
+    /** Append the canonical bytes of a value to the content of a payload
+     @details two values with the same elements of the same types give the same bytes
+     @param content         the content to complete
+     @param value           a value */
+    static void         appendValue(std::string& content, const TTValue& value);
+
+    /** Is a payload worth to be shared ?
+     @param content         the content of a payload */
+    static TTBoolean    shareable(const std::string& content) { return content.size() >= TTSCORE_PAYLOAD_SHARED_SIZE; }
+
+    /** Format a key as hexadecimal digits
+     @param key             a key
+     @param text            the returned text (16 digits) */
+    static void         formatKey(TTUInt64 key, char text[17]);
+
+    /** Parse a key formatted by formatKey
+     @return                NO if the text is not a key */
+    static TTBoolean    parseKey(const char* text, TTUInt64& key);
+
+    /** Look for a payload written before
+     @param content         the content of the payload
+     @param key             the returned key of the payload (0 if another payload have the same key : it can't be shared)
+     @return                YES if the same payload have been written before : only its key have to be written */
+    TTBoolean           written(const std::string& content, TTUInt64& key);
+
+    /** Remember the first object read with a payload
+     @param key             the key of the payload
+     @param anObject        the object which holds the payload */
+    void                setHolder(TTUInt64 key, TTObject& anObject);
+
+    /** Get the object which holds a payload
+     @param key             the key of the payload
+     @return                an invalid object if no object have been read with the payload */
+    TTObject            holder(TTUInt64 key) const;
+
+    /** Forget all the payloads (and release their holders) */
+    void                clear();
+
+    /** The payloads of the file written or read on the calling thread
+     @details each thread has its own current payloads so two files can be written or read at the same time
+     @return                NULL if the payloads are not shared */
+    static TTScorePayloads* current();
+
+    /** Set the payloads of the file written or read on the calling thread
+     @param aPayloads       payloads or NULL at the end of the writing or the reading */
+    static void             setCurrent(TTScorePayloads* aPayloads);
+
+private:
+
+    std::unordered_map<TTUInt64, std::string>   mWritten;       ///< the content of the payloads written so far stored by key
+    std::unordered_map<TTUInt64, TTObject>      mHolders;       ///< the objects which hold the payloads read so far stored by key
+};
+
+#endif // __TT_SCORE_PAYLOADS_H__
@@ -0,0 +1,156 @@
+/** @file
+ *
+ * @ingroup scoreLibrary
+ *
+ * @brief measure where the time goes while a score is loaded or saved
+ *
+ * @details The profiler gathers the time spent in each phase of a load or a save
+ * (parsing or writing the file, creating the objects, posting the edition solver, sampling the curves and flattening the states)
+ * and the time spent by each object. The report gives the totals per phase, the totals and the counts per object type
+ * and the slowest objects. @n@n
+ *
+ * @see Scenario
+ *
+ * @authors Théo de la Hogue & Clément Bossut
+ *
+ * @copyright Copyright © 2013, Théo de la Hogue & Clément Bossut @n
+ * This code is licensed under the terms of the "CeCILL-C" @n
+ * http://www.cecill.info
+ */
+
+#ifndef __TT_SCORE_PROFILER_H__
+#define __TT_SCORE_PROFILER_H__
+
+#include "TTScoreIncludes.h"
+
+#include <chrono>
+#include <unordered_map>
+#include <vector>
+
+#define TTSCORE_PROFILER_SLOWEST 10
+
+/** The phases of a load or a save */
+enum TTScoreProfilerPhase
+{
+    kTTScoreProfilerFile = 0,           ///< parsing or writing the file itself (what is not spent by the other phases)
+    kTTScoreProfilerObjects,            ///< creating the objects and reading their attributes (or writing them)
+    kTTScoreProfilerSolver,             ///< posting the events and processes into the edition solver
+    kTTScoreProfilerSampling,           ///< sampling the curves
+    kTTScoreProfilerFlattening,         ///< flattening the states of the events
+    kTTScoreProfilerPhaseCount
+};
+
+/**	Gather the time spent by each phase and each object of a load or a save
+ @details only one load or save is profiled at a time on each thread (see current) and it have to happen on a single thread.
+ The times are in millisecond. */
+class TTSCORE_EXPORT TTScoreProfiler
+{
+public:
+
+    TTScoreProfiler();
+
+    /** Forget the previous measures and start the clock */
+    void        start();
+
+    /** Stop the clock
+     @details the time which is not spent by any other phase is the time spent to parse or to write the file */
+    void        stop();
+
+    /** Start to measure an object or a phase
+     @details measures can be nested : the time of the inner measures is not counted twice */
+    void        enter();
+
+    /** Stop to measure an object or a phase
+     @param phase           the phase
+     @param type            the type of the object or of what is measured (kTTSymEmpty to only count it into the phase)
+     @param anObject        the object to list it among the slowest ones (NULL to only count it by type)
+     @param name            the name of the object
+     @param count           how many objects have been measured */
+    void        leave(TTScoreProfilerPhase phase, TTSymbol type, TTPtr anObject = NULL, TTSymbol name = kTTSymEmpty, TTUInt32 count = 1);
+
+    /** Get the report of the last load or save
+     @param value           total time,
+                            then "phase" name time for each phase,
+                            then "type" name time count for each object type,
+                            then "object" type name time for the slowest objects
+     @param slowest         how many of the slowest objects to report */
+    void        report(TTValue& value, TTUInt32 slowest = TTSCORE_PROFILER_SLOWEST) const;
+
+    /** The profiler of the load or the save in progress on the calling thread
+     @details each thread has its own current profiler so two scores can be loaded or saved at the same time
+     @return                NULL if nothing is profiled */
+    static TTScoreProfiler* current();
+
+    /** Set the profiler of the load or the save in progress on the calling thread
+     @param aProfiler       a profiler or NULL at the end of the load or the save */
+    static void             setCurrent(TTScoreProfiler* aProfiler);
+
+private:
+
+    typedef std::chrono::steady_clock Clock;
+
+    /** What have been measured for an object type or an object */
+    struct Measure
+    {
+        TTSymbol    type;
+        TTSymbol    name;
+        TTFloat64   time;
+        TTUInt32    count;
+
+        Measure() : time(0.), count(0) {}
+    };
+
+    /** A measure in progress */
+    struct Frame
+    {
+        Clock::time_point   start;
+        TTFloat64           inner;                              ///< the time spent by the nested measures
+    };
+
+    Clock::time_point                       mStart;             ///< when the load or the save started
+    TTFloat64                               mTotal;             ///< the duration of the load or the save
+    TTFloat64                               mPhases[kTTScoreProfilerPhaseCount]; ///< the time spent by each phase
+    std::unordered_map<TTPtr, Measure>      mTypes;             ///< the measures stored by type symbol
+    std::unordered_map<TTPtr, Measure>      mObjects;           ///< the measures stored by object
+    std::vector<Frame>                      mFrames;            ///< the measures in progress
+};
+
+/**	Measure the scope where it is declared into the current profiler (if any) */
+class TTScoreProfilerScope
+{
+public:
+
+    TTScoreProfilerScope(TTScoreProfilerPhase phase, TTSymbol type, TTPtr anObject = NULL, TTSymbol name = kTTSymEmpty) :
+    mProfiler(TTScoreProfiler::current()), mPhase(phase), mType(type), mObject(anObject), mName(name), mCount(1)
+    {
+        if (mProfiler)
+            mProfiler->enter();
+    }
+
+    ~TTScoreProfilerScope()
+    {
+        if (mProfiler)
+            mProfiler->leave(mPhase, mType, mObject, mName, mCount);
+    }
+
+    /** Is there a profiler to measure the scope ?
+     @details this avoids to look for the name of an object which is not profiled */
+    TTBoolean   active() const { return mProfiler != NULL; }
+
+    /** Set the object measured when it is known after the scope started (e.g. once it is created) */
+    void        setObject(TTPtr anObject, TTSymbol type, TTSymbol name) { mObject = anObject; mType = type; mName = name; }
+
+    /** Set how many objects are measured by the scope */
+    void        setCount(TTUInt32 count) { mCount = count; }
+
+private:
+
+    TTScoreProfiler*        mProfiler;
+    TTScoreProfilerPhase    mPhase;
+    TTSymbol                mType;
+    TTPtr                   mObject;
+    TTSymbol                mName;
+    TTUInt32                mCount;
+};
+
+#endif // __TT_SCORE_PROFILER_H__
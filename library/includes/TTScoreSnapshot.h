@@ -0,0 +1,472 @@
+/** @file
+ *
+ * @ingroup scoreLibrary
+ *
+ * @brief binary snapshot of a score loadable by mapping the file into memory
+ *
+ * @details A snapshot stores the score as flat tables of fixed size records (containers, events, state lines, processes, conditions, cases and curves)
+ * which refer to each other by index. Symbols and values are stored once into a strings table and an atoms table, curve points into a floats table. @n
+ * The tables are read in place from the mapped file : there is no parsing, only the creation of the objects. @n
+ * A journal appends small snapshots (frames) of the objects edited since the last snapshot, a load replays them after the snapshot (see Scenario::JournalWrite). @n@n
+ *
+ * @see Scenario, Loop, Automation, TTCurve, TTTimeEvent, TTTimeCondition
+ *
+ * @authors Théo de la Hogue & Clément Bossut
+ *
+ * @copyright Copyright © 2013, Théo de la Hogue & Clément Bossut @n
+ * This code is licensed under the terms of the "CeCILL-C" @n
+ * http://www.cecill.info
+ */
+
+#ifndef __TT_SCORE_SNAPSHOT_H__
+#define __TT_SCORE_SNAPSHOT_H__
+
+#include "TTScoreIncludes.h"
+#include "TTScoreEncoding.h"
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <unordered_map>
+#include <atomic>
+#include <thread>
+
+#define TTSCORE_SNAPSHOT_MAGIC          0x53535454          ///< "TTSS"
+#define TTSCORE_SNAPSHOT_VERSION        2                   ///< to increment each time a record changes
+#define TTSCORE_SNAPSHOT_ENDIANNESS     0x01020304          ///< to detect a snapshot written on a machine with another byte order
+#define TTSCORE_SNAPSHOT_NONE           0xFFFFFFFF          ///< an undefined index
+#define TTSCORE_SNAPSHOT_WRITE_CHUNK    1048576             ///< the number of bytes written at once to report the progress of a writing
+
+/** The tables of a snapshot */
+enum TTScoreSnapshotTable
+{
+    kTTScoreSnapshotStrings = 0,        ///< null terminated strings (char)
+    kTTScoreSnapshotAtoms,              ///< elements of the values (TTScoreSnapshotAtom)
+    kTTScoreSnapshotFloats,             ///< curve parameters and points (TTFloat64)
+    kTTScoreSnapshotContainers,         ///< scenarios and loops (TTScoreSnapshotContainer)
+    kTTScoreSnapshotEvents,             ///< time events (TTScoreSnapshotEvent)
+    kTTScoreSnapshotStateLines,         ///< lines of the time events state (TTScoreSnapshotStateLine)
+    kTTScoreSnapshotProcesses,          ///< time processes (TTScoreSnapshotProcess)
+    kTTScoreSnapshotConditions,         ///< time conditions (TTScoreSnapshotCondition)
+    kTTScoreSnapshotCases,              ///< cases of the time conditions (TTScoreSnapshotCase)
+    kTTScoreSnapshotCurves,             ///< automation curves (TTScoreSnapshotCurve)
+    kTTScoreSnapshotRemovals,           ///< objects removed since the previous frame of a journal (TTScoreSnapshotRemoval)
+    kTTScoreSnapshotTableCount
+};
+
+/** The type of an atom */
+enum TTScoreSnapshotAtomType
+{
+    kTTScoreSnapshotAtomNone = 0,       ///< an element which can't be stored (object, pointer, ...)
+    kTTScoreSnapshotAtomFloat32,
+    kTTScoreSnapshotAtomFloat64,
+    kTTScoreSnapshotAtomInt8,
+    kTTScoreSnapshotAtomUInt8,
+    kTTScoreSnapshotAtomInt16,
+    kTTScoreSnapshotAtomUInt16,
+    kTTScoreSnapshotAtomInt32,
+    kTTScoreSnapshotAtomUInt32,
+    kTTScoreSnapshotAtomInt64,
+    kTTScoreSnapshotAtomUInt64,
+    kTTScoreSnapshotAtomBoolean,
+    kTTScoreSnapshotAtomSymbol
+};
+
+/** The header at the beginning of a snapshot file, followed by one TTScoreSnapshotTableEntry per table */
+struct TTScoreSnapshotHeader
+{
+    TTUInt32    magic;
+    TTUInt32    version;
+    TTUInt32    endianness;
+    TTUInt32    tableCount;
+};
+
+/** Where a table is in the file */
+struct TTScoreSnapshotTableEntry
+{
+    TTUInt64    offset;                 ///< from the beginning of the file (aligned on 8 bytes)
+    TTUInt32    count;                  ///< number of records
+    TTUInt32    recordSize;             ///< size of a record to check the snapshot matches this version of the library
+};
+
+/** An element of a value */
+struct TTScoreSnapshotAtom
+{
+    TTUInt32    type;                   ///< a TTScoreSnapshotAtomType
+    TTUInt32    string;                 ///< offset of the symbol into the strings table
+    TTInt64     integer;                ///< for integers and booleans
+    TTFloat64   number;                 ///< for floats
+};
+
+/** A scenario or a loop */
+struct TTScoreSnapshotContainer
+{
+    TTUInt32    process;                ///< the process record of the container (TTSCORE_SNAPSHOT_NONE for the root scenario)
+    TTUInt32    name;                   ///< only for the root scenario
+    TTUInt32    version;                ///< the score version of the root scenario
+    TTUInt32    color[3];
+    TTFloat64   viewZoom[2];
+    TTFloat64   viewPosition[2];
+    TTUInt32    startEvent;             ///< the root scenario start event (TTSCORE_SNAPSHOT_NONE for a sub container)
+    TTUInt32    endEvent;               ///< the root scenario end event (TTSCORE_SNAPSHOT_NONE for a sub container)
+    TTUInt32    eventFirst;
+    TTUInt32    eventCount;
+    TTUInt32    processFirst;
+    TTUInt32    processCount;
+    TTUInt32    conditionFirst;
+    TTUInt32    conditionCount;
+};
+
+/** A time event */
+struct TTScoreSnapshotEvent
+{
+    TTUInt32    name;
+    TTUInt32    date;
+    TTUInt32    mute;
+    TTUInt32    stateFirst;
+    TTUInt32    stateCount;
+};
+
+/** A line of a time event state */
+struct TTScoreSnapshotStateLine
+{
+    TTUInt32    address;
+    TTUInt32    valueFirst;             ///< into the atoms table
+    TTUInt32    valueCount;
+};
+
+/** A time process */
+struct TTScoreSnapshotProcess
+{
+    TTUInt32    type;                   ///< the class name of the process
+    TTUInt32    name;
+    TTUInt32    start;                  ///< the start event record
+    TTUInt32    end;                    ///< the end event record
+    TTUInt32    durationMin;
+    TTUInt32    durationMax;
+    TTUInt32    mute;
+    TTUInt32    color[3];
+    TTUInt32    verticalPosition;
+    TTUInt32    verticalSize;
+    TTUInt32    container;              ///< the container record of a scenario or a loop (TTSCORE_SNAPSHOT_NONE otherwise)
+    TTUInt32    curveFirst;             ///< the curves of an automation
+    TTUInt32    curveCount;
+};
+
+/** A time condition */
+struct TTScoreSnapshotCondition
+{
+    TTUInt32    name;
+    TTUInt32    dispose;                ///< the dispose expression
+    TTUInt32    caseFirst;
+    TTUInt32    caseCount;
+};
+
+/** A case of a time condition */
+struct TTScoreSnapshotCase
+{
+    TTUInt32    event;                  ///< the event record
+    TTUInt32    trigger;                ///< the trigger expression
+    TTUInt32    dflt;                   ///< the default comportment
+};
+
+/** An automation curve (the curves of an address are consecutive) */
+struct TTScoreSnapshotCurve
+{
+    TTUInt32    address;
+    TTUInt32    active;
+    TTUInt32    redundancy;
+    TTUInt32    recorded;
+    TTUInt32    sampleRate;
+    TTUInt32    functionFirst;          ///< x1 y1 b1 x2 y2 b2 ... into the floats table (for a function based curve)
+    TTUInt32    functionCount;
+    TTUInt32    sampleFirst;            ///< x1 y1 x2 y2 ... into the floats table (the sampled points)
+    TTUInt32    sampleCount;            ///< the number of floats (twice the number of points)
+};
+
+/** An object removed since the previous frame of a journal */
+struct TTScoreSnapshotRemoval
+{
+    TTUInt32    table;                  ///< kTTScoreSnapshotEvents, kTTScoreSnapshotProcesses or kTTScoreSnapshotConditions
+    TTUInt32    name;
+};
+
+/** The header of a journal frame, followed by the snapshot of the frame */
+struct TTScoreSnapshotFrame
+{
+    TTUInt64    size;                   ///< size of the snapshot
+    TTUInt64    checksum;               ///< hash of the snapshot bytes to detect a frame half written or damaged
+};
+
+/**	Build the tables of a snapshot and write them into a file
+ @details the objects write their own records (see the WriteAsSnapshot messages) */
+class TTSCORE_EXPORT TTScoreSnapshotWriter
+{
+public:
+
+    TTScoreSnapshotWriter();
+
+    /** Store a symbol once
+     @return                the offset of the symbol into the strings table */
+    TTUInt32    addSymbol(TTSymbol aSymbol);
+
+    /** Store the elements of a value into the atoms table
+     @param value           the value to store
+     @param count           the returned number of atoms
+     @return                the first atom */
+    TTUInt32    addValue(const TTValue& value, TTUInt32& count);
+
+    /** Store floats into the floats table
+     @details the same floats are stored once when they are worth to be shared (see TTScorePayloads)
+     @return                the first float */
+    TTUInt32    addFloats(const TTFloat64* values, TTUInt32 count);
+
+    /** Find the records stored before for the same content
+     @param table           a table
+     @param content         the canonical bytes of the content (see TTScorePayloads::appendValue)
+     @return                the first record (TTSCORE_SNAPSHOT_NONE if the content have not been stored) */
+    TTUInt32    sharedRecords(TTScoreSnapshotTable table, const std::string& content) const;
+
+    /** Remember the records stored for a content to share them with the next identical contents
+     @param table           a table
+     @param content         the canonical bytes of the content
+     @param first           the first record */
+    void        setSharedRecords(TTScoreSnapshotTable table, const std::string& content, TTUInt32 first);
+
+    /** Append a record to a table
+     @return                the index of the record */
+    template<class Record>
+    TTUInt32    append(TTScoreSnapshotTable table, const Record& record)
+    {
+        TTScoreBuffer& buffer = mTables[table];
+        TTUInt32 index = buffer.size() / sizeof(Record);
+
+        buffer.resize(buffer.size() + sizeof(Record));
+        memcpy(&buffer[index * sizeof(Record)], &record, sizeof(Record));
+
+        return index;
+    }
+
+    /** Access a record to edit it after it has been appended */
+    template<class Record>
+    Record&     at(TTScoreSnapshotTable table, TTUInt32 index)
+    {
+        return *reinterpret_cast<Record*>(&mTables[table][index * sizeof(Record)]);
+    }
+
+    /** Get the number of records of a table */
+    TTUInt32    size(TTScoreSnapshotTable table) const;
+
+    /** Remember the record of a time event to refer to it from processes and conditions */
+    void        setEventIndex(TTObjectBasePtr anEvent, TTUInt32 index);
+
+    /** Get the record of a time event (TTSCORE_SNAPSHOT_NONE if the event has not been written) */
+    TTUInt32    eventIndex(TTObjectBasePtr anEvent) const;
+
+    /** Write the snapshot into a file
+     @details the file is written next to the path then renamed so a crash never leaves a half written snapshot
+     @param path            the file path
+     @param progress        an optional ratio of the file written so far updated while writing
+     @return                an error code if the file can't be written */
+    TTErr       write(const TTString& path, std::atomic<TTFloat64>* progress = NULL);
+
+    /** Append the snapshot as a frame at the end of a journal file
+     @details a frame is a TTScoreSnapshotFrame followed by the snapshot : a frame half written by a crash is cut when the journal is read
+     (see TTScoreSnapshotReadJournal) and a frame which can't be written entirely is cut at once
+     @return                an error code if the frame can't be written */
+    TTErr       append(const TTString& path);
+
+private:
+
+    /** Lay out the header, the table entries and the tables as they are stored */
+    void        image(TTScoreBuffer& buffer) const;
+
+    TTScoreBuffer                                   mTables[kTTScoreSnapshotTableCount];
+    TTUInt32                                        mRecordSizes[kTTScoreSnapshotTableCount];
+    std::unordered_map<std::string, TTUInt32>       mStrings;
+    std::unordered_map<std::string, TTUInt32>       mShared[kTTScoreSnapshotTableCount];
+    std::unordered_map<TTObjectBasePtr, TTUInt32>   mEvents;
+};
+
+typedef TTScoreSnapshotWriter* TTScoreSnapshotWriterPtr;
+
+
+/**	Write a snapshot into a file on a background thread
+ @details the tables of a writer hold a copy of the score : once they are filled by the objects
+ the score can be edited or played while the file is written without sharing anything with the writing thread */
+class TTSCORE_EXPORT TTScoreSnapshotBackgroundWriter
+{
+public:
+
+    TTScoreSnapshotBackgroundWriter();
+    ~TTScoreSnapshotBackgroundWriter();
+
+    /** Start to write the tables of a writer into a file
+     @details the tables are moved out of the writer
+     @param aWriter         a filled writer
+     @param path            the file path
+     @return                kTTErrGeneric if a writing is already in progress */
+    TTErr       start(TTScoreSnapshotWriter& aWriter, const TTString& path);
+
+    /** Is there a writing started and not finished ? */
+    TTBoolean   busy() const { return mThread.joinable(); }
+
+    /** Is the writing done ? */
+    TTBoolean   done() const { return mDone; }
+
+    /** The ratio of the file written so far */
+    TTFloat64   progress() const { return mProgress; }
+
+    /** Wait the end of the writing
+     @return                the error of the writing */
+    TTErr       finish();
+
+private:
+
+    TTScoreSnapshotWriter                   mWriter;
+    TTString                                mPath;
+    std::thread                             mThread;
+    std::atomic<TTFloat64>                  mProgress;
+    std::atomic<TTBoolean>                  mDone;
+    TTErr                                   mError;
+};
+
+
+/**	Map a snapshot file into memory and give access to its tables
+ @details the objects read their own records (see the ReadFromSnapshot messages) @n
+ to read lazily the reader have to be owned by a std::shared_ptr : the processes which defer their reading keep it (and the file mapped) alive */
+class TTSCORE_EXPORT TTScoreSnapshotReader : public std::enable_shared_from_this<TTScoreSnapshotReader>
+{
+public:
+
+    TTScoreSnapshotReader();
+    ~TTScoreSnapshotReader();
+
+    /** Enable the lazy reading : the sub containers and the curves are read on first access (see TTScoreSnapshotPending) */
+    void        setLazy(TTBoolean lazy) { mLazy = lazy; }
+
+    /** Is the reading lazy ? */
+    TTBoolean   lazy() const { return mLazy; }
+
+    /** Map a snapshot file and check its header and its tables
+     @return                an error code if the file can't be mapped or is not a valid snapshot */
+    TTErr       open(const TTString& path);
+
+    /** Check a snapshot already in memory (like a frame of a journal) and read it in place
+     @details the data have to stay valid until the reader is closed
+     @return                an error code if the data is not a valid snapshot */
+    TTErr       open(const unsigned char* data, TTUInt64 size);
+
+    /** Unmap the file */
+    void        close();
+
+    /** Get the number of records of a table */
+    TTUInt32    size(TTScoreSnapshotTable table) const;
+
+    /** Check a range of records exists into a table */
+    TTBoolean   contains(TTScoreSnapshotTable table, TTUInt32 first, TTUInt32 count) const;
+
+    /** Get the records of a table
+     @details use contains before to access a record */
+    template<class Record>
+    const Record* records(TTScoreSnapshotTable table) const
+    {
+        return reinterpret_cast<const Record*>(mData + mTables[table].offset);
+    }
+
+    /** Get a symbol from its offset into the strings table (kTTSymEmpty if the offset is not valid) */
+    TTSymbol    symbol(TTUInt32 offset) const;
+
+    /** Get a value from the atoms table
+     @return                NO if the range is not valid */
+    TTBoolean   value(TTUInt32 first, TTUInt32 count, TTValue& value) const;
+
+    /** Get floats from the floats table
+     @return                NULL if the range is not valid */
+    const TTFloat64* floats(TTUInt32 first, TTUInt32 count) const;
+
+    /** Remember the time event created for an event record to link processes and conditions on it */
+    void        setEvent(TTUInt32 index, TTObject& anEvent);
+
+    /** Get the time event created for an event record (an empty object if there is none) */
+    TTObject    event(TTUInt32 index) const;
+
+private:
+
+    /** Check the header and the tables of the data */
+    TTErr       check();
+
+    const unsigned char*                mData;
+    TTUInt64                            mSize;
+    TTBoolean                           mMapped;
+    TTScoreSnapshotTableEntry           mTables[kTTScoreSnapshotTableCount];
+    std::vector<TTObject>               mEvents;
+    TTBoolean                           mLazy;
+#ifdef TT_PLATFORM_WIN
+    HANDLE                              mFile;
+    HANDLE                              mMapping;
+#endif
+};
+
+typedef TTScoreSnapshotReader* TTScoreSnapshotReaderPtr;
+
+
+/**	A process record which reading have been deferred until the process is needed
+ @details a process defers its reading when the reader is lazy then it reads its record on first access (compilation, go to, edition or gui request) */
+class TTSCORE_EXPORT TTScoreSnapshotPending
+{
+public:
+
+    TTScoreSnapshotPending() : mIndex(TTSCORE_SNAPSHOT_NONE) {}
+
+    /** Defer the reading of a process record if the reader is lazy
+     @return                YES if the reading have been deferred */
+    TTBoolean   defer(TTScoreSnapshotReader& aReader, TTUInt32 index);
+
+    /** Is there a deferred reading ? */
+    TTBoolean   pending() const { return mReader != NULL; }
+
+    /** Take the deferred reading to do it
+     @details the pending state is cleared before the reading so it can't be done twice
+     @param aReader         the returned reader (it stays alive as long as it is held)
+     @param index           the returned process record
+     @return                NO if there is no deferred reading */
+    TTBoolean   take(std::shared_ptr<TTScoreSnapshotReader>& aReader, TTUInt32& index);
+
+    /** Forget the deferred reading */
+    void        clear() { mReader.reset(); mIndex = TTSCORE_SNAPSHOT_NONE; }
+
+private:
+
+    std::shared_ptr<TTScoreSnapshotReader>  mReader;
+    TTUInt32                                mIndex;
+};
+
+
+/** Write the generic attributes of a time process into a new process record
+ @param aWriter             a snapshot writer
+ @param aTimeProcess        a time process
+ @param start               the start event record
+ @param end                 the end event record
+ @return                    the index of the process record */
+TTUInt32 TTSCORE_EXPORT TTScoreSnapshotWriteProcess(TTScoreSnapshotWriter& aWriter, TTObject& aTimeProcess, TTUInt32 start, TTUInt32 end);
+
+/** Set the generic attributes of a time process from a process record
+ @param aReader             a snapshot reader
+ @param record              a process record
+ @param aTimeProcess        a time process */
+void TTSCORE_EXPORT TTScoreSnapshotReadProcess(const TTScoreSnapshotReader& aReader, const TTScoreSnapshotProcess& record, TTObject& aTimeProcess);
+
+/** Read the frames of a journal file
+ @details the reading stops at the first frame which is incomplete or which doesn't match its checksum :
+ this frame and the next bytes are cut from the file so the next frames are appended after the last complete one
+ @param path                a journal file
+ @param data                the returned content of the file (until the end of the last complete frame)
+ @param frames              the returned offset and size of each complete frame into the data
+ @return                    kTTErrValueNotFound if there is no journal, kTTErrGeneric if it can't be read or cut */
+TTErr TTSCORE_EXPORT TTScoreSnapshotReadJournal(const TTString& path, TTScoreBuffer& data, std::vector<std::pair<TTUInt64, TTUInt64> >& frames);
+
+/** Remove a journal file once its frames are compacted into a snapshot */
+void TTSCORE_EXPORT TTScoreSnapshotRemoveJournal(const TTString& path);
+
+#endif // __TT_SCORE_SNAPSHOT_H__
@@ -0,0 +1,81 @@
+/** @file
+ *
+ * @ingroup scoreLibrary
+ *
+ * @brief format the attributes of the score xml files straight into a reusable buffer
+ *
+ * @details The score writers used to convert each attribute into a TTValue then call TTValue::toString to get its text.
+ * The formatter writes the numbers and the symbols directly into a buffer which is reused from one attribute to the next. @n
+ * Every element is written as TTValue::toString does (unsigned integers end with a 'u', floats have a decimal point)
+ * because the readers infer the type of each element from its text. @n
+ * Unlike TTValue::toString the floats are not rounded to six decimals : they are written with the fewest digits read back as the same float. @n@n
+ *
+ * @see TTCurve, TTTimeEvent, Scenario, Loop
+ *
+ * @authors Théo de la Hogue & Clément Bossut
+ *
+ * @copyright Copyright © 2013, Théo de la Hogue & Clément Bossut @n
+ * This code is licensed under the terms of the "CeCILL-C" @n
+ * http://www.cecill.info
+ */
+
+#ifndef __TT_SCORE_XML_FORMATTER_H__
+#define __TT_SCORE_XML_FORMATTER_H__
+
+#include "TTScoreIncludes.h"
+
+#include <libxml/xmlwriter.h>
+
+#include <string>
+
+/**	Format values into a reusable buffer and write them as xml attributes */
+class TTSCORE_EXPORT TTScoreXmlFormatter
+{
+public:
+
+    TTScoreXmlFormatter();
+
+    /** Format the elements of a value separated by a space
+     @return                the text (valid until the next formatting) */
+    const char* format(const TTValue& value);
+
+    /** Format a single number or a symbol without building a value
+     @return                the text (valid until the next formatting) */
+    const char* format(TTUInt32 value);
+    const char* format(TTInt32 value);
+    const char* format(TTBoolean value);
+    const char* format(TTFloat64 value);
+    const char* format(TTSymbol value);
+
+    /** Parse an unsigned integer attribute without building a value
+     @details the text is read as TTValue::fromString reads an unsigned integer (digits ended by a 'u' as written by TTValue::toString)
+     and the digits without the 'u' are accepted too
+     @param text            a null terminated text
+     @param value           the returned value
+     @return                NO if the text is not an unsigned integer */
+    static TTBoolean parseUInt32(const char* text, TTUInt32& value);
+
+    /** Write an attribute into a xml writer
+     @param aWriter         a xml text writer
+     @param name            the name of the attribute
+     @param value           a value, a number or a symbol */
+    template<class Value>
+    void        writeAttribute(xmlTextWriterPtr aWriter, const char* name, const Value& value)
+    {
+        const char* text = format(value);
+        xmlTextWriterWriteAttribute(aWriter, BAD_CAST name, BAD_CAST text);
+    }
+
+private:
+
+    void        appendElement(const TTElement& element);
+    void        appendInteger(TTInt64 value);
+    void        appendUnsigned(TTUInt64 value);
+    void        appendDigits(TTUInt64 value);
+    void        appendFloat(TTFloat64 value);
+    void        appendSymbol(TTSymbol value);
+
+    std::string mBuffer;
+};
+
+#endif // __TT_SCORE_XML_FORMATTER_H__
@@ -164,6 +164,14 @@ private :
 	TTErr           WriteAsXml(const TTValue& inputValue, TTValue& outputValue);
 	TTErr           ReadFromXml(const TTValue& inputValue, TTValue& outputValue);
     
+    /**  needed to be handled by a TTScoreSnapshotWriter/Reader
+     @details the events of the cases have to be written or read before
+     @param	inputValue      a writer pointer | a reader pointer, the condition record
+     @param	outputValue     the condition record written | nothing
+     @return                an error code if the operation fails */
+	TTErr           WriteAsSnapshot(const TTValue& inputValue, TTValue& outputValue);
+	TTErr           ReadFromSnapshot(const TTValue& inputValue, TTValue& outputValue);
+    
     /** To be notified when an event date changed
      @param inputValue      the event which have changed his date
      @param outputValue     nothing
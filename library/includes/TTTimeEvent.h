@@ -20,6 +20,12 @@
 
 #include "TTScoreIncludes.h"
 
+#include <string>
+#include <vector>
+
+/** The address and the value of each line of an event state */
+typedef std::vector<std::pair<TTAddress, TTValue> > TTTimeEventStateLines;
+
 /**	a class to define an event
  
  The TTTimeEvent class allows to ...
@@ -120,6 +126,28 @@ private :
 	TTErr           WriteAsXml(const TTValue& inputValue, TTValue& outputValue);
 	TTErr           ReadFromXml(const TTValue& inputValue, TTValue& outputValue);
     
+    /**  needed to be handled by a TTScoreSnapshotWriter/Reader
+     @details only the command lines of the state are stored
+     @param	inputValue      a writer pointer | a reader pointer, the event record
+     @param	outputValue     the event record written | nothing
+     @return                an error code if the operation fails */
+	TTErr           WriteAsSnapshot(const TTValue& inputValue, TTValue& outputValue);
+	TTErr           ReadFromSnapshot(const TTValue& inputValue, TTValue& outputValue);
+    
+    /** Get the address and the value of each line of the state
+     @details the state is flattened if needed
+     @param lines           the returned lines */
+    void            getStateLines(TTTimeEventStateLines& lines);
+    
+    /** Get the canonical bytes of state lines to store identical states once into the files (see TTScorePayloads)
+     @param lines           the lines of a state
+     @param content         the returned content */
+    static void     getStateContent(const TTTimeEventStateLines& lines, std::string& content);
+    
+    /** Append lines to the state
+     @param lines           the lines to append */
+    void            appendStateLines(const TTTimeEventStateLines& lines);
+    
     
     /** Push the state content
      @details this method eases the call of state run method
@@ -110,6 +110,14 @@ private :
 	virtual TTErr	WriteAsXml(const TTValue& inputValue, TTValue& outputValue) {outputValue = inputValue; return kTTErrGeneric;};
 	virtual TTErr	ReadFromXml(const TTValue& inputValue, TTValue& outputValue) {outputValue = inputValue; return kTTErrGeneric;};
     
+    /**  needed to be handled by a TTScoreSnapshotWriter/Reader
+     @details the generic attributes are stored by the container (see TTScoreSnapshotWriteProcess), this stores what is specific to the process
+     @param	inputValue      a writer pointer | a reader pointer, the process record
+     @param	outputValue     nothing
+     @return                an error code if the operation fails */
+	virtual TTErr	WriteAsSnapshot(const TTValue& inputValue, TTValue& outputValue) {return kTTErrNone;};
+	virtual TTErr	ReadFromSnapshot(const TTValue& inputValue, TTValue& outputValue) {return kTTErrNone;};
+    
     /** get the time process rigidity
      @param	value           rigidity state
      @return                kTTErrNone */
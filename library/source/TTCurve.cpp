@@ -14,22 +14,45 @@
  */
 
 #include "TTCurve.h"
+#include "TTScoreEncoding.h"
+#include "TTScoreSnapshot.h"
+#include "TTScoreXmlFormatter.h"
+#include "TTScorePayloads.h"
 
 #include <libxml/encoding.h>
 #include <libxml/xmlwriter.h>
 #include <libxml/xmlreader.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <string.h>
+#include <stdlib.h>
+#include <thread>
+
 #define thisTTClass                 TTCurve
 #define thisTTClassName             "Curve"
 #define thisTTClassTags             "curve"
 
+#define TTCURVE_SAMPLES_RAW         0               ///< samples data format : x y float64 pairs
+#define TTCURVE_SAMPLES_XOR         2               ///< samples data format : x y float64 representations xor the previous ones (see TTScoreBufferAppendFloat64Xor)
+
 TT_BASE_OBJECT_CONSTRUCTOR,
 mActive(YES),
 mRedundancy(NO),
 mSampleRate(20),
 mRecorded(NO),
 mSampled(NO),
-mLastSample(0.)
+mSamplesCompressed(YES),
+mLastSample(0.),
+mPreviousX(0.),
+mPreviousY(0.),
+mPreviousValid(NO),
+mRecordAnchorX(0.),
+mRecordAnchorY(0.),
+mRecordMinY(0.),
+mRecordMaxY(0.)
 {
 	TT_ASSERT("Correct number of args to create TTCurve", arguments.size() == 0);
 
@@ -40,9 +63,13 @@ mLastSample(0.)
     addAttributeWithSetter(SampleRate, kTypeUInt32);
     addAttribute(Recorded, kTypeBoolean);
     addAttribute(Sampled, kTypeBoolean);
+    addAttribute(SamplesCompressed, kTypeBoolean);
     
     addMessageWithArguments(Sample);
     addMessageWithArguments(ValueAt);
+    addMessageWithArguments(Simplify);
+    addMessageWithArguments(Overview);
+    addMessageWithArguments(Import);
     
 	// needed to be handled by a TTXmlHandler
 	addMessageWithArguments(WriteAsXml);
@@ -55,6 +82,12 @@ mLastSample(0.)
 	addMessageProperty(WriteAsText, hidden, YES);
 	addMessageWithArguments(ReadFromText);
 	addMessageProperty(ReadFromText, hidden, YES);
+    
+    // needed to be handled by a TTScoreSnapshotWriter/Reader
+	addMessageWithArguments(WriteAsSnapshot);
+	addMessageProperty(WriteAsSnapshot, hidden, YES);
+	addMessageWithArguments(ReadFromSnapshot);
+	addMessageProperty(ReadFromSnapshot, hidden, YES);
 
     mFunction = TTObject("freehand", 1); // for 1 channel only
 }
@@ -125,6 +158,7 @@ TTErr TTCurve::setFunctionParameters(const TTValue& value)
         // sample       : x1 y1 x2 y2 . .
         
         mList.clear();
+        clearOverview();
         
         for (i = 0; i < value.size(); i = i+3)
         {
@@ -170,6 +204,7 @@ TTErr TTCurve::setFunctionParameters(const TTValue& value)
         
         // clear the samples
         mList.clear();
+        clearOverview();
         
         // it is not based on a record anymore
         mRecorded = NO;
@@ -275,17 +310,15 @@ TTErr TTCurve::Sample(const TTValue& inputValue, TTValue& outputValue)
             // for a function based curve
             else
             {
+                std::vector<TTFloat64> samples;
+                
                 // get new samples from function
-                mList.clear();
+                calculateSamples(nbPoints, samples);
+                setSamples(samples);
+                
                 outputValue.clear();
                 for (i = 0; i < nbPoints; i++)
-                {
-                    x = TTFloat64(i) / TTFloat64(nbPoints);
-                    TTAudioObjectBasePtr(mFunction.instance())->calculate(x, y);
-                    
-                    mList.append(TTValue(x, y));
-                    outputValue.append(y);
-                }
+                    outputValue.append(samples[i]);
             }
             
             mSampled = YES;
@@ -297,6 +330,30 @@ TTErr TTCurve::Sample(const TTValue& inputValue, TTValue& outputValue)
     return kTTErrGeneric;
 }
 
+void TTCurve::calculateSamples(TTUInt32 nbPoints, std::vector<TTFloat64>& y)
+{
+    TTFloat64 x;
+    
+    y.resize(nbPoints);
+    
+    for (TTUInt32 i = 0; i < nbPoints; i++)
+    {
+        x = TTFloat64(i) / TTFloat64(nbPoints);
+        TTAudioObjectBasePtr(mFunction.instance())->calculate(x, y[i]);
+    }
+}
+
+void TTCurve::setSamples(const std::vector<TTFloat64>& y)
+{
+    mList.clear();
+    clearOverview();
+    
+    for (TTUInt32 i = 0; i < y.size(); i++)
+        mList.append(TTValue(TTFloat64(i) / TTFloat64(y.size()), y[i]));
+    
+    mSampled = YES;
+}
+
 TTErr TTCurve::ValueAt(const TTValue& inputValue, TTValue& outputValue)
 {
     if (inputValue.size() == 1) {
@@ -324,6 +381,438 @@ TTErr TTCurve::ValueAt(const TTValue& inputValue, TTValue& outputValue)
     return kTTErrGeneric;
 }
 
+TTErr TTCurve::Simplify(const TTValue& inputValue, TTValue& outputValue)
+{
+    if (inputValue.size() == 1) {
+        
+        if (inputValue[0].type() == kTypeFloat64) {
+            
+            // only record based curves store their points
+            if (!mRecorded)
+                return kTTErrGeneric;
+            
+            outputValue = simplify(TTFloat64(inputValue[0]));
+            
+            return kTTErrNone;
+        }
+    }
+    
+    return kTTErrGeneric;
+}
+
+TTErr TTCurve::Import(const TTValue& inputValue, TTValue& outputValue)
+{
+    TTCurveSampleFile       aFile;
+    std::vector<TTCurvePtr> curves(1, this);
+    TTSymbol                path;
+    TTSymbol                format;
+    TTFloat64               tolerance = TTCURVE_IMPORT_TOLERANCE_AUTO;
+    TTInt32                 yColumn = 1;
+    TTInt32                 xColumn = 0;
+    TTUInt32                columns = 0;
+    TTUInt64                rows;
+    TTErr                   err;
+    
+    if (inputValue.size() < 1 || inputValue[0].type() != kTypeSymbol)
+        return kTTErrGeneric;
+    
+    path = inputValue[0];
+    format = TTCurveSampleFile::format(path.c_str());
+    
+    if (inputValue.size() > 1)
+        tolerance = inputValue[1];
+    
+    if (inputValue.size() > 2)
+        yColumn = inputValue[2];
+    
+    if (inputValue.size() > 3)
+        xColumn = inputValue[3];
+    
+    if (inputValue.size() > 4 && inputValue[4].type() == kTypeSymbol)
+        format = inputValue[4];
+    
+    if (inputValue.size() > 5)
+        columns = inputValue[5];
+    
+    if (yColumn < 0 || yColumn == xColumn)
+        return kTTErrGeneric;
+    
+    // a binary file needs at least the x and y columns
+    if (columns == 0)
+        columns = std::max(yColumn, xColumn) + 1;
+    
+    err = aFile.open(path.c_str(), format, columns);
+    if (err)
+        return err;
+    
+    err = TTCurveImport(curves, aFile, xColumn, yColumn, tolerance, rows);
+    if (err)
+        return err;
+    
+    outputValue = rows;
+    outputValue.append(TTUInt32(mList.getSize()));
+    
+    return kTTErrNone;
+}
+
+TTErr TTCurve::Overview(const TTValue& inputValue, TTValue& outputValue)
+{
+    if (inputValue.size() == 3) {
+        
+        if (inputValue[0].type() == kTypeFloat64 && inputValue[1].type() == kTypeFloat64 && inputValue[2].type() == kTypeUInt32) {
+            
+            TTFloat64   start = inputValue[0];
+            TTFloat64   end = inputValue[1];
+            TTUInt32    columns = inputValue[2];
+            TTFloat64   width, x, min, max;
+            TTUInt32    level, size, first, last, c, i;
+            
+            if (start < 0.) start = 0.;
+            if (end > 1.) end = 1.;
+            
+            if (columns == 0 || end <= start)
+                return kTTErrGeneric;
+            
+            if (mOverviewMin.empty())
+                buildOverview();
+            
+            if (mOverviewMin.empty())
+                return kTTErrGeneric;
+            
+            // choose the coarsest level which still have at least one bin per column
+            width = (end - start) / columns;
+            level = 0;
+            while (level + 1 < mOverviewMin.size() && 1. / mOverviewMin[level + 1].size() <= width)
+                level++;
+            
+            std::vector<TTFloat64>& levelMin = mOverviewMin[level];
+            std::vector<TTFloat64>& levelMax = mOverviewMax[level];
+            size = levelMin.size();
+            
+            outputValue.resize(columns * 3);
+            
+            for (c = 0; c < columns; c++)
+            {
+                x = start + c * width;
+                
+                first = TTUInt32(x * size);
+                last = TTUInt32(ceil((x + width) * size));
+                
+                if (first >= size) first = size - 1;
+                if (last > size) last = size;
+                if (last <= first) last = first + 1;
+                
+                min = levelMin[first];
+                max = levelMax[first];
+                for (i = first + 1; i < last; i++)
+                {
+                    if (levelMin[i] < min) min = levelMin[i];
+                    if (levelMax[i] > max) max = levelMax[i];
+                }
+                
+                outputValue[c*3] = x;
+                outputValue[c*3+1] = min;
+                outputValue[c*3+2] = max;
+            }
+            
+            return kTTErrNone;
+        }
+    }
+    
+    return kTTErrGeneric;
+}
+
+void TTCurve::buildOverview()
+{
+    TTUInt32                size, bin, i, j;
+    TTFloat64               x, y, lastY = 0.;
+    std::vector<TTBoolean>  filled;
+    
+    clearOverview();
+    
+    if (mList.isEmpty())
+        return;
+    
+    // the finest level has a power of two bins count close to the number of points
+    size = 1;
+    while (size < mList.getSize() && size < TTCURVE_OVERVIEW_SIZE_MAX)
+        size *= 2;
+    
+    mOverviewMin.resize(1);
+    mOverviewMax.resize(1);
+    mOverviewMin[0].assign(size, 0.);
+    mOverviewMax[0].assign(size, 0.);
+    filled.assign(size, NO);
+    
+    std::vector<TTFloat64>& levelMin = mOverviewMin[0];
+    std::vector<TTFloat64>& levelMax = mOverviewMax[0];
+    
+    for (mList.begin(); mList.end(); mList.next())
+    {
+        x = mList.current()[0];
+        y = mList.current()[1];
+        lastY = y;
+        
+        bin = x <= 0. ? 0 : TTUInt32(x * size);
+        if (bin >= size)
+            bin = size - 1;
+        
+        if (!filled[bin])
+        {
+            levelMin[bin] = y;
+            levelMax[bin] = y;
+            filled[bin] = YES;
+        }
+        else
+        {
+            if (y < levelMin[bin]) levelMin[bin] = y;
+            if (y > levelMax[bin]) levelMax[bin] = y;
+        }
+    }
+    
+    // empty bins take the value of the next point (see in TTCurveNextSampleAt) or the last one at the end
+    y = lastY;
+    for (i = size; i > 0; i--)
+    {
+        if (filled[i - 1])
+            y = levelMin[i - 1];
+        else
+        {
+            levelMin[i - 1] = y;
+            levelMax[i - 1] = y;
+        }
+    }
+    
+    // each upper level merges the bins of the level below two by two
+    for (j = 1; size > 1; j++)
+    {
+        size /= 2;
+        
+        mOverviewMin.push_back(std::vector<TTFloat64>(size));
+        mOverviewMax.push_back(std::vector<TTFloat64>(size));
+        
+        for (i = 0; i < size; i++)
+        {
+            mOverviewMin[j][i] = std::min(mOverviewMin[j-1][2*i], mOverviewMin[j-1][2*i+1]);
+            mOverviewMax[j][i] = std::max(mOverviewMax[j-1][2*i], mOverviewMax[j-1][2*i+1]);
+        }
+    }
+}
+
+void TTCurve::recordStart(TTFloat64 x, TTFloat64 y)
+{
+    mList.append(TTValue(x, y));
+    clearOverview();
+    
+    mRecordAnchorX = x;
+    mRecordAnchorY = y;
+    
+    mRecordMinY = y;
+    mRecordMaxY = y;
+    
+    mRecordWindowX.clear();
+    mRecordWindowY.clear();
+    mRecordWindowX.reserve(TTCURVE_RECORD_WINDOW_MAX);
+    mRecordWindowY.reserve(TTCURVE_RECORD_WINDOW_MAX);
+}
+
+void TTCurve::record(TTFloat64 x, TTFloat64 y, TTFloat64 tolerance)
+{
+    TTUInt32 i, size = mRecordWindowX.size();
+    
+    mRecordMinY = std::min(mRecordMinY, y);
+    mRecordMaxY = std::max(mRecordMaxY, y);
+    
+    // the tolerance grows with the range recorded so far
+    if (tolerance < 0.)
+        tolerance = (mRecordMaxY - mRecordMinY) * TTCURVE_RECORD_TOLERANCE_RATIO;
+    
+    // check that all the points received since the anchor still fit the line between the anchor and the new point
+    for (i = 0; i < size; i++)
+        if (TTCurveVerticalError(mRecordAnchorX, mRecordAnchorY, x, y, mRecordWindowX[i], mRecordWindowY[i]) > tolerance)
+            break;
+    
+    // when they don't fit (or when the window is full) : store the last point of the window as the new anchor
+    if (i < size || size >= TTCURVE_RECORD_WINDOW_MAX)
+    {
+        mRecordAnchorX = mRecordWindowX[size-1];
+        mRecordAnchorY = mRecordWindowY[size-1];
+        
+        mList.append(TTValue(mRecordAnchorX, mRecordAnchorY));
+        clearOverview();
+        
+        mRecordWindowX.clear();
+        mRecordWindowY.clear();
+    }
+    
+    mRecordWindowX.push_back(x);
+    mRecordWindowY.push_back(y);
+}
+
+void TTCurve::recordEnd()
+{
+    // store the pending point
+    if (!mRecordWindowX.empty())
+    {
+        mList.append(TTValue(mRecordWindowX.back(), mRecordWindowY.back()));
+        clearOverview();
+    }
+    
+    mRecordWindowX.clear();
+    mRecordWindowY.clear();
+}
+
+TTUInt32 TTCurve::simplify(TTFloat64 tolerance)
+{
+    std::vector<TTFloat64>  x, y;
+    std::vector<TTBoolean>  keep;
+    std::vector<std::pair<TTUInt32, TTUInt32> > segments;
+    TTUInt32                i, first, last, farthest, size = mList.getSize();
+    TTFloat64               error, maxError;
+    
+    if (size < 3)
+        return 0;
+    
+    x.reserve(size);
+    y.reserve(size);
+    for (mList.begin(); mList.end(); mList.next())
+    {
+        x.push_back(TTFloat64(mList.current()[0]));
+        y.push_back(TTFloat64(mList.current()[1]));
+    }
+    
+    keep.assign(size, NO);
+    keep[0] = YES;
+    keep[size-1] = YES;
+    
+    // Ramer-Douglas-Peucker : split each segment at its farthest point while the error is too big
+    // (segments are stacked to not recurse on long records)
+    segments.push_back(std::make_pair(TTUInt32(0), size-1));
+    
+    while (!segments.empty())
+    {
+        first = segments.back().first;
+        last = segments.back().second;
+        segments.pop_back();
+        
+        maxError = 0.;
+        farthest = first;
+        
+        for (i = first + 1; i < last; i++)
+        {
+            error = TTCurveVerticalError(x[first], y[first], x[last], y[last], x[i], y[i]);
+            
+            if (error > maxError)
+            {
+                maxError = error;
+                farthest = i;
+            }
+        }
+        
+        if (farthest != first && maxError > tolerance)
+        {
+            keep[farthest] = YES;
+            segments.push_back(std::make_pair(first, farthest));
+            segments.push_back(std::make_pair(farthest, last));
+        }
+    }
+    
+    // rebuild the list with the kept points
+    mList.clear();
+    clearOverview();
+    for (i = 0; i < size; i++)
+        if (keep[i])
+            mList.append(TTValue(x[i], y[i]));
+    
+    return size - mList.getSize();
+}
+
+void TTCurve::encodeSamples(TTString& text)
+{
+    TTScoreBuffer   buffer;
+    TTUInt64        previousX = 0, previousY = 0;
+    TTUInt32        rawSize;
+    
+    buffer.push_back(TTCURVE_SAMPLES_RAW);
+    TTScoreBufferAppendVarint(buffer, mList.getSize());
+    rawSize = buffer.size() + mList.getSize() * 16;
+    
+    if (mSamplesCompressed) {
+        
+        buffer[0] = TTCURVE_SAMPLES_XOR;
+        buffer.reserve(rawSize);
+        
+        for (mList.begin(); mList.end() && buffer.size() < rawSize; mList.next()) {
+            
+            TTScoreBufferAppendFloat64Xor(buffer, mList.current()[0], previousX);
+            TTScoreBufferAppendFloat64Xor(buffer, mList.current()[1], previousY);
+        }
+        
+        // the values hardly share any bit : the raw format is smaller
+        if (buffer.size() >= rawSize) {
+            
+            buffer.resize(1);
+            buffer[0] = TTCURVE_SAMPLES_RAW;
+            TTScoreBufferAppendVarint(buffer, mList.getSize());
+        }
+    }
+    
+    if (buffer[0] == TTCURVE_SAMPLES_RAW) {
+        
+        buffer.reserve(rawSize);
+        
+        for (mList.begin(); mList.end(); mList.next()) {
+            
+            TTScoreBufferAppendFloat64(buffer, mList.current()[0]);
+            TTScoreBufferAppendFloat64(buffer, mList.current()[1]);
+        }
+    }
+    
+    TTScoreBase64Encode(buffer, text);
+}
+
+TTErr TTCurve::decodeSamples(const char* text)
+{
+    TTScoreBuffer   buffer;
+    TTUInt32        offset = 1;
+    TTUInt64        size, i, previousX = 0, previousY = 0;
+    TTFloat64       x, y;
+    TTBoolean       valid;
+    
+    if (!TTScoreBase64Decode(text, buffer) || buffer.empty())
+        return kTTErrGeneric;
+    
+    if (buffer[0] != TTCURVE_SAMPLES_RAW && buffer[0] != TTCURVE_SAMPLES_XOR)
+        return kTTErrGeneric;
+    
+    if (!TTScoreBufferReadVarint(buffer, offset, size))
+        return kTTErrGeneric;
+    
+    mList.clear();
+    clearOverview();
+    
+    for (i = 0; i < size; i++) {
+        
+        if (buffer[0] == TTCURVE_SAMPLES_XOR)
+            valid = TTScoreBufferReadFloat64Xor(buffer, offset, x, previousX) && TTScoreBufferReadFloat64Xor(buffer, offset, y, previousY);
+        else
+            valid = TTScoreBufferReadFloat64(buffer, offset, x) && TTScoreBufferReadFloat64(buffer, offset, y);
+        
+        if (!valid) {
+            
+            mList.clear();
+            return kTTErrGeneric;
+        }
+        
+        mList.append(TTValue(x, y));
+    }
+    
+    // remember the format to write it back the same way
+    mSamplesCompressed = buffer[0] == TTCURVE_SAMPLES_XOR;
+    
+    return kTTErrNone;
+}
+
 TTErr TTCurve::WriteAsXml(const TTValue& inputValue, TTValue& outputValue)
 {
     TTObject o = inputValue[0];
@@ -331,50 +820,56 @@ TTErr TTCurve::WriteAsXml(const TTValue& inputValue, TTValue& outputValue)
     if (!aXmlHandler)
 		return kTTErrGeneric;
     
-    TTValue     v;
-    TTString    s;
+    TTValue             v;
+    TTString            s;
+    TTScoreXmlFormatter aFormatter;
 	
     xmlTextWriterStartElement((xmlTextWriterPtr)aXmlHandler->mWriter, BAD_CAST "curve");
 	
     // Write if it is active
-    v = mActive;
-    v.toString();
-    s = TTString(v[0]);
-    xmlTextWriterWriteAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, BAD_CAST "active", BAD_CAST s.data());
+    aFormatter.writeAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, "active", mActive);
     
     // Write the redundancy
-    v = mRedundancy;
-    v.toString();
-    s = TTString(v[0]);
-    xmlTextWriterWriteAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, BAD_CAST "redundancy", BAD_CAST s.data());
+    aFormatter.writeAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, "redundancy", mRedundancy);
     
     // Write the sample rate
-    v = mSampleRate;
-    v.toString();
-    s = TTString(v[0]);
-    xmlTextWriterWriteAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, BAD_CAST "sampleRate", BAD_CAST s.data());
+    aFormatter.writeAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, "sampleRate", mSampleRate);
+    
+    // points identical to the points of a curve written before are only referred by their key
+    TTScorePayloads*    payloads = TTScorePayloads::current();
+    TTBoolean           written = NO;
     
-    if (!mRecorded)
+    if (payloads) {
+        
+        std::string content;
+        TTUInt64    key;
+        
+        getPayloadContent(content);
+        
+        if (TTScorePayloads::shareable(content)) {
+            
+            written = payloads->written(content, key);
+            
+            if (key) {
+                
+                char text[17];
+                TTScorePayloads::formatKey(key, text);
+                xmlTextWriterWriteAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, BAD_CAST "payload", BAD_CAST text);
+            }
+        }
+    }
+    
+    if (!written && !mRecorded)
     {
         // Write the function parameters
         getFunctionParameters(v);
-        v.toString();
-        s = TTString(v[0]);
-        xmlTextWriterWriteAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, BAD_CAST "function", BAD_CAST s.data());
+        aFormatter.writeAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, "function", v);
     }
-    else
+    else if (!written)
     {
-        // Write the samples
-        v.clear();
-        for (mList.begin(); mList.end(); mList.next()) {
-            
-            v.append(mList.current()[0]);
-            v.append(mList.current()[1]);
-        }
-            
-        v.toString();
-        s = TTString(v[0]);
-        xmlTextWriterWriteAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, BAD_CAST "samples", BAD_CAST s.data());
+        // Write the samples as base64 binary data
+        encodeSamples(s);
+        xmlTextWriterWriteAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, BAD_CAST "samplesData", BAD_CAST s.data());
     }
     
     xmlTextWriterEndElement((xmlTextWriterPtr)aXmlHandler->mWriter);
@@ -389,7 +884,8 @@ TTErr TTCurve::ReadFromXml(const TTValue& inputValue, TTValue& outputValue)
     if (!aXmlHandler)
 		return kTTErrGeneric;
     
-    TTValue v;
+    TTValue     v;
+    TTObject    holder;
 	
     // get the active state
     if (!aXmlHandler->getXmlAttribute(kTTSym_active, v, NO)) {
@@ -427,18 +923,65 @@ TTErr TTCurve::ReadFromXml(const TTValue& inputValue, TTValue& outputValue)
         }
     }
     
+    // get the key of points shared with a curve read before
+    TTScorePayloads* payloads = TTScorePayloads::current();
+    
+    if (payloads) {
+        
+        xmlChar* data = xmlTextReaderGetAttribute((xmlTextReaderPtr)aXmlHandler->mReader, BAD_CAST "payload");
+        TTUInt64 key;
+        
+        if (data && TTScorePayloads::parseKey((const char*)data, key)) {
+            
+            holder = payloads->holder(key);
+            
+            // the first curve read with the key holds the points for the next curves
+            if (!holder.valid()) {
+                
+                TTObject thisObject(this);
+                payloads->setHolder(key, thisObject);
+            }
+        }
+        
+        if (data)
+            xmlFree(data);
+    }
+    
+    // copy the points of the first curve read with the same key
+    if (holder.valid())
+        copyPayload(TTCurvePtr(holder.instance()));
+    
     // get the function parameters
-    if (!aXmlHandler->getXmlAttribute(kTTSym_function, v, NO)) {
+    else if (!aXmlHandler->getXmlAttribute(kTTSym_function, v, NO)) {
         
         setFunctionParameters(v);
         
         mRecorded = NO;
     }
     
-    // get the function samples
+    // get the function samples as base64 binary data
+    // note : the attribute is read directly to avoid to create a huge symbol
+    else if (xmlTextReaderMoveToAttribute((xmlTextReaderPtr)aXmlHandler->mReader, BAD_CAST "samplesData") == 1) {
+        
+        xmlChar* data = xmlTextReaderValue((xmlTextReaderPtr)aXmlHandler->mReader);
+        TTErr err = decodeSamples((const char*)data);
+        
+        xmlFree(data);
+        xmlTextReaderMoveToElement((xmlTextReaderPtr)aXmlHandler->mReader);
+        
+        if (err)
+            TTLogError("TTCurve::ReadFromXml : corrupted samples data\n");
+        else {
+            mRecorded = YES;
+            mSampled = YES;
+        }
+    }
+    
+    // get the function samples (older format)
     else if (!aXmlHandler->getXmlAttribute(kTTSym_samples, v, NO)) {
         
         mList.clear();
+        clearOverview();
         for (TTUInt32 i = 0; i < v.size(); i = i+2)
             mList.append(TTValue(v[i], v[i+1]));
         
@@ -449,6 +992,46 @@ TTErr TTCurve::ReadFromXml(const TTValue& inputValue, TTValue& outputValue)
 	return kTTErrNone;
 }
 
+void TTCurve::getPayloadContent(std::string& content)
+{
+    TTValue v;
+    
+    content.clear();
+    content.push_back(mRecorded ? 'r' : 'f');
+    
+    if (mRecorded) {
+        
+        for (mList.begin(); mList.end(); mList.next()) {
+            
+            TTFloat64 point[2] = {mList.current()[0], mList.current()[1]};
+            content.append((const char*)point, sizeof(point));
+        }
+    }
+    else if (!getFunctionParameters(v))
+        TTScorePayloads::appendValue(content, v);
+}
+
+void TTCurve::copyPayload(TTCurve* aCurve)
+{
+    TTValue v;
+    
+    mRecorded = aCurve->mRecorded;
+    mSamplesCompressed = aCurve->mSamplesCompressed;
+    
+    if (mRecorded) {
+        
+        mList.clear();
+        clearOverview();
+        
+        for (aCurve->mList.begin(); aCurve->mList.end(); aCurve->mList.next())
+            mList.append(aCurve->mList.current());
+        
+        mSampled = YES;
+    }
+    else if (!aCurve->getFunctionParameters(v))
+        setFunctionParameters(v);
+}
+
 TTErr TTCurve::WriteAsText(const TTValue& inputValue, TTValue& outputValue)
 {
     TTObject o = inputValue[0];
@@ -473,12 +1056,116 @@ TTErr TTCurve::ReadFromText(const TTValue& inputValue, TTValue& outputValue)
 	return kTTErrGeneric;
 }
 
+TTErr TTCurve::WriteAsSnapshot(const TTValue& inputValue, TTValue& outputValue)
+{
+    if (inputValue.size() != 1 || inputValue[0].type() != kTypePointer)
+        return kTTErrGeneric;
+    
+    TTScoreSnapshotWriterPtr    aWriter = TTScoreSnapshotWriterPtr(TTPtr(inputValue[0]));
+    TTScoreSnapshotCurve        record;
+    std::vector<TTFloat64>      floats;
+    TTValue                     v;
+    
+    record.address = 0;
+    record.active = mActive;
+    record.redundancy = mRedundancy;
+    record.recorded = mRecorded;
+    record.sampleRate = mSampleRate;
+    record.functionFirst = 0;
+    record.functionCount = 0;
+    
+    if (!mRecorded && !getFunctionParameters(v)) {
+        
+        for (TTUInt32 i = 0; i < v.size(); i++)
+            floats.push_back(v[i]);
+        
+        record.functionFirst = aWriter->addFloats(floats.data(), floats.size());
+        record.functionCount = floats.size();
+    }
+    
+    // store the points only if they are sampled (a record based curve is always)
+    floats.clear();
+    if (mRecorded || mSampled) {
+        
+        floats.reserve(mList.getSize() * 2);
+        for (mList.begin(); mList.end(); mList.next()) {
+            floats.push_back(mList.current()[0]);
+            floats.push_back(mList.current()[1]);
+        }
+    }
+    
+    record.sampleFirst = aWriter->addFloats(floats.data(), floats.size());
+    record.sampleCount = floats.size();
+    
+    outputValue = aWriter->append(kTTScoreSnapshotCurves, record);
+    
+    return kTTErrNone;
+}
+
+TTErr TTCurve::ReadFromSnapshot(const TTValue& inputValue, TTValue& outputValue)
+{
+    if (inputValue.size() != 2 || inputValue[0].type() != kTypePointer)
+        return kTTErrGeneric;
+    
+    TTScoreSnapshotReaderPtr    aReader = TTScoreSnapshotReaderPtr(TTPtr(inputValue[0]));
+    TTUInt32                    index = inputValue[1];
+    const TTFloat64*            floats;
+    TTValue                     v;
+    
+    if (!aReader->contains(kTTScoreSnapshotCurves, index, 1))
+        return kTTErrGeneric;
+    
+    const TTScoreSnapshotCurve& record = aReader->records<TTScoreSnapshotCurve>(kTTScoreSnapshotCurves)[index];
+    
+    mActive = record.active != 0;
+    mRedundancy = record.redundancy != 0;
+    mSampleRate = record.sampleRate ? record.sampleRate : 20;
+    mRecorded = record.recorded != 0;
+    
+    // set the function without sampling it as the points are empty
+    mList.clear();
+    clearOverview();
+    
+    if (!mRecorded && record.functionCount) {
+        
+        floats = aReader->floats(record.functionFirst, record.functionCount);
+        if (!floats)
+            return kTTErrGeneric;
+        
+        v.resize(record.functionCount);
+        for (TTUInt32 i = 0; i < record.functionCount; i++)
+            v[i] = floats[i];
+        
+        setFunctionParameters(v);
+    }
+    
+    // then restore the sampled points
+    floats = aReader->floats(record.sampleFirst, record.sampleCount);
+    if (!floats)
+        return kTTErrGeneric;
+    
+    for (TTUInt32 i = 0; i + 1 < record.sampleCount; i = i+2)
+        mList.append(TTValue(floats[i], floats[i+1]));
+    
+    mSampled = mList.getSize() > 0;
+    
+    return kTTErrNone;
+}
+
 
 #if 0
 #pragma mark -
 #pragma mark Some Functions
 #endif
 
+TTFloat64 TTCurveVerticalError(TTFloat64 x1, TTFloat64 y1, TTFloat64 x2, TTFloat64 y2, TTFloat64 x, TTFloat64 y)
+{
+    if (x2 == x1)
+        return fabs(y - y1);
+    
+    return fabs(y - (y1 + (y2 - y1) * (x - x1) / (x2 - x1)));
+}
+
 TTErr TTCurveNextSampleAt(TTCurve* aCurve, TTFloat64& x, TTFloat64& y)
 {
     if (aCurve->mActive)
@@ -513,3 +1200,447 @@ TTErr TTCurveNextSampleAt(TTCurve* aCurve, TTFloat64& x, TTFloat64& y)
     
     return kTTErrValueNotFound;
 }
+
+TTErr TTCurveInterpolatedSampleAt(TTCurve* aCurve, TTFloat64& x, TTFloat64& y)
+{
+    if (aCurve->mActive)
+    {
+        TTFloat64 currentX, currentY;
+        
+        // while the list doesn't reach the end
+        while (aCurve->mList.end())
+        {
+            currentX = aCurve->mList.current()[0];
+            currentY = aCurve->mList.current()[1];
+            
+            if (currentX < x)
+            {
+                // remember the point before x
+                aCurve->mPreviousX = currentX;
+                aCurve->mPreviousY = currentY;
+                aCurve->mPreviousValid = YES;
+                
+                aCurve->mList.next();
+            }
+            else
+            {
+                if (aCurve->mPreviousValid && currentX > aCurve->mPreviousX)
+                    y = aCurve->mPreviousY + (currentY - aCurve->mPreviousY) * (x - aCurve->mPreviousX) / (currentX - aCurve->mPreviousX);
+                else
+                    y = currentY;
+                
+                return kTTErrNone;
+            }
+        }
+    }
+    
+    return kTTErrValueNotFound;
+}
+
+// each thread loads its own score
+static thread_local TTCurveSampler* sCurrentSampler = NULL;
+
+TTCurveSampler* TTCurveSampler::current()
+{
+    return sCurrentSampler;
+}
+
+void TTCurveSampler::setCurrent(TTCurveSampler* aSampler)
+{
+    sCurrentSampler = aSampler;
+}
+
+void TTCurveSampler::add(TTCurvePtr aCurve, TTUInt32 duration)
+{
+    if (aCurve)
+        mCurves.push_back(std::make_pair(aCurve, duration));
+}
+
+void TTCurveSampler::run()
+{
+    std::vector<TTUInt32>                   calculated;
+    std::vector<TTUInt32>                   nbPoints;
+    std::vector<std::vector<TTFloat64> >    samples;
+    TTValue                                 none;
+    TTUInt32                                i;
+    unsigned int                            nbThreads = std::thread::hardware_concurrency();
+    
+    // only the function based curves not sampled yet are calculated,
+    // the points of the other curves are only read so they are sampled here
+    for (i = 0; i < mCurves.size(); i++)
+    {
+        TTCurvePtr  curve = mCurves[i].first;
+        TTUInt32    size = mCurves[i].second / curve->mSampleRate;
+        
+        if (curve->mRecorded || (curve->mSampled && size == curve->mList.getSize()))
+            curve->Sample(TTValue(mCurves[i].second), none);
+        else
+        {
+            calculated.push_back(i);
+            nbPoints.push_back(size);
+        }
+    }
+    
+    if (nbThreads > calculated.size())
+        nbThreads = calculated.size();
+    
+    if (calculated.size() < TTCURVE_SAMPLER_PARALLEL_CURVES || nbThreads < 2)
+    {
+        for (i = 0; i < calculated.size(); i++)
+            mCurves[calculated[i]].first->Sample(TTValue(mCurves[calculated[i]].second), none);
+    }
+    else
+    {
+        std::atomic<unsigned int> next(0);
+        std::vector<std::thread> threads;
+        
+        samples.resize(calculated.size());
+        
+        // the threads don't touch the lists of the curves (nor any TTValue) : they only fill their own vectors
+        for (unsigned int t = 0; t < nbThreads; t++)
+            threads.push_back(std::thread([this, &calculated, &nbPoints, &samples, &next]()
+            {
+                unsigned int j;
+                
+                while ((j = next++) < calculated.size())
+                    mCurves[calculated[j]].first->calculateSamples(nbPoints[j], samples[j]);
+            }));
+        
+        for (unsigned int t = 0; t < threads.size(); t++)
+            threads[t].join();
+        
+        // then the curves are filled on the calling thread
+        for (i = 0; i < calculated.size(); i++)
+            mCurves[calculated[i]].first->setSamples(samples[i]);
+    }
+    
+    mCurves.clear();
+}
+
+TTCurveSampleFile::TTCurveSampleFile() :
+mFile(NULL),
+mColumns(0),
+mRowSize(0),
+mBegin(0),
+mEnd(0)
+{
+    ;
+}
+
+TTCurveSampleFile::~TTCurveSampleFile()
+{
+    close();
+}
+
+TTErr TTCurveSampleFile::open(const TTString& path, TTSymbol format, TTUInt32 columns)
+{
+    close();
+    
+    if (format == TTSymbol("csv"))
+        mRowSize = 0;
+    
+    else if (format == TTSymbol("float32"))
+        mRowSize = columns * sizeof(TTFloat32);
+    
+    else if (format == TTSymbol("float64"))
+        mRowSize = columns * sizeof(TTFloat64);
+    
+    else
+        return kTTErrGeneric;
+    
+    // a binary row have to fit into a chunk
+    if (format != TTSymbol("csv") && (mRowSize == 0 || mRowSize > TTCURVE_IMPORT_CHUNK_SIZE))
+        return kTTErrGeneric;
+    
+    mFile = fopen(path.c_str(), "rb");
+    if (!mFile)
+        return kTTErrGeneric;
+    
+    mFormat = format;
+    mColumns = columns;
+    
+    mChunk.resize(TTCURVE_IMPORT_CHUNK_SIZE + 1);
+    mBegin = 0;
+    mEnd = 0;
+    mChunk[0] = 0;
+    
+    return kTTErrNone;
+}
+
+void TTCurveSampleFile::close()
+{
+    if (mFile)
+        fclose(mFile);
+    
+    mFile = NULL;
+    mBegin = 0;
+    mEnd = 0;
+    
+    std::vector<char>().swap(mChunk);
+}
+
+TTSymbol TTCurveSampleFile::format(const TTString& path)
+{
+    std::string extension(path.c_str());
+    size_t      dot = extension.find_last_of('.');
+    
+    extension = dot == std::string::npos ? std::string() : extension.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    
+    if (extension == "csv" || extension == "txt")
+        return TTSymbol("csv");
+    
+    if (extension == "f32")
+        return TTSymbol("float32");
+    
+    return TTSymbol("float64");
+}
+
+TTBoolean TTCurveSampleFile::fill()
+{
+    size_t read = 0;
+    
+    if (!mFile)
+        return NO;
+    
+    if (mBegin > 0)
+    {
+        memmove(&mChunk[0], &mChunk[mBegin], mEnd - mBegin);
+        mEnd -= mBegin;
+        mBegin = 0;
+    }
+    
+    if (mEnd < TTCURVE_IMPORT_CHUNK_SIZE)
+        read = fread(&mChunk[mEnd], 1, TTCURVE_IMPORT_CHUNK_SIZE - mEnd, mFile);
+    
+    mEnd += read;
+    mChunk[mEnd] = 0;
+    
+    return read > 0;
+}
+
+TTBoolean TTCurveSampleFile::next(std::vector<TTFloat64>& row)
+{
+    if (!mFile)
+        return NO;
+    
+    // binary rows
+    if (mRowSize)
+    {
+        while (mEnd - mBegin < mRowSize)
+            if (!fill())
+                return NO;
+        
+        const char* data = &mChunk[mBegin];
+        
+        row.resize(mColumns);
+        
+        for (TTUInt32 i = 0; i < mColumns; i++)
+        {
+            if (mFormat == TTSymbol("float32"))
+            {
+                TTFloat32 value;
+                memcpy(&value, data + i * sizeof(TTFloat32), sizeof(TTFloat32));
+                row[i] = value;
+            }
+            else
+                memcpy(&row[i], data + i * sizeof(TTFloat64), sizeof(TTFloat64));
+        }
+        
+        mBegin += mRowSize;
+        
+        return YES;
+    }
+    
+    // csv lines
+    while (YES)
+    {
+        const char* line = &mChunk[mBegin];
+        const char* end = (const char*)memchr(line, '\n', mEnd - mBegin);
+        size_t      lineEnd;
+        
+        if (!end)
+        {
+            // the line continues into the next chunk (unless it fills the whole chunk)
+            if (mEnd - mBegin < TTCURVE_IMPORT_CHUNK_SIZE && fill())
+                continue;
+            
+            // the last line of the file (fill moved it at the beginning of the chunk)
+            if (mBegin == mEnd)
+                return NO;
+            
+            line = &mChunk[mBegin];
+            end = &mChunk[mEnd];
+        }
+        
+        lineEnd = end - &mChunk[0];
+        mBegin = lineEnd < mEnd ? lineEnd + 1 : mEnd;
+        
+        if (parse(line, end, row))
+            return YES;
+    }
+}
+
+TTBoolean TTCurveSampleFile::parse(const char* line, const char* end, std::vector<TTFloat64>& row)
+{
+    char*       number;
+    TTFloat64   value;
+    
+    row.clear();
+    
+    while (YES)
+    {
+        while (line < end && (*line == ',' || *line == ';' || *line == ' ' || *line == '\t' || *line == '\r'))
+            line++;
+        
+        if (line >= end)
+            break;
+        
+        // the line ends with a newline or with the ending zero of the chunk so the number can't go beyond it
+        value = strtod(line, &number);
+        
+        if (number == line)
+            return NO;
+        
+        row.push_back(value);
+        line = number;
+    }
+    
+    return !row.empty();
+}
+
+/** Simplify the points kept by an import until half of them are removed
+ @param aCurve          a curve being imported
+ @param tolerance       the tolerance of the curve, doubled each time the points are simplified
+ @param range           the range of the values read so far */
+static void TTCurveImportReduce(TTCurvePtr aCurve, TTFloat64& tolerance, TTFloat64 range)
+{
+    aCurve->simplify(tolerance);
+    
+    while (aCurve->mList.getSize() > TTCURVE_IMPORT_POINTS_MAX / 2)
+    {
+        if (tolerance > 0.)
+            tolerance *= 2.;
+        else
+            tolerance = std::max(range * TTCURVE_IMPORT_TOLERANCE_RATIO, std::numeric_limits<TTFloat64>::min());
+        
+        aCurve->simplify(tolerance);
+    }
+}
+
+TTErr TTCurveImport(std::vector<TTCurvePtr>& curves, TTCurveSampleFile& aFile, TTInt32 xColumn, TTUInt32 firstColumn, TTFloat64 tolerance, TTUInt64& rows)
+{
+    std::vector<TTFloat64>  row, pointsX, pointsY;
+    std::vector<TTFloat64>  tolerances(curves.size(), std::max(tolerance, 0.)), minY(curves.size()), maxY(curves.size());
+    std::vector<TTUInt32>   yColumns;
+    TTUInt32                i, j, needed;
+    TTFloat64               x, y, firstX = 0., lastX = 0.;
+    TTBoolean               valid;
+    
+    rows = 0;
+    
+    if (curves.empty())
+        return kTTErrGeneric;
+    
+    // the columns of the curves skip the x column
+    for (i = firstColumn; yColumns.size() < curves.size(); i++)
+        if (TTInt32(i) != xColumn)
+            yColumns.push_back(i);
+    
+    needed = std::max(TTInt32(yColumns.back()), xColumn) + 1;
+    
+    for (i = 0; i < curves.size(); i++)
+    {
+        curves[i]->mList.clear();
+        curves[i]->clearOverview();
+    }
+    
+    while (aFile.next(row))
+    {
+        if (row.size() < needed)
+            continue;
+        
+        x = xColumn < 0 ? TTFloat64(rows) : row[xColumn];
+        
+        // ignore the gaps and the rows which go back in time
+        valid = std::isfinite(x) && (rows == 0 || x > lastX);
+        
+        for (i = 0; i < yColumns.size() && valid; i++)
+            valid = std::isfinite(row[yColumns[i]]);
+        
+        if (!valid)
+            continue;
+        
+        if (rows == 0)
+        {
+            firstX = x;
+            
+            for (i = 0; i < curves.size(); i++)
+            {
+                minY[i] = maxY[i] = row[yColumns[i]];
+                curves[i]->recordStart(x, row[yColumns[i]]);
+            }
+        }
+        else
+        {
+            for (i = 0; i < curves.size(); i++)
+            {
+                y = row[yColumns[i]];
+                minY[i] = std::min(minY[i], y);
+                maxY[i] = std::max(maxY[i], y);
+                
+                if (tolerance < 0.)
+                    tolerances[i] = std::max(tolerances[i], (maxY[i] - minY[i]) * TTCURVE_IMPORT_TOLERANCE_RATIO);
+                
+                curves[i]->record(x, y, tolerances[i]);
+                
+                // the memory stays bounded whatever the data is
+                if (curves[i]->mList.getSize() > TTCURVE_IMPORT_POINTS_MAX)
+                    TTCurveImportReduce(curves[i], tolerances[i], maxY[i] - minY[i]);
+            }
+        }
+        
+        lastX = x;
+        rows++;
+    }
+    
+    aFile.close();
+    
+    if (rows == 0)
+        return kTTErrGeneric;
+    
+    for (i = 0; i < curves.size(); i++)
+    {
+        TTCurvePtr aCurve = curves[i];
+        
+        aCurve->recordEnd();
+        
+        pointsX.clear();
+        pointsY.clear();
+        for (aCurve->mList.begin(); aCurve->mList.end(); aCurve->mList.next())
+        {
+            pointsX.push_back(TTFloat64(aCurve->mList.current()[0]));
+            pointsY.push_back(TTFloat64(aCurve->mList.current()[1]));
+        }
+        
+        // normalize the x between [0. :: 1.]
+        aCurve->mList.clear();
+        
+        if (rows == 1)
+        {
+            aCurve->mList.append(TTValue(0., pointsY[0]));
+            aCurve->mList.append(TTValue(1., pointsY[0]));
+        }
+        else
+        {
+            for (j = 0; j < pointsX.size(); j++)
+                aCurve->mList.append(TTValue((pointsX[j] - firstX) / (lastX - firstX), pointsY[j]));
+        }
+        
+        aCurve->clearOverview();
+        aCurve->mRecorded = YES;
+        aCurve->mSampled = YES;
+    }
+    
+    return kTTErrNone;
+}
@@ -0,0 +1,232 @@
+/** @file
+ *
+ * @ingroup scoreLibrary
+ *
+ * @brief binary encoding tools used to store large data into score files
+ *
+ * @see TTCurve
+ *
+ * @authors Théo de la Hogue & Clément Bossut
+ *
+ * @copyright Copyright © 2013, Théo de la Hogue & Clément Bossut @n
+ * This code is licensed under the terms of the "CeCILL-C" @n
+ * http://www.cecill.info
+ */
+
+#include "TTScoreEncoding.h"
+
+#include <string.h>
+
+static const char TTScoreBase64Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static TTUInt64 TTScoreFloat64ToBits(TTFloat64 value)
+{
+    TTUInt64 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static TTFloat64 TTScoreBitsToFloat64(TTUInt64 bits)
+{
+    TTFloat64 value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static TTInt32 TTScoreBase64Index(char c)
+{
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+') return 62;
+    if (c == '/') return 63;
+    return -1;
+}
+
+void TTScoreBufferAppendVarint(TTScoreBuffer& buffer, TTUInt64 value)
+{
+    while (value >= 0x80)
+    {
+        buffer.push_back((unsigned char)(value | 0x80));
+        value >>= 7;
+    }
+    
+    buffer.push_back((unsigned char)value);
+}
+
+TTBoolean TTScoreBufferReadVarint(const TTScoreBuffer& buffer, TTUInt32& offset, TTUInt64& value)
+{
+    TTUInt32 shift = 0;
+    
+    value = 0;
+    while (offset < buffer.size() && shift < 64)
+    {
+        unsigned char byte = buffer[offset++];
+        
+        value |= TTUInt64(byte & 0x7F) << shift;
+        
+        if (!(byte & 0x80))
+            return YES;
+        
+        shift += 7;
+    }
+    
+    return NO;
+}
+
+void TTScoreBufferAppendFloat64(TTScoreBuffer& buffer, TTFloat64 value)
+{
+    TTUInt64 bits = TTScoreFloat64ToBits(value);
+    
+    for (TTUInt32 i = 0; i < 8; i++)
+        buffer.push_back((unsigned char)(bits >> (8 * i)));
+}
+
+TTBoolean TTScoreBufferReadFloat64(const TTScoreBuffer& buffer, TTUInt32& offset, TTFloat64& value)
+{
+    TTUInt64 bits = 0;
+    
+    if (offset + 8 > buffer.size())
+        return NO;
+    
+    for (TTUInt32 i = 0; i < 8; i++)
+        bits |= TTUInt64(buffer[offset++]) << (8 * i);
+    
+    value = TTScoreBitsToFloat64(bits);
+    return YES;
+}
+
+void TTScoreBufferAppendFloat64Xor(TTScoreBuffer& buffer, TTFloat64 value, TTUInt64& previous)
+{
+    TTUInt64 bits = TTScoreFloat64ToBits(value);
+    TTUInt64 difference = bits ^ previous;
+    TTUInt32 leading = 0, trailing = 0, size;
+    
+    previous = bits;
+    
+    // the same value : only a null control byte
+    if (!difference) {
+        buffer.push_back(0);
+        return;
+    }
+    
+    while (!((difference >> (8 * trailing)) & 0xFF))
+        trailing++;
+    
+    while (!((difference >> (8 * (7 - leading))) & 0xFF))
+        leading++;
+    
+    // control byte : the number of written bytes then the number of trailing null bytes
+    size = 8 - leading - trailing;
+    buffer.push_back((unsigned char)((size << 4) | trailing));
+    
+    for (TTUInt32 i = 0; i < size; i++)
+        buffer.push_back((unsigned char)(difference >> (8 * (trailing + i))));
+}
+
+TTBoolean TTScoreBufferReadFloat64Xor(const TTScoreBuffer& buffer, TTUInt32& offset, TTFloat64& value, TTUInt64& previous)
+{
+    TTUInt64 difference = 0;
+    TTUInt32 size, trailing;
+    
+    if (offset >= buffer.size())
+        return NO;
+    
+    size = buffer[offset] >> 4;
+    trailing = buffer[offset] & 0x0F;
+    offset++;
+    
+    if (size + trailing > 8 || (!size && trailing))
+        return NO;
+    
+    if (offset + size > buffer.size())
+        return NO;
+    
+    for (TTUInt32 i = 0; i < size; i++)
+        difference |= TTUInt64(buffer[offset++]) << (8 * (trailing + i));
+    
+    previous ^= difference;
+    
+    value = TTScoreBitsToFloat64(previous);
+    return YES;
+}
+
+void TTScoreBase64Encode(const TTScoreBuffer& buffer, TTString& text)
+{
+    TTUInt32 i, size = buffer.size();
+    
+    text.clear();
+    text.reserve(((size + 2) / 3) * 4);
+    
+    for (i = 0; i + 2 < size; i = i+3)
+    {
+        TTUInt32 triple = (buffer[i] << 16) | (buffer[i+1] << 8) | buffer[i+2];
+        
+        text += TTScoreBase64Alphabet[(triple >> 18) & 0x3F];
+        text += TTScoreBase64Alphabet[(triple >> 12) & 0x3F];
+        text += TTScoreBase64Alphabet[(triple >> 6) & 0x3F];
+        text += TTScoreBase64Alphabet[triple & 0x3F];
+    }
+    
+    if (i < size)
+    {
+        TTUInt32 triple = buffer[i] << 16;
+        
+        if (i + 1 < size)
+            triple |= buffer[i+1] << 8;
+        
+        text += TTScoreBase64Alphabet[(triple >> 18) & 0x3F];
+        text += TTScoreBase64Alphabet[(triple >> 12) & 0x3F];
+        text += i + 1 < size ? TTScoreBase64Alphabet[(triple >> 6) & 0x3F] : '=';
+        text += '=';
+    }
+}
+
+TTBoolean TTScoreBase64Decode(const char* text, TTScoreBuffer& buffer)
+{
+    TTUInt32 quad = 0, count = 0, padding = 0;
+    
+    buffer.clear();
+    
+    if (!text)
+        return NO;
+    
+    buffer.reserve((strlen(text) / 4) * 3);
+    
+    for (const char* c = text; *c; c++)
+    {
+        if (*c == ' ' || *c == '\n' || *c == '\r' || *c == '\t')
+            continue;
+        
+        if (*c == '=')
+        {
+            padding++;
+            quad = quad << 6;
+        }
+        else
+        {
+            TTInt32 index = TTScoreBase64Index(*c);
+            
+            // no data is allowed after the padding
+            if (index < 0 || padding)
+                return NO;
+            
+            quad = (quad << 6) | index;
+        }
+        
+        if (++count == 4)
+        {
+            if (padding > 2)
+                return NO;
+            
+            buffer.push_back((unsigned char)(quad >> 16));
+            if (padding < 2) buffer.push_back((unsigned char)(quad >> 8));
+            if (padding < 1) buffer.push_back((unsigned char)quad);
+            
+            quad = 0;
+            count = 0;
+        }
+    }
+    
+    return count == 0;
+}
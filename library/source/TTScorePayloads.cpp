@@ -0,0 +1,177 @@
+/** @file
+ *
+ * @ingroup scoreLibrary
+ *
+ * @brief share the payloads which are repeated in a score file (identical states, identical curves)
+ *
+ * @see TTScorePayloads.h
+ *
+ * @authors Théo de la Hogue & Clément Bossut
+ *
+ * @copyright Copyright © 2013, Théo de la Hogue & Clément Bossut @n
+ * This code is licensed under the terms of the "CeCILL-C" @n
+ * http://www.cecill.info
+ */
+
+#include "TTScorePayloads.h"
+
+#include <string.h>
+
+// each thread writes or reads its own file
+static thread_local TTScorePayloads* sCurrentPayloads = NULL;
+
+/** Get the key of a payload (64 bits FNV-1a hash of its content)
+ @details 0 is never returned as it means a payload which is not shared */
+static TTUInt64 TTScorePayloadsKey(const std::string& content)
+{
+    TTUInt64 key = 0xcbf29ce484222325ULL;
+
+    for (size_t i = 0; i < content.size(); i++) {
+
+        key ^= (unsigned char)content[i];
+        key *= 0x100000001b3ULL;
+    }
+
+    return key ? key : 1;
+}
+
+/** Append the bytes of a number to the content of a payload */
+template<class Number>
+static void TTScorePayloadsAppend(std::string& content, char type, Number number)
+{
+    content.push_back(type);
+    content.append((const char*)&number, sizeof(Number));
+}
+
+void TTScorePayloads::appendValue(std::string& content, const TTValue& value)
+{
+    TTSymbol s;
+
+    TTScorePayloadsAppend(content, 'n', TTUInt32(value.size()));
+
+    for (TTUInt32 i = 0; i < value.size(); i++) {
+
+        const TTElement& element = value[i];
+
+        switch (element.type()) {
+
+            case kTypeFloat32 :     TTScorePayloadsAppend(content, 'f', TTFloat32(element));   break;
+            case kTypeFloat64 :     TTScorePayloadsAppend(content, 'd', TTFloat64(element));   break;
+            case kTypeInt8 :        TTScorePayloadsAppend(content, 'b', TTInt8(element));      break;
+            case kTypeUInt8 :       TTScorePayloadsAppend(content, 'B', TTUInt8(element));     break;
+            case kTypeInt16 :       TTScorePayloadsAppend(content, 'h', TTInt16(element));     break;
+            case kTypeUInt16 :      TTScorePayloadsAppend(content, 'H', TTUInt16(element));    break;
+            case kTypeInt32 :       TTScorePayloadsAppend(content, 'i', TTInt32(element));     break;
+            case kTypeUInt32 :      TTScorePayloadsAppend(content, 'I', TTUInt32(element));    break;
+            case kTypeInt64 :       TTScorePayloadsAppend(content, 'l', TTInt64(element));     break;
+            case kTypeUInt64 :      TTScorePayloadsAppend(content, 'L', TTUInt64(element));    break;
+            case kTypeBoolean :     TTScorePayloadsAppend(content, '?', TTUInt8(TTBoolean(element))); break;
+
+            case kTypeSymbol :
+            {
+                s = element;
+                content.push_back('s');
+                content.append(s.c_str());
+                content.push_back(0);
+                break;
+            }
+
+            // an element which can't be compared by content (object, pointer, ...)
+            default :
+            {
+                TTScorePayloadsAppend(content, 'p', TTPtr(&element));
+                break;
+            }
+        }
+    }
+}
+
+void TTScorePayloads::formatKey(TTUInt64 key, char text[17])
+{
+    static const char digits[] = "0123456789abcdef";
+
+    for (TTInt32 i = 15; i >= 0; i--) {
+
+        text[i] = digits[key & 0xF];
+        key >>= 4;
+    }
+
+    text[16] = 0;
+}
+
+TTBoolean TTScorePayloads::parseKey(const char* text, TTUInt64& key)
+{
+    if (!text || strlen(text) != 16)
+        return NO;
+
+    key = 0;
+
+    for (TTUInt32 i = 0; i < 16; i++) {
+
+        char c = text[i];
+
+        key <<= 4;
+
+        if (c >= '0' && c <= '9')
+            key |= TTUInt64(c - '0');
+        else if (c >= 'a' && c <= 'f')
+            key |= TTUInt64(c - 'a' + 10);
+        else
+            return NO;
+    }
+
+    return key != 0;
+}
+
+TTBoolean TTScorePayloads::written(const std::string& content, TTUInt64& key)
+{
+    key = TTScorePayloadsKey(content);
+
+    std::unordered_map<TTUInt64, std::string>::const_iterator it = mWritten.find(key);
+
+    if (it == mWritten.end()) {
+
+        mWritten[key] = content;
+        return NO;
+    }
+
+    if (it->second == content)
+        return YES;
+
+    // another payload have the same key
+    key = 0;
+    return NO;
+}
+
+void TTScorePayloads::setHolder(TTUInt64 key, TTObject& anObject)
+{
+    // the first object read with the payload holds it
+    if (mHolders.find(key) == mHolders.end())
+        mHolders[key] = anObject;
+}
+
+TTObject TTScorePayloads::holder(TTUInt64 key) const
+{
+    std::unordered_map<TTUInt64, TTObject>::const_iterator it = mHolders.find(key);
+
+    if (it != mHolders.end())
+        return it->second;
+
+    return TTObject();
+}
+
+void TTScorePayloads::clear()
+{
+    mWritten.clear();
+    mHolders.clear();
+}
+
+TTScorePayloads* TTScorePayloads::current()
+{
+    return sCurrentPayloads;
+}
+
+void TTScorePayloads::setCurrent(TTScorePayloads* aPayloads)
+{
+    sCurrentPayloads = aPayloads;
+}
@@ -0,0 +1,159 @@
+/** @file
+ *
+ * @ingroup scoreLibrary
+ *
+ * @brief measure where the time goes while a score is loaded or saved
+ *
+ * @see TTScoreProfiler.h
+ *
+ * @authors Théo de la Hogue & Clément Bossut
+ *
+ * @copyright Copyright © 2013, Théo de la Hogue & Clément Bossut @n
+ * This code is licensed under the terms of the "CeCILL-C" @n
+ * http://www.cecill.info
+ */
+
+#include "TTScoreProfiler.h"
+
+#include <algorithm>
+
+static const char* sPhaseNames[kTTScoreProfilerPhaseCount] = {"file", "objects", "solver", "sampling", "flattening"};
+
+// each thread loads or saves its own score
+static thread_local TTScoreProfiler* sCurrentProfiler = NULL;
+
+/** Compare two measures to sort the slowest first */
+static bool TTScoreProfilerSlower(const std::pair<TTPtr, TTFloat64>& a, const std::pair<TTPtr, TTFloat64>& b)
+{
+    return a.second > b.second;
+}
+
+TTScoreProfiler::TTScoreProfiler() :
+mTotal(0.)
+{
+    for (TTUInt32 i = 0; i < kTTScoreProfilerPhaseCount; i++)
+        mPhases[i] = 0.;
+}
+
+void TTScoreProfiler::start()
+{
+    mTotal = 0.;
+
+    for (TTUInt32 i = 0; i < kTTScoreProfilerPhaseCount; i++)
+        mPhases[i] = 0.;
+
+    mTypes.clear();
+    mObjects.clear();
+    mFrames.clear();
+
+    mStart = Clock::now();
+}
+
+void TTScoreProfiler::stop()
+{
+    mTotal = std::chrono::duration<double, std::milli>(Clock::now() - mStart).count();
+
+    // the file is parsed or written during the time which is not spent by the other phases
+    TTFloat64 measured = 0.;
+
+    for (TTUInt32 i = kTTScoreProfilerFile + 1; i < kTTScoreProfilerPhaseCount; i++)
+        measured += mPhases[i];
+
+    mPhases[kTTScoreProfilerFile] = std::max(0., mTotal - measured);
+    mFrames.clear();
+}
+
+void TTScoreProfiler::enter()
+{
+    Frame frame;
+
+    frame.start = Clock::now();
+    frame.inner = 0.;
+
+    mFrames.push_back(frame);
+}
+
+void TTScoreProfiler::leave(TTScoreProfilerPhase phase, TTSymbol type, TTPtr anObject, TTSymbol name, TTUInt32 count)
+{
+    if (mFrames.empty())
+        return;
+
+    TTFloat64 elapsed = std::chrono::duration<double, std::milli>(Clock::now() - mFrames.back().start).count();
+    TTFloat64 time = std::max(0., elapsed - mFrames.back().inner);
+
+    mFrames.pop_back();
+
+    // the outer measure doesn't count this time again
+    if (!mFrames.empty())
+        mFrames.back().inner += elapsed;
+
+    mPhases[phase] += time;
+
+    if (type == kTTSymEmpty)
+        return;
+
+    Measure& byType = mTypes[type.rawpointer()];
+    byType.type = type;
+    byType.time += time;
+    byType.count += count;
+
+    if (anObject) {
+
+        Measure& byObject = mObjects[anObject];
+        byObject.type = type;
+        byObject.name = name;
+        byObject.time += time;
+        byObject.count += count;
+    }
+}
+
+void TTScoreProfiler::report(TTValue& value, TTUInt32 slowest) const
+{
+    value.clear();
+    value.append(mTotal);
+
+    for (TTUInt32 i = 0; i < kTTScoreProfilerPhaseCount; i++) {
+
+        value.append(TTSymbol("phase"));
+        value.append(TTSymbol(sPhaseNames[i]));
+        value.append(mPhases[i]);
+    }
+
+    for (std::unordered_map<TTPtr, Measure>::const_iterator it = mTypes.begin(); it != mTypes.end(); ++it) {
+
+        value.append(TTSymbol("type"));
+        value.append(it->second.type);
+        value.append(it->second.time);
+        value.append(it->second.count);
+    }
+
+    // sort the objects by time only to keep the slowest ones
+    std::vector<std::pair<TTPtr, TTFloat64> > objects;
+    objects.reserve(mObjects.size());
+
+    for (std::unordered_map<TTPtr, Measure>::const_iterator it = mObjects.begin(); it != mObjects.end(); ++it)
+        objects.push_back(std::make_pair(it->first, it->second.time));
+
+    slowest = std::min(slowest, TTUInt32(objects.size()));
+    std::partial_sort(objects.begin(), objects.begin() + slowest, objects.end(), &TTScoreProfilerSlower);
+
+    for (TTUInt32 i = 0; i < slowest; i++) {
+
+        const Measure& measure = mObjects.find(objects[i].first)->second;
+
+        value.append(TTSymbol("object"));
+        value.append(measure.type);
+        value.append(measure.name);
+        value.append(measure.time);
+    }
+}
+
+TTScoreProfiler* TTScoreProfiler::current()
+{
+    return sCurrentProfiler;
+}
+
+void TTScoreProfiler::setCurrent(TTScoreProfiler* aProfiler)
+{
+    sCurrentProfiler = aProfiler;
+}
@@ -0,0 +1,757 @@
+/** @file
+ *
+ * @ingroup scoreLibrary
+ *
+ * @brief binary snapshot of a score loadable by mapping the file into memory
+ *
+ * @see TTScoreSnapshot.h
+ *
+ * @authors Théo de la Hogue & Clément Bossut
+ *
+ * @copyright Copyright © 2013, Théo de la Hogue & Clément Bossut @n
+ * This code is licensed under the terms of the "CeCILL-C" @n
+ * http://www.cecill.info
+ */
+
+#include "TTScoreSnapshot.h"
+#include "TTScorePayloads.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifndef TT_PLATFORM_WIN
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static TTUInt64 TTScoreSnapshotAlign(TTUInt64 offset)
+{
+    return (offset + 7) & ~TTUInt64(7);
+}
+
+/** Get the checksum of a journal frame (64 bits FNV-1a hash of its bytes) */
+static TTUInt64 TTScoreSnapshotChecksum(const TTUInt8* bytes, TTUInt64 size)
+{
+    TTUInt64 checksum = 0xcbf29ce484222325ULL;
+
+    for (TTUInt64 i = 0; i < size; i++) {
+        checksum ^= bytes[i];
+        checksum *= 0x100000001b3ULL;
+    }
+
+    return checksum;
+}
+
+/** Cut a file after its first bytes
+ @return                NO if the file can't be cut */
+static TTBoolean TTScoreSnapshotTruncate(const TTString& path, TTUInt64 size)
+{
+#ifdef TT_PLATFORM_WIN
+    HANDLE          file;
+    LARGE_INTEGER   end;
+    TTBoolean       done;
+
+    file = CreateFileA(path.c_str(), GENERIC_WRITE, 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return NO;
+
+    end.QuadPart = size;
+    done = SetFilePointerEx(file, end, NULL, FILE_BEGIN) && SetEndOfFile(file);
+
+    CloseHandle(file);
+    return done;
+#else
+    return truncate(path.c_str(), off_t(size)) == 0;
+#endif
+}
+
+TTScoreSnapshotWriter::TTScoreSnapshotWriter()
+{
+    mRecordSizes[kTTScoreSnapshotStrings] = sizeof(char);
+    mRecordSizes[kTTScoreSnapshotAtoms] = sizeof(TTScoreSnapshotAtom);
+    mRecordSizes[kTTScoreSnapshotFloats] = sizeof(TTFloat64);
+    mRecordSizes[kTTScoreSnapshotContainers] = sizeof(TTScoreSnapshotContainer);
+    mRecordSizes[kTTScoreSnapshotEvents] = sizeof(TTScoreSnapshotEvent);
+    mRecordSizes[kTTScoreSnapshotStateLines] = sizeof(TTScoreSnapshotStateLine);
+    mRecordSizes[kTTScoreSnapshotProcesses] = sizeof(TTScoreSnapshotProcess);
+    mRecordSizes[kTTScoreSnapshotConditions] = sizeof(TTScoreSnapshotCondition);
+    mRecordSizes[kTTScoreSnapshotCases] = sizeof(TTScoreSnapshotCase);
+    mRecordSizes[kTTScoreSnapshotCurves] = sizeof(TTScoreSnapshotCurve);
+    mRecordSizes[kTTScoreSnapshotRemovals] = sizeof(TTScoreSnapshotRemoval);
+
+    // the empty symbol is always at offset 0
+    addSymbol(kTTSymEmpty);
+}
+
+TTUInt32 TTScoreSnapshotWriter::addSymbol(TTSymbol aSymbol)
+{
+    std::string s(aSymbol.c_str());
+
+    std::unordered_map<std::string, TTUInt32>::iterator it = mStrings.find(s);
+    if (it != mStrings.end())
+        return it->second;
+
+    TTScoreBuffer& strings = mTables[kTTScoreSnapshotStrings];
+    TTUInt32 offset = strings.size();
+
+    strings.insert(strings.end(), s.begin(), s.end());
+    strings.push_back(0);
+
+    mStrings.emplace(s, offset);
+    return offset;
+}
+
+TTUInt32 TTScoreSnapshotWriter::addValue(const TTValue& value, TTUInt32& count)
+{
+    TTUInt32 first = size(kTTScoreSnapshotAtoms);
+
+    for (TTUInt32 i = 0; i < value.size(); i++) {
+
+        const TTElement&    element = value[i];
+        TTScoreSnapshotAtom atom;
+        TTSymbol            s;
+
+        atom.type = kTTScoreSnapshotAtomNone;
+        atom.string = 0;
+        atom.integer = 0;
+        atom.number = 0.;
+
+        switch (element.type()) {
+
+            case kTypeFloat32 :     atom.type = kTTScoreSnapshotAtomFloat32;   atom.number = TTFloat32(element);   break;
+            case kTypeFloat64 :     atom.type = kTTScoreSnapshotAtomFloat64;   atom.number = TTFloat64(element);   break;
+            case kTypeInt8 :        atom.type = kTTScoreSnapshotAtomInt8;      atom.integer = TTInt8(element);     break;
+            case kTypeUInt8 :       atom.type = kTTScoreSnapshotAtomUInt8;     atom.integer = TTUInt8(element);    break;
+            case kTypeInt16 :       atom.type = kTTScoreSnapshotAtomInt16;     atom.integer = TTInt16(element);    break;
+            case kTypeUInt16 :      atom.type = kTTScoreSnapshotAtomUInt16;    atom.integer = TTUInt16(element);   break;
+            case kTypeInt32 :       atom.type = kTTScoreSnapshotAtomInt32;     atom.integer = TTInt32(element);    break;
+            case kTypeUInt32 :      atom.type = kTTScoreSnapshotAtomUInt32;    atom.integer = TTUInt32(element);   break;
+            case kTypeInt64 :       atom.type = kTTScoreSnapshotAtomInt64;     atom.integer = TTInt64(element);    break;
+            case kTypeUInt64 :      atom.type = kTTScoreSnapshotAtomUInt64;    atom.integer = TTUInt64(element);   break;
+            case kTypeBoolean :     atom.type = kTTScoreSnapshotAtomBoolean;   atom.integer = TTBoolean(element);  break;
+            case kTypeSymbol :      atom.type = kTTScoreSnapshotAtomSymbol;    s = element; atom.string = addSymbol(s); break;
+            default :               break;
+        }
+
+        append(kTTScoreSnapshotAtoms, atom);
+    }
+
+    count = size(kTTScoreSnapshotAtoms) - first;
+    return first;
+}
+
+TTUInt32 TTScoreSnapshotWriter::addFloats(const TTFloat64* values, TTUInt32 count)
+{
+    TTScoreBuffer& floats = mTables[kTTScoreSnapshotFloats];
+    TTUInt32 first = size(kTTScoreSnapshotFloats);
+    std::string content;
+
+    // identical curves share their floats
+    if (count * sizeof(TTFloat64) >= TTSCORE_PAYLOAD_SHARED_SIZE) {
+
+        content.assign((const char*)values, count * sizeof(TTFloat64));
+
+        TTUInt32 shared = sharedRecords(kTTScoreSnapshotFloats, content);
+        if (shared != TTSCORE_SNAPSHOT_NONE)
+            return shared;
+
+        setSharedRecords(kTTScoreSnapshotFloats, content, first);
+    }
+
+    if (count) {
+        floats.resize(floats.size() + count * sizeof(TTFloat64));
+        memcpy(&floats[first * sizeof(TTFloat64)], values, count * sizeof(TTFloat64));
+    }
+
+    return first;
+}
+
+TTUInt32 TTScoreSnapshotWriter::sharedRecords(TTScoreSnapshotTable table, const std::string& content) const
+{
+    std::unordered_map<std::string, TTUInt32>::const_iterator it = mShared[table].find(content);
+
+    if (it != mShared[table].end())
+        return it->second;
+
+    return TTSCORE_SNAPSHOT_NONE;
+}
+
+void TTScoreSnapshotWriter::setSharedRecords(TTScoreSnapshotTable table, const std::string& content, TTUInt32 first)
+{
+    mShared[table][content] = first;
+}
+
+TTUInt32 TTScoreSnapshotWriter::size(TTScoreSnapshotTable table) const
+{
+    return mTables[table].size() / mRecordSizes[table];
+}
+
+void TTScoreSnapshotWriter::setEventIndex(TTObjectBasePtr anEvent, TTUInt32 index)
+{
+    mEvents[anEvent] = index;
+}
+
+TTUInt32 TTScoreSnapshotWriter::eventIndex(TTObjectBasePtr anEvent) const
+{
+    std::unordered_map<TTObjectBasePtr, TTUInt32>::const_iterator it = mEvents.find(anEvent);
+
+    if (it != mEvents.end())
+        return it->second;
+
+    return TTSCORE_SNAPSHOT_NONE;
+}
+
+void TTScoreSnapshotWriter::image(TTScoreBuffer& buffer) const
+{
+    TTScoreSnapshotHeader       header;
+    TTScoreSnapshotTableEntry   entries[kTTScoreSnapshotTableCount];
+    TTUInt64                    offset;
+
+    header.magic = TTSCORE_SNAPSHOT_MAGIC;
+    header.version = TTSCORE_SNAPSHOT_VERSION;
+    header.endianness = TTSCORE_SNAPSHOT_ENDIANNESS;
+    header.tableCount = kTTScoreSnapshotTableCount;
+
+    // place each table after the header and the table entries
+    offset = TTScoreSnapshotAlign(sizeof(header) + sizeof(entries));
+
+    for (TTUInt32 i = 0; i < kTTScoreSnapshotTableCount; i++) {
+
+        entries[i].offset = offset;
+        entries[i].count = size(TTScoreSnapshotTable(i));
+        entries[i].recordSize = mRecordSizes[i];
+
+        offset = TTScoreSnapshotAlign(offset + mTables[i].size());
+    }
+
+    // the padding between the tables is filled with zeros
+    buffer.assign(offset, 0);
+    memcpy(&buffer[0], &header, sizeof(header));
+    memcpy(&buffer[sizeof(header)], entries, sizeof(entries));
+
+    for (TTUInt32 i = 0; i < kTTScoreSnapshotTableCount; i++)
+        if (mTables[i].size())
+            memcpy(&buffer[entries[i].offset], &mTables[i][0], mTables[i].size());
+}
+
+TTErr TTScoreSnapshotWriter::write(const TTString& path, std::atomic<TTFloat64>* progress)
+{
+    TTScoreBuffer   buffer;
+    TTString        temporaryPath = path;
+    FILE*           file;
+    TTBoolean       written = YES;
+    size_t          offset, chunk;
+
+    image(buffer);
+
+    temporaryPath += ".tmp";
+
+    file = fopen(temporaryPath.c_str(), "wb");
+    if (!file)
+        return kTTErrGeneric;
+
+    for (offset = 0; offset < buffer.size() && written; offset += chunk) {
+
+        chunk = buffer.size() - offset;
+        if (chunk > TTSCORE_SNAPSHOT_WRITE_CHUNK)
+            chunk = TTSCORE_SNAPSHOT_WRITE_CHUNK;
+
+        written = fwrite(&buffer[offset], chunk, 1, file) == 1;
+
+        if (progress)
+            *progress = TTFloat64(offset + chunk) / TTFloat64(buffer.size());
+    }
+
+    if (fclose(file) != 0)
+        written = NO;
+
+    if (!written) {
+        remove(temporaryPath.c_str());
+        return kTTErrGeneric;
+    }
+
+#ifdef TT_PLATFORM_WIN
+    // rename doesn't replace an existing file on windows
+    if (!MoveFileExA(temporaryPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+#else
+    if (rename(temporaryPath.c_str(), path.c_str()) != 0) {
+#endif
+        remove(temporaryPath.c_str());
+        return kTTErrGeneric;
+    }
+
+    return kTTErrNone;
+}
+
+TTErr TTScoreSnapshotWriter::append(const TTString& path)
+{
+    TTScoreBuffer           buffer;
+    TTScoreSnapshotFrame    frame;
+    FILE*                   file;
+    long                    end;
+    TTBoolean               written;
+
+    image(buffer);
+    frame.size = buffer.size();
+    frame.checksum = TTScoreSnapshotChecksum(&buffer[0], buffer.size());
+
+    file = fopen(path.c_str(), "ab");
+    if (!file)
+        return kTTErrGeneric;
+
+    end = fseek(file, 0, SEEK_END) == 0 ? ftell(file) : -1;
+
+    written = end >= 0 && fwrite(&frame, sizeof(frame), 1, file) == 1 && fwrite(&buffer[0], buffer.size(), 1, file) == 1;
+
+    if (fclose(file) != 0)
+        written = NO;
+
+    // the next frames are not appended after a half written one
+    if (!written && end >= 0)
+        TTScoreSnapshotTruncate(path, end);
+
+    return written ? kTTErrNone : kTTErrGeneric;
+}
+
+
+TTScoreSnapshotBackgroundWriter::TTScoreSnapshotBackgroundWriter() :
+mProgress(0.),
+mDone(NO),
+mError(kTTErrNone)
+{
+    ;
+}
+
+TTScoreSnapshotBackgroundWriter::~TTScoreSnapshotBackgroundWriter()
+{
+    finish();
+}
+
+TTErr TTScoreSnapshotBackgroundWriter::start(TTScoreSnapshotWriter& aWriter, const TTString& path)
+{
+    if (busy())
+        return kTTErrGeneric;
+
+    mWriter = std::move(aWriter);
+    mPath = path;
+    mProgress = 0.;
+    mDone = NO;
+    mError = kTTErrNone;
+
+    mThread = std::thread([this]()
+    {
+        mError = mWriter.write(mPath, &mProgress);
+        mDone = YES;
+    });
+
+    return kTTErrNone;
+}
+
+TTErr TTScoreSnapshotBackgroundWriter::finish()
+{
+    if (!busy())
+        return kTTErrNone;
+
+    mThread.join();
+
+    // release the tables
+    mWriter = TTScoreSnapshotWriter();
+
+    return mError;
+}
+
+
+TTScoreSnapshotReader::TTScoreSnapshotReader() :
+mData(NULL),
+mSize(0),
+mMapped(NO),
+mLazy(NO)
+#ifdef TT_PLATFORM_WIN
+,mFile(INVALID_HANDLE_VALUE),
+mMapping(NULL)
+#endif
+{
+    memset(mTables, 0, sizeof(mTables));
+}
+
+TTScoreSnapshotReader::~TTScoreSnapshotReader()
+{
+    close();
+}
+
+TTErr TTScoreSnapshotReader::open(const TTString& path)
+{
+    close();
+
+#ifdef TT_PLATFORM_WIN
+    LARGE_INTEGER fileSize;
+
+    mFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (mFile == INVALID_HANDLE_VALUE)
+        return kTTErrGeneric;
+
+    if (!GetFileSizeEx(mFile, &fileSize) || fileSize.QuadPart == 0) {
+        close();
+        return kTTErrGeneric;
+    }
+
+    mMapping = CreateFileMappingA(mFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mMapping) {
+        close();
+        return kTTErrGeneric;
+    }
+
+    mData = (const unsigned char*)MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0);
+    if (!mData) {
+        close();
+        return kTTErrGeneric;
+    }
+
+    mSize = fileSize.QuadPart;
+#else
+    struct stat fileStatus;
+    int         fd = ::open(path.c_str(), O_RDONLY);
+    void*       data;
+
+    if (fd < 0)
+        return kTTErrGeneric;
+
+    if (fstat(fd, &fileStatus) != 0 || fileStatus.st_size == 0) {
+        ::close(fd);
+        return kTTErrGeneric;
+    }
+
+    data = mmap(NULL, fileStatus.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // the mapping stays valid once the file is closed
+    ::close(fd);
+
+    if (data == MAP_FAILED)
+        return kTTErrGeneric;
+
+    mData = (const unsigned char*)data;
+    mSize = fileStatus.st_size;
+#endif
+
+    mMapped = YES;
+
+    return check();
+}
+
+TTErr TTScoreSnapshotReader::open(const unsigned char* data, TTUInt64 size)
+{
+    close();
+
+    if (!data)
+        return kTTErrGeneric;
+
+    mData = data;
+    mSize = size;
+
+    return check();
+}
+
+TTErr TTScoreSnapshotReader::check()
+{
+    const TTScoreSnapshotHeader*     header;
+    const TTScoreSnapshotTableEntry* entries;
+    TTUInt32                         recordSizes[kTTScoreSnapshotTableCount] = {
+        sizeof(char),
+        sizeof(TTScoreSnapshotAtom),
+        sizeof(TTFloat64),
+        sizeof(TTScoreSnapshotContainer),
+        sizeof(TTScoreSnapshotEvent),
+        sizeof(TTScoreSnapshotStateLine),
+        sizeof(TTScoreSnapshotProcess),
+        sizeof(TTScoreSnapshotCondition),
+        sizeof(TTScoreSnapshotCase),
+        sizeof(TTScoreSnapshotCurve),
+        sizeof(TTScoreSnapshotRemoval)};
+
+    // check the header
+    if (mSize < sizeof(TTScoreSnapshotHeader) + sizeof(mTables)) {
+        close();
+        return kTTErrGeneric;
+    }
+
+    header = (const TTScoreSnapshotHeader*)mData;
+
+    if (header->magic != TTSCORE_SNAPSHOT_MAGIC ||
+        header->version != TTSCORE_SNAPSHOT_VERSION ||
+        header->endianness != TTSCORE_SNAPSHOT_ENDIANNESS ||
+        header->tableCount != kTTScoreSnapshotTableCount) {
+        close();
+        return kTTErrGeneric;
+    }
+
+    // check each table is inside the file and its records have the expected size
+    entries = (const TTScoreSnapshotTableEntry*)(mData + sizeof(TTScoreSnapshotHeader));
+
+    for (TTUInt32 i = 0; i < kTTScoreSnapshotTableCount; i++) {
+
+        if (entries[i].recordSize != recordSizes[i] ||
+            entries[i].offset % 8 != 0 ||
+            entries[i].offset > mSize ||
+            TTUInt64(entries[i].count) * entries[i].recordSize > mSize - entries[i].offset) {
+            close();
+            return kTTErrGeneric;
+        }
+
+        mTables[i] = entries[i];
+    }
+
+    // the strings table have to be terminated to read symbols safely
+    if (mTables[kTTScoreSnapshotStrings].count == 0 ||
+        records<char>(kTTScoreSnapshotStrings)[mTables[kTTScoreSnapshotStrings].count - 1] != 0) {
+        close();
+        return kTTErrGeneric;
+    }
+
+    mEvents.resize(mTables[kTTScoreSnapshotEvents].count);
+
+    return kTTErrNone;
+}
+
+void TTScoreSnapshotReader::close()
+{
+#ifdef TT_PLATFORM_WIN
+    if (mData && mMapped)
+        UnmapViewOfFile(mData);
+
+    if (mMapping)
+        CloseHandle(mMapping);
+
+    if (mFile != INVALID_HANDLE_VALUE)
+        CloseHandle(mFile);
+
+    mMapping = NULL;
+    mFile = INVALID_HANDLE_VALUE;
+#else
+    if (mData && mMapped)
+        munmap((void*)mData, mSize);
+#endif
+
+    mData = NULL;
+    mSize = 0;
+    mMapped = NO;
+    memset(mTables, 0, sizeof(mTables));
+    mEvents.clear();
+}
+
+TTUInt32 TTScoreSnapshotReader::size(TTScoreSnapshotTable table) const
+{
+    return mTables[table].count;
+}
+
+TTBoolean TTScoreSnapshotReader::contains(TTScoreSnapshotTable table, TTUInt32 first, TTUInt32 count) const
+{
+    return first <= mTables[table].count && count <= mTables[table].count - first;
+}
+
+TTSymbol TTScoreSnapshotReader::symbol(TTUInt32 offset) const
+{
+    if (offset >= mTables[kTTScoreSnapshotStrings].count)
+        return kTTSymEmpty;
+
+    return TTSymbol(records<char>(kTTScoreSnapshotStrings) + offset);
+}
+
+TTBoolean TTScoreSnapshotReader::value(TTUInt32 first, TTUInt32 count, TTValue& value) const
+{
+    const TTScoreSnapshotAtom* atoms;
+
+    value.clear();
+
+    if (!contains(kTTScoreSnapshotAtoms, first, count))
+        return NO;
+
+    atoms = records<TTScoreSnapshotAtom>(kTTScoreSnapshotAtoms) + first;
+
+    for (TTUInt32 i = 0; i < count; i++) {
+
+        switch (atoms[i].type) {
+
+            case kTTScoreSnapshotAtomFloat32 :  value.append(TTFloat32(atoms[i].number));   break;
+            case kTTScoreSnapshotAtomFloat64 :  value.append(TTFloat64(atoms[i].number));   break;
+            case kTTScoreSnapshotAtomInt8 :     value.append(TTInt8(atoms[i].integer));     break;
+            case kTTScoreSnapshotAtomUInt8 :    value.append(TTUInt8(atoms[i].integer));    break;
+            case kTTScoreSnapshotAtomInt16 :    value.append(TTInt16(atoms[i].integer));    break;
+            case kTTScoreSnapshotAtomUInt16 :   value.append(TTUInt16(atoms[i].integer));   break;
+            case kTTScoreSnapshotAtomInt32 :    value.append(TTInt32(atoms[i].integer));    break;
+            case kTTScoreSnapshotAtomUInt32 :   value.append(TTUInt32(atoms[i].integer));   break;
+            case kTTScoreSnapshotAtomInt64 :    value.append(TTInt64(atoms[i].integer));    break;
+            case kTTScoreSnapshotAtomUInt64 :   value.append(TTUInt64(atoms[i].integer));   break;
+            case kTTScoreSnapshotAtomBoolean :  value.append(TTBoolean(atoms[i].integer != 0)); break;
+            case kTTScoreSnapshotAtomSymbol :   value.append(symbol(atoms[i].string));      break;
+            default :                           break;
+        }
+    }
+
+    return YES;
+}
+
+const TTFloat64* TTScoreSnapshotReader::floats(TTUInt32 first, TTUInt32 count) const
+{
+    if (!contains(kTTScoreSnapshotFloats, first, count))
+        return NULL;
+
+    return records<TTFloat64>(kTTScoreSnapshotFloats) + first;
+}
+
+void TTScoreSnapshotReader::setEvent(TTUInt32 index, TTObject& anEvent)
+{
+    if (index < mEvents.size())
+        mEvents[index] = anEvent;
+}
+
+TTObject TTScoreSnapshotReader::event(TTUInt32 index) const
+{
+    if (index < mEvents.size())
+        return mEvents[index];
+
+    return TTObject();
+}
+
+
+TTBoolean TTScoreSnapshotPending::defer(TTScoreSnapshotReader& aReader, TTUInt32 index)
+{
+    if (!aReader.lazy())
+        return NO;
+
+    mReader = aReader.shared_from_this();
+    mIndex = index;
+
+    return YES;
+}
+
+TTBoolean TTScoreSnapshotPending::take(std::shared_ptr<TTScoreSnapshotReader>& aReader, TTUInt32& index)
+{
+    if (!mReader)
+        return NO;
+
+    aReader = mReader;
+    index = mIndex;
+    clear();
+
+    return YES;
+}
+
+
+TTUInt32 TTScoreSnapshotWriteProcess(TTScoreSnapshotWriter& aWriter, TTObject& aTimeProcess, TTUInt32 start, TTUInt32 end)
+{
+    TTScoreSnapshotProcess  record;
+    TTValue                 v;
+
+    memset(&record, 0, sizeof(record));
+
+    record.type = aWriter.addSymbol(aTimeProcess.name());
+
+    aTimeProcess.get(kTTSym_name, v);
+    record.name = aWriter.addSymbol(v[0]);
+
+    record.start = start;
+    record.end = end;
+
+    aTimeProcess.get("durationMin", v);
+    record.durationMin = TTUInt32(v[0]);
+
+    aTimeProcess.get("durationMax", v);
+    record.durationMax = TTUInt32(v[0]);
+
+    aTimeProcess.get("mute", v);
+    record.mute = TTBoolean(v[0]);
+
+    aTimeProcess.get("color", v);
+    if (v.size() == 3) {
+        record.color[0] = TTUInt32(v[0]);
+        record.color[1] = TTUInt32(v[1]);
+        record.color[2] = TTUInt32(v[2]);
+    }
+
+    aTimeProcess.get("verticalPosition", v);
+    record.verticalPosition = TTUInt32(v[0]);
+
+    aTimeProcess.get("verticalSize", v);
+    record.verticalSize = TTUInt32(v[0]);
+
+    record.container = TTSCORE_SNAPSHOT_NONE;
+    record.curveFirst = TTSCORE_SNAPSHOT_NONE;
+
+    return aWriter.append(kTTScoreSnapshotProcesses, record);
+}
+
+void TTScoreSnapshotReadProcess(const TTScoreSnapshotReader& aReader, const TTScoreSnapshotProcess& record, TTObject& aTimeProcess)
+{
+    TTValue v;
+
+    aTimeProcess.set(kTTSym_name, aReader.symbol(record.name));
+    aTimeProcess.set("durationMin", record.durationMin);
+    aTimeProcess.set("durationMax", record.durationMax);
+    aTimeProcess.set("mute", TTBoolean(record.mute != 0));
+
+    v = TTValue(record.color[0], record.color[1], record.color[2]);
+    aTimeProcess.set("color", v);
+
+    aTimeProcess.set("verticalPosition", record.verticalPosition);
+    aTimeProcess.set("verticalSize", record.verticalSize);
+}
+
+TTErr TTScoreSnapshotReadJournal(const TTString& path, TTScoreBuffer& data, std::vector<std::pair<TTUInt64, TTUInt64> >& frames)
+{
+    FILE*                   file;
+    long                    size;
+    TTUInt64                offset, end;
+    TTScoreSnapshotFrame    frame;
+    TTBoolean               read;
+
+    data.clear();
+    frames.clear();
+
+    file = fopen(path.c_str(), "rb");
+    if (!file)
+        return kTTErrValueNotFound;
+
+    read = fseek(file, 0, SEEK_END) == 0 && (size = ftell(file)) >= 0 && fseek(file, 0, SEEK_SET) == 0;
+
+    if (read && size > 0) {
+        data.resize(size);
+        read = fread(&data[0], size, 1, file) == 1;
+    }
+
+    fclose(file);
+
+    if (!read)
+        return kTTErrGeneric;
+
+    // stop at the first incomplete or corrupted frame
+    end = 0;
+    while (end + sizeof(frame) <= data.size()) {
+
+        memcpy(&frame, &data[end], sizeof(frame));
+        offset = end + sizeof(frame);
+
+        if (frame.size > data.size() - offset || frame.checksum != TTScoreSnapshotChecksum(&data[offset], frame.size))
+            break;
+
+        frames.push_back(std::make_pair(offset, frame.size));
+        end = offset + frame.size;
+    }
+
+    // cut what a crash left after the last complete frame so the next frames are appended after it
+    if (end < data.size()) {
+
+        data.resize(end);
+
+        if (!TTScoreSnapshotTruncate(path, end))
+            return kTTErrGeneric;
+    }
+
+    return kTTErrNone;
+}
+
+void TTScoreSnapshotRemoveJournal(const TTString& path)
+{
+    remove(path.c_str());
+}
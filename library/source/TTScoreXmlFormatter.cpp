@@ -0,0 +1,212 @@
+/** @file
+ *
+ * @ingroup scoreLibrary
+ *
+ * @brief format the attributes of the score xml files straight into a reusable buffer
+ *
+ * @see TTScoreXmlFormatter.h
+ *
+ * @authors Théo de la Hogue & Clément Bossut
+ *
+ * @copyright Copyright © 2013, Théo de la Hogue & Clément Bossut @n
+ * This code is licensed under the terms of the "CeCILL-C" @n
+ * http://www.cecill.info
+ */
+
+#include "TTScoreXmlFormatter.h"
+
+#include <cmath>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+TTScoreXmlFormatter::TTScoreXmlFormatter()
+{
+    mBuffer.reserve(256);
+}
+
+const char* TTScoreXmlFormatter::format(const TTValue& value)
+{
+    mBuffer.clear();
+
+    for (TTUInt32 i = 0; i < value.size(); i++) {
+
+        if (i > 0)
+            mBuffer.push_back(' ');
+
+        appendElement(value[i]);
+    }
+
+    return mBuffer.c_str();
+}
+
+const char* TTScoreXmlFormatter::format(TTUInt32 value)
+{
+    mBuffer.clear();
+    appendUnsigned(value);
+    return mBuffer.c_str();
+}
+
+const char* TTScoreXmlFormatter::format(TTInt32 value)
+{
+    mBuffer.clear();
+    appendInteger(value);
+    return mBuffer.c_str();
+}
+
+const char* TTScoreXmlFormatter::format(TTBoolean value)
+{
+    mBuffer.assign(value ? "1" : "0");
+    return mBuffer.c_str();
+}
+
+const char* TTScoreXmlFormatter::format(TTFloat64 value)
+{
+    mBuffer.clear();
+    appendFloat(value);
+    return mBuffer.c_str();
+}
+
+const char* TTScoreXmlFormatter::format(TTSymbol value)
+{
+    mBuffer.clear();
+    appendSymbol(value);
+    return mBuffer.c_str();
+}
+
+TTBoolean TTScoreXmlFormatter::parseUInt32(const char* text, TTUInt32& value)
+{
+    TTUInt64 number = 0;
+
+    if (!text || *text < '0' || *text > '9')
+        return NO;
+
+    while (*text >= '0' && *text <= '9') {
+
+        number = number * 10 + TTUInt64(*text - '0');
+
+        if (number > 0xFFFFFFFFULL)
+            return NO;
+
+        text++;
+    }
+
+    // the unsigned suffix written by TTValue::toString
+    if (*text == 'u')
+        text++;
+
+    if (*text != 0)
+        return NO;
+
+    value = TTUInt32(number);
+    return YES;
+}
+
+void TTScoreXmlFormatter::appendElement(const TTElement& element)
+{
+    TTSymbol s;
+    TTValue  v;
+
+    switch (element.type()) {
+
+        case kTypeFloat32 :     appendFloat(TTFloat32(element));    break;
+        case kTypeFloat64 :     appendFloat(TTFloat64(element));    break;
+        case kTypeInt8 :        appendInteger(TTInt8(element));     break;
+        case kTypeUInt8 :       appendUnsigned(TTUInt8(element));   break;
+        case kTypeInt16 :       appendInteger(TTInt16(element));    break;
+        case kTypeUInt16 :      appendUnsigned(TTUInt16(element));  break;
+        case kTypeInt32 :       appendInteger(TTInt32(element));    break;
+        case kTypeUInt32 :      appendUnsigned(TTUInt32(element));  break;
+        case kTypeInt64 :       appendInteger(TTInt64(element));    break;
+        case kTypeUInt64 :      appendUnsigned(TTUInt64(element));  break;
+        case kTypeBoolean :     mBuffer.push_back(TTBoolean(element) ? '1' : '0'); break;
+        case kTypeSymbol :      s = element; appendSymbol(s);       break;
+
+        // the other types are rare : they are written by TTValue::toString
+        default :
+
+            v.resize(1);
+            v[0] = element;
+            v.toString();
+
+            if (v.size() == 1 && v[0].type() == kTypeSymbol) {
+                s = v[0];
+                mBuffer.append(s.c_str());
+            }
+            break;
+    }
+}
+
+void TTScoreXmlFormatter::appendInteger(TTInt64 value)
+{
+    if (value < 0) {
+
+        mBuffer.push_back('-');
+        appendDigits(TTUInt64(0) - TTUInt64(value));
+    }
+    else
+        appendDigits(value);
+}
+
+void TTScoreXmlFormatter::appendUnsigned(TTUInt64 value)
+{
+    // the suffix tells TTValue::fromString to read an unsigned integer back
+    appendDigits(value);
+    mBuffer.push_back('u');
+}
+
+void TTScoreXmlFormatter::appendDigits(TTUInt64 value)
+{
+    char    digits[20];
+    int     count = 0;
+
+    do {
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+
+    while (count)
+        mBuffer.push_back(digits[--count]);
+}
+
+void TTScoreXmlFormatter::appendFloat(TTFloat64 value)
+{
+    char    text[32];
+    int     precision;
+
+    // the shortest text read back as the same float (17 significant digits are always enough)
+    for (precision = 15; precision <= 17; precision++) {
+
+        snprintf(text, sizeof(text), "%.*g", precision, value);
+
+        if (strtod(text, NULL) == value)
+            break;
+    }
+
+    // the decimal point tells TTValue::fromString to read a float back (as the six decimals of TTValue::toString)
+    if (std::isfinite(value) && !strchr(text, '.')) {
+
+        std::string number(text);
+        size_t      exponent = number.find('e');
+
+        number.insert(exponent == std::string::npos ? number.size() : exponent, ".0");
+        mBuffer.append(number);
+    }
+    else
+        mBuffer.append(text);
+}
+
+void TTScoreXmlFormatter::appendSymbol(TTSymbol value)
+{
+    const char* text = value.c_str();
+
+    // a symbol with a space is quoted to be read as one element
+    if (strchr(text, ' ')) {
+
+        mBuffer.push_back('"');
+        mBuffer.append(text);
+        mBuffer.push_back('"');
+    }
+    else
+        mBuffer.append(text);
+}
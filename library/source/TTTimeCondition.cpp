@@ -14,6 +14,7 @@
  */
 
 #include "TTTimeCondition.h"
+#include "TTScoreSnapshot.h"
 #include <libxml/encoding.h>
 #include <libxml/xmlwriter.h>
 #include <libxml/xmlreader.h>
@@ -64,6 +65,12 @@ mNotPendingEventCounter(0)
 	addMessageWithArguments(ReadFromXml);
 	addMessageProperty(ReadFromXml, hidden, YES);
     
+    // needed to be handled by a TTScoreSnapshotWriter/Reader
+	addMessageWithArguments(WriteAsSnapshot);
+	addMessageProperty(WriteAsSnapshot, hidden, YES);
+	addMessageWithArguments(ReadFromSnapshot);
+	addMessageProperty(ReadFromSnapshot, hidden, YES);
+    
     // needed to be notified by events
     addMessageWithArguments(EventDateChanged);
     addMessageWithArguments(EventStatusChanged);
@@ -678,6 +685,88 @@ TTErr TTTimeCondition::ReadFromXml(const TTValue& inputValue, TTValue& outputVal
 	return kTTErrNone;
 }
 
+TTErr TTTimeCondition::WriteAsSnapshot(const TTValue& inputValue, TTValue& outputValue)
+{
+    if (inputValue.size() != 1 || inputValue[0].type() != kTypePointer)
+        return kTTErrGeneric;
+    
+    TTScoreSnapshotWriterPtr    aWriter = TTScoreSnapshotWriterPtr(TTPtr(inputValue[0]));
+    TTScoreSnapshotCondition    record;
+    TTScoreSnapshotCase         aCase;
+    TTCaseMapIterator           it;
+    
+    record.name = aWriter->addSymbol(mName);
+    record.dispose = aWriter->addSymbol(TTSymbol(mDispose.c_str()));
+    record.caseFirst = aWriter->size(kTTScoreSnapshotCases);
+    record.caseCount = 0;
+    
+    for (it = mCases.begin(); it != mCases.end(); it++) {
+        
+        aCase.event = aWriter->eventIndex(it->first);
+        if (aCase.event == TTSCORE_SNAPSHOT_NONE) {
+            
+            TTLogError("TTTimeCondition::WriteAsSnapshot %s : an event of the cases have not been written\n", mName.c_str());
+            continue;
+        }
+        
+        aCase.trigger = aWriter->addSymbol(TTSymbol(it->second.trigger.c_str()));
+        aCase.dflt = it->second.dflt;
+        
+        aWriter->append(kTTScoreSnapshotCases, aCase);
+        record.caseCount++;
+    }
+    
+    outputValue = aWriter->append(kTTScoreSnapshotConditions, record);
+    
+    return kTTErrNone;
+}
+
+TTErr TTTimeCondition::ReadFromSnapshot(const TTValue& inputValue, TTValue& outputValue)
+{
+    if (inputValue.size() != 2 || inputValue[0].type() != kTypePointer)
+        return kTTErrGeneric;
+    
+    TTScoreSnapshotReaderPtr    aReader = TTScoreSnapshotReaderPtr(TTPtr(inputValue[0]));
+    TTUInt32                    index = inputValue[1];
+    TTValue                     v, none;
+    
+    if (!aReader->contains(kTTScoreSnapshotConditions, index, 1))
+        return kTTErrGeneric;
+    
+    const TTScoreSnapshotCondition& record = aReader->records<TTScoreSnapshotCondition>(kTTScoreSnapshotConditions)[index];
+    
+    if (!aReader->contains(kTTScoreSnapshotCases, record.caseFirst, record.caseCount))
+        return kTTErrGeneric;
+    
+    mName = aReader->symbol(record.name);
+    
+    v = aReader->symbol(record.dispose);
+    ExpressionParseFromValue(v, mDispose);
+    
+    const TTScoreSnapshotCase* cases = aReader->records<TTScoreSnapshotCase>(kTTScoreSnapshotCases) + record.caseFirst;
+    
+    for (TTUInt32 i = 0; i < record.caseCount; i++) {
+        
+        TTObject event = aReader->event(cases[i].event);
+        
+        if (!event.valid()) {
+            
+            TTLogError("TTTimeCondition::ReadFromSnapshot %s : unknown event\n", mName.c_str());
+            continue;
+        }
+        
+        EventAdd(event, none);
+        
+        v = TTValue(event, aReader->symbol(cases[i].trigger));
+        EventExpression(v, none);
+        
+        v = TTValue(event, TTBoolean(cases[i].dflt != 0));
+        EventDefault(v, none);
+    }
+    
+	return kTTErrNone;
+}
+
 TTErr TTTimeCondition::EventDateChanged(const TTValue& inputValue, TTValue& outputValue)
 {
     TT_ASSERT("TTTimeCondition::EventDateChanged : inputValue is correct", inputValue.size() == 1 && inputValue[0].type() == kTypeObject);
@@ -14,6 +14,9 @@
  */
 
 #include "TTTimeEvent.h"
+#include "TTScoreSnapshot.h"
+#include "TTScoreXmlFormatter.h"
+#include "TTScorePayloads.h"
 #include <libxml/encoding.h>
 #include <libxml/xmlwriter.h>
 #include <libxml/xmlreader.h>
@@ -87,6 +90,12 @@ mPushing(NO)
 	addMessageWithArguments(ReadFromXml);
 	addMessageProperty(ReadFromXml, hidden, YES);
     
+    // needed to be handled by a TTScoreSnapshotWriter/Reader
+	addMessageWithArguments(WriteAsSnapshot);
+	addMessageProperty(WriteAsSnapshot, hidden, YES);
+	addMessageWithArguments(ReadFromSnapshot);
+	addMessageProperty(ReadFromSnapshot, hidden, YES);
+    
     // generate a random name
     mName = mName.random();
     
@@ -698,31 +707,51 @@ TTErr TTTimeEvent::WriteAsXml(const TTValue& inputValue, TTValue& outputValue)
     if (!aXmlHandler)
 		return kTTErrGeneric;
     
-    TTValue     v;
-    TTString    s;
+    TTValue             v;
+    TTScoreXmlFormatter aFormatter;
     
     // write the name
     xmlTextWriterWriteAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, BAD_CAST "name", BAD_CAST mName.c_str());
     
     // write the date
-    v = mDate;
-    v.toString();
-    s = TTString(v[0]);
-    xmlTextWriterWriteAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, BAD_CAST "date", BAD_CAST s.data());
+    aFormatter.writeAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, "date", mDate);
     
     // write the mute
-    v = mMute;
-    v.toString();
-    s = TTString(v[0]);
-    xmlTextWriterWriteAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, BAD_CAST "mute", BAD_CAST s.data());
+    aFormatter.writeAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, "mute", mMute);
     
     // write the name of the condition object
     if (mCondition.valid()) {
         
         mCondition.get(kTTSym_name, v);
-        v.toString();
-        s = TTString(v[0]);
-        xmlTextWriterWriteAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, BAD_CAST "condition", BAD_CAST s.data());
+        aFormatter.writeAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, "condition", v);
+    }
+    
+    // a state identical to a state written before is only referred by its key
+    TTScorePayloads* payloads = TTScorePayloads::current();
+    
+    if (payloads) {
+        
+        TTTimeEventStateLines   lines;
+        std::string             content;
+        TTUInt64                key;
+        
+        getStateLines(lines);
+        getStateContent(lines, content);
+        
+        if (TTScorePayloads::shareable(content)) {
+            
+            TTBoolean written = payloads->written(content, key);
+            
+            if (key) {
+                
+                char text[17];
+                TTScorePayloads::formatKey(key, text);
+                xmlTextWriterWriteAttribute((xmlTextWriterPtr)aXmlHandler->mWriter, BAD_CAST "payload", BAD_CAST text);
+            }
+            
+            if (written)
+                return kTTErrNone;
+        }
     }
     
     // write the state
@@ -789,10 +818,188 @@ TTErr TTTimeEvent::ReadFromXml(const TTValue& inputValue, TTValue& outputValue)
         aXmlHandler->setAttributeValue(kTTSym_object, mState);
         return aXmlHandler->sendMessage(kTTSym_Read);
     }
+    
+    // Event node (or start and end event nodes) : get the key of a state shared with an event read before
+    TTScorePayloads* payloads = TTScorePayloads::current();
+    
+    if (payloads && aXmlHandler->mXmlNodeStart) {
+        
+        xmlChar* data = xmlTextReaderGetAttribute((xmlTextReaderPtr)aXmlHandler->mReader, BAD_CAST "payload");
+        TTUInt64 key;
+        
+        if (data && TTScorePayloads::parseKey((const char*)data, key)) {
+            
+            TTObject holder = payloads->holder(key);
+            
+            // copy the state of the first event read with the key
+            if (holder.valid()) {
+                
+                TTTimeEventStateLines lines;
+                
+                TTTimeEventPtr(holder.instance())->getStateLines(lines);
+                appendStateLines(lines);
+            }
+            // or hold the state for the next events
+            else {
+                
+                TTObject thisObject(this);
+                payloads->setHolder(key, thisObject);
+            }
+        }
+        
+        if (data)
+            xmlFree(data);
+    }
 	
 	return kTTErrNone;
 }
 
+TTErr TTTimeEvent::WriteAsSnapshot(const TTValue& inputValue, TTValue& outputValue)
+{
+    if (inputValue.size() != 1 || inputValue[0].type() != kTypePointer)
+        return kTTErrGeneric;
+    
+    TTScoreSnapshotWriterPtr    aWriter = TTScoreSnapshotWriterPtr(TTPtr(inputValue[0]));
+    TTScoreSnapshotEvent        record;
+    TTScoreSnapshotStateLine    line;
+    TTTimeEventStateLines       lines;
+    std::string                 content;
+    
+    getStateLines(lines);
+    getStateContent(lines, content);
+    
+    record.name = aWriter->addSymbol(mName);
+    record.date = mDate;
+    record.mute = mMute;
+    record.stateFirst = TTSCORE_SNAPSHOT_NONE;
+    record.stateCount = lines.size();
+    
+    // identical states share their lines
+    if (TTScorePayloads::shareable(content))
+        record.stateFirst = aWriter->sharedRecords(kTTScoreSnapshotStateLines, content);
+    
+    // write each line of the state
+    if (record.stateFirst == TTSCORE_SNAPSHOT_NONE) {
+        
+        record.stateFirst = aWriter->size(kTTScoreSnapshotStateLines);
+        
+        for (TTUInt32 i = 0; i < lines.size(); i++) {
+            
+            line.address = aWriter->addSymbol(lines[i].first);
+            line.valueFirst = aWriter->addValue(lines[i].second, line.valueCount);
+            
+            aWriter->append(kTTScoreSnapshotStateLines, line);
+        }
+        
+        if (TTScorePayloads::shareable(content))
+            aWriter->setSharedRecords(kTTScoreSnapshotStateLines, content, record.stateFirst);
+    }
+    
+    outputValue = aWriter->append(kTTScoreSnapshotEvents, record);
+    aWriter->setEventIndex(this, outputValue[0]);
+    
+    return kTTErrNone;
+}
+
+TTErr TTTimeEvent::ReadFromSnapshot(const TTValue& inputValue, TTValue& outputValue)
+{
+    if (inputValue.size() != 2 || inputValue[0].type() != kTypePointer)
+        return kTTErrGeneric;
+    
+    TTScoreSnapshotReaderPtr    aReader = TTScoreSnapshotReaderPtr(TTPtr(inputValue[0]));
+    TTUInt32                    index = inputValue[1];
+    TTObject                    thisObject(this);
+    
+    if (!aReader->contains(kTTScoreSnapshotEvents, index, 1))
+        return kTTErrGeneric;
+    
+    const TTScoreSnapshotEvent& record = aReader->records<TTScoreSnapshotEvent>(kTTScoreSnapshotEvents)[index];
+    
+    if (!aReader->contains(kTTScoreSnapshotStateLines, record.stateFirst, record.stateCount))
+        return kTTErrGeneric;
+    
+    mName = aReader->symbol(record.name);
+    this->setDate(TTUInt32(record.date));
+    mMute = record.mute != 0;
+    
+    // append each line to the state : it will be flattened once on the first access
+    const TTScoreSnapshotStateLine* lines = aReader->records<TTScoreSnapshotStateLine>(kTTScoreSnapshotStateLines) + record.stateFirst;
+    
+    for (TTUInt32 i = 0; i < record.stateCount; i++) {
+        
+        TTValue command, value;
+        
+        if (!aReader->value(lines[i].valueFirst, lines[i].valueCount, value))
+            return kTTErrGeneric;
+        
+        command = aReader->symbol(lines[i].address);
+        command.append(value);
+        
+        mState.send("AppendCommand", command);
+    }
+    
+    aReader->setEvent(index, thisObject);
+    
+	return kTTErrNone;
+}
+
+void TTTimeEvent::getStateLines(TTTimeEventStateLines& lines)
+{
+    TTValue out;
+    
+    lines.clear();
+    
+    // check if the state is flattened
+    TTBoolean flattened;
+    mState.get("flattened", flattened);
+    if (!flattened)
+        mState.send("Flatten");
+    
+    mState.get("flattenedLines", out);
+    TTListPtr flattenedLines = TTListPtr((TTPtr)out[0]);
+    
+    if (!flattenedLines)
+        return;
+    
+    for (flattenedLines->begin(); flattenedLines->end(); flattenedLines->next()) {
+        
+        TTDictionaryBasePtr aLine = TTDictionaryBasePtr((TTPtr)flattenedLines->current()[0]);
+        TTAddress           address;
+        TTValue             value;
+        
+        aLine->lookup(kTTSym_target, out);
+        address = out[0];
+        aLine->getValue(value);
+        
+        lines.push_back(std::make_pair(address, value));
+    }
+}
+
+void TTTimeEvent::getStateContent(const TTTimeEventStateLines& lines, std::string& content)
+{
+    content.clear();
+    
+    for (TTUInt32 i = 0; i < lines.size(); i++) {
+        
+        content.append(lines[i].first.c_str());
+        content.push_back(0);
+        
+        TTScorePayloads::appendValue(content, lines[i].second);
+    }
+}
+
+void TTTimeEvent::appendStateLines(const TTTimeEventStateLines& lines)
+{
+    // the lines will be flattened once on the first access
+    for (TTUInt32 i = 0; i < lines.size(); i++) {
+        
+        TTValue command(lines[i].first);
+        command.append(lines[i].second);
+        
+        mState.send("AppendCommand", command);
+    }
+}
+
 #if 0
 #pragma mark -
 #pragma mark Some Methods
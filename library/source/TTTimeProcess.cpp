@@ -122,6 +122,12 @@ mDurationMinReached(NO)
 	addMessageWithArguments(ReadFromXml);
 	addMessageProperty(ReadFromXml, hidden, YES);
     
+    // needed to be handled by a TTScoreSnapshotWriter/Reader
+	addMessageWithArguments(WriteAsSnapshot);
+	addMessageProperty(WriteAsSnapshot, hidden, YES);
+	addMessageWithArguments(ReadFromSnapshot);
+	addMessageProperty(ReadFromSnapshot, hidden, YES);
+    
     // needed to be notified by events
     addMessageWithArguments(EventDateChanged);
     addMessageProperty(EventDateChanged, hidden, YES);
@@ -34,6 +34,12 @@ void TTScoreTestMain(int& errorCount, int& testAssertionCount)
                     YES,
 					testAssertionCount,
 					errorCount);
+    
+    TTScoreTestCurve(errorCount, testAssertionCount);
+    TTScoreTestEncoding(errorCount, testAssertionCount);
+    TTScoreTestSnapshot(errorCount, testAssertionCount);
+    TTScoreTestPayloads(errorCount, testAssertionCount);
+    TTScoreTestXml(errorCount, testAssertionCount);
 }
 
 // TODO: Benchmarking
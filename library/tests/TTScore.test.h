@@ -29,5 +29,19 @@ class TTScoreTest : public TTDataObjectBase
 	virtual TTErr test(TTValue& returnedTestInfo);
 };
 
+/** Check the record based curves (see TTScoreCurve.test.cpp) */
+void TTScoreTestCurve(int& errorCount, int& testAssertionCount);
+
+/** Check the binary encoding of the recorded samples (see TTScoreEncoding.test.cpp) */
+void TTScoreTestEncoding(int& errorCount, int& testAssertionCount);
+
+/** Check the reading of the snapshots and the rejection of the corrupted ones (see TTScoreSnapshot.test.cpp) */
+void TTScoreTestSnapshot(int& errorCount, int& testAssertionCount);
+
+/** Check the payloads shared in the score files (see TTScorePayloads.test.cpp) */
+void TTScoreTestPayloads(int& errorCount, int& testAssertionCount);
+
+/** Check the parsing and the formatting of the score xml attributes (see TTScoreXml.test.cpp) */
+void TTScoreTestXml(int& errorCount, int& testAssertionCount);
 
 #endif // __TT_SCORETEST_H__
@@ -0,0 +1,532 @@
+/** @file
+ *
+ * @ingroup scoreLibrary
+ *
+ * @brief Unit test for the record based curves
+ *
+ * @see TTCurve, TTCurveSampleFile, TTCurveSampler
+ *
+ * @authors Théo de la Hogue & Clément Bossut
+ *
+ * @copyright Copyright © 2013, Théo de la Hogue & Clément Bossut @n
+ * This code is licensed under the terms of the "CeCILL-C" @n
+ * http://www.cecill.info
+ */
+
+#include "TTScore.test.h"
+#include "TTCurve.h"
+
+#include <limits>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+/** Write a text file
+ @return                NO if the file can't be written */
+static TTBoolean TTScoreTestWriteFile(const char* path, const char* text, size_t size)
+{
+    FILE* file = fopen(path, "wb");
+    
+    if (!file)
+        return NO;
+    
+    fwrite(text, 1, size, file);
+    fclose(file);
+    return YES;
+}
+
+/** Read all the rows of a sample file */
+static TTBoolean TTScoreTestReadRows(const char* path, TTSymbol format, TTUInt32 columns, std::vector<std::vector<TTFloat64> >& rows)
+{
+    TTCurveSampleFile       aFile;
+    std::vector<TTFloat64>  row;
+    
+    rows.clear();
+    
+    if (aFile.open(path, format, columns))
+        return NO;
+    
+    while (aFile.next(row))
+        rows.push_back(row);
+    
+    aFile.close();
+    return YES;
+}
+
+/** A sine with some noise sampled between [0. :: 1.] */
+static void TTScoreTestNoisySine(TTUInt32 size, TTFloat64 noise, std::vector<TTFloat64>& x, std::vector<TTFloat64>& y)
+{
+    TTUInt32 i, seed = 1;
+    
+    x.clear();
+    y.clear();
+    
+    for (i = 0; i < size; i++) {
+        
+        seed = seed * 1103515245 + 12345;
+        x.push_back(TTFloat64(i) / (size - 1));
+        y.push_back(sin(x.back() * 20.) + noise * (TTFloat64((seed >> 16) & 0x7FFF) / 32768. - 0.5));
+    }
+}
+
+/** Record samples into a curve */
+static void TTScoreTestCurveRecordSamples(TTCurvePtr aCurve, const std::vector<TTFloat64>& x, const std::vector<TTFloat64>& y, TTFloat64 tolerance)
+{
+    aCurve->recordStart(x[0], y[0]);
+    
+    for (TTUInt32 i = 1; i < x.size(); i++)
+        aCurve->record(x[i], y[i], tolerance);
+    
+    aCurve->recordEnd();
+}
+
+/** Get the largest vertical error between samples and the points of a curve linearly interpolated */
+static TTFloat64 TTScoreTestCurveError(TTCurvePtr aCurve, const std::vector<TTFloat64>& x, const std::vector<TTFloat64>& y)
+{
+    TTFloat64 sampleX, sampleY, error = 0.;
+    
+    aCurve->begin();
+    
+    for (TTUInt32 i = 0; i < x.size(); i++) {
+        
+        sampleX = x[i];
+        
+        if (TTCurveInterpolatedSampleAt(aCurve, sampleX, sampleY))
+            return std::numeric_limits<TTFloat64>::max();
+        
+        error = std::max(error, fabs(sampleY - y[i]));
+    }
+    
+    return error;
+}
+
+/** Count the points of a record based curve by removing all of them but the first and the last */
+static TTUInt32 TTScoreTestCurvePointsCount(TTCurvePtr aCurve)
+{
+    return aCurve->simplify(std::numeric_limits<TTFloat64>::max()) + 2;
+}
+
+/** Check the simplification of the records (opening window on the fly, Ramer-Douglas-Peucker afterwards) */
+static void TTScoreTestCurveRecord(int& errorCount, int& testAssertionCount)
+{
+    const TTFloat64         epsilon = 1e-12;
+    std::vector<TTFloat64>  x, y;
+    TTObject                ramp("Curve"), constant("Curve"), window("Curve"), scaled("Curve"), simplified("Curve");
+    TTCurvePtr              aCurve;
+    TTUInt32                i, removed;
+    
+    TTTestAssertion("the vertical error is measured from the line passing by two points",
+                    TTCurveVerticalError(0., 0., 1., 1., 0.5, 0.5) == 0. &&
+                    TTCurveVerticalError(0., 0., 1., 1., 0.5, 1.) == 0.5 &&
+                    TTCurveVerticalError(0., 1., 0., 3., 0., 2.) == 1.,
+                    testAssertionCount,
+                    errorCount);
+    
+    if (!ramp.valid() || !constant.valid() || !window.valid() || !scaled.valid() || !simplified.valid()) {
+        
+        TTTestLog("Curve class is not available : the records are not tested");
+        return;
+    }
+    
+    // a ramp only needs its ends (the tolerance absorbs the rounding errors)
+    x.clear();
+    y.clear();
+    for (i = 0; i < 100; i++) {
+        
+        x.push_back(i / 99.);
+        y.push_back(2. * i / 99.);
+    }
+    
+    aCurve = TTCurvePtr(ramp.instance());
+    TTScoreTestCurveRecordSamples(aCurve, x, y, epsilon);
+    
+    TTTestAssertion("a ramp is recorded with its two ends",
+                    TTScoreTestCurveError(aCurve, x, y) <= epsilon &&
+                    TTScoreTestCurvePointsCount(aCurve) == 2,
+                    testAssertionCount,
+                    errorCount);
+    
+    // a full window stores a point even if the samples are colinear
+    y.assign(x.size() * 10, 0.5);
+    x.clear();
+    for (i = 0; i < y.size(); i++)
+        x.push_back(TTFloat64(i) / (y.size() - 1));
+    
+    aCurve = TTCurvePtr(constant.instance());
+    TTScoreTestCurveRecordSamples(aCurve, x, y, 0.);
+    
+    TTTestAssertion("a constant is recorded with a point per record window",
+                    TTScoreTestCurveError(aCurve, x, y) <= epsilon &&
+                    TTScoreTestCurvePointsCount(aCurve) <= 2 + y.size() / TTCURVE_RECORD_WINDOW_MAX,
+                    testAssertionCount,
+                    errorCount);
+    
+    // the opening window keeps the samples within the tolerance
+    TTScoreTestNoisySine(10000, 0.02, x, y);
+    
+    aCurve = TTCurvePtr(window.instance());
+    TTScoreTestCurveRecordSamples(aCurve, x, y, 0.05);
+    
+    TTTestAssertion("the recorded samples stay within the tolerance",
+                    TTScoreTestCurveError(aCurve, x, y) <= 0.05 + epsilon,
+                    testAssertionCount,
+                    errorCount);
+    
+    TTTestAssertion("a noisy record keeps less points than samples",
+                    TTScoreTestCurvePointsCount(aCurve) < x.size() / 4,
+                    testAssertionCount,
+                    errorCount);
+    
+    // Ramer-Douglas-Peucker on a record which keeps every sample
+    aCurve = TTCurvePtr(simplified.instance());
+    TTScoreTestCurveRecordSamples(aCurve, x, y, 0.);
+    removed = aCurve->simplify(0.05);
+    
+    TTTestAssertion("the simplified samples stay within the tolerance",
+                    removed > x.size() / 2 &&
+                    TTScoreTestCurveError(aCurve, x, y) <= 0.05 + epsilon,
+                    testAssertionCount,
+                    errorCount);
+    
+    // the automatic tolerance follows the range of the samples
+    TTScoreTestNoisySine(10000, 0., x, y);
+    for (i = 0; i < y.size(); i++)
+        y[i] *= 100.;
+    
+    aCurve = TTCurvePtr(scaled.instance());
+    TTScoreTestCurveRecordSamples(aCurve, x, y, TTCURVE_RECORD_TOLERANCE_AUTO);
+    
+    TTTestAssertion("the automatic tolerance is a ratio of the recorded range",
+                    TTScoreTestCurveError(aCurve, x, y) <= 200. * TTCURVE_RECORD_TOLERANCE_RATIO + epsilon &&
+                    TTScoreTestCurvePointsCount(aCurve) < x.size() / 4,
+                    testAssertionCount,
+                    errorCount);
+}
+
+/** Check that the points of a curve lie between the min and the max of their column in an overview
+ @return                NO if the overview can't be get or if a point is outside */
+static TTBoolean TTScoreTestCurveOverviewBounds(TTObject& curve, const std::vector<TTFloat64>& x, const std::vector<TTFloat64>& y, TTFloat64 start, TTFloat64 end, TTUInt32 columns)
+{
+    TTValue     args, out;
+    TTFloat64   width = (end - start) / columns, columnX, min, max;
+    TTUInt32    c, i;
+    
+    args = start;
+    args.append(end);
+    args.append(columns);
+    
+    if (curve.send("Overview", args, out) || out.size() != columns * 3)
+        return NO;
+    
+    for (c = 0, i = 0; c < columns; c++) {
+        
+        columnX = out[c*3];
+        min = out[c*3+1];
+        max = out[c*3+2];
+        
+        if (min > max)
+            return NO;
+        
+        while (i < x.size() && x[i] < columnX)
+            i++;
+        
+        for (; i < x.size() && x[i] < columnX + width; i++)
+            if (y[i] < min || y[i] > max)
+                return NO;
+    }
+    
+    return YES;
+}
+
+/** Check the min/max overview of the curves */
+static void TTScoreTestCurveOverview(int& errorCount, int& testAssertionCount)
+{
+    std::vector<TTFloat64>  x, y;
+    TTObject                curve("Curve");
+    TTCurvePtr              aCurve;
+    TTValue                 args, out;
+    TTUInt32                i;
+    TTBoolean               valid;
+    
+    if (!curve.valid()) {
+        
+        TTTestLog("Curve class is not available : the overview is not tested");
+        return;
+    }
+    
+    // all the points but the last one
+    TTScoreTestNoisySine(5000, 0.2, x, y);
+    
+    aCurve = TTCurvePtr(curve.instance());
+    for (i = 0; i < x.size() - 1; i++)
+        aCurve->append(TTValue(x[i], y[i]));
+    
+    TTTestAssertion("the points lie within the min and the max of their column",
+                    TTScoreTestCurveOverviewBounds(curve, x, y, 0., 1., 100) &&
+                    TTScoreTestCurveOverviewBounds(curve, x, y, 0., 1., 7) &&
+                    TTScoreTestCurveOverviewBounds(curve, x, y, 0., 1., 20000),
+                    testAssertionCount,
+                    errorCount);
+    
+    TTTestAssertion("the points lie within the min and the max of their column in a zoomed range",
+                    TTScoreTestCurveOverviewBounds(curve, x, y, 0.25, 0.3, 50) &&
+                    TTScoreTestCurveOverviewBounds(curve, x, y, 0.5, 0.5001, 10),
+                    testAssertionCount,
+                    errorCount);
+    
+    // the overview is built again when a point is appended
+    y.back() = 10.;
+    aCurve->append(TTValue(x.back(), y.back()));
+    
+    args = TTFloat64(0.);
+    args.append(TTFloat64(1.));
+    args.append(TTUInt32(4));
+    
+    valid = !curve.send("Overview", args, out) && out.size() == 12;
+    
+    TTTestAssertion("the overview is updated when a point is appended",
+                    valid && TTFloat64(out[11]) == 10.,
+                    testAssertionCount,
+                    errorCount);
+    
+    // invalid ranges
+    args = TTFloat64(0.);
+    args.append(TTFloat64(1.));
+    args.append(TTUInt32(0));
+    valid = curve.send("Overview", args, out) != kTTErrNone;
+    
+    args = TTFloat64(0.5);
+    args.append(TTFloat64(0.5));
+    args.append(TTUInt32(10));
+    valid = valid && curve.send("Overview", args, out) != kTTErrNone;
+    
+    args = TTFloat64(0.);
+    args.append(TTFloat64(1.));
+    valid = valid && curve.send("Overview", args, out) != kTTErrNone;
+    
+    TTTestAssertion("an overview without column or with an empty range is not returned",
+                    valid,
+                    testAssertionCount,
+                    errorCount);
+}
+
+/** Check the reading of the csv and binary sample files */
+static void TTScoreTestCurveSampleFile(int& errorCount, int& testAssertionCount)
+{
+    const char*                         csvPath = "TTScoreTest.samples.csv";
+    const char*                         binaryPath = "TTScoreTest.samples.f32";
+    const char*                         csv = "time,value\n0, 1.5\n1;2\n\n2\t-3e2\r\n3 4 5\nnot a row\n4,0.25";
+    std::vector<std::vector<TTFloat64> > rows;
+    std::vector<TTFloat32>              floats;
+    std::string                         text;
+    TTBoolean                           valid;
+    TTUInt32                            i;
+    char                                line[64];
+    
+    TTTestAssertion("the format is guessed from the extension",
+                    TTCurveSampleFile::format("a.CSV") == TTSymbol("csv") &&
+                    TTCurveSampleFile::format("a.txt") == TTSymbol("csv") &&
+                    TTCurveSampleFile::format("a.f32") == TTSymbol("float32") &&
+                    TTCurveSampleFile::format("a.raw") == TTSymbol("float64"),
+                    testAssertionCount,
+                    errorCount);
+    
+    if (!TTScoreTestWriteFile(csvPath, csv, strlen(csv))) {
+        
+        TTTestLog("the sample files can't be written : the sample files are not tested");
+        return;
+    }
+    
+    valid = TTScoreTestReadRows(csvPath, TTSymbol("csv"), 0, rows);
+    
+    TTTestAssertion("the csv rows are read whatever the separator is and the other lines are skipped",
+                    valid && rows.size() == 5 &&
+                    rows[0].size() == 2 && rows[0][1] == 1.5 &&
+                    rows[1].size() == 2 && rows[1][1] == 2. &&
+                    rows[2].size() == 2 && rows[2][1] == -300. &&
+                    rows[3].size() == 3 && rows[3][2] == 5. &&
+                    rows[4].size() == 2 && rows[4][0] == 4. && rows[4][1] == 0.25,
+                    testAssertionCount,
+                    errorCount);
+    
+    // more than a chunk : some lines are split between two chunks
+    for (i = 0; i < 200000; i++) {
+        
+        snprintf(line, sizeof(line), "%u,%u.5\n", i, i);
+        text += line;
+    }
+    
+    valid = TTScoreTestWriteFile(csvPath, text.c_str(), text.size()) && TTScoreTestReadRows(csvPath, TTSymbol("csv"), 0, rows);
+    
+    for (i = 0; i < rows.size() && valid; i++)
+        valid = rows[i].size() == 2 && rows[i][0] == i && rows[i][1] == i + 0.5;
+    
+    TTTestAssertion("the lines between two chunks are read",
+                    valid && rows.size() == 200000 && text.size() > TTCURVE_IMPORT_CHUNK_SIZE,
+                    testAssertionCount,
+                    errorCount);
+    
+    // 3 rows of 2 float32 columns then an incomplete row
+    for (i = 0; i < 7; i++)
+        floats.push_back(TTFloat32(i) * 0.5f);
+    
+    valid = TTScoreTestWriteFile(binaryPath, (const char*)&floats[0], floats.size() * sizeof(TTFloat32)) &&
+            TTScoreTestReadRows(binaryPath, TTSymbol("float32"), 2, rows);
+    
+    TTTestAssertion("the binary rows are read and an incomplete row is ignored",
+                    valid && rows.size() == 3 &&
+                    rows[0][0] == 0. && rows[0][1] == 0.5 &&
+                    rows[2][0] == 2. && rows[2][1] == 2.5,
+                    testAssertionCount,
+                    errorCount);
+    
+    TTTestAssertion("an unknown format is rejected",
+                    !TTScoreTestReadRows(binaryPath, TTSymbol("int16"), 2, rows),
+                    testAssertionCount,
+                    errorCount);
+    
+    remove(csvPath);
+    remove(binaryPath);
+}
+
+/** Check that an import keeps the shape of the data with a bounded number of points */
+static void TTScoreTestCurveImport(int& errorCount, int& testAssertionCount)
+{
+    const char*     path = "TTScoreTest.import.csv";
+    TTObject        curve("Curve");
+    TTValue         args, out;
+    TTErr           err;
+    std::string     text;
+    char            line[64];
+    TTUInt32        i, seed = 1;
+    
+    if (!curve.valid()) {
+        
+        TTTestLog("Curve class is not available : the import is not tested");
+        return;
+    }
+    
+    // a ramp with a row going back in time
+    for (i = 0; i <= 1000; i++) {
+        
+        snprintf(line, sizeof(line), "%u,%f\n", i == 500 ? 10 : i, i / 1000.);
+        text += line;
+    }
+    
+    if (!TTScoreTestWriteFile(path, text.c_str(), text.size())) {
+        
+        TTTestLog("the sample file can't be written : the import is not tested");
+        return;
+    }
+    
+    args = TTValue(TTSymbol(path));
+    err = curve.send("Import", args, out);
+    
+    TTTestAssertion("a ramp is imported with a point per record window",
+                    !err && out.size() == 2 && TTUInt64(out[0]) == 1000 && TTUInt32(out[1]) <= 2 + 1000 / TTCURVE_RECORD_WINDOW_MAX,
+                    testAssertionCount,
+                    errorCount);
+    
+    // noise : without tolerance nearly every row would be kept
+    text.clear();
+    for (i = 0; i < 4 * TTCURVE_IMPORT_POINTS_MAX; i++) {
+        
+        seed = seed * 1103515245 + 12345;
+        snprintf(line, sizeof(line), "%u,%u\n", i, (seed >> 16) & 0x7FFF);
+        text += line;
+    }
+    
+    TTScoreTestWriteFile(path, text.c_str(), text.size());
+    
+    args = TTValue(TTSymbol(path));
+    args.append(TTFloat64(0.));
+    err = curve.send("Import", args, out);
+    
+    TTTestAssertion("the points of noisy data are bounded",
+                    !err && out.size() == 2 && TTUInt64(out[0]) == 4 * TTCURVE_IMPORT_POINTS_MAX &&
+                    TTUInt32(out[1]) <= TTCURVE_IMPORT_POINTS_MAX + 1,
+                    testAssertionCount,
+                    errorCount);
+    
+    remove(path);
+}
+
+/** Check the curves sampled together are sampled like one by one */
+static void TTScoreTestCurveSampler(int& errorCount, int& testAssertionCount)
+{
+    std::vector<TTObject>   curves, references;
+    TTCurveSampler          sampler;
+    TTCurveSampler*         other = &sampler;
+    TTValue                 parameters, samples, expected;
+    TTUInt32                i, j, count = 2 * TTCURVE_SAMPLER_PARALLEL_CURVES;
+    TTBoolean               same = YES;
+    
+    // a ramp with another end for each curve
+    for (i = 0; i < count; i++) {
+        
+        TTObject curve("Curve"), reference("Curve");
+        
+        if (!curve.valid() || !reference.valid()) {
+            
+            TTTestLog("Curve class is not available : the sampler is not tested");
+            return;
+        }
+        
+        parameters = TTValue(TTFloat64(0.), TTFloat64(0.), TTFloat64(0.));
+        parameters.append(TTFloat64(1.));
+        parameters.append(TTFloat64(i));
+        parameters.append(TTFloat64(0.));
+        
+        curve.set("functionParameters", parameters);
+        reference.set("functionParameters", parameters);
+        
+        curves.push_back(curve);
+        references.push_back(reference);
+        
+        sampler.add(TTCurvePtr(curve.instance()), 1000 + i);
+    }
+    
+    sampler.run();
+    
+    for (i = 0; i < count && same; i++) {
+        
+        curves[i].send("Sample", TTUInt32(1000 + i), samples);
+        references[i].send("Sample", TTUInt32(1000 + i), expected);
+        
+        same = samples.size() > 0 && samples.size() == expected.size();
+        
+        for (j = 0; j < samples.size() && same; j++)
+            same = TTFloat64(samples[j]) == TTFloat64(expected[j]);
+    }
+    
+    TTTestAssertion("the curves sampled together are sampled like one by one",
+                    same && sampler.size() == 0,
+                    testAssertionCount,
+                    errorCount);
+    
+    // the current sampler of a loading thread is not the one of another thread
+    TTCurveSampler::setCurrent(&sampler);
+    std::thread([&other]() { other = TTCurveSampler::current(); }).join();
+    
+    TTTestAssertion("the current sampler is the one of the calling thread",
+                    TTCurveSampler::current() == &sampler && other == NULL,
+                    testAssertionCount,
+                    errorCount);
+    
+    TTCurveSampler::setCurrent(NULL);
+}
+
+void TTScoreTestCurve(int& errorCount, int& testAssertionCount)
+{
+    TTTestLog("\n");
+    TTTestLog("Testing curves");
+    
+    TTScoreTestCurveRecord(errorCount, testAssertionCount);
+    TTScoreTestCurveOverview(errorCount, testAssertionCount);
+    TTScoreTestCurveSampleFile(errorCount, testAssertionCount);
+    TTScoreTestCurveImport(errorCount, testAssertionCount);
+    TTScoreTestCurveSampler(errorCount, testAssertionCount);
+}
@@ -0,0 +1,224 @@
+/** @file
+ *
+ * @ingroup scoreLibrary
+ *
+ * @brief Unit test for the binary encoding tools
+ *
+ * @see TTScoreEncoding
+ *
+ * @authors Théo de la Hogue & Clément Bossut
+ *
+ * @copyright Copyright © 2013, Théo de la Hogue & Clément Bossut @n
+ * This code is licensed under the terms of the "CeCILL-C" @n
+ * http://www.cecill.info
+ */
+
+#include "TTScore.test.h"
+#include "TTScoreEncoding.h"
+
+#include <limits>
+#include <math.h>
+#include <string.h>
+
+/** Check the variable length integers */
+static void TTScoreTestEncodingVarint(int& errorCount, int& testAssertionCount)
+{
+    TTScoreBuffer   buffer;
+    TTUInt64        values[] = {0, 1, 127, 128, 300, 16383, 16384, 0xFFFFFFFF, 0xFFFFFFFFFFFFFFFFULL};
+    TTUInt32        i, count = sizeof(values) / sizeof(values[0]), offset = 0;
+    TTUInt64        value;
+    TTBoolean       valid = YES;
+    
+    for (i = 0; i < count; i++)
+        TTScoreBufferAppendVarint(buffer, values[i]);
+    
+    for (i = 0; i < count && valid; i++)
+        valid = TTScoreBufferReadVarint(buffer, offset, value) && value == values[i];
+    
+    TTTestAssertion("varints are read back",
+                    valid && offset == buffer.size(),
+                    testAssertionCount,
+                    errorCount);
+    
+    buffer.clear();
+    TTScoreBufferAppendVarint(buffer, 127);
+    TTScoreBufferAppendVarint(buffer, 128);
+    TTScoreBufferAppendVarint(buffer, 0xFFFFFFFFFFFFFFFFULL);
+    
+    TTTestAssertion("a varint takes one byte per 7 bits",
+                    buffer.size() == 1 + 2 + 10 &&
+                    buffer[0] == 0x7F &&
+                    buffer[1] == 0x80 && buffer[2] == 0x01,
+                    testAssertionCount,
+                    errorCount);
+    
+    // a truncated varint
+    buffer.resize(2);
+    offset = 1;
+    
+    TTTestAssertion("a truncated varint is not read",
+                    !TTScoreBufferReadVarint(buffer, offset, value),
+                    testAssertionCount,
+                    errorCount);
+}
+
+/** Check the raw and xor encoded floats */
+static void TTScoreTestEncodingFloat64(int& errorCount, int& testAssertionCount)
+{
+    TTScoreBuffer   raw, xored;
+    TTFloat64       values[] = {0., 0.25, 0.25, -0.25, 1., 127., 64., -0., 1e-300, 3.141592653589793,
+                                std::numeric_limits<TTFloat64>::infinity(), std::numeric_limits<TTFloat64>::quiet_NaN(), 0.1};
+    TTUInt32        i, count = sizeof(values) / sizeof(values[0]), offset;
+    TTUInt64        previous = 0;
+    TTFloat64       value;
+    TTBoolean       valid = YES;
+    
+    for (i = 0; i < count; i++) {
+        
+        TTScoreBufferAppendFloat64(raw, values[i]);
+        TTScoreBufferAppendFloat64Xor(xored, values[i], previous);
+    }
+    
+    offset = 0;
+    for (i = 0; i < count && valid; i++)
+        valid = TTScoreBufferReadFloat64(raw, offset, value) && !memcmp(&value, &values[i], sizeof(value));
+    
+    TTTestAssertion("raw floats are read back exactly",
+                    valid && raw.size() == count * 8,
+                    testAssertionCount,
+                    errorCount);
+    
+    offset = 0;
+    previous = 0;
+    for (i = 0; i < count && valid; i++)
+        valid = TTScoreBufferReadFloat64Xor(xored, offset, value, previous) && !memcmp(&value, &values[i], sizeof(value));
+    
+    TTTestAssertion("xor encoded floats are read back exactly (sign changes, infinity and nan included)",
+                    valid && offset == xored.size(),
+                    testAssertionCount,
+                    errorCount);
+    
+    // the sizes the encoding is made for
+    xored.clear();
+    previous = 0;
+    TTScoreBufferAppendFloat64Xor(xored, 0.5, previous);
+    offset = xored.size();
+    TTScoreBufferAppendFloat64Xor(xored, 0.5, previous);
+    
+    TTTestAssertion("a repeated float takes one byte",
+                    xored.size() - offset == 1,
+                    testAssertionCount,
+                    errorCount);
+    
+    offset = xored.size();
+    TTScoreBufferAppendFloat64Xor(xored, 100., previous);
+    TTScoreBufferAppendFloat64Xor(xored, 101., previous);
+    
+    TTTestAssertion("integer values take less than 4 bytes",
+                    xored.size() - offset < 8,
+                    testAssertionCount,
+                    errorCount);
+    
+    offset = xored.size();
+    TTScoreBufferAppendFloat64Xor(xored, TTFloat64(TTFloat32(0.7)), previous);
+    TTScoreBufferAppendFloat64Xor(xored, TTFloat64(TTFloat32(0.71)), previous);
+    
+    TTTestAssertion("32 bits float values take at most 6 bytes",
+                    xored.size() - offset <= 12,
+                    testAssertionCount,
+                    errorCount);
+    
+    offset = xored.size();
+    TTScoreBufferAppendFloat64Xor(xored, 3.141592653589793, previous);
+    TTScoreBufferAppendFloat64Xor(xored, -2.718281828459045, previous);
+    
+    TTTestAssertion("a float never takes more than 9 bytes",
+                    xored.size() - offset <= 18,
+                    testAssertionCount,
+                    errorCount);
+    
+    // a control byte announcing more than 8 bytes
+    xored.clear();
+    xored.push_back(0x72);
+    xored.insert(xored.end(), 8, 0);
+    offset = 0;
+    previous = 0;
+    
+    TTTestAssertion("an invalid control byte is not read",
+                    !TTScoreBufferReadFloat64Xor(xored, offset, value, previous),
+                    testAssertionCount,
+                    errorCount);
+    
+    xored.resize(3);
+    xored[0] = 0x40;
+    offset = 0;
+    valid = !TTScoreBufferReadFloat64Xor(xored, offset, value, previous);
+    offset = 0;
+    valid = valid && !TTScoreBufferReadFloat64(xored, offset, value);
+    
+    TTTestAssertion("a truncated float is not read",
+                    valid,
+                    testAssertionCount,
+                    errorCount);
+}
+
+/** Check the base64 conversion with the test vectors of the RFC 4648 */
+static void TTScoreTestEncodingBase64(int& errorCount, int& testAssertionCount)
+{
+    const char*     plain[] = {"", "f", "fo", "foo", "foob", "fooba", "foobar"};
+    const char*     encoded[] = {"", "Zg==", "Zm8=", "Zm9v", "Zm9vYg==", "Zm9vYmE=", "Zm9vYmFy"};
+    TTScoreBuffer   buffer, decoded;
+    TTString        text;
+    TTBoolean       valid = YES;
+    TTUInt32        i;
+    
+    for (i = 0; i < 7 && valid; i++) {
+        
+        buffer.assign(plain[i], plain[i] + strlen(plain[i]));
+        TTScoreBase64Encode(buffer, text);
+        
+        valid = text == encoded[i] && TTScoreBase64Decode(encoded[i], decoded) && decoded == buffer;
+    }
+    
+    TTTestAssertion("base64 test vectors are encoded and decoded",
+                    valid,
+                    testAssertionCount,
+                    errorCount);
+    
+    // all the byte values
+    buffer.clear();
+    for (i = 0; i < 256; i++)
+        buffer.push_back((unsigned char)i);
+    
+    TTScoreBase64Encode(buffer, text);
+    
+    TTTestAssertion("every byte is read back",
+                    TTScoreBase64Decode(text.c_str(), decoded) && decoded == buffer,
+                    testAssertionCount,
+                    errorCount);
+    
+    TTTestAssertion("white spaces are ignored",
+                    TTScoreBase64Decode(" Zm9v\n YmFy\r\n\t", decoded) &&
+                    decoded.size() == 6 && !memcmp(&decoded[0], "foobar", 6),
+                    testAssertionCount,
+                    errorCount);
+    
+    TTTestAssertion("invalid base64 is rejected",
+                    !TTScoreBase64Decode("Zm9", decoded) &&
+                    !TTScoreBase64Decode("Zm9v!", decoded) &&
+                    !TTScoreBase64Decode("Zg==Zm9v", decoded) &&
+                    !TTScoreBase64Decode("Z===", decoded) &&
+                    !TTScoreBase64Decode(NULL, decoded),
+                    testAssertionCount,
+                    errorCount);
+}
+
+void TTScoreTestEncoding(int& errorCount, int& testAssertionCount)
+{
+    TTTestLog("\n");
+    TTTestLog("Testing score encoding");
+    
+    TTScoreTestEncodingVarint(errorCount, testAssertionCount);
+    TTScoreTestEncodingFloat64(errorCount, testAssertionCount);
+    TTScoreTestEncodingBase64(errorCount, testAssertionCount);
+}
@@ -0,0 +1,195 @@
+/** @file
+ *
+ * @ingroup scoreLibrary
+ *
+ * @brief Unit test for the payloads shared in the score files
+ *
+ * @see TTScorePayloads
+ *
+ * @authors Théo de la Hogue & Clément Bossut
+ *
+ * @copyright Copyright © 2013, Théo de la Hogue & Clément Bossut @n
+ * This code is licensed under the terms of the "CeCILL-C" @n
+ * http://www.cecill.info
+ */
+
+#include "TTScore.test.h"
+#include "TTScorePayloads.h"
+
+#include <string.h>
+#include <thread>
+
+/** Check the formatting and the parsing of the keys */
+static void TTScoreTestPayloadsKey(int& errorCount, int& testAssertionCount)
+{
+    TTUInt64    keys[] = {1, 0x0123456789abcdefULL, 0xfedcba9876543210ULL, 0xFFFFFFFFFFFFFFFFULL};
+    TTUInt32    i, count = sizeof(keys) / sizeof(keys[0]);
+    TTUInt64    key;
+    char        text[17];
+    TTBoolean   valid = YES;
+    
+    for (i = 0; i < count && valid; i++) {
+        
+        TTScorePayloads::formatKey(keys[i], text);
+        valid = strlen(text) == 16 && TTScorePayloads::parseKey(text, key) && key == keys[i];
+    }
+    
+    TTTestAssertion("keys are parsed back",
+                    valid,
+                    testAssertionCount,
+                    errorCount);
+    
+    TTScorePayloads::formatKey(0x0123456789abcdefULL, text);
+    
+    TTTestAssertion("a key is formatted as 16 lower case hexadecimal digits",
+                    !strcmp(text, "0123456789abcdef"),
+                    testAssertionCount,
+                    errorCount);
+    
+    TTTestAssertion("invalid keys are rejected",
+                    !TTScorePayloads::parseKey(NULL, key) &&
+                    !TTScorePayloads::parseKey("", key) &&
+                    !TTScorePayloads::parseKey("0123456789abcde", key) &&
+                    !TTScorePayloads::parseKey("0123456789abcdef0", key) &&
+                    !TTScorePayloads::parseKey("0123456789ABCDEF", key) &&
+                    !TTScorePayloads::parseKey("0123456789abcdeg", key) &&
+                    !TTScorePayloads::parseKey(" 123456789abcdef", key) &&
+                    !TTScorePayloads::parseKey("0000000000000000", key),
+                    testAssertionCount,
+                    errorCount);
+}
+
+/** Check the canonical bytes of the values */
+static void TTScoreTestPayloadsContent(int& errorCount, int& testAssertionCount)
+{
+    std::string a, b;
+    
+    TTScorePayloads::appendValue(a, TTValue(TTFloat64(0.5), TTSymbol("foo"), TTUInt32(3)));
+    TTScorePayloads::appendValue(b, TTValue(TTFloat64(0.5), TTSymbol("foo"), TTUInt32(3)));
+    
+    TTTestAssertion("equal values give the same bytes",
+                    a == b,
+                    testAssertionCount,
+                    errorCount);
+    
+    a.clear();
+    b.clear();
+    TTScorePayloads::appendValue(a, TTValue(TTInt32(1)));
+    TTScorePayloads::appendValue(b, TTValue(TTFloat64(1.)));
+    
+    TTTestAssertion("the type of the elements is part of the bytes",
+                    a != b,
+                    testAssertionCount,
+                    errorCount);
+    
+    a.clear();
+    b.clear();
+    TTScorePayloads::appendValue(a, TTValue(TTSymbol("ab"), TTSymbol("c")));
+    TTScorePayloads::appendValue(b, TTValue(TTSymbol("a"), TTSymbol("bc")));
+    
+    TTTestAssertion("the symbols are delimited",
+                    a != b,
+                    testAssertionCount,
+                    errorCount);
+    
+    // the values of a payload are appended one after the other
+    a.clear();
+    b.clear();
+    TTScorePayloads::appendValue(a, TTValue(TTFloat64(1.), TTFloat64(2.)));
+    TTScorePayloads::appendValue(b, TTValue(TTFloat64(1.)));
+    TTScorePayloads::appendValue(b, TTValue(TTFloat64(2.)));
+    
+    TTTestAssertion("the size of the values is part of the bytes",
+                    a != b,
+                    testAssertionCount,
+                    errorCount);
+    
+    TTTestAssertion("only the large payloads are shared",
+                    !TTScorePayloads::shareable(std::string(TTSCORE_PAYLOAD_SHARED_SIZE - 1, 'x')) &&
+                    TTScorePayloads::shareable(std::string(TTSCORE_PAYLOAD_SHARED_SIZE, 'x')),
+                    testAssertionCount,
+                    errorCount);
+}
+
+/** Check the payloads written and read */
+static void TTScoreTestPayloadsShare(int& errorCount, int& testAssertionCount)
+{
+    TTScorePayloads payloads;
+    std::string     content, other;
+    TTUInt64        key, otherKey, sameKey;
+    TTObject        first("Curve"), second("Curve");
+    TTScorePayloads* otherCurrent = &payloads;
+    
+    TTScorePayloads::appendValue(content, TTValue(TTFloat64(0.), TTFloat64(1.), TTFloat64(0.5)));
+    TTScorePayloads::appendValue(other, TTValue(TTFloat64(0.), TTFloat64(1.), TTFloat64(0.25)));
+    
+    TTTestAssertion("a payload is written the first time",
+                    !payloads.written(content, key) && key != 0 &&
+                    !payloads.written(other, otherKey) && otherKey != 0 && otherKey != key,
+                    testAssertionCount,
+                    errorCount);
+    
+    TTTestAssertion("a payload written before is found with the same key",
+                    payloads.written(content, sameKey) && sameKey == key,
+                    testAssertionCount,
+                    errorCount);
+    
+    TTTestAssertion("a payload is not known before it is read",
+                    !payloads.holder(key).valid(),
+                    testAssertionCount,
+                    errorCount);
+    
+    if (first.valid() && second.valid()) {
+        
+        payloads.setHolder(key, first);
+        payloads.setHolder(key, second);
+        
+        TTTestAssertion("the first object read with a payload holds it",
+                        payloads.holder(key).instance() == first.instance() &&
+                        !payloads.holder(otherKey).valid(),
+                        testAssertionCount,
+                        errorCount);
+    }
+    else
+        TTTestLog("Curve class is not available : the holders are not tested");
+    
+    payloads.clear();
+    
+    TTTestAssertion("the payloads are forgotten when cleared",
+                    !payloads.written(content, sameKey) && sameKey == key &&
+                    !payloads.holder(key).valid(),
+                    testAssertionCount,
+                    errorCount);
+    
+    TTTestAssertion("the payloads are not shared out of a file writing or reading",
+                    TTScorePayloads::current() == NULL,
+                    testAssertionCount,
+                    errorCount);
+    
+    TTScorePayloads::setCurrent(&payloads);
+    
+    TTTestAssertion("the payloads of the file written or read are the current ones",
+                    TTScorePayloads::current() == &payloads,
+                    testAssertionCount,
+                    errorCount);
+    
+    // another thread writes or reads another file
+    std::thread([&otherCurrent]() { otherCurrent = TTScorePayloads::current(); }).join();
+    
+    TTTestAssertion("the current payloads are the ones of the calling thread",
+                    otherCurrent == NULL,
+                    testAssertionCount,
+                    errorCount);
+    
+    TTScorePayloads::setCurrent(NULL);
+}
+
+void TTScoreTestPayloads(int& errorCount, int& testAssertionCount)
+{
+    TTTestLog("\n");
+    TTTestLog("Testing score payloads");
+    
+    TTScoreTestPayloadsKey(errorCount, testAssertionCount);
+    TTScoreTestPayloadsContent(errorCount, testAssertionCount);
+    TTScoreTestPayloadsShare(errorCount, testAssertionCount);
+}
@@ -0,0 +1,419 @@
+/** @file
+ *
+ * @ingroup scoreLibrary
+ *
+ * @brief Unit test for the checks of the snapshot reader
+ *
+ * @see TTScoreSnapshot
+ *
+ * @authors Théo de la Hogue & Clément Bossut
+ *
+ * @copyright Copyright © 2013, Théo de la Hogue & Clément Bossut @n
+ * This code is licensed under the terms of the "CeCILL-C" @n
+ * http://www.cecill.info
+ */
+
+#include "TTScore.test.h"
+#include "TTScoreSnapshot.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+#define TTSCORE_TEST_SNAPSHOT_PATH "TTScoreTest.snapshot"
+
+/** Write a small snapshot and read it back into a buffer
+ @return                NO if the snapshot can't be written or read */
+static TTBoolean TTScoreTestSnapshotImage(TTScoreBuffer& image)
+{
+    TTScoreSnapshotWriter   writer;
+    TTScoreSnapshotEvent    event;
+    TTScoreSnapshotCurve    curve;
+    TTFloat64               points[] = {0., 0., 0.5, 1., 1., 0.};
+    TTUInt32                count;
+    FILE*                   file;
+    long                    size;
+    TTBoolean               read;
+    
+    memset(&event, 0, sizeof(event));
+    event.name = writer.addSymbol(TTSymbol("start"));
+    event.stateFirst = writer.addValue(TTValue(TTFloat64(0.5), TTSymbol("foo"), TTInt32(-3)), count);
+    event.stateCount = count;
+    writer.append(kTTScoreSnapshotEvents, event);
+    
+    memset(&curve, 0, sizeof(curve));
+    curve.address = writer.addSymbol(TTSymbol("/foo"));
+    curve.sampleFirst = writer.addFloats(points, 6);
+    curve.sampleCount = 6;
+    writer.append(kTTScoreSnapshotCurves, curve);
+    
+    if (writer.write(TTSCORE_TEST_SNAPSHOT_PATH))
+        return NO;
+    
+    file = fopen(TTSCORE_TEST_SNAPSHOT_PATH, "rb");
+    if (!file)
+        return NO;
+    
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    
+    image.resize(size > 0 ? size : 0);
+    read = size > 0 && fread(&image[0], size, 1, file) == 1;
+    
+    fclose(file);
+    remove(TTSCORE_TEST_SNAPSHOT_PATH);
+    
+    return read;
+}
+
+/** Write the first bytes of a snapshot image into a file
+ @return                NO if the file can't be written */
+static TTBoolean TTScoreTestSnapshotWrite(const TTScoreBuffer& image, TTUInt64 size)
+{
+    FILE*       file = fopen(TTSCORE_TEST_SNAPSHOT_PATH, "wb");
+    TTBoolean   written;
+    
+    if (!file)
+        return NO;
+    
+    written = size == 0 || fwrite(&image[0], size, 1, file) == 1;
+    
+    return fclose(file) == 0 && written;
+}
+
+/** Get the entry of a table into a snapshot image */
+static TTScoreSnapshotTableEntry& TTScoreTestSnapshotEntry(TTScoreBuffer& image, TTScoreSnapshotTable table)
+{
+    return ((TTScoreSnapshotTableEntry*)&image[sizeof(TTScoreSnapshotHeader)])[table];
+}
+
+/** Get the end of the last record of a snapshot image */
+static TTUInt64 TTScoreTestSnapshotEnd(TTScoreBuffer& image)
+{
+    TTUInt64 end = 0;
+    
+    for (TTUInt32 i = 0; i < kTTScoreSnapshotTableCount; i++) {
+        
+        TTScoreSnapshotTableEntry& entry = TTScoreTestSnapshotEntry(image, TTScoreSnapshotTable(i));
+        end = std::max(end, entry.offset + TTUInt64(entry.count) * entry.recordSize);
+    }
+    
+    return end;
+}
+
+/** Check a reader accepts the first bytes of a snapshot image once written into a file */
+static TTBoolean TTScoreTestSnapshotValid(const TTScoreBuffer& image, TTUInt64 size)
+{
+    TTScoreSnapshotReader   reader;
+    TTBoolean               valid;
+    
+    valid = TTScoreTestSnapshotWrite(image, size) && reader.open(TTSCORE_TEST_SNAPSHOT_PATH) == kTTErrNone;
+    
+    reader.close();
+    remove(TTSCORE_TEST_SNAPSHOT_PATH);
+    
+    return valid;
+}
+
+/** Check the reading of a valid snapshot */
+static void TTScoreTestSnapshotRead(int& errorCount, int& testAssertionCount)
+{
+    TTScoreBuffer           image;
+    TTScoreSnapshotReader   reader;
+    const TTFloat64*        points;
+    TTValue                 v;
+    TTUInt32                atoms;
+    
+    if (!TTScoreTestSnapshotImage(image) || !TTScoreTestSnapshotWrite(image, image.size())) {
+        
+        TTTestLog("the snapshot can't be written : the reader is not tested");
+        return;
+    }
+    
+    TTTestAssertion("a snapshot file is mapped",
+                    reader.open(TTSCORE_TEST_SNAPSHOT_PATH) == kTTErrNone &&
+                    reader.size(kTTScoreSnapshotEvents) == 1 &&
+                    reader.size(kTTScoreSnapshotCurves) == 1,
+                    testAssertionCount,
+                    errorCount);
+    
+    const TTScoreSnapshotEvent& event = reader.records<TTScoreSnapshotEvent>(kTTScoreSnapshotEvents)[0];
+    const TTScoreSnapshotCurve& curve = reader.records<TTScoreSnapshotCurve>(kTTScoreSnapshotCurves)[0];
+    
+    points = reader.floats(curve.sampleFirst, curve.sampleCount);
+    
+    TTTestAssertion("the symbols, the values and the floats are read back",
+                    reader.symbol(event.name) == TTSymbol("start") &&
+                    reader.symbol(curve.address) == TTSymbol("/foo") &&
+                    reader.value(event.stateFirst, event.stateCount, v) && v.size() == 3 &&
+                    TTFloat64(v[0]) == 0.5 && TTSymbol(v[1]) == TTSymbol("foo") && TTInt32(v[2]) == -3 &&
+                    points && points[2] == 0.5 && points[3] == 1.,
+                    testAssertionCount,
+                    errorCount);
+    
+    // the ranges at the bounds of the tables
+    atoms = reader.size(kTTScoreSnapshotAtoms);
+    
+    TTTestAssertion("the ranges inside a table are accepted",
+                    reader.contains(kTTScoreSnapshotAtoms, 0, atoms) &&
+                    reader.contains(kTTScoreSnapshotAtoms, atoms, 0) &&
+                    reader.floats(0, reader.size(kTTScoreSnapshotFloats)) != NULL,
+                    testAssertionCount,
+                    errorCount);
+    
+    TTTestAssertion("the ranges outside a table are rejected",
+                    !reader.contains(kTTScoreSnapshotAtoms, atoms, 1) &&
+                    !reader.contains(kTTScoreSnapshotAtoms, 1, atoms) &&
+                    !reader.contains(kTTScoreSnapshotAtoms, 1, 0xFFFFFFFF) &&
+                    !reader.contains(kTTScoreSnapshotAtoms, 0xFFFFFFFF, 2) &&
+                    !reader.value(atoms - 1, 2, v) &&
+                    reader.floats(curve.sampleFirst + 1, curve.sampleCount) == NULL &&
+                    reader.symbol(reader.size(kTTScoreSnapshotStrings)) == kTTSymEmpty,
+                    testAssertionCount,
+                    errorCount);
+    
+    reader.close();
+    remove(TTSCORE_TEST_SNAPSHOT_PATH);
+    
+    TTTestAssertion("a missing file is not read",
+                    reader.open(TTSCORE_TEST_SNAPSHOT_PATH) != kTTErrNone &&
+                    reader.size(kTTScoreSnapshotEvents) == 0,
+                    testAssertionCount,
+                    errorCount);
+    
+    // a frame of a journal
+    TTTestAssertion("a snapshot in memory is read in place",
+                    reader.open(&image[0], image.size()) == kTTErrNone &&
+                    reader.size(kTTScoreSnapshotEvents) == 1 &&
+                    reader.open(NULL, image.size()) != kTTErrNone,
+                    testAssertionCount,
+                    errorCount);
+}
+
+/** Check the header and the tables of a corrupted snapshot are rejected */
+static void TTScoreTestSnapshotCheck(int& errorCount, int& testAssertionCount)
+{
+    TTScoreBuffer               image, corrupted;
+    TTScoreSnapshotReader       reader;
+    TTScoreSnapshotHeader*      header;
+    TTBoolean                   valid;
+    
+    if (!TTScoreTestSnapshotImage(image))
+        return;
+    
+    TTTestAssertion("a truncated snapshot is rejected",
+                    TTScoreTestSnapshotValid(image, image.size()) &&
+                    !TTScoreTestSnapshotValid(image, TTScoreTestSnapshotEnd(image) - 1) &&
+                    !TTScoreTestSnapshotValid(image, sizeof(TTScoreSnapshotHeader)) &&
+                    !TTScoreTestSnapshotValid(image, 0),
+                    testAssertionCount,
+                    errorCount);
+    
+    // each field of the header
+    corrupted = image;
+    header = (TTScoreSnapshotHeader*)&corrupted[0];
+    header->magic++;
+    valid = TTScoreTestSnapshotValid(corrupted, corrupted.size());
+    
+    corrupted = image;
+    header = (TTScoreSnapshotHeader*)&corrupted[0];
+    header->version++;
+    valid = valid || TTScoreTestSnapshotValid(corrupted, corrupted.size());
+    
+    corrupted = image;
+    header = (TTScoreSnapshotHeader*)&corrupted[0];
+    header->endianness = 0x04030201;
+    valid = valid || TTScoreTestSnapshotValid(corrupted, corrupted.size());
+    
+    corrupted = image;
+    header = (TTScoreSnapshotHeader*)&corrupted[0];
+    header->tableCount--;
+    valid = valid || TTScoreTestSnapshotValid(corrupted, corrupted.size());
+    
+    TTTestAssertion("a snapshot with another header is rejected",
+                    !valid,
+                    testAssertionCount,
+                    errorCount);
+    
+    // the entries of the tables
+    corrupted = image;
+    TTScoreTestSnapshotEntry(corrupted, kTTScoreSnapshotCurves).recordSize += 4;
+    valid = TTScoreTestSnapshotValid(corrupted, corrupted.size());
+    
+    corrupted = image;
+    TTScoreTestSnapshotEntry(corrupted, kTTScoreSnapshotFloats).offset += 4;
+    valid = valid || TTScoreTestSnapshotValid(corrupted, corrupted.size());
+    
+    corrupted = image;
+    TTScoreTestSnapshotEntry(corrupted, kTTScoreSnapshotEvents).offset = corrupted.size() + 8;
+    valid = valid || TTScoreTestSnapshotValid(corrupted, corrupted.size());
+    
+    corrupted = image;
+    TTScoreTestSnapshotEntry(corrupted, kTTScoreSnapshotCurves).count++;
+    valid = valid || TTScoreTestSnapshotValid(corrupted, corrupted.size());
+    
+    corrupted = image;
+    TTScoreTestSnapshotEntry(corrupted, kTTScoreSnapshotAtoms).count = 0xFFFFFFFF;
+    valid = valid || TTScoreTestSnapshotValid(corrupted, corrupted.size());
+    
+    TTTestAssertion("a table outside the snapshot or with another record size is rejected",
+                    !valid,
+                    testAssertionCount,
+                    errorCount);
+    
+    // the strings table
+    corrupted = image;
+    TTScoreSnapshotTableEntry& strings = TTScoreTestSnapshotEntry(corrupted, kTTScoreSnapshotStrings);
+    corrupted[strings.offset + strings.count - 1] = 'x';
+    valid = TTScoreTestSnapshotValid(corrupted, corrupted.size());
+    
+    corrupted = image;
+    TTScoreTestSnapshotEntry(corrupted, kTTScoreSnapshotStrings).count = 0;
+    valid = valid || TTScoreTestSnapshotValid(corrupted, corrupted.size());
+    
+    TTTestAssertion("an empty or unterminated strings table is rejected",
+                    !valid,
+                    testAssertionCount,
+                    errorCount);
+    
+    // a rejected snapshot closes the reader
+    corrupted = image;
+    TTScoreTestSnapshotEntry(corrupted, kTTScoreSnapshotCurves).count++;
+    
+    if (TTScoreTestSnapshotWrite(image, image.size()))
+        reader.open(TTSCORE_TEST_SNAPSHOT_PATH);
+    
+    if (TTScoreTestSnapshotWrite(corrupted, corrupted.size()))
+        reader.open(TTSCORE_TEST_SNAPSHOT_PATH);
+    
+    remove(TTSCORE_TEST_SNAPSHOT_PATH);
+    
+    TTTestAssertion("a rejected snapshot gives no record",
+                    reader.size(kTTScoreSnapshotEvents) == 0 &&
+                    reader.size(kTTScoreSnapshotCurves) == 0 &&
+                    !reader.contains(kTTScoreSnapshotAtoms, 0, 1),
+                    testAssertionCount,
+                    errorCount);
+}
+
+/** Append a small frame to a journal */
+static TTBoolean TTScoreTestSnapshotAppend(const char* path, const char* name)
+{
+    TTScoreSnapshotWriter   writer;
+    TTScoreSnapshotRemoval  removal;
+    
+    removal.table = kTTScoreSnapshotEvents;
+    removal.name = writer.addSymbol(TTSymbol(name));
+    writer.append(kTTScoreSnapshotRemovals, removal);
+    
+    return writer.append(TTString(path)) == kTTErrNone;
+}
+
+/** Get the size of a file (-1 if it can't be opened) */
+static long TTScoreTestSnapshotFileSize(const char* path)
+{
+    FILE*   file = fopen(path, "rb");
+    long    size = -1;
+    
+    if (file) {
+        
+        if (fseek(file, 0, SEEK_END) == 0)
+            size = ftell(file);
+        
+        fclose(file);
+    }
+    
+    return size;
+}
+
+/** Check the frames of a journal and the repair of a damaged journal */
+static void TTScoreTestSnapshotJournal(int& errorCount, int& testAssertionCount)
+{
+    const char*                                     path = "TTScoreTest.journal";
+    TTScoreBuffer                                   data;
+    std::vector<std::pair<TTUInt64, TTUInt64> >     frames;
+    TTScoreSnapshotReader                           reader;
+    FILE*                                           file;
+    long                                            complete;
+    TTBoolean                                       damaged;
+    
+    remove(path);
+    
+    TTTestAssertion("a missing journal gives no frame",
+                    TTScoreSnapshotReadJournal(TTString(path), data, frames) == kTTErrValueNotFound &&
+                    frames.empty(),
+                    testAssertionCount,
+                    errorCount);
+    
+    if (!TTScoreTestSnapshotAppend(path, "first") || !TTScoreTestSnapshotAppend(path, "second")) {
+        
+        TTTestLog("the journal can't be written : the frames are not tested");
+        remove(path);
+        return;
+    }
+    
+    TTTestAssertion("the frames are read back in order",
+                    !TTScoreSnapshotReadJournal(TTString(path), data, frames) && frames.size() == 2 &&
+                    !reader.open(&data[frames[1].first], frames[1].second) &&
+                    reader.size(kTTScoreSnapshotRemovals) == 1 &&
+                    reader.symbol(reader.records<TTScoreSnapshotRemoval>(kTTScoreSnapshotRemovals)[0].name) == TTSymbol("second"),
+                    testAssertionCount,
+                    errorCount);
+    
+    reader.close();
+    complete = TTScoreTestSnapshotFileSize(path);
+    
+    // a frame half written by a crash
+    file = fopen(path, "ab");
+    if (file) {
+        
+        fwrite(&data[0], frames[0].first + 4, 1, file);
+        fclose(file);
+    }
+    
+    TTTestAssertion("a torn frame is ignored and cut from the journal",
+                    !TTScoreSnapshotReadJournal(TTString(path), data, frames) && frames.size() == 2 &&
+                    TTScoreTestSnapshotFileSize(path) == complete,
+                    testAssertionCount,
+                    errorCount);
+    
+    // a damaged byte in the second frame
+    file = fopen(path, "r+b");
+    if (file) {
+        
+        fseek(file, long(frames[1].first + frames[1].second - 1), SEEK_SET);
+        fputc(data[frames[1].first + frames[1].second - 1] ^ 0xFF, file);
+        fclose(file);
+    }
+    
+    damaged = !TTScoreSnapshotReadJournal(TTString(path), data, frames) && frames.size() == 1 &&
+              TTScoreTestSnapshotFileSize(path) == long(frames[0].first + frames[0].second);
+    
+    TTTestAssertion("a frame which doesn't match its checksum is cut with the next bytes",
+                    damaged,
+                    testAssertionCount,
+                    errorCount);
+    
+    TTTestAssertion("a frame is appended after the last complete one",
+                    damaged &&
+                    TTScoreTestSnapshotAppend(path, "third") &&
+                    !TTScoreSnapshotReadJournal(TTString(path), data, frames) && frames.size() == 2 &&
+                    !reader.open(&data[frames[1].first], frames[1].second) &&
+                    reader.symbol(reader.records<TTScoreSnapshotRemoval>(kTTScoreSnapshotRemovals)[0].name) == TTSymbol("third"),
+                    testAssertionCount,
+                    errorCount);
+    
+    reader.close();
+    TTScoreSnapshotRemoveJournal(TTString(path));
+}
+
+void TTScoreTestSnapshot(int& errorCount, int& testAssertionCount)
+{
+    TTTestLog("\n");
+    TTTestLog("Testing score snapshots");
+    
+    TTScoreTestSnapshotRead(errorCount, testAssertionCount);
+    TTScoreTestSnapshotCheck(errorCount, testAssertionCount);
+    TTScoreTestSnapshotJournal(errorCount, testAssertionCount);
+}
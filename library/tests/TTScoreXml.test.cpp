@@ -0,0 +1,308 @@
+/** @file
+ *
+ * @ingroup scoreLibrary
+ *
+ * @brief Unit test for the score xml attributes
+ *
+ * @see TTScoreXmlFormatter
+ *
+ * @authors Théo de la Hogue & Clément Bossut
+ *
+ * @copyright Copyright © 2013, Théo de la Hogue & Clément Bossut @n
+ * This code is licensed under the terms of the "CeCILL-C" @n
+ * http://www.cecill.info
+ */
+
+#include "TTScore.test.h"
+#include "TTScoreXmlFormatter.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+/** The score of the DemoApp (see implementations/DemoApp/DemoScenario.score) */
+static const char* sTTScoreTestDemoScenario =
+"<?xml version=\"1.0\" encoding=\"ISO-8859-1\" standalone=\"yes\"?>\n"
+"<jamoma version=\"0.6\" xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\" xsi:schemaLocation=\"http://jamoma.org/ file:jamoma.xsd\">\n"
+" <Scenario name=\"Demo Scenario\">\n"
+"  <startEvent name=\"start\" date=\"0u\"/>\n"
+"  <endEvent name=\"end\" date=\"36000000u\"/>\n"
+"  <event name=\"Start Fade In\" date=\"1000u\">\n"
+"   <command address=\"demo:/myParameter\">0</command>\n"
+"  </event>\n"
+"  <event name=\"End Fade In\" date=\"5000u\">\n"
+"   <command address=\"demo:/myParameter\">1</command>\n"
+"  </event>\n"
+"  <event name=\"Start Fade Out\" date=\"6000u\">\n"
+"   <command address=\"demo:/myParameter\">1</command>\n"
+"  </event>\n"
+"  <event name=\"End Fade Out\" date=\"10000u\">\n"
+"   <command address=\"demo:/myParameter\">0</command>\n"
+"  </event>\n"
+"  <Automation name=\"Fade In\" start=\"Start Fade In\" end=\"End Fade In\">\n"
+"   <indexedCurves address=\"demo:/myParameter\">\n"
+"    <curve active=\"1\" redundancy=\"0\" sampleRate=\"40u\" function=\"0.000000 0.000000 1.000000 1.000000 1.000000 1.000000\"/>\n"
+"   </indexedCurves>\n"
+"  </Automation>\n"
+"  <Interval name=\"Wait before to Fade Out\" start=\"End Fade In\" end=\"Start Fade Out\"/>\n"
+"  <Automation name=\"Fade Out\" start=\"Start Fade Out\" end=\"End Fade Out\">\n"
+"   <indexedCurves address=\"demo:/myParameter\">\n"
+"    <curve active=\"1\" redundancy=\"0\" sampleRate=\"40u\" function=\"0.000000 1.000000 1.000000 1.000000 0.000000 1.000000\"/>\n"
+"   </indexedCurves>\n"
+"  </Automation>\n"
+"  <condition name=\"Wait for a key\">\n"
+"    <case event=\"Start Fade Out\" trigger=\"demo:/myMessage == a\" default=\"1\"/>\n"
+"  </condition>\n"
+" </Scenario>\n"
+"</jamoma>\n";
+
+/** Read a whole text file
+ @return                an empty string if the file can't be read */
+static std::string TTScoreTestReadFile(const char* path)
+{
+    std::string text;
+    char        chunk[4096];
+    size_t      read;
+    FILE*       file = fopen(path, "rb");
+    
+    if (!file)
+        return text;
+    
+    while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0)
+        text.append(chunk, read);
+    
+    fclose(file);
+    return text;
+}
+
+/** Get the sorted dates of the events of a scenario */
+static void TTScoreTestEventDates(TTObject& aScenario, std::vector<TTUInt32>& dates)
+{
+    TTValue     events, v;
+    TTObject    anEvent;
+    
+    dates.clear();
+    aScenario.get("timeEvents", events);
+    
+    for (TTUInt32 i = 0; i < events.size(); i++) {
+        
+        anEvent = events[i];
+        anEvent.get("date", v);
+        
+        if (v.size() == 1)
+            dates.push_back(TTUInt32(v[0]));
+    }
+    
+    std::sort(dates.begin(), dates.end());
+}
+
+/** Check the parsing of the unsigned integer attributes */
+static void TTScoreTestXmlParse(int& errorCount, int& testAssertionCount)
+{
+    TTUInt32 value = 0;
+    
+    TTTestAssertion("parseUInt32 reads the unsigned suffix written by TTValue::toString",
+                    TTScoreXmlFormatter::parseUInt32("36000000u", value) && value == 36000000,
+                    testAssertionCount,
+                    errorCount);
+    
+    TTTestAssertion("parseUInt32 reads a zero date",
+                    TTScoreXmlFormatter::parseUInt32("0u", value) && value == 0,
+                    testAssertionCount,
+                    errorCount);
+    
+    TTTestAssertion("parseUInt32 reads the digits without suffix",
+                    TTScoreXmlFormatter::parseUInt32("40", value) && value == 40,
+                    testAssertionCount,
+                    errorCount);
+    
+    TTTestAssertion("parseUInt32 reads the biggest unsigned integer",
+                    TTScoreXmlFormatter::parseUInt32("4294967295u", value) && value == 4294967295U,
+                    testAssertionCount,
+                    errorCount);
+    
+    TTTestAssertion("parseUInt32 rejects what is not an unsigned integer",
+                    !TTScoreXmlFormatter::parseUInt32("", value) &&
+                    !TTScoreXmlFormatter::parseUInt32("u", value) &&
+                    !TTScoreXmlFormatter::parseUInt32("-1", value) &&
+                    !TTScoreXmlFormatter::parseUInt32("1.5", value) &&
+                    !TTScoreXmlFormatter::parseUInt32("12uu", value) &&
+                    !TTScoreXmlFormatter::parseUInt32("4294967296u", value),
+                    testAssertionCount,
+                    errorCount);
+}
+
+/** Check that the formatter writes each element as TTValue::toString does (except the floats, which are not rounded) */
+static void TTScoreTestXmlFormat(int& errorCount, int& testAssertionCount)
+{
+    TTScoreXmlFormatter aFormatter;
+    TTValue             v, expected;
+    std::string         text;
+    TTFloat64           floats[] = {0.1, 1. / 3., 123456789.123, 1e20, -2.5e-300, 0.};
+    TTUInt32            i, count = sizeof(floats) / sizeof(floats[0]);
+    TTBoolean           exact = YES;
+    
+    v.append(TTUInt32(40));
+    v.append(TTInt32(-3));
+    v.append(TTBoolean(YES));
+    v.append(TTSymbol("Demo Scenario"));
+    
+    expected = v;
+    expected.toString();
+    text = aFormatter.format(v);
+    
+    TTTestAssertion("format writes a value as TTValue::toString",
+                    text == TTSymbol(expected[0]).c_str(),
+                    testAssertionCount,
+                    errorCount);
+    
+    TTTestAssertion("format writes the unsigned suffix",
+                    std::string(aFormatter.format(TTUInt32(36000000))) == "36000000u",
+                    testAssertionCount,
+                    errorCount);
+    
+    TTTestAssertion("format writes the decimal point of an integral float",
+                    std::string(aFormatter.format(TTFloat64(1.))) == "1.0" &&
+                    std::string(aFormatter.format(TTFloat64(1e20))) == "1.0e+20" &&
+                    std::string(aFormatter.format(TTFloat64(0.25))) == "0.25",
+                    testAssertionCount,
+                    errorCount);
+    
+    for (i = 0; i < count && exact; i++) {
+        
+        expected.clear();
+        expected.append(TTSymbol(aFormatter.format(floats[i])));
+        expected.fromString();
+        
+        exact = expected.size() == 1 && expected[0].type() == kTypeFloat64 && TTFloat64(expected[0]) == floats[i];
+    }
+    
+    TTTestAssertion("format writes the floats read back exactly",
+                    exact,
+                    testAssertionCount,
+                    errorCount);
+    
+    TTTestAssertion("format writes a signed integer without suffix",
+                    std::string(aFormatter.format(TTInt32(-12))) == "-12",
+                    testAssertionCount,
+                    errorCount);
+    
+    // the readers infer the type of each element from the text
+    v.clear();
+    v.append(TTFloat64(0.));
+    v.append(TTFloat64(1.));
+    v.append(TTUInt32(40));
+    
+    expected.clear();
+    expected.append(TTSymbol(aFormatter.format(v)));
+    expected.fromString();
+    
+    TTTestAssertion("format reads back with the same types",
+                    expected.size() == 3 &&
+                    expected[0].type() == kTypeFloat64 &&
+                    expected[1].type() == kTypeFloat64 &&
+                    expected[2].type() == kTypeUInt32 &&
+                    TTUInt32(expected[2]) == 40,
+                    testAssertionCount,
+                    errorCount);
+}
+
+/** Read DemoScenario.score, write it, read the written file and write it again
+ @details the two written files have to be the same and the events have to be read each time */
+static void TTScoreTestXmlRoundTrip(int& errorCount, int& testAssertionCount)
+{
+    const char*             demoPath = "TTScoreTest.demo.score";
+    const char*             firstPath = "TTScoreTest.first.score";
+    const char*             secondPath = "TTScoreTest.second.score";
+    TTObject                xmlHandler("XmlHandler");
+    TTObject                original("Scenario");
+    TTObject                copy("Scenario");
+    TTValue                 out;
+    TTErr                   err;
+    std::vector<TTUInt32>   originalDates, copyDates;
+    std::string             first, second;
+    FILE*                   file;
+    
+    if (!xmlHandler.valid() || !original.valid() || !copy.valid()) {
+        
+        TTTestLog("XmlHandler or Scenario class is not available : the xml round trip is not tested");
+        return;
+    }
+    
+    file = fopen(demoPath, "wb");
+    if (!file) {
+        
+        TTTestLog("the DemoScenario can't be written : the xml round trip is not tested");
+        return;
+    }
+    
+    fputs(sTTScoreTestDemoScenario, file);
+    fclose(file);
+    
+    // read the demo then write it
+    xmlHandler.set("object", original);
+    err = xmlHandler.send("Read", TTSymbol(demoPath), out);
+    
+    TTTestAssertion("DemoScenario is read",
+                    !err,
+                    testAssertionCount,
+                    errorCount);
+    
+    TTScoreTestEventDates(original, originalDates);
+    
+    TTTestAssertion("the dates of DemoScenario events are read",
+                    std::find(originalDates.begin(), originalDates.end(), TTUInt32(1000)) != originalDates.end() &&
+                    std::find(originalDates.begin(), originalDates.end(), TTUInt32(10000)) != originalDates.end() &&
+                    originalDates.back() == 36000000,
+                    testAssertionCount,
+                    errorCount);
+    
+    xmlHandler.send("Write", TTSymbol(firstPath), out);
+    first = TTScoreTestReadFile(firstPath);
+    
+    TTTestAssertion("the written file keeps the types of the attributes",
+                    first.find("date=\"1000u\"") != std::string::npos &&
+                    first.find("sampleRate=\"40u\"") != std::string::npos &&
+                    first.find("function=\"0.0 0.0 1.0 1.0 1.0 1.0\"") != std::string::npos,
+                    testAssertionCount,
+                    errorCount);
+    
+    // read the written file then write it again
+    xmlHandler.set("object", copy);
+    err = xmlHandler.send("Read", TTSymbol(firstPath), out);
+    
+    TTTestAssertion("the written file is read",
+                    !err,
+                    testAssertionCount,
+                    errorCount);
+    
+    TTScoreTestEventDates(copy, copyDates);
+    
+    TTTestAssertion("the written file gives the same events",
+                    copyDates == originalDates,
+                    testAssertionCount,
+                    errorCount);
+    
+    xmlHandler.send("Write", TTSymbol(secondPath), out);
+    second = TTScoreTestReadFile(secondPath);
+    
+    TTTestAssertion("the written file is written again the same way",
+                    !first.empty() && first == second,
+                    testAssertionCount,
+                    errorCount);
+    
+    remove(demoPath);
+    remove(firstPath);
+    remove(secondPath);
+}
+
+void TTScoreTestXml(int& errorCount, int& testAssertionCount)
+{
+    TTTestLog("\n");
+    TTTestLog("Testing score xml attributes");
+    
+    TTScoreTestXmlParse(errorCount, testAssertionCount);
+    TTScoreTestXmlFormat(errorCount, testAssertionCount);
+    TTScoreTestXmlRoundTrip(errorCount, testAssertionCount);
+}